@@ -110,6 +110,8 @@ struct access_t
     {
         uint64_t     i_pos;     /* idem */
         bool         b_eof;     /* idem */
+        uint64_t     i_dropped; /* Packets lost before they could be read
+                                 * (e.g. receive buffer overflow) */
 
         bool         b_dir_sorted; /* Set it to true if items returned by
                                     * pf_readdir are already sorted. */
@@ -153,6 +155,7 @@ static inline void access_InitFields( access_t *p_a )
 {
     p_a->info.i_pos = 0;
     p_a->info.b_eof = false;
+    p_a->info.i_dropped = 0;
 }
 
 /**
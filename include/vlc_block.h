@@ -134,6 +134,9 @@ struct block_t
  *      with preheader and or body (increase
  *      and decrease are supported). Use it as it is optimised.
  * - block_Duplicate : create a copy of a block.
+ * - block_Share : create a block sharing the payload of another block,
+ *      without copying it if possible (copy-on-write).
+ * - block_Unshare : make the payload of a block private before writing to it.
  ****************************************************************************/
 VLC_API void block_Init( block_t *, void *, size_t );
 VLC_API block_t *block_Alloc( size_t ) VLC_USED VLC_MALLOC;
@@ -166,6 +169,23 @@ static inline void block_Release( block_t *p_block )
     p_block->pf_release( p_block );
 }
 
+VLC_API block_t *block_Share( block_t * ) VLC_USED;
+VLC_API block_t *block_Unshare( block_t * ) VLC_USED;
+
+/**
+ * Block allocator statistics (see block_GetStats()).
+ */
+typedef struct
+{
+    uint64_t i_alloc; /**< Blocks allocated with block_Alloc() */
+    uint64_t i_heap; /**< Blocks allocated from the heap (not recycled) */
+    uint64_t i_refill; /**< Thread cache refills from the global depot */
+    uint64_t i_flush; /**< Thread cache flushes to the global depot */
+    uint64_t i_cached; /**< Free blocks currently kept in the global depot */
+} block_stats_t;
+
+VLC_API void block_GetStats( block_stats_t * );
+
 VLC_API block_t *block_heap_Alloc(void *, size_t) VLC_USED VLC_MALLOC;
 VLC_API block_t *block_mmap_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
 VLC_API block_t * block_shm_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
@@ -341,4 +361,57 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 }
 #define vlc_fifo_CleanupPush(fifo) vlc_cleanup_push(vlc_fifo_Cleanup, fifo)
 
+/****************************************************************************
+ * Single producer, single consumer rings of blocks.
+ ****************************************************************************
+ * - block_RingNew : create a ring with a fixed number of slots, data limits
+ *      and an overflow policy
+ * - block_RingRelease : destroy a ring and free all blocks in it
+ * - block_RingPut : queue a block (producer only)
+ * - block_RingPace : wait until few enough blocks are queued (producer only)
+ * - block_RingFlush : discard all queued blocks (producer only)
+ * - block_RingGet : dequeue a block, if any (consumer only)
+ * - block_RingWait : wait for a block to be queued (consumer only)
+ * - block_RingWake : wake the consumer up from block_RingWait
+ * - block_RingCount/block_RingSize : how many blocks/bytes are queued
+ *
+ * No locks are taken to queue and dequeue blocks, so there must be no more
+ * than one thread queuing, and one thread dequeuing blocks.
+ * block_RingWait is the only cancellation point.
+ ****************************************************************************/
+
+typedef struct block_ring_t block_ring_t;
+
+/** Overflow policies of block rings */
+enum
+{
+    BLOCK_RING_DROP_OLDEST, /**< Discard the oldest blocks */
+    BLOCK_RING_DROP_NONREF, /**< Drop the new non-reference (B) frames */
+    BLOCK_RING_BLOCK, /**< Wait for the consumer */
+};
+
+/**
+ * Block ring statistics (see block_RingGetStats()).
+ */
+typedef struct
+{
+    uint64_t i_put; /**< Blocks queued */
+    uint64_t i_dropped; /**< Blocks dropped by the overflow policy */
+    uint64_t i_waits; /**< Times the producer waited for the consumer */
+} block_ring_stats_t;
+
+VLC_API block_ring_t *block_RingNew( size_t slots, size_t max_bytes,
+                                     mtime_t max_duration,
+                                     int overflow ) VLC_USED VLC_MALLOC;
+VLC_API void block_RingRelease( block_ring_t * );
+VLC_API int block_RingPut( block_ring_t *, block_t *, bool can_wait );
+VLC_API void block_RingPace( block_ring_t *, size_t depth );
+VLC_API void block_RingFlush( block_ring_t *, block_t *marker );
+VLC_API block_t *block_RingGet( block_ring_t * ) VLC_USED;
+VLC_API void block_RingWait( block_ring_t * );
+VLC_API void block_RingWake( block_ring_t * );
+VLC_API size_t block_RingCount( block_ring_t * ) VLC_USED;
+VLC_API size_t block_RingSize( block_ring_t * ) VLC_USED;
+VLC_API void block_RingGetStats( block_ring_t *, block_ring_stats_t * );
+
 #endif /* VLC_BLOCK_H */
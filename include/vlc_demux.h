@@ -182,6 +182,10 @@ enum demux_query_e
     DEMUX_NAV_DOWN,            /* res=can fail */
     DEMUX_NAV_LEFT,            /* res=can fail */
     DEMUX_NAV_RIGHT,           /* res=can fail */
+
+    /* Number of packets lost before they could be demuxed (e.g. receive
+     * buffer overflow), since the demux was opened */
+    DEMUX_GET_DROPPED,         /* arg1= uint64_t *     res=can fail */
 };
 
 VLC_API int demux_vaControlHelper( stream_t *, int64_t i_start, int64_t i_end, int64_t i_bitrate, int i_align, int i_query, va_list args );
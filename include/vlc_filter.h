@@ -260,6 +260,82 @@ VLC_API void filter_DeleteBlend( filter_t * );
         return p_outpic;                                                \
     }
 
+/**
+ * Maximum number of slices a plane is split into by filter_Slice().
+ */
+#define FILTER_SLICES_MAX 16
+
+/**
+ * Slice function of a video filter.
+ *
+ * It processes the lines [start, end) of a plane, and may read the lines
+ * [first, start) before, to prime a filter with vertical state. Slices of the
+ * same call run concurrently, each on a different index below
+ * FILTER_SLICES_MAX, so that it can be used to select scratch memory.
+ */
+typedef void (*filter_slice_t)( void *opaque, unsigned slice,
+                                int first, int start, int end );
+
+/**
+ * It runs a slice function over the lines of a plane.
+ *
+ * The plane is split in horizontal slices, run concurrently on the calling
+ * thread and on a pool of threads shared by all the filters of the instance.
+ * The number of slices is bounded by the "filter-threads" option. It returns
+ * once all the slices are done.
+ *
+ * \param lines number of lines of the plane
+ * \param align the slices start on multiples of align lines
+ * \param overlap number of lines before its start that a slice may read
+ */
+VLC_API void filter_Slice( filter_t *, filter_slice_t, void *opaque,
+                           int lines, unsigned align, unsigned overlap );
+
+typedef struct
+{
+    filter_t  *filter;
+    picture_t *src;
+    picture_t *dst;
+} filter_slice_pictures_t;
+
+/**
+ * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
+ * using a void (*)( filter_t *, picture_t *, picture_t *, unsigned, unsigned )
+ * function, called concurrently on ranges of pairs of input lines.
+ *
+ * Filters that also resize the picture are called on all the lines at once.
+ */
+#define VIDEO_FILTER_SLICE_WRAPPER( name )                              \
+    static void name ## _Slice( void *opaque, unsigned slice,          \
+                                int first, int start, int end )         \
+    {                                                                   \
+        filter_slice_pictures_t *p = opaque;                            \
+        VLC_UNUSED(slice); VLC_UNUSED(first);                           \
+        name( p->filter, p->src, p->dst, start, end );                  \
+    }                                                                   \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        const video_format_t *in = &p_filter->fmt_in.video;             \
+        const video_format_t *out = &p_filter->fmt_out.video;           \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( p_outpic )                                                  \
+        {                                                               \
+            if( in->i_width == out->i_width                             \
+             && in->i_height == out->i_height )                         \
+            {                                                           \
+                filter_slice_pictures_t p = { p_filter, p_pic, p_outpic }; \
+                filter_Slice( p_filter, name ## _Slice, &p,             \
+                              in->i_height, 2, 0 );                     \
+            }                                                           \
+            else                                                        \
+                name( p_filter, p_pic, p_outpic, 0, in->i_height );     \
+            picture_CopyProperties( p_outpic, p_pic );                  \
+        }                                                               \
+        picture_Release( p_pic );                                       \
+        return p_outpic;                                                \
+    }
+
 /**
  * Filter chain management API
  * The filter chain management API is used to dynamically construct filters
@@ -375,6 +451,58 @@ VLC_API picture_t *filter_chain_VideoFilter(filter_chain_t *chain,
  */
 VLC_API void filter_chain_VideoFlush( filter_chain_t * );
 
+/**
+ * Run each filter of a video filter chain on its own thread.
+ *
+ * Consecutive pictures are then processed by different filters at the same
+ * time. filter_chain_VideoFilter() queues its input picture and returns
+ * the first picture out of the chain, if any: the output lags behind the
+ * input by up to depth pictures per filter. The chain remains synchronous
+ * while it holds no filter.
+ *
+ * This must be called before the chain filters any picture.
+ *
+ * \param chain video filter chain
+ * \param depth maximum number of pictures waiting for each filter,
+ *              0 to filter synchronously (the default)
+ * \param ready callback invoked from any thread whenever a filtered picture
+ *              becomes available, or NULL
+ * \param opaque data for the callback
+ */
+VLC_API void filter_chain_SetPipeline(filter_chain_t *chain, unsigned depth,
+                                      void (*ready)(void *), void *opaque);
+
+/**
+ * Wait for the pictures being filtered by a video filter chain.
+ *
+ * \return the first picture out of the chain, or NULL if every picture
+ * given to the chain has been returned or dropped
+ */
+VLC_API picture_t *filter_chain_VideoDrain(filter_chain_t *chain);
+
+/**
+ * Statistics of a filter within a video filter chain.
+ */
+typedef struct
+{
+    unsigned queued; /**< Pictures waiting for the filter */
+    unsigned queued_max; /**< Most pictures ever waiting for the filter */
+    uint64_t pictures; /**< Pictures filtered */
+    mtime_t time; /**< Average time to filter a picture */
+    mtime_t time_max; /**< Longest time to filter a picture */
+} filter_chain_stats_t;
+
+/**
+ * Get the statistics of a filter of a video filter chain.
+ *
+ * \param chain video filter chain
+ * \param index position of the filter in the chain, from 0
+ * \param stats structure to fill
+ * \return VLC_SUCCESS, or VLC_EGENERIC if there is no such filter
+ */
+VLC_API int filter_chain_GetStats(filter_chain_t *chain, unsigned index,
+                                  filter_chain_stats_t *stats);
+
 /**
  * Apply the filter chain to a audio block.
  * \bug Deal with block chains and document.
@@ -119,4 +119,20 @@ VLC_API int vlc_dup( int );
 VLC_API int vlc_pipe( int[2] );
 VLC_API ssize_t vlc_write( int, const void *, size_t );
 VLC_API ssize_t vlc_writev( int, const struct iovec *, int );
+
+/**
+ * \defgroup aio Asynchronous file writing
+ * Writes to a regular file without waiting for the disk, using io_uring on
+ * Linux. vlc_aio_WriterNew() returns NULL where this is not supported.
+ * @{
+ */
+typedef struct vlc_aio_writer vlc_aio_writer_t;
+
+VLC_API vlc_aio_writer_t *vlc_aio_WriterNew( int fd, uint64_t offset ) VLC_USED;
+VLC_API void vlc_aio_WriterDelete( vlc_aio_writer_t * );
+VLC_API ssize_t vlc_aio_Write( vlc_aio_writer_t *, block_t * );
+VLC_API int vlc_aio_Sync( vlc_aio_writer_t * );
+VLC_API int vlc_aio_Seek( vlc_aio_writer_t *, uint64_t );
+VLC_API uint64_t vlc_aio_Tell( const vlc_aio_writer_t * ) VLC_USED;
+/** @} */
 #endif
@@ -145,6 +145,27 @@ VLC_API int httpd_StreamHeader( httpd_stream_t *, uint8_t *p_data, int i_data );
 VLC_API int httpd_StreamSend( httpd_stream_t *, const block_t *p_block );
 VLC_API int httpd_StreamSetHTTPHeaders(httpd_stream_t *, httpd_header *, size_t);
 
+/* what to do with the clients lagging more than the stream buffer size */
+enum
+{
+    HTTPD_BACKLOG_DROP,       /* skip to the last keyframe */
+    HTTPD_BACKLOG_DISCONNECT, /* close the connection */
+    HTTPD_BACKLOG_THROTTLE,   /* go on at the client pace while data is kept */
+};
+
+typedef struct
+{
+    uint64_t i_clients;     /* connections served */
+    uint64_t i_instant;     /* connections started at once on a keyframe */
+    uint64_t i_skips;       /* times a client skipped data */
+    uint64_t i_skipped;     /* bytes skipped */
+    uint64_t i_disconnects; /* clients disconnected for being too slow */
+} httpd_stream_stats_t;
+
+/* keep the last i_gops complete groups of pictures for new clients */
+VLC_API int httpd_StreamSetBacklog( httpd_stream_t *, unsigned i_gops, int i_policy );
+VLC_API void httpd_StreamGetStats( httpd_stream_t *, httpd_stream_stats_t * );
+
 /* Msg functions facilities */
 VLC_API void httpd_MsgAdd( httpd_message_t *, const char *psz_name, const char *psz_value, ... ) VLC_FORMAT( 3, 4 );
 /* return "" if not found. The string is not allocated */
@@ -337,6 +337,7 @@ struct input_stats_t
     /* Input */
     int64_t i_read_packets;
     int64_t i_read_bytes;
+    int64_t i_dropped_packets;
     float f_input_bitrate;
     float f_average_input_bitrate;
 
@@ -348,6 +349,14 @@ struct input_stats_t
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
 
+    /* Stream cache */
+    int64_t i_cache_hits;           /**< Seeks served by a cache track */
+    int64_t i_cache_misses;         /**< Seeks that needed an access seek */
+    int64_t i_readahead_hits;       /**< Reads served without waiting */
+    int64_t i_readahead_stalls;     /**< Reads that waited for the access */
+    int64_t i_readahead_stall_time; /**< Time waited for the access (us) */
+    int64_t i_readahead_misses;     /**< Seeks outside of the read-ahead */
+
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
@@ -142,6 +142,29 @@ VLC_API vlc_interrupt_t *vlc_interrupt_set(vlc_interrupt_t *);
  */
 VLC_API void vlc_interrupt_raise(vlc_interrupt_t *);
 
+/**
+ * Registers a custom interrupt handler for the calling thread, to wake it up
+ * from a wait which is not one of the interruptible sleep functions, such as
+ * a condition variable. If an interruption is already pending, the handler
+ * is invoked at once.
+ *
+ * @warning The handler is invoked with the lock of the interruption context
+ * held: it shall not wait for the calling thread.
+ *
+ * @param cb handler for the interruption
+ * @param opaque data pointer for the handler
+ * @note Must be paired with a call to vlc_interrupt_unregister().
+ */
+VLC_API void vlc_interrupt_register(void (*cb)(void *), void *opaque);
+
+/**
+ * Unregisters the interrupt handler of the calling thread, waiting for any
+ * pending invocation of it.
+ *
+ * @return EINTR if an interruption occurred, zero otherwise
+ */
+VLC_API int vlc_interrupt_unregister(void);
+
 /**
  * Marks the interruption context as "killed". This is not reversible.
  */
@@ -139,6 +139,9 @@ int net_Subscribe (vlc_object_t *obj, int fd, const struct sockaddr *addr,
 
 VLC_API int net_SetCSCov( int fd, int sendcov, int recvcov );
 
+VLC_API int net_RecvBlocks( int fd, block_t *const *blocks, unsigned count,
+                            uint32_t *drops );
+
 /* Functions to read from or write to the networking layer */
 struct virtual_socket_t
 {
@@ -51,12 +51,16 @@
 #else
 #   include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 #include <dirent.h>
 
 #include <vlc_common.h>
 #include "fs.h"
 #include <vlc_input.h>
 #include <vlc_access.h>
+#include <vlc_block.h>
 #include <vlc_dialog.h>
 #ifdef _WIN32
 # include <vlc_charset.h>
@@ -65,12 +69,20 @@
 #include <vlc_url.h>
 #include <vlc_interrupt.h>
 
+/* Size of the file mappings handed to the stream */
+#define MMAP_WINDOW (1 << 20)
+
 struct access_sys_t
 {
     int fd;
 
     bool b_pace_control;
     uint64_t size;
+#ifdef HAVE_MMAP
+    uint64_t page_mask;
+    uint64_t mapped; /* End of the last mapped window */
+    bool b_mmap; /* Cleared once the file shrank below a mapping */
+#endif
 };
 
 #if !defined (_WIN32) && !defined (__OS2__)
@@ -128,8 +140,14 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t FileRead (access_t *, uint8_t *, size_t);
+#ifdef HAVE_MMAP
+static block_t *FileBlock (access_t *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static ssize_t StreamRead (access_t *, uint8_t *, size_t);
 static int NoSeek (access_t *, uint64_t);
@@ -227,6 +245,21 @@ int FileOpen( vlc_object_t *p_this )
         p_access->pf_seek = FileSeek;
         p_sys->b_pace_control = true;
         p_sys->size = st.st_size;
+#ifdef HAVE_MMAP
+        /* Local regular files can be mapped rather than copied by read().
+         * A remote file could be truncated behind our back (SIGBUS). */
+        if (S_ISREG (st.st_mode)
+         && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = FileBlock;
+            p_sys->page_mask = sysconf (_SC_PAGE_SIZE) - 1;
+            p_sys->mapped = 0;
+            p_sys->b_mmap = true;
+            msg_Dbg (p_access, "mapping file in memory");
+        }
+#endif
 
         /* Demuxers will need the beginning of the file for probing. */
         posix_fadvise (fd, 0, 4096, POSIX_FADV_WILLNEED);
@@ -264,7 +297,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_read == NULL && p_access->pf_block == NULL)
     {
         DirClose (p_this);
         return;
@@ -298,6 +331,95 @@ static ssize_t FileRead (access_t *p_access, uint8_t *p_buffer, size_t i_len)
 }
 
 
+#ifdef HAVE_MMAP
+/**
+ * Reads the next window of a regular file into a block.
+ */
+static block_t *FileBlockRead (access_t *p_access, size_t length)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    block_t *block = block_Alloc (length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    ssize_t val = pread (p_sys->fd, block->p_buffer, length,
+                         p_access->info.i_pos);
+    if (val <= 0)
+    {
+        if (val < 0)
+            msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        block_Release (block);
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+    block->i_buffer = val;
+    p_access->info.i_pos += val;
+    return block;
+}
+
+/**
+ * Maps the next window of a local regular file.
+ */
+static block_t *FileBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    uint64_t pos = p_access->info.i_pos;
+    struct stat st;
+
+    /* Touching pages mapped past the end of the file raises SIGBUS, so the
+     * size is checked before each window. If the file ever shrinks below a
+     * mapping, it is not mapped anymore: the blocks already handed out
+     * cannot be fixed, but the following ones are safe. */
+    if (fstat (p_sys->fd, &st))
+        p_sys->b_mmap = false;
+    else
+    {
+        if ((uint64_t)st.st_size < p_sys->mapped && p_sys->b_mmap)
+        {
+            msg_Warn (p_access, "file truncated, not mapping it anymore");
+            p_sys->b_mmap = false;
+        }
+        p_sys->size = st.st_size;
+    }
+
+    if (pos >= p_sys->size)
+    {
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    /* The mapping starts on a page boundary, before the payload */
+    uint64_t offset = pos & ~p_sys->page_mask;
+    size_t skip = pos - offset;
+    size_t length = __MIN(p_sys->size - pos, MMAP_WINDOW);
+
+    if (!p_sys->b_mmap)
+        return FileBlockRead (p_access, length);
+
+    /* Writable private mapping: decoders may modify the data in place */
+    void *addr = mmap (NULL, skip + length, PROT_READ|PROT_WRITE,
+                       MAP_PRIVATE, p_sys->fd, offset);
+    if (addr == MAP_FAILED)
+        /* Fall back to reading, e.g. for files that cannot be mapped */
+        return FileBlockRead (p_access, length);
+
+    posix_madvise (addr, skip + length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, skip + length, POSIX_MADV_WILLNEED);
+    /* Start reading the next window from the disk already */
+    posix_fadvise (p_sys->fd, pos + length, MMAP_WINDOW, POSIX_FADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc (addr, skip + length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    block->p_buffer += skip;
+    block->i_buffer = length;
+    p_access->info.i_pos += length;
+    p_sys->mapped = __MAX(p_sys->mapped, pos + length);
+    return block;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
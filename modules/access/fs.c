@@ -30,6 +30,13 @@
 #include "fs.h"
 #include <vlc_plugin.h>
 
+#define MMAP_TEXT N_("Map local files in memory")
+#define MMAP_LONGTEXT N_( \
+    "Read local files through memory mappings instead of copying them. " \
+    "Files on network file systems are always read normally. " \
+    "Mapped files are not read ahead by the stream cache, and truncating " \
+    "a file while it is being played may crash VLC." )
+
 vlc_module_begin ()
     set_description( N_("File input") )
     set_shortname( N_("File") )
@@ -39,6 +46,7 @@ vlc_module_begin ()
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
+    add_bool( "file-mmap", false, MMAP_TEXT, MMAP_LONGTEXT, true )
 
     add_submodule()
     set_section( N_("Directory" ), NULL )
@@ -95,6 +95,18 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+/** Maximum number of datagrams received at once */
+#define RTP_BATCH 8
+
+static void rtp_batch_release (void *data)
+{
+    block_t **pkts = data;
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (pkts[i] != NULL)
+            block_Release (pkts[i]);
+}
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -104,11 +116,13 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
+    block_t *pkts[RTP_BATCH] = { NULL };
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+    vlc_cleanup_push (rtp_batch_release, pkts);
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -125,22 +139,45 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
-            block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
-            if (unlikely(block == NULL))
+            unsigned count = 0;
+            while (count < RTP_BATCH)
+            {
+                if (pkts[count] == NULL)
+                {
+                    pkts[count] = block_Alloc (0xffff); /* TODO: p_sys->mru */
+                    if (unlikely(pkts[count] == NULL))
+                        break;
+                }
+                pkts[count++]->i_buffer = 0xffff;
+            }
+            if (unlikely(count == 0))
                 break; /* we are totallly screwed */
 
-            ssize_t len = recv (rtp_fd, block->p_buffer, block->i_buffer, 0);
-            if (len != -1)
+            uint32_t drops = sys->kernel_drops;
+            int received = net_RecvBlocks (rtp_fd, pkts, count, &drops);
+            if (received != -1)
             {
-                block->i_buffer = len;
-                rtp_process (demux, block);
+                if (drops != sys->kernel_drops)
+                {
+                    uint32_t lost = drops - sys->kernel_drops;
+
+                    msg_Warn (demux, "%"PRIu32" RTP packet(s) dropped by "
+                              "the kernel", lost);
+                    /* reported in the input statistics */
+                    atomic_fetch_add (&sys->dropped, lost);
+                    sys->kernel_drops = drops;
+                }
+
+                for (int i = 0; i < received; i++)
+                    rtp_process (demux, pkts[i]);
+                memmove (pkts, pkts + received,
+                         (RTP_BATCH - received) * sizeof (*pkts));
+                memset (pkts + RTP_BATCH - received, 0,
+                        received * sizeof (*pkts));
             }
             else
-            {
                 msg_Warn (demux, "RTP network error: %s",
                           vlc_strerror_c(errno));
-                block_Release (block);
-            }
         }
 
     dequeue:
@@ -148,6 +185,7 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TS_INVALID;
         vlc_restorecancel (canc);
     }
+    vlc_cleanup_run ();
     return NULL;
 }
 
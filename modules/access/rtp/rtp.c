@@ -265,6 +265,8 @@ static int Open (vlc_object_t *obj)
     p_sys->max_dropout  = var_CreateGetInteger (obj, "rtp-max-dropout");
     p_sys->max_misorder = var_CreateGetInteger (obj, "rtp-max-misorder");
     p_sys->thread_ready = false;
+    p_sys->kernel_drops = 0;
+    atomic_init (&p_sys->dropped, 0);
     p_sys->autodetect   = true;
 
     demux->pf_demux   = NULL;
@@ -393,6 +395,13 @@ static int Control (demux_t *demux, int query, va_list args)
             *v = false;
             return VLC_SUCCESS;
         }
+
+        case DEMUX_GET_DROPPED:
+        {
+            uint64_t *v = va_arg (args, uint64_t *);
+            *v = atomic_load (&sys->dropped);
+            return VLC_SUCCESS;
+        }
     }
 
     if (sys->chained_demux != NULL)
@@ -20,6 +20,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  ****************************************************************************/
 
+#include <vlc_atomic.h>
+
 typedef struct rtp_pt_t rtp_pt_t;
 typedef struct rtp_session_t rtp_session_t;
 
@@ -69,6 +71,8 @@ struct demux_sys_t
     int           fd;
     int           rtcp_fd;
     vlc_thread_t  thread;
+    uint32_t      kernel_drops; /**< Kernel drop counter (thread only) */
+    atomic_uint_least64_t dropped; /**< Packets dropped by the kernel */
 
     mtime_t       timeout;
     uint16_t      max_dropout; /**< Max packet forward misordering */
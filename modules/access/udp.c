@@ -47,6 +47,9 @@
 
 #define MTU 65535
 
+/* Maximum number of datagrams received at once */
+#define BATCH 16
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -78,6 +81,8 @@ struct access_sys_t
     block_fifo_t *fifo;
     vlc_sem_t semaphore;
     vlc_thread_t thread;
+    uint64_t dropped; /**< Datagrams dropped (protected by the FIFO lock) */
+    uint32_t kernel_drops; /**< Kernel drop counter (reader thread only) */
 };
 
 /*****************************************************************************
@@ -179,6 +184,8 @@ static int Open( vlc_object_t *p_this )
     }
 
     sys->fifo_size = var_InheritInteger( p_access, "udp-buffer");
+    sys->dropped = 0;
+    sys->kernel_drops = 0;
     vlc_sem_init( &sys->semaphore, 0 );
 
     if( vlc_clone( &sys->thread, ThreadRead, p_access,
@@ -254,7 +261,10 @@ static block_t *BlockUDP( access_t *p_access )
 
     vlc_sem_wait_i11e(&sys->semaphore);
     vlc_fifo_Lock(sys->fifo);
-    block = vlc_fifo_DequeueUnlocked(sys->fifo);
+    /* The semaphore is posted once per batch of datagrams: dequeue them all.
+     * This may leave the FIFO empty for a later post (no data yet). */
+    block = vlc_fifo_DequeueAllUnlocked(sys->fifo);
+    p_access->info.i_dropped = sys->dropped;
     vlc_fifo_Unlock(sys->fifo);
 
     return block;
@@ -263,50 +273,90 @@ static block_t *BlockUDP( access_t *p_access )
 /*****************************************************************************
  * ThreadRead: Pull packets from socket as soon as possible.
  *****************************************************************************/
+static void ReleaseBatch( void *data )
+{
+    block_t **pkts = data;
+
+    for (unsigned i = 0; i < BATCH; i++)
+        if (pkts[i] != NULL)
+            block_Release(pkts[i]);
+}
+
 static void* ThreadRead( void *data )
 {
     access_t *access = data;
     access_sys_t *sys = access->p_sys;
+    block_t *pkts[BATCH] = { NULL };
 
+    vlc_cleanup_push(ReleaseBatch, pkts);
     for(;;)
     {
-        block_t *pkt = block_Alloc(MTU);
-        if (unlikely(pkt == NULL))
+        unsigned count = 0;
+
+        /* Allocate blocks for the next batch */
+        while (count < BATCH)
+        {
+            if (pkts[count] == NULL)
+            {
+                pkts[count] = block_Alloc(MTU);
+                if (unlikely(pkts[count] == NULL))
+                    break;
+            }
+            pkts[count++]->i_buffer = MTU;
+        }
+
+        if (unlikely(count == 0))
         {   /* OOM - dequeue and discard one packet */
             char dummy;
             recv(sys->fd, &dummy, 1, 0);
             continue;
         }
 
-        ssize_t len;
+        uint32_t drops = sys->kernel_drops;
+        int n;
 
-        block_cleanup_push(pkt);
         do
         {
 #ifndef LIBVLC_USE_PTHREAD
             struct pollfd ufd = { .fd = sys->fd, .events = POLLIN };
             while (poll(&ufd, 1, -1) <= 0); /* cancellation point */
 #endif
-            len = recv(sys->fd, pkt->p_buffer, MTU, 0);
+            n = net_RecvBlocks(sys->fd, pkts, count, &drops);
         }
-        while (len == -1);
-        vlc_cleanup_pop();
+        while (n == -1);
 
-        pkt->i_buffer = len;
+        /* Chain the received datagrams, keep the other blocks for later */
+        block_t *chain = NULL, **pp = &chain;
+        size_t len = 0;
 
+        for (int i = 0; i < n; i++)
+        {
+            len += pkts[i]->i_buffer;
+            *pp = pkts[i];
+            pp = &pkts[i]->p_next;
+        }
+        memmove(pkts, pkts + n, (BATCH - n) * sizeof (*pkts));
+        memset(pkts + BATCH - n, 0, n * sizeof (*pkts));
+
+        int canc = vlc_savecancel();
         vlc_fifo_Lock(sys->fifo);
+        sys->dropped += (uint32_t)(drops - sys->kernel_drops);
+        sys->kernel_drops = drops;
+
         /* Discard old buffers on overflow */
-        while (vlc_fifo_GetBytes(sys->fifo) + len > sys->fifo_size)
+        while (vlc_fifo_GetBytes(sys->fifo) + len > sys->fifo_size
+            && !vlc_fifo_IsEmpty(sys->fifo))
         {
-            int canc = vlc_savecancel();
             block_Release(vlc_fifo_DequeueUnlocked(sys->fifo));
-            vlc_restorecancel(canc);
+            sys->dropped++;
         }
 
-        vlc_fifo_QueueUnlocked(sys->fifo, pkt);
+        vlc_fifo_QueueUnlocked(sys->fifo, chain);
         vlc_fifo_Unlock(sys->fifo);
         vlc_sem_post(&sys->semaphore);
+        vlc_restorecancel(canc);
     }
+    vlc_cleanup_pop();
 
     return NULL;
 }
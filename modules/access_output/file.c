@@ -184,6 +184,48 @@ static ssize_t Send(sout_access_out_t *access, block_t *block)
 }
 #endif
 
+/*****************************************************************************
+ * Asynchronous writing to a regular file
+ *****************************************************************************/
+struct sout_access_out_sys_t
+{
+    int fd;
+    vlc_aio_writer_t *aio;
+};
+
+static ssize_t ReadAsync( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    uint64_t i_pos = vlc_aio_Tell( p_sys->aio );
+
+    if( vlc_aio_Sync( p_sys->aio )
+     || lseek( p_sys->fd, i_pos, SEEK_SET ) == (off_t)-1 )
+        return -1;
+
+    ssize_t val = read( p_sys->fd, p_buffer->p_buffer, p_buffer->i_buffer );
+    if( val > 0 )
+        vlc_aio_Seek( p_sys->aio, i_pos + val );
+    return val;
+}
+
+static ssize_t WriteAsync( sout_access_out_t *p_access, block_t *p_buffer )
+{
+    ssize_t val = vlc_aio_Write( p_access->p_sys->aio, p_buffer );
+    if( val < 0 )
+        msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+    return val;
+}
+
+static int SeekAsync( sout_access_out_t *p_access, off_t i_pos )
+{
+    if( vlc_aio_Seek( p_access->p_sys->aio, i_pos ) )
+    {
+        msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+        return -1;
+    }
+    return 0;
+}
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
@@ -212,7 +254,7 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
         case ACCESS_OUT_CAN_SEEK:
         {
             bool *pb = va_arg( args, bool * );
-            *pb = p_access->pf_seek == Seek;
+            *pb = p_access->pf_seek == Seek || p_access->pf_seek == SeekAsync;
             break;
         }
 
@@ -224,6 +266,7 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 
 static const char *const ppsz_sout_options[] = {
     "append",
+    "async",
     "format",
     "overwrite",
 #ifdef O_SYNC
@@ -364,6 +407,31 @@ static int Open( vlc_object_t *p_this )
     if (append)
         lseek (fd, 0, SEEK_END);
 
+    /* Regular files can be written without waiting for the disk */
+    if (S_ISREG(st.st_mode) && var_GetBool (p_access, SOUT_CFG_PREFIX"async")
+#ifdef O_SYNC
+     && !var_GetBool (p_access, SOUT_CFG_PREFIX"sync")
+#endif
+       )
+    {
+        sout_access_out_sys_t *p_sys = malloc (sizeof (*p_sys));
+        if (unlikely(p_sys == NULL))
+            return VLC_SUCCESS;
+
+        p_sys->aio = vlc_aio_WriterNew (fd, lseek (fd, 0, SEEK_CUR));
+        if (p_sys->aio == NULL)
+        {
+            free (p_sys);
+            return VLC_SUCCESS;
+        }
+        p_sys->fd = fd;
+        p_access->pf_read = ReadAsync;
+        p_access->pf_write = WriteAsync;
+        p_access->pf_seek = SeekAsync;
+        p_access->p_sys = p_sys;
+        msg_Dbg (p_access, "writing asynchronously");
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -374,7 +442,18 @@ static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
 
-    close( (intptr_t)p_access->p_sys );
+    if( p_access->pf_write == WriteAsync )
+    {
+        sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+        if( vlc_aio_Sync( p_sys->aio ) )
+            msg_Err( p_access, "cannot write: %s", vlc_strerror_c(errno) );
+        vlc_aio_WriterDelete( p_sys->aio );
+        close( p_sys->fd );
+        free( p_sys );
+    }
+    else
+        close( (intptr_t)p_access->p_sys );
 
     msg_Dbg( p_access, "file access output closed" );
 }
@@ -390,6 +469,9 @@ static void Close( vlc_object_t * p_this )
     "on the file path")
 #define SYNC_TEXT N_("Synchronous writing")
 #define SYNC_LONGTEXT N_( "Open the file with synchronous writing.")
+#define ASYNC_TEXT N_("Asynchronous writing")
+#define ASYNC_LONGTEXT N_( "Write regular files in the background, in " \
+    "large chunks, where the operating system supports it.")
 
 vlc_module_begin ()
     set_description( N_("File stream output") )
@@ -404,6 +486,8 @@ vlc_module_begin ()
               true )
     add_bool( SOUT_CFG_PREFIX "format", false, FORMAT_TEXT, FORMAT_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "async", true, ASYNC_TEXT, ASYNC_LONGTEXT,
+              true )
 #ifdef O_SYNC
     add_bool( SOUT_CFG_PREFIX "sync", false, SYNC_TEXT,SYNC_LONGTEXT,
               false )
@@ -61,6 +61,19 @@ static void Close( vlc_object_t * );
 #define METACUBE_TEXT N_("Metacube")
 #define METACUBE_LONGTEXT N_("Use the Metacube protocol. Needed for streaming " \
                              "to the Cubemap reflector.")
+#define GOPS_TEXT N_("Cached groups of pictures")
+#define GOPS_LONGTEXT N_("Number of complete groups of pictures kept in " \
+                         "memory. New clients start at once on the last " \
+                         "keyframe, slow clients can lag that far behind.")
+#define BACKLOG_TEXT N_("Slow clients")
+#define BACKLOG_LONGTEXT N_("What to do with the clients that fall behind " \
+                            "the cached groups of pictures: skip to the last " \
+                            "keyframe, disconnect them, or let them go at " \
+                            "their own pace while the data is kept.")
+
+static const char *const ppsz_backlog[] = { "drop", "disconnect", "throttle" };
+static const char *const ppsz_backlog_text[] = {
+    N_("Skip to the last keyframe"), N_("Disconnect"), N_("Throttle") };
 
 
 vlc_module_begin ()
@@ -78,6 +91,11 @@ vlc_module_begin ()
                 MIME_TEXT, MIME_LONGTEXT, true )
     add_bool( SOUT_CFG_PREFIX "metacube", false,
               METACUBE_TEXT, METACUBE_LONGTEXT, true )
+    add_integer_with_range( SOUT_CFG_PREFIX "gops", 2, 1, 16,
+                            GOPS_TEXT, GOPS_LONGTEXT, true )
+    add_string( SOUT_CFG_PREFIX "backlog", "drop",
+                BACKLOG_TEXT, BACKLOG_LONGTEXT, true )
+        change_string_list( ppsz_backlog, ppsz_backlog_text )
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -86,7 +104,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "user", "pwd", "mime", "metacube", NULL
+    "user", "pwd", "mime", "metacube", "gops", "backlog", NULL
 };
 
 static ssize_t Write( sout_access_out_t *, block_t * );
@@ -275,6 +293,22 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    char *psz_backlog = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "backlog" );
+    int i_backlog = HTTPD_BACKLOG_DROP;
+    if( psz_backlog && !strcmp( psz_backlog, "disconnect" ) )
+        i_backlog = HTTPD_BACKLOG_DISCONNECT;
+    else if( psz_backlog && !strcmp( psz_backlog, "throttle" ) )
+        i_backlog = HTTPD_BACKLOG_THROTTLE;
+    free( psz_backlog );
+    httpd_StreamSetBacklog( p_sys->p_httpd_stream,
+                            var_GetInteger( p_access, SOUT_CFG_PREFIX "gops" ),
+                            i_backlog );
+
+    var_Create( p_access, "http-clients", VLC_VAR_INTEGER );
+    var_Create( p_access, "http-skips", VLC_VAR_INTEGER );
+    var_Create( p_access, "http-skipped-bytes", VLC_VAR_INTEGER );
+    var_Create( p_access, "http-disconnects", VLC_VAR_INTEGER );
+
     if( p_sys->b_metacube )
     {
         httpd_header headers[] = {{ "Content-encoding", "metacube" }};
@@ -305,6 +339,13 @@ static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t       *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t   *p_sys = p_access->p_sys;
+    httpd_stream_stats_t     stats;
+
+    httpd_StreamGetStats( p_sys->p_httpd_stream, &stats );
+    msg_Dbg( p_access, "%"PRIu64" clients (%"PRIu64" started on a keyframe), "
+             "%"PRIu64" skips of %"PRIu64" bytes, %"PRIu64" disconnected",
+             stats.i_clients, stats.i_instant, stats.i_skips,
+             stats.i_skipped, stats.i_disconnects );
 
     httpd_StreamDelete( p_sys->p_httpd_stream );
     httpd_HostDelete( p_sys->p_httpd_host );
@@ -457,6 +498,14 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
         block_ChainRelease( p_buffer );
     }
 
+    /* publish how the clients keep up with the stream */
+    httpd_stream_stats_t stats;
+    httpd_StreamGetStats( p_sys->p_httpd_stream, &stats );
+    var_SetInteger( p_access, "http-clients", stats.i_clients );
+    var_SetInteger( p_access, "http-skips", stats.i_skips );
+    var_SetInteger( p_access, "http-skipped-bytes", stats.i_skipped );
+    var_SetInteger( p_access, "http-disconnects", stats.i_disconnects );
+
     return( i_err < 0 ? VLC_EGENERIC : i_len );
 }
 
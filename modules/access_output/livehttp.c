@@ -54,6 +54,7 @@
 #endif
 
 #define STR_ENDLIST "#EXT-X-ENDLIST\n"
+#define STR_INIT    "init"
 
 #define MAX_RENAME_RETRIES        10
 
@@ -105,6 +106,23 @@ static void Close( vlc_object_t * );
 #define INTITIAL_SEG_TEXT N_("Number of first segment")
 #define INITIAL_SEG_LONGTEXT N_("The number of the first segment generated")
 
+#define PARTIAL_TEXT N_("Low latency partial segments")
+#define PARTIAL_LONGTEXT N_("With fragmented MP4, publish every fragment in the "\
+                            "playlist as a partial segment as soon as it is written, "\
+                            "while its segment is still growing.")
+
+#define MPD_TEXT N_("DASH manifest file")
+#define MPD_LONGTEXT N_("Path to the DASH MPD to create along the index, "\
+                        "for fragmented MP4 only. With partial segments, it "\
+                        "is a low latency MPD: the web server must then send "\
+                        "the growing segments with chunked transfer encoding.")
+
+#define DELTA_TEXT N_("Playlist delta update file")
+#define DELTA_LONGTEXT N_("Path to the index to create without its oldest "\
+                          "segments (EXT-X-SKIP), for the clients asking for "\
+                          "a delta update with _HLS_skip=YES. The web server "\
+                          "must serve it for these requests.")
+
 vlc_module_begin ()
     set_description( N_("HTTP Live streaming output") )
     set_shortname( N_("LiveHTTP" ))
@@ -129,6 +147,12 @@ vlc_module_begin ()
                 INDEX_TEXT, INDEX_LONGTEXT, false )
     add_string( SOUT_CFG_PREFIX "index-url", NULL,
                 INDEXURL_TEXT, INDEXURL_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "mpd", NULL,
+                MPD_TEXT, MPD_LONGTEXT, false )
+    add_string( SOUT_CFG_PREFIX "delta", NULL,
+                DELTA_TEXT, DELTA_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "partial", false,
+              PARTIAL_TEXT, PARTIAL_LONGTEXT, true )
     add_string( SOUT_CFG_PREFIX "key-uri", NULL,
                 KEYURI_TEXT, KEYURI_TEXT, true )
     add_loadfile( SOUT_CFG_PREFIX "key-file", NULL,
@@ -156,6 +180,9 @@ static const char *const ppsz_sout_options[] = {
     "key-loadfile",
     "generate-iv",
     "initial-segment-number",
+    "mpd",
+    "partial",
+    "delta",
     NULL
 };
 
@@ -163,6 +190,14 @@ static ssize_t Write( sout_access_out_t *, block_t * );
 static int Seek ( sout_access_out_t *, off_t  );
 static int Control( sout_access_out_t *, int, va_list );
 
+typedef struct output_part
+{
+    uint64_t i_offset;
+    size_t   i_size;
+    mtime_t  i_duration;
+    bool     b_independent;
+} output_part_t;
+
 typedef struct output_segment
 {
     char *psz_filename;
@@ -172,6 +207,13 @@ typedef struct output_segment
     float f_seglength;
     uint32_t i_segment_number;
     uint8_t aes_ivs[16];
+
+    /* fragmented MP4 */
+    mtime_t i_start;
+    mtime_t i_length;
+    uint64_t i_size;
+    int i_parts;
+    output_part_t **pp_parts;
 } output_segment_t;
 
 struct sout_access_out_sys_t
@@ -203,6 +245,26 @@ struct sout_access_out_sys_t
     uint8_t stuffing_bytes[16];
     ssize_t stuffing_size;
     vlc_array_t *segments_t;
+    uint32_t i_index_last; /* last segment in the index file, 0 if rewritten */
+
+    /* fragmented MP4 (CMAF) */
+    bool b_fmp4;
+    bool b_partial;
+    bool b_video;
+    char *psz_initPath;
+    char *psz_initUri;
+    char *psz_mpdPath;
+    char *psz_deltaPath;
+    char *psz_codecs;          /* RFC 6381 codecs of the tracks */
+    block_t *init_buffer;
+    mtime_t i_part_length;     /* of the buffered fragment */
+    mtime_t i_part_dts;        /* decode time of the buffered fragment */
+    mtime_t i_first_dts;       /* decode time of the first fragment */
+    bool b_part_independent;
+    mtime_t i_part_max;
+    mtime_t i_media_time;      /* end of the written fragments */
+    uint64_t i_bytes;
+    time_t i_start_time;
 };
 
 static int LoadCryptFile( sout_access_out_t *p_access);
@@ -210,6 +272,7 @@ static int CryptSetup( sout_access_out_t *p_access, char *keyfile );
 static int CheckSegmentChange( sout_access_out_t *p_access, block_t *p_buffer );
 static ssize_t writeSegment( sout_access_out_t *p_access );
 static ssize_t openNextFile( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys );
+static ssize_t writePart( sout_access_out_t *p_access, mtime_t i_next_dts );
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -242,6 +305,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_ratecontrol = var_GetBool( p_access, SOUT_CFG_PREFIX "ratecontrol") ;
     p_sys->b_caching = var_GetBool( p_access, SOUT_CFG_PREFIX "caching") ;
     p_sys->b_generate_iv = var_GetBool( p_access, SOUT_CFG_PREFIX "generate-iv") ;
+    p_sys->b_partial = var_GetBool( p_access, SOUT_CFG_PREFIX "partial") ;
     p_sys->b_segment_has_data = false;
 
     p_sys->segments_t = vlc_array_new();
@@ -249,6 +313,8 @@ static int Open( vlc_object_t *p_this )
     p_sys->stuffing_size = 0;
     p_sys->i_opendts = VLC_TS_INVALID;
     p_sys->i_dts_offset  = 0;
+    p_sys->i_part_dts = VLC_TS_INVALID;
+    p_sys->i_first_dts = VLC_TS_INVALID;
 
     p_sys->psz_indexPath = NULL;
     psz_idx = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index" );
@@ -269,6 +335,8 @@ static int Open( vlc_object_t *p_this )
     }
 
     p_sys->psz_indexUrl = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "index-url" );
+    p_sys->psz_mpdPath  = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "mpd" );
+    p_sys->psz_deltaPath = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "delta" );
     p_sys->psz_keyfile  = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "key-loadfile" );
     p_sys->key_uri      = var_GetNonEmptyString( p_access, SOUT_CFG_PREFIX "key-uri" );
 
@@ -278,6 +346,8 @@ static int Open( vlc_object_t *p_this )
     {
         free( p_sys->psz_indexUrl );
         free( p_sys->psz_indexPath );
+        free( p_sys->psz_mpdPath );
+        free( p_sys->psz_deltaPath );
         free( p_sys );
         msg_Err( p_access, "Encryption init failed" );
         return VLC_EGENERIC;
@@ -286,6 +356,8 @@ static int Open( vlc_object_t *p_this )
     {
         free( p_sys->psz_indexUrl );
         free( p_sys->psz_indexPath );
+        free( p_sys->psz_mpdPath );
+        free( p_sys->psz_deltaPath );
         free( p_sys );
         msg_Err( p_access, "Encryption init failed" );
         return VLC_EGENERIC;
@@ -502,8 +574,48 @@ static char *formatSegmentPath( char *psz_path, uint32_t i_seg, bool b_sanitize
     return psz_result;
 }
 
+/*****************************************************************************
+ * formatSegmentName: replace the segment number in the path by a name,
+ * or by a DASH $Number$ template if there is no name
+ *****************************************************************************/
+static char *formatSegmentName( char *psz_path, const char *psz_name, bool b_sanitize )
+{
+    char *psz_result;
+    char *psz_firstNumSign;
+
+    if ( ! ( psz_result  = str_format_time( psz_path ) ) )
+        return NULL;
+
+    psz_firstNumSign = psz_result + strcspn( psz_result, SEG_NUMBER_PLACEHOLDER );
+    int i_cnt = strspn( psz_firstNumSign, SEG_NUMBER_PLACEHOLDER );
+    char *psz_newResult;
+    int ret;
+
+    *psz_firstNumSign = '\0';
+    if ( psz_name )
+        ret = asprintf( &psz_newResult, "%s%s%s%s", psz_result, i_cnt ? "" : ".",
+                        psz_name, psz_firstNumSign + i_cnt );
+    else if ( i_cnt )
+        ret = asprintf( &psz_newResult, "%s$Number%%0%dd$%s", psz_result,
+                        i_cnt, psz_firstNumSign + i_cnt );
+    else
+        ret = asprintf( &psz_newResult, "%s$Number$", psz_result );
+    free ( psz_result );
+    if ( ret < 0 )
+        return NULL;
+    psz_result = psz_newResult;
+
+    if ( b_sanitize )
+        path_sanitize( psz_result );
+
+    return psz_result;
+}
+
 static void destroySegment( output_segment_t *segment )
 {
+    for( int i = 0; i < segment->i_parts; i++ )
+        free( segment->pp_parts[i] );
+    TAB_CLEAN( segment->i_parts, segment->pp_parts );
     free( segment->psz_filename );
     free( segment->psz_duration );
     free( segment->psz_uri );
@@ -553,6 +665,432 @@ static bool isFirstItemRemovable( sout_access_out_sys_t *p_sys, uint32_t i_first
     return duration >= (first->f_seglength + (float)(p_sys->i_numsegs * p_sys->i_seglen));
 }
 
+#define SECONDS_MAX_LENGTH 24
+/* Segments of the last target durations are never skipped in delta updates */
+#define DELTA_SKIP_TARGETS 6
+/*****************************************************************************
+ * formatSeconds: print a duration with a dot whatever the locale
+ *****************************************************************************/
+static const char *formatSeconds( char *psz_buf, mtime_t i_time )
+{
+    snprintf( psz_buf, SECONDS_MAX_LENGTH, "%"PRId64".%03u", i_time / CLOCK_FREQ,
+              (unsigned)( i_time % CLOCK_FREQ / 1000 ) );
+    return psz_buf;
+}
+
+/************************************************************************
+ * printSegment: write the index entry of a segment, with its key if it
+ * changed, and its parts if requested
+ ************************************************************************/
+static int printSegment( FILE *fp, sout_access_out_sys_t *p_sys,
+                         const output_segment_t *segment,
+                         const char **ppsz_current_uri, bool b_parts )
+{
+    if( p_sys->key_uri &&
+        ( !*ppsz_current_uri || strcmp( *ppsz_current_uri, segment->psz_key_uri ) ) )
+    {
+        int ret = 0;
+        *ppsz_current_uri = segment->psz_key_uri;
+        if( p_sys->b_generate_iv )
+        {
+            unsigned long long iv_hi = segment->aes_ivs[0];
+            unsigned long long iv_lo = segment->aes_ivs[8];
+            for( unsigned short i = 1; i < 8; i++ )
+            {
+                iv_hi <<= 8;
+                iv_hi |= segment->aes_ivs[i] & 0xff;
+                iv_lo <<= 8;
+                iv_lo |= segment->aes_ivs[8+i] & 0xff;
+            }
+            ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
+                           segment->psz_key_uri, iv_hi, iv_lo );
+
+        } else {
+            ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
+        }
+        if( ret < 0 )
+            return -1;
+    }
+
+    if( b_parts )
+    {
+        for( int i = 0; i < segment->i_parts; i++ )
+        {
+            const output_part_t *part = segment->pp_parts[i];
+            char psz_duration[SECONDS_MAX_LENGTH];
+
+            if( fprintf( fp, "#EXT-X-PART:DURATION=%s,URI=\"%s\",BYTERANGE=\"%zu@%"PRIu64"\"%s\n",
+                         formatSeconds( psz_duration, part->i_duration ),
+                         segment->psz_uri, part->i_size, part->i_offset,
+                         part->b_independent ? ",INDEPENDENT=YES" : "" ) < 0 )
+                return -1;
+        }
+    }
+
+    /* Still being written, announce its next part */
+    if( !segment->psz_duration )
+        return fprintf( fp, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\",BYTERANGE-START=%"PRIu64"\n",
+                        segment->psz_uri, segment->i_size );
+
+    return fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri );
+}
+
+/************************************************************************
+ * appendIndex: add the new segments at the end of a growing index file
+ ************************************************************************/
+static int appendIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                        uint32_t i_firstseg, unsigned i_index_offset )
+{
+    FILE *fp = vlc_fopen( p_sys->psz_indexPath, "at" );
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", p_sys->psz_indexPath );
+        p_sys->i_index_last = 0;
+        return -1;
+    }
+    /* The entries are appended by a single write, so that readers do not
+     * get half of them */
+    setvbuf( fp, NULL, _IOFBF, 65536 );
+
+    const char *psz_current_uri = NULL;
+    if( p_sys->i_index_last >= i_firstseg )
+    {
+        output_segment_t *previous = vlc_array_item_at_index( p_sys->segments_t,
+                                     p_sys->i_index_last - i_firstseg + i_index_offset );
+        psz_current_uri = previous->psz_key_uri;
+    }
+
+    bool b_error = false;
+    for ( uint32_t i = p_sys->i_index_last + 1; !b_error && i <= p_sys->i_segment; i++ )
+    {
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    i - i_firstseg + i_index_offset );
+        if ( printSegment( fp, p_sys, segment, &psz_current_uri, false ) < 0 )
+            b_error = true;
+    }
+
+    if ( fclose( fp ) || b_error )
+    {
+        /* The index is written again in full next time */
+        msg_Err( p_access, "cannot append to index file `%s'", p_sys->psz_indexPath );
+        p_sys->i_index_last = 0;
+        return -1;
+    }
+
+    p_sys->i_index_last = p_sys->i_segment;
+    msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
+    return 0;
+}
+
+/************************************************************************
+ * printIndex: print the index, without its first i_skip segments
+ ************************************************************************/
+static int printIndex( FILE *fp, sout_access_out_sys_t *p_sys,
+                       uint32_t i_firstseg, unsigned i_index_offset,
+                       bool b_isend, unsigned i_skip )
+{
+    if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:%d\n#EXT-X-ALLOW-CACHE:%s"
+                      "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
+                      p_sys->psz_deltaPath ? 9 : p_sys->b_fmp4 ? 6 : 3,
+                      p_sys->b_caching ? "YES" : "NO",
+                      p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
+                      i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg) && !i_skip) ? "#EXT-X-DISCONTINUITY\n" : ""
+                      ) < 0 )
+        return -1;
+
+    bool b_part_inf = p_sys->b_fmp4 && p_sys->b_partial && p_sys->i_part_max > 0;
+    if ( b_part_inf || p_sys->psz_deltaPath )
+    {
+        char psz_hold[SECONDS_MAX_LENGTH], psz_target[SECONDS_MAX_LENGTH];
+
+        if ( fputs( "#EXT-X-SERVER-CONTROL:", fp ) < 0 ||
+             ( p_sys->psz_deltaPath &&
+               fprintf( fp, "CAN-SKIP-UNTIL=%zu%s", DELTA_SKIP_TARGETS * p_sys->i_seglen,
+                        b_part_inf ? "," : "" ) < 0 ) ||
+             ( b_part_inf &&
+               fprintf( fp, "PART-HOLD-BACK=%s\n#EXT-X-PART-INF:PART-TARGET=%s",
+                        formatSeconds( psz_hold, 3 * p_sys->i_part_max ),
+                        formatSeconds( psz_target, p_sys->i_part_max ) ) < 0 ) ||
+             fputc( '\n', fp ) == EOF )
+            return -1;
+    }
+
+    mtime_t i_part_horizon = INT64_MAX;
+    if ( p_sys->b_fmp4 )
+    {
+        /* parts are only listed for the last three target durations */
+        if( b_part_inf )
+            i_part_horizon = p_sys->i_media_time - 3 * p_sys->i_seglenm;
+
+        if ( fprintf( fp, "#EXT-X-MAP:URI=\"%s\"\n", p_sys->psz_initUri ) < 0 )
+            return -1;
+    }
+
+    if ( i_skip > 0 &&
+         fprintf( fp, "#EXT-X-SKIP:SKIPPED-SEGMENTS=%u\n", i_skip ) < 0 )
+        return -1;
+
+    const char *psz_current_uri = NULL;
+    for ( uint32_t i = i_firstseg + i_skip; i <= p_sys->i_segment; i++ )
+    {
+        //scale to i_index_offset..numsegs + i_index_offset
+        uint32_t index = i - i_firstseg + i_index_offset;
+
+        output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
+        bool b_parts = segment->i_start + segment->i_length > i_part_horizon ||
+                       ( p_sys->b_partial && !segment->psz_duration );
+
+        if ( printSegment( fp, p_sys, segment, &psz_current_uri, b_parts ) < 0 )
+            return -1;
+    }
+
+    if ( b_isend && fputs ( STR_ENDLIST, fp ) < 0 )
+        return -1;
+    return 0;
+}
+
+/************************************************************************
+ * writePlaylist: write a playlist to a temporary file, which then
+ * replaces it
+ ************************************************************************/
+static int writePlaylist( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                          const char *psz_path, uint32_t i_firstseg,
+                          unsigned i_index_offset, bool b_isend, unsigned i_skip )
+{
+    char *psz_idxTmp;
+    if ( asprintf( &psz_idxTmp, "%s.tmp", psz_path ) < 0)
+        return -1;
+
+    FILE *fp = vlc_fopen( psz_idxTmp, "wt");
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
+        free( psz_idxTmp );
+        return -1;
+    }
+
+    int val = printIndex( fp, p_sys, i_firstseg, i_index_offset, b_isend, i_skip );
+    if ( fclose( fp ) || val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        free( psz_idxTmp );
+        return -1;
+    }
+
+    val = vlc_rename ( psz_idxTmp, psz_path );
+    if ( val < 0 )
+    {
+        vlc_unlink( psz_idxTmp );
+        msg_Err( p_access, "Error moving LiveHttp index file" );
+    }
+    else
+        msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , psz_path );
+
+    free( psz_idxTmp );
+    return val;
+}
+
+/************************************************************************
+ * writeIndex: write the whole index file
+ ************************************************************************/
+static int writeIndex( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                       uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    p_sys->i_index_last = 0;
+
+    if ( writePlaylist( p_access, p_sys, p_sys->psz_indexPath, i_firstseg,
+                        i_index_offset, b_isend, 0 ) < 0 )
+        return -1;
+
+    output_segment_t *last = vlc_array_item_at_index( p_sys->segments_t,
+                             vlc_array_count( p_sys->segments_t ) - 1 );
+    if( !b_isend && last->psz_duration )
+        p_sys->i_index_last = p_sys->i_segment;
+    return 0;
+}
+
+/************************************************************************
+ * writeDelta: write the playlist delta update, skipping the segments
+ * that start more than CAN-SKIP-UNTIL before the end of the index
+ ************************************************************************/
+static int writeDelta( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                       uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    float duration = .0f;
+    for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
+    {
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    i - i_firstseg + i_index_offset );
+        duration += segment->f_seglength;
+    }
+
+    unsigned i_skip = 0;
+    for ( uint32_t i = i_firstseg; i < p_sys->i_segment; i++, i_skip++ )
+    {
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    i - i_firstseg + i_index_offset );
+        if ( duration < (float)( DELTA_SKIP_TARGETS * p_sys->i_seglen ) )
+            break;
+        duration -= segment->f_seglength;
+    }
+
+    return writePlaylist( p_access, p_sys, p_sys->psz_deltaPath, i_firstseg,
+                          i_index_offset, b_isend, i_skip );
+}
+
+/************************************************************************
+ * writeMPD: write the DASH manifest of the fragmented MP4 segments
+ ************************************************************************/
+static int writeMPD( sout_access_out_t *p_access, sout_access_out_sys_t *p_sys,
+                     uint32_t i_firstseg, unsigned i_index_offset, bool b_isend )
+{
+    char *psz_mpdTmp;
+    if ( asprintf( &psz_mpdTmp, "%s.tmp", p_sys->psz_mpdPath ) < 0 )
+        return -1;
+
+    char *psz_media = formatSegmentName( p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path,
+                                         NULL, false );
+    char *psz_media_xml = psz_media ? convert_xml_special_chars( psz_media ) : NULL;
+    char *psz_init_xml = convert_xml_special_chars( p_sys->psz_initUri );
+    free( psz_media );
+    if ( unlikely( !psz_media_xml || !psz_init_xml ) )
+    {
+        free( psz_media_xml );
+        free( psz_init_xml );
+        free( psz_mpdTmp );
+        return -1;
+    }
+
+    FILE *fp = vlc_fopen( psz_mpdTmp, "wt" );
+    if ( !fp )
+    {
+        msg_Err( p_access, "cannot open MPD file `%s'", psz_mpdTmp );
+        free( psz_media_xml );
+        free( psz_init_xml );
+        free( psz_mpdTmp );
+        return -1;
+    }
+
+    /* Only complete segments are announced, but for low latency: the
+     * segment being written is then announced with the target duration,
+     * and can be requested as soon as its first fragment is written */
+    const bool b_low_latency = p_sys->b_partial && !b_isend;
+    uint32_t i_lastseg = p_sys->i_segment;
+    output_segment_t *last = vlc_array_item_at_index( p_sys->segments_t,
+                             vlc_array_count( p_sys->segments_t ) - 1 );
+    if ( !last->psz_duration && !b_low_latency )
+        i_lastseg--;
+
+    mtime_t i_window = 0;
+    for ( uint32_t i = i_firstseg; i <= i_lastseg; i++ )
+    {
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    i - i_firstseg + i_index_offset );
+        if ( segment->psz_duration )
+            i_window += segment->i_length;
+    }
+
+    char psz_duration[SECONDS_MAX_LENGTH], psz_now[21];
+    struct tm tm;
+    time_t now = time( NULL );
+    strftime( psz_now, sizeof( psz_now ), "%Y-%m-%dT%H:%M:%SZ",
+              gmtime_r( &now, &tm ) );
+
+    fprintf( fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                 "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+                 " profiles=\"urn:mpeg:dash:profile:isoff-live:2011\"" );
+    if ( b_isend )
+    {
+        fprintf( fp, " type=\"static\" mediaPresentationDuration=\"PT%sS\"",
+                 formatSeconds( psz_duration, p_sys->i_media_time ) );
+    }
+    else
+    {
+        char psz_start[21];
+
+        strftime( psz_start, sizeof( psz_start ), "%Y-%m-%dT%H:%M:%SZ",
+                  gmtime_r( &p_sys->i_start_time, &tm ) );
+        fprintf( fp, " type=\"dynamic\" availabilityStartTime=\"%s\" publishTime=\"%s\""
+                     " minimumUpdatePeriod=\"PT%zuS\"", psz_start, psz_now, p_sys->i_seglen );
+        if ( p_sys->i_numsegs )
+            fprintf( fp, " timeShiftBufferDepth=\"PT%sS\"",
+                     formatSeconds( psz_duration, i_window ) );
+    }
+
+    uint64_t i_bandwidth = p_sys->i_media_time > 0 ?
+                           p_sys->i_bytes * 8 * CLOCK_FREQ / p_sys->i_media_time : 0;
+    fprintf( fp, " minBufferTime=\"PT%zuS\">\n", p_sys->i_seglen );
+
+    /* Low latency: the fragments of a segment are sent as they are written,
+     * with chunked transfer encoding, so that the segment is available
+     * once its first fragment is */
+    char psz_offset[SECONDS_MAX_LENGTH] = "";
+    if ( b_low_latency )
+    {
+        fprintf( fp, " <ServiceDescription id=\"0\">\n"
+                     "  <Latency target=\"%"PRId64"\"/>\n"
+                     " </ServiceDescription>\n", 3 * p_sys->i_part_max / 1000 );
+        formatSeconds( psz_offset, __MAX( p_sys->i_seglenm - p_sys->i_part_max, 0 ) );
+    }
+
+    fprintf( fp, " <Period id=\"0\" start=\"PT0S\">\n"
+                 "  <AdaptationSet mimeType=\"%s/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">\n"
+                 "   <Representation id=\"0\" bandwidth=\"%"PRIu64"\"%s%s%s>\n"
+                 "    <SegmentTemplate timescale=\"1000\" initialization=\"%s\""
+                 " media=\"%s\" startNumber=\"%"PRIu32"\"%s%s%s>\n"
+                 "     <SegmentTimeline>\n",
+             p_sys->b_video ? "video" : "audio", i_bandwidth,
+             p_sys->psz_codecs ? " codecs=\"" : "",
+             p_sys->psz_codecs ? p_sys->psz_codecs : "",
+             p_sys->psz_codecs ? "\"" : "",
+             psz_init_xml, psz_media_xml, i_firstseg,
+             b_low_latency ? " availabilityTimeOffset=\"" : "", psz_offset,
+             b_low_latency ? "\" availabilityTimeComplete=\"false\"" : "" );
+    free( psz_media_xml );
+    free( psz_init_xml );
+
+    for ( uint32_t i = i_firstseg; i <= i_lastseg; i++ )
+    {
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    i - i_firstseg + i_index_offset );
+        mtime_t i_length = segment->psz_duration ? segment->i_length :
+                           __MAX( segment->i_length, p_sys->i_seglenm );
+        fprintf( fp, "      <S t=\"%"PRId64"\" d=\"%"PRId64"\"/>\n",
+                 segment->i_start / 1000, i_length / 1000 );
+    }
+
+    fputs( "     </SegmentTimeline>\n"
+           "    </SegmentTemplate>\n"
+           "   </Representation>\n"
+           "  </AdaptationSet>\n"
+           " </Period>\n", fp );
+    if ( b_low_latency )
+        fprintf( fp, " <UTCTiming schemeIdUri=\"urn:mpeg:dash:utc:direct:2014\""
+                     " value=\"%s\"/>\n", psz_now );
+    fputs( "</MPD>\n", fp );
+
+    if ( ferror( fp ) )
+    {
+        fclose( fp );
+        vlc_unlink( psz_mpdTmp );
+        free( psz_mpdTmp );
+        return -1;
+    }
+    fclose( fp );
+
+    int val = vlc_rename( psz_mpdTmp, p_sys->psz_mpdPath );
+    if ( val < 0 )
+    {
+        vlc_unlink( psz_mpdTmp );
+        msg_Err( p_access, "Error moving LiveHttp MPD file" );
+    }
+    else
+        msg_Dbg( p_access, "LiveHttpMPDComplete: %s" , p_sys->psz_mpdPath );
+
+    free( psz_mpdTmp );
+    return 0;
+}
+
 /************************************************************************
  * updateIndexAndDel: If necessary, update index file & delete old segments
  ************************************************************************/
@@ -574,110 +1112,44 @@ static int updateIndexAndDel( sout_access_out_t *p_access, sout_access_out_sys_t
         i_index_offset = vlc_array_count( p_sys->segments_t ) - numsegs;
     }
 
+    /* false while the parts of a segment are being published */
+    output_segment_t *last = vlc_array_item_at_index( p_sys->segments_t,
+                             vlc_array_count( p_sys->segments_t ) - 1 );
+    bool b_complete = last->psz_duration != NULL;
+
     // First update index
     if ( p_sys->psz_indexPath )
     {
-        int val;
-        FILE *fp;
-        char *psz_idxTmp;
-        if ( asprintf( &psz_idxTmp, "%s.tmp", p_sys->psz_indexPath ) < 0)
+        /* A playlist that only grows (EVENT) gets its new segments
+         * appended, instead of being written again */
+        bool b_append = p_sys->i_index_last && p_sys->i_numsegs == 0 &&
+                        !( p_sys->b_fmp4 && p_sys->b_partial ) && !b_isend && b_complete;
+        if ( ( !b_append || appendIndex( p_access, p_sys, i_firstseg, i_index_offset ) < 0 ) &&
+             writeIndex( p_access, p_sys, i_firstseg, i_index_offset, b_isend ) < 0 )
             return -1;
 
-        fp = vlc_fopen( psz_idxTmp, "wt");
-        if ( !fp )
-        {
-            msg_Err( p_access, "cannot open index file `%s'", psz_idxTmp );
-            free( psz_idxTmp );
-            return -1;
-        }
-
-        if ( fprintf( fp, "#EXTM3U\n#EXT-X-TARGETDURATION:%zu\n#EXT-X-VERSION:3\n#EXT-X-ALLOW-CACHE:%s"
-                          "%s\n#EXT-X-MEDIA-SEQUENCE:%"PRIu32"\n%s", p_sys->i_seglen,
-                          p_sys->b_caching ? "YES" : "NO",
-                          p_sys->i_numsegs > 0 ? "" : b_isend ? "\n#EXT-X-PLAYLIST-TYPE:VOD" : "\n#EXT-X-PLAYLIST-TYPE:EVENT",
-                          i_firstseg, ((p_sys->i_initial_segment > 1) && (p_sys->i_initial_segment == i_firstseg)) ? "#EXT-X-DISCONTINUITY\n" : ""
-                          ) < 0 )
-        {
-            free( psz_idxTmp );
-            fclose( fp );
-            return -1;
-        }
-        char *psz_current_uri=NULL;
-
-
-        for ( uint32_t i = i_firstseg; i <= p_sys->i_segment; i++ )
-        {
-            //scale to i_index_offset..numsegs + i_index_offset
-            uint32_t index = i - i_firstseg + i_index_offset;
-
-            output_segment_t *segment = (output_segment_t *)vlc_array_item_at_index( p_sys->segments_t, index );
-            if( p_sys->key_uri &&
-                ( !psz_current_uri ||  strcmp( psz_current_uri, segment->psz_key_uri ) )
-              )
-            {
-                int ret = 0;
-                free( psz_current_uri );
-                psz_current_uri = strdup( segment->psz_key_uri );
-                if( p_sys->b_generate_iv )
-                {
-                    unsigned long long iv_hi = segment->aes_ivs[0];
-                    unsigned long long iv_lo = segment->aes_ivs[8];
-                    for( unsigned short i = 1; i < 8; i++ )
-                    {
-                        iv_hi <<= 8;
-                        iv_hi |= segment->aes_ivs[i] & 0xff;
-                        iv_lo <<= 8;
-                        iv_lo |= segment->aes_ivs[8+i] & 0xff;
-                    }
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\",IV=0X%16.16llx%16.16llx\n",
-                                   segment->psz_key_uri, iv_hi, iv_lo );
-
-                } else {
-                    ret = fprintf( fp, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"\n", segment->psz_key_uri );
-                }
-                if( ret < 0 )
-                {
-                    free( psz_current_uri );
-                    free( psz_idxTmp );
-                    fclose( fp );
-                    return -1;
-                }
-            }
-
-            val = fprintf( fp, "#EXTINF:%s,\n%s\n", segment->psz_duration, segment->psz_uri);
-            if ( val < 0 )
-            {
-                free( psz_current_uri );
-                free( psz_idxTmp );
-                fclose( fp );
-                return -1;
-            }
-        }
-        free( psz_current_uri );
-
-        if ( b_isend )
-        {
-            if ( fputs ( STR_ENDLIST, fp ) < 0)
-            {
-                free( psz_idxTmp );
-                fclose( fp ) ;
-                return -1;
-            }
-
-        }
-        fclose( fp );
+        if ( p_sys->psz_deltaPath )
+            writeDelta( p_access, p_sys, i_firstseg, i_index_offset, b_isend );
+    }
 
-        val = vlc_rename ( psz_idxTmp, p_sys->psz_indexPath);
+    /* A low latency MPD also announces the segment being written */
+    if ( p_sys->psz_mpdPath && p_sys->b_fmp4 && ( b_complete || p_sys->b_partial ) )
+        writeMPD( p_access, p_sys, i_firstseg, i_index_offset, b_isend );
 
-        if ( val < 0 )
+    // Parts are no longer listed past three target durations
+    if ( p_sys->b_fmp4 && p_sys->b_partial )
+    {
+        for ( int index = vlc_array_count( p_sys->segments_t ) - 1; index >= 0; index-- )
         {
-            vlc_unlink( psz_idxTmp );
-            msg_Err( p_access, "Error moving LiveHttp index file" );
+            output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t, index );
+            if ( segment->i_start + segment->i_length > p_sys->i_media_time - 3 * p_sys->i_seglenm )
+                continue;
+            if ( segment->i_parts == 0 )
+                break;
+            for ( int i = 0; i < segment->i_parts; i++ )
+                free( segment->pp_parts[i] );
+            TAB_CLEAN( segment->i_parts, segment->pp_parts );
         }
-        else
-            msg_Dbg( p_access, "LiveHttpIndexComplete: %s" , p_sys->psz_indexPath );
-
-        free( psz_idxTmp );
     }
 
     // Then take care of deletion
@@ -759,42 +1231,56 @@ static void Close( vlc_object_t * p_this )
 {
     sout_access_out_t *p_access = (sout_access_out_t*)p_this;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    block_t *output_block = p_sys->block_buffer;
-    p_sys->block_buffer = NULL;
 
-    while( output_block )
+    if( p_sys->b_fmp4 )
+    {
+        /* The last fragment ends with the stream */
+        if( p_sys->block_buffer && p_sys->i_handle >= 0 &&
+            unlikely( writePart( p_access, VLC_TS_INVALID ) < 0 ) )
+            msg_Err( p_access, "cannot write the last fragment" );
+        block_ChainRelease( p_sys->block_buffer );
+        p_sys->block_buffer = NULL;
+        block_ChainRelease( p_sys->init_buffer );
+    }
+    else
     {
-        block_t *p_next = output_block->p_next;
-        output_block->p_next = NULL;
+        block_t *output_block = p_sys->block_buffer;
+        p_sys->block_buffer = NULL;
 
-        /* Since we are flushing, check the segment change by hand and don't wait
-         * possible keyframe*/
-        if( p_sys->b_segment_has_data &&  (float)(output_block->i_length + p_sys->i_dts_offset +
-                     output_block->i_dts - p_sys->i_opendts) >= p_sys->i_seglenm )
+        while( output_block )
         {
-            closeCurrentSegment( p_access, p_sys, false );
-            p_sys->i_dts_offset = 0;
-            if( unlikely(openNextFile( p_access, p_sys ) < 0 ) )
+            block_t *p_next = output_block->p_next;
+            output_block->p_next = NULL;
+
+            /* Since we are flushing, check the segment change by hand and don't wait
+             * possible keyframe*/
+            if( p_sys->b_segment_has_data &&  (float)(output_block->i_length + p_sys->i_dts_offset +
+                         output_block->i_dts - p_sys->i_opendts) >= p_sys->i_seglenm )
             {
-                block_ChainRelease( output_block );
-                output_block = NULL;
-                block_ChainRelease( p_next );
+                closeCurrentSegment( p_access, p_sys, false );
+                p_sys->i_dts_offset = 0;
+                if( unlikely(openNextFile( p_access, p_sys ) < 0 ) )
+                {
+                    block_ChainRelease( output_block );
+                    output_block = NULL;
+                    block_ChainRelease( p_next );
 
-                /* Jump out of the loop so we can close rest of the stuff*/
-                continue;
+                    /* Jump out of the loop so we can close rest of the stuff*/
+                    continue;
+                }
+                p_sys->i_opendts = p_sys->block_buffer ? p_sys->block_buffer->i_dts : output_block->i_dts;
             }
-            p_sys->i_opendts = p_sys->block_buffer ? p_sys->block_buffer->i_dts : output_block->i_dts;
+            Write( p_access, output_block );
+            output_block = p_next;
         }
-        Write( p_access, output_block );
-        output_block = p_next;
-    }
 
-    ssize_t writevalue = writeSegment( p_access );
-    msg_Dbg( p_access, "Writing.. %zd", writevalue );
-    if( unlikely( writevalue < 0 ) )
-    {
-        block_ChainRelease( p_sys->block_buffer );
-        p_sys->block_buffer = NULL;
+        ssize_t writevalue = writeSegment( p_access );
+        msg_Dbg( p_access, "Writing.. %zd", writevalue );
+        if( unlikely( writevalue < 0 ) )
+        {
+            block_ChainRelease( p_sys->block_buffer );
+            p_sys->block_buffer = NULL;
+        }
     }
 
     closeCurrentSegment( p_access, p_sys, true );
@@ -821,6 +1307,11 @@ static void Close( vlc_object_t * p_this )
 
     free( p_sys->psz_indexUrl );
     free( p_sys->psz_indexPath );
+    free( p_sys->psz_mpdPath );
+    free( p_sys->psz_deltaPath );
+    free( p_sys->psz_initPath );
+    free( p_sys->psz_initUri );
+    free( p_sys->psz_codecs );
     free( p_sys );
 
     msg_Dbg( p_access, "livehttp access output closed" );
@@ -1015,6 +1506,448 @@ static ssize_t writeSegment( sout_access_out_t *p_access )
     return i_write;
 }
 
+/*****************************************************************************
+ * isBox: check the type of the ISO base media box starting the block
+ *****************************************************************************/
+static bool isBox( const block_t *p_block, const char *psz_type )
+{
+    return p_block->i_buffer >= 8 && !memcmp( &p_block->p_buffer[4], psz_type, 4 );
+}
+
+/* Returns the end of the box starting at p, NULL if it overflows p_end */
+static const uint8_t *boxEnd( const uint8_t *p, const uint8_t *p_end )
+{
+    if( p_end - p < 8 )
+        return NULL;
+
+    uint64_t i_size = GetDWBE( p ), i_header = 8;
+    if( i_size == 1 ) /* 64 bits largesize */
+    {
+        i_size = p_end - p >= 16 ? GetQWBE( &p[8] ) : 0;
+        i_header = 16;
+    }
+    else if( i_size == 0 ) /* up to the end of its parent */
+        i_size = p_end - p;
+
+    if( i_size < i_header || i_size > (uint64_t)( p_end - p ) )
+        return NULL;
+    return p + i_size;
+}
+
+/* Returns the payload of a box */
+static const uint8_t *boxData( const uint8_t *p )
+{
+    return p + ( GetDWBE( p ) == 1 ? 16 : 8 );
+}
+
+/* Returns the first box of the given type in [p, p_end), following the
+ * children of each type of a path such as "mdia/minf/stbl" */
+static const uint8_t *findBox( const uint8_t *p, const uint8_t *p_end,
+                               const char *psz_path )
+{
+    for( const uint8_t *p_box_end; ( p_box_end = boxEnd( p, p_end ) ); p = p_box_end )
+    {
+        if( memcmp( &p[4], psz_path, 4 ) )
+            continue;
+        if( psz_path[4] != '/' )
+            return p;
+        return findBox( boxData( p ), p_box_end, &psz_path[5] );
+    }
+    return NULL;
+}
+
+/* Returns the handler type of a trak box, NULL if none */
+static const uint8_t *getHandler( const uint8_t *p_trak, const uint8_t *p_end )
+{
+    const uint8_t *p_trak_end = boxEnd( p_trak, p_end );
+    const uint8_t *p_hdlr = findBox( boxData( p_trak ), p_trak_end, "mdia/hdlr" );
+    /* after the version, flags and pre_defined */
+    if( !p_hdlr || boxEnd( p_hdlr, p_trak_end ) - boxData( p_hdlr ) < 12 )
+        return NULL;
+    return boxData( p_hdlr ) + 8;
+}
+
+/* Looks for a video handler among the tracks of the moov box */
+static bool hasVideoTrack( const block_t *p_init )
+{
+    const uint8_t *p_end = p_init->p_buffer + p_init->i_buffer;
+    const uint8_t *p_moov = findBox( p_init->p_buffer, p_end, "moov" );
+    if( !p_moov )
+        return false;
+
+    const uint8_t *p_moov_end = boxEnd( p_moov, p_end );
+    for( const uint8_t *p_trak = findBox( boxData( p_moov ), p_moov_end, "trak" );
+         p_trak; p_trak = findBox( boxEnd( p_trak, p_moov_end ), p_moov_end, "trak" ) )
+    {
+        const uint8_t *p_handler = getHandler( p_trak, p_moov_end );
+        if( p_handler && !memcmp( p_handler, "vide", 4 ) )
+            return true;
+    }
+    return false;
+}
+
+/* Reads the size of an MPEG-4 descriptor */
+static size_t readDescriptorSize( const uint8_t **pp, const uint8_t *p_end )
+{
+    size_t i_size = 0;
+    for( int i = 0; i < 4 && *pp < p_end; i++ )
+    {
+        uint8_t b = *(*pp)++;
+        i_size = ( i_size << 7 ) | ( b & 0x7f );
+        if( !( b & 0x80 ) )
+            break;
+    }
+    return i_size;
+}
+
+/* Formats the codecs parameter of an mp4a sample entry from its esds box */
+static int printAudioCodec( char *psz, size_t i_len,
+                            const uint8_t *p, const uint8_t *p_end )
+{
+    p += 4; /* version and flags */
+    if( p + 5 > p_end || *p++ != 0x03 ) /* ES_Descriptor */
+        return 0;
+    readDescriptorSize( &p, p_end );
+    if( p + 3 > p_end )
+        return 0;
+    uint8_t i_flags = p[2];
+    p += 3;
+    if( i_flags & 0x80 ) /* streamDependenceFlag */
+        p += 2;
+    if( i_flags & 0x40 ) /* URL_Flag */
+        p += 1 + ( p < p_end ? *p : 0 );
+    if( i_flags & 0x20 ) /* OCRstreamFlag */
+        p += 2;
+
+    if( p + 15 > p_end || *p++ != 0x04 ) /* DecoderConfigDescriptor */
+        return 0;
+    readDescriptorSize( &p, p_end );
+    if( p + 13 > p_end )
+        return 0;
+    uint8_t i_object_type = p[0];
+    p += 13;
+
+    if( i_object_type != 0x40 || p + 2 > p_end || *p++ != 0x05 )
+        return snprintf( psz, i_len, "mp4a.%02X", i_object_type );
+    readDescriptorSize( &p, p_end );
+    if( p + 2 > p_end )
+        return 0;
+
+    /* MPEG-4 audio object type */
+    unsigned i_aot = p[0] >> 3;
+    if( i_aot == 31 )
+        i_aot = 32 + ( ( ( p[0] & 0x07 ) << 3 ) | ( p[1] >> 5 ) );
+    return snprintf( psz, i_len, "mp4a.40.%u", i_aot );
+}
+
+/* Formats the codecs parameter of an HEVC sample entry from its hvcC box */
+static int printHEVCCodec( char *psz, size_t i_len, const char *psz_type,
+                           const uint8_t *p, const uint8_t *p_end )
+{
+    if( p + 13 > p_end )
+        return 0;
+
+    static const char *const ppsz_space[] = { "", "A", "B", "C" };
+    uint32_t i_compat = GetDWBE( &p[2] ), i_reversed = 0;
+    for( int i = 0; i < 32; i++ )
+        i_reversed |= ( ( i_compat >> i ) & 1 ) << ( 31 - i );
+
+    int i_ret = snprintf( psz, i_len, "%.4s.%s%u.%"PRIX32".%c%u", psz_type,
+                          ppsz_space[p[1] >> 6], p[1] & 0x1f, i_reversed,
+                          ( p[1] & 0x20 ) ? 'H' : 'L', p[12] );
+
+    /* constraint flags, without the trailing zero bytes */
+    int i_constraints = 6;
+    while( i_constraints > 0 && p[5 + i_constraints] == 0 )
+        i_constraints--;
+    for( int i = 0; i < i_constraints && i_ret > 0 && (size_t)i_ret < i_len; i++ )
+        i_ret += snprintf( &psz[i_ret], i_len - i_ret, ".%02X", p[6 + i] );
+    return i_ret;
+}
+
+/* Formats the codecs parameter of the first sample entry of a track */
+static int printCodec( char *psz, size_t i_len,
+                       const uint8_t *p_trak, const uint8_t *p_end )
+{
+    const uint8_t *p_handler = getHandler( p_trak, p_end );
+    const uint8_t *p_trak_end = boxEnd( p_trak, p_end );
+    const uint8_t *p_stsd = findBox( boxData( p_trak ), p_trak_end,
+                                     "mdia/minf/stbl/stsd" );
+    if( !p_handler || !p_stsd )
+        return 0;
+
+    /* first sample entry, after the version, flags and entry count */
+    const uint8_t *p_stsd_end = boxEnd( p_stsd, p_trak_end );
+    const uint8_t *p_entry = boxData( p_stsd ) + 8;
+    const uint8_t *p_entry_end = p_entry < p_stsd_end ?
+                                 boxEnd( p_entry, p_stsd_end ) : NULL;
+    if( !p_entry_end )
+        return 0;
+
+    char psz_type[5];
+    memcpy( psz_type, &p_entry[4], 4 );
+    psz_type[4] = '\0';
+
+    /* The child boxes follow the fields of the sample entry */
+    const uint8_t *p_child = boxData( p_entry ) + 8;
+    if( !memcmp( p_handler, "vide", 4 ) )
+        p_child += 70;
+    else if( !memcmp( p_handler, "soun", 4 ) )
+    {
+        p_child += 20;
+        /* QuickTime sound sample description versions 1 and 2 */
+        if( p_child <= p_entry_end && GetWBE( &p_child[-20] ) == 1 )
+            p_child += 16;
+        else if( p_child <= p_entry_end && GetWBE( &p_child[-20] ) == 2 )
+            p_child += 36;
+    }
+    if( p_child > p_entry_end )
+        return 0;
+
+    const uint8_t *p_box;
+    if( ( p_box = findBox( p_child, p_entry_end, "avcC" ) ) &&
+        boxEnd( p_box, p_entry_end ) - boxData( p_box ) >= 4 )
+    {
+        const uint8_t *p = boxData( p_box );
+        return snprintf( psz, i_len, "%s.%02X%02X%02X", psz_type, p[1], p[2], p[3] );
+    }
+    if( ( p_box = findBox( p_child, p_entry_end, "hvcC" ) ) )
+        return printHEVCCodec( psz, i_len, psz_type, boxData( p_box ),
+                               boxEnd( p_box, p_entry_end ) );
+    if( !strcmp( psz_type, "mp4a" ) &&
+        ( p_box = findBox( p_child, p_entry_end, "esds" ) ) )
+        return printAudioCodec( psz, i_len, boxData( p_box ),
+                                boxEnd( p_box, p_entry_end ) );
+
+    /* Other codecs are named after their sample entry */
+    if( !strcmp( psz_type, "ac-3" ) || !strcmp( psz_type, "ec-3" ) ||
+        !strcmp( psz_type, "vp09" ) || !strcmp( psz_type, "av01" ) )
+        return snprintf( psz, i_len, "%s", psz_type );
+    if( !strcmp( psz_type, "Opus" ) )
+        return snprintf( psz, i_len, "opus" );
+    if( !strcmp( psz_type, "fLaC" ) )
+        return snprintf( psz, i_len, "flac" );
+    return 0;
+}
+
+/* Builds the RFC 6381 codecs parameter of the tracks in the moov box */
+static char *getCodecs( const block_t *p_init )
+{
+    const uint8_t *p_end = p_init->p_buffer + p_init->i_buffer;
+    const uint8_t *p_moov = findBox( p_init->p_buffer, p_end, "moov" );
+    char psz_codecs[256] = "";
+    size_t i_codecs = 0;
+
+    if( !p_moov )
+        return NULL;
+
+    const uint8_t *p_moov_end = boxEnd( p_moov, p_end );
+    for( const uint8_t *p_trak = findBox( boxData( p_moov ), p_moov_end, "trak" );
+         p_trak; p_trak = findBox( boxEnd( p_trak, p_moov_end ), p_moov_end, "trak" ) )
+    {
+        char psz_codec[64];
+        int i_ret = printCodec( psz_codec, sizeof( psz_codec ), p_trak, p_moov_end );
+
+        if( i_ret <= 0 || (size_t)i_ret >= sizeof( psz_codec ) ||
+            i_codecs + i_ret + 2 > sizeof( psz_codecs ) )
+            continue;
+
+        i_codecs += snprintf( &psz_codecs[i_codecs], sizeof( psz_codecs ) - i_codecs,
+                              "%s%s", i_codecs ? "," : "", psz_codec );
+    }
+
+    return i_codecs ? strdup( psz_codecs ) : NULL;
+}
+
+/*****************************************************************************
+ * setupFragmented: switch to fragmented MP4 (CMAF) segments
+ *****************************************************************************/
+static int setupFragmented( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    char *psz_idxFormat = p_sys->psz_indexUrl ? p_sys->psz_indexUrl : p_access->psz_path;
+
+    p_sys->psz_initPath = formatSegmentName( p_access->psz_path, STR_INIT, true );
+    p_sys->psz_initUri = formatSegmentName( psz_idxFormat, STR_INIT, false );
+    if( unlikely( !p_sys->psz_initPath || !p_sys->psz_initUri ) )
+        return VLC_ENOMEM;
+
+    if( p_sys->b_partial && p_sys->key_uri )
+    {
+        msg_Warn( p_access, "no partial segments with encryption" );
+        p_sys->b_partial = false;
+    }
+
+    msg_Dbg( p_access, "fragmented MP4 segments, initialization in %s",
+             p_sys->psz_initPath );
+    p_sys->b_fmp4 = true;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * writeInitSegment: write the ftyp and moov boxes to their own file
+ *****************************************************************************/
+static int writeInitSegment( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_t *init = block_ChainGather( p_sys->init_buffer );
+    if( unlikely( !init ) )
+        return -1;
+    p_sys->init_buffer = NULL;
+
+    p_sys->b_video = hasVideoTrack( init );
+    free( p_sys->psz_codecs );
+    p_sys->psz_codecs = getCodecs( init );
+
+    int fd = vlc_open( p_sys->psz_initPath, O_WRONLY | O_CREAT | O_LARGEFILE |
+                       O_TRUNC, 0666 );
+    if( fd == -1 )
+    {
+        msg_Err( p_access, "cannot open `%s' (%s)", p_sys->psz_initPath,
+                 vlc_strerror_c(errno) );
+        block_Release( init );
+        return -1;
+    }
+
+    ssize_t val = vlc_write( fd, init->p_buffer, init->i_buffer );
+    close( fd );
+    if( val < 0 || (size_t)val != init->i_buffer )
+    {
+        msg_Err( p_access, "cannot write `%s'", p_sys->psz_initPath );
+        block_Release( init );
+        return -1;
+    }
+
+    msg_Dbg( p_access, "LiveHttpInitComplete: %s", p_sys->psz_initPath );
+    block_Release( init );
+    return 0;
+}
+
+/*****************************************************************************
+ * writePart: append the buffered fragment to the current segment, the
+ * decode time of the next fragment gives its duration
+ *****************************************************************************/
+static ssize_t writePart( sout_access_out_t *p_access, mtime_t i_next_dts )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                vlc_array_count( p_sys->segments_t ) - 1 );
+
+    output_part_t *part = malloc( sizeof( *part ) );
+    if( unlikely( !part ) )
+        return -1;
+
+    ssize_t val = writeSegment( p_access );
+    if( val < 0 )
+    {
+        free( part );
+        return -1;
+    }
+
+    /* Durations are differences of the fragments decode times, so that
+     * rounding errors do not add up over the stream */
+    mtime_t i_end;
+    if( p_sys->i_part_dts > VLC_TS_INVALID && i_next_dts > p_sys->i_part_dts )
+        i_end = i_next_dts - p_sys->i_first_dts;
+    else if( p_sys->i_part_dts > VLC_TS_INVALID )
+        i_end = p_sys->i_part_dts - p_sys->i_first_dts + p_sys->i_part_length;
+    else
+        i_end = p_sys->i_media_time + p_sys->i_part_length;
+
+    part->i_offset = segment->i_size;
+    part->i_size = val;
+    part->i_duration = i_end - p_sys->i_media_time;
+    part->b_independent = p_sys->b_part_independent;
+    TAB_APPEND( segment->i_parts, segment->pp_parts, part );
+
+    segment->i_size += val;
+    segment->i_length = i_end - segment->i_start;
+    p_sys->i_media_time = i_end;
+    p_sys->i_part_max = __MAX( p_sys->i_part_max, part->i_duration );
+    p_sys->i_bytes += val;
+
+    p_sys->f_seglen = (float)segment->i_length / CLOCK_FREQ;
+    p_sys->b_segment_has_data = true;
+    return val;
+}
+
+/*****************************************************************************
+ * writeFragmented: buffer a block of the fragmented MP4 stream, writing
+ * every fragment (moof and mdat) once the next one starts
+ *****************************************************************************/
+static ssize_t writeFragmented( sout_access_out_t *p_access, block_t *p_block )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    ssize_t i_write = 0;
+
+    if( p_block->i_flags & BLOCK_FLAG_HEADER )
+    {
+        block_ChainAppend( &p_sys->init_buffer, p_block );
+        return 0;
+    }
+
+    if( !isBox( p_block, "moof" ) )
+    {
+        block_ChainAppend( &p_sys->block_buffer, p_block );
+        return 0;
+    }
+
+    if( p_sys->init_buffer )
+    {
+        if( writeInitSegment( p_access ) < 0 )
+        {
+            block_Release( p_block );
+            return -1;
+        }
+        if( p_sys->i_start_time == 0 )
+            p_sys->i_start_time = time( NULL );
+    }
+
+    if( p_sys->block_buffer && p_sys->i_handle >= 0 )
+    {
+        i_write = writePart( p_access, p_block->i_dts );
+        if( i_write < 0 )
+        {
+            block_Release( p_block );
+            return -1;
+        }
+
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    vlc_array_count( p_sys->segments_t ) - 1 );
+        if( ( p_sys->b_splitanywhere || ( p_block->i_flags & BLOCK_FLAG_TYPE_I ) ) &&
+            segment->i_length + p_block->i_length > p_sys->i_seglenm )
+            closeCurrentSegment( p_access, p_sys, false );
+        else if( p_sys->b_partial )
+            updateIndexAndDel( p_access, p_sys, false );
+    }
+    else
+    {
+        /* nothing to put it in */
+        block_ChainRelease( p_sys->block_buffer );
+        p_sys->block_buffer = NULL;
+    }
+
+    if( p_sys->i_handle < 0 )
+    {
+        if( openNextFile( p_access, p_sys ) < 0 )
+        {
+            block_Release( p_block );
+            return -1;
+        }
+        output_segment_t *segment = vlc_array_item_at_index( p_sys->segments_t,
+                                    vlc_array_count( p_sys->segments_t ) - 1 );
+        segment->i_start = p_sys->i_media_time;
+    }
+
+    if( p_sys->i_first_dts == VLC_TS_INVALID )
+        p_sys->i_first_dts = p_block->i_dts;
+    p_sys->i_part_dts = p_block->i_dts;
+    p_sys->i_part_length = p_block->i_length;
+    p_sys->b_part_independent = p_block->i_flags & BLOCK_FLAG_TYPE_I;
+    block_ChainAppend( &p_sys->block_buffer, p_block );
+    return i_write;
+}
+
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
@@ -1025,6 +1958,31 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     block_t *p_temp;
     while( p_buffer )
     {
+        /* fragmented MP4 streams start with their ftyp box */
+        if( unlikely( !p_sys->b_fmp4 && p_sys->i_handle < 0 &&
+                      ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) &&
+                      isBox( p_buffer, "ftyp" ) ) &&
+            setupFragmented( p_access ) != VLC_SUCCESS )
+        {
+            block_ChainRelease ( p_buffer );
+            return -1;
+        }
+
+        if( p_sys->b_fmp4 )
+        {
+            p_temp = p_buffer->p_next;
+            p_buffer->p_next = NULL;
+            ssize_t writevalue = writeFragmented( p_access, p_buffer );
+            if( unlikely( writevalue < 0 ) )
+            {
+                block_ChainRelease ( p_temp );
+                return -1;
+            }
+            i_write += writevalue;
+            p_buffer = p_temp;
+            continue;
+        }
+
         if( ( p_sys->b_splitanywhere  || ( p_buffer->i_flags & BLOCK_FLAG_HEADER ) ) )
         {
             if( unlikely( CheckSegmentChange( p_access, p_buffer ) != VLC_SUCCESS ) )
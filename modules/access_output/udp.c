@@ -46,11 +46,33 @@
 #else
 #   include <sys/socket.h>
 #endif
+#ifdef __linux__
+#   include <netinet/udp.h>
+#endif
 
 #include <vlc_network.h>
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Pacing timer wheel: packets are scheduled into slots of one millisecond */
+#define SLOT_DURATION 1000
+#define WHEEL_SLOTS   1024
+
+/* Maximum number of packets sent with a single system call */
+#define SEND_BATCH 64
+
+#if defined(HAVE_SENDMMSG) && defined(UDP_SEGMENT)
+/* UDP generic segmentation offload limits */
+# define GSO_MAX_SEGMENTS 64
+# define GSO_MAX_SIZE     65000
+#endif
+
+/* Packets sent later than this are accounted as late */
+#define LATE_THRESHOLD 20000
+
+/* Send timing statistics are published at most this often */
+#define STATS_PERIOD CLOCK_FREQ
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -64,12 +86,10 @@ static void Close( vlc_object_t * );
     "Default caching value for outbound UDP streams. This " \
     "value should be set in milliseconds." )
 
-#define GROUP_TEXT N_("Group packets")
-#define GROUP_LONGTEXT N_("Packets can be sent one by one at the right time " \
-                          "or by groups. You can choose the number " \
-                          "of packets that will be sent at a time. It " \
-                          "helps reducing the scheduling load on " \
-                          "heavily-loaded systems." )
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split groups of packets into " \
+                        "datagrams (UDP GSO), if it supports it. This " \
+                        "reduces the CPU load of high bit rate streams." )
 
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
@@ -77,8 +97,8 @@ vlc_module_begin ()
     set_category( CAT_SOUT )
     set_subcategory( SUBCAT_SOUT_ACO )
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
-    add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
-                                 true )
+    add_obsolete_integer( SOUT_CFG_PREFIX "group" ) /* since 3.0.0 */
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT, true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -91,7 +111,7 @@ vlc_module_end ()
 
 static const char *const ppsz_sout_options[] = {
     "caching",
-    "group",
+    "gso",
     NULL
 };
 
@@ -109,12 +129,20 @@ static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
 static block_t *NewUDPPacket( sout_access_out_t *, mtime_t );
+static void PublishStats( sout_access_out_t * );
+
+typedef struct
+{
+    block_t      *p_first;
+    block_t     **pp_last;
+} udp_slot_t;
 
 struct sout_access_out_sys_t
 {
     mtime_t       i_caching;
     int           i_handle;
     bool          b_mtu_warning;
+    bool          b_gso;
     size_t        i_mtu;
 
     block_fifo_t *p_fifo;
@@ -122,6 +150,22 @@ struct sout_access_out_sys_t
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    /* Pacing state (sending thread only) */
+    udp_slot_t    wheel[WHEEL_SLOTS];
+    mtime_t       i_wheel_tick; /* tick of the earliest pending slot */
+    unsigned      i_wheel_count; /* packets in the wheel */
+    udp_slot_t    overflow; /* packets beyond the wheel horizon */
+    block_t      *p_sending;
+    mtime_t       i_date_last;
+    unsigned      i_dropped_packets;
+
+    /* Send timing statistics (sending thread only) */
+    uint64_t      i_late_packets;
+    mtime_t       i_max_lateness;
+    mtime_t       i_last_lateness;
+    mtime_t       i_jitter;
+    mtime_t       i_stats_date; /* next publication of the statistics */
 };
 
 #define DEFAULT_PORT 1234
@@ -214,6 +258,44 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_empty_blocks = block_FifoNew();
     p_sys->p_buffer = NULL;
 
+    for( unsigned i = 0; i < WHEEL_SLOTS; i++ )
+    {
+        p_sys->wheel[i].p_first = NULL;
+        p_sys->wheel[i].pp_last = &p_sys->wheel[i].p_first;
+    }
+    p_sys->i_wheel_tick = 0;
+    p_sys->i_wheel_count = 0;
+    p_sys->overflow.p_first = NULL;
+    p_sys->overflow.pp_last = &p_sys->overflow.p_first;
+    p_sys->p_sending = NULL;
+    p_sys->i_date_last = -1;
+    p_sys->i_dropped_packets = 0;
+
+    /* Send timing statistics */
+    p_sys->i_late_packets = 0;
+    p_sys->i_max_lateness = 0;
+    p_sys->i_last_lateness = 0;
+    p_sys->i_jitter = 0;
+    p_sys->i_stats_date = 0;
+    var_Create( p_access, "late-packets", VLC_VAR_INTEGER );
+    var_Create( p_access, "max-lateness", VLC_VAR_INTEGER );
+    var_Create( p_access, "send-jitter", VLC_VAR_INTEGER );
+
+    p_sys->b_gso = false;
+#ifdef GSO_MAX_SEGMENTS
+    if( var_GetBool( p_access, SOUT_CFG_PREFIX "gso" ) )
+    {
+        int val;
+        socklen_t len = sizeof (val);
+
+        /* Check that the kernel supports UDP segmentation offload */
+        p_sys->b_gso = getsockopt( i_handle, SOL_UDP, UDP_SEGMENT,
+                                   &val, &len ) == 0;
+        msg_Dbg( p_access, "UDP segmentation offload %s",
+                 p_sys->b_gso ? "enabled" : "not supported" );
+    }
+#endif
+
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
@@ -242,6 +324,7 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
+    PublishStats( p_access );
     block_FifoRelease( p_sys->p_fifo );
     block_FifoRelease( p_sys->p_empty_blocks );
 
@@ -393,75 +476,368 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
 }
 
 /*****************************************************************************
- * ThreadWrite: Write a packet on the network at the good time.
+ * Pacing: packets are scheduled into a timer wheel of one millisecond slots.
+ * Each slot is sent at once when its time has come.
  *****************************************************************************/
-static void* ThreadWrite( void *data )
+static void SlotAppend( udp_slot_t *p_slot, block_t *p_pk )
+{
+    p_pk->p_next = NULL;
+    *p_slot->pp_last = p_pk;
+    p_slot->pp_last = &p_pk->p_next;
+}
+
+static block_t *SlotTake( udp_slot_t *p_slot )
+{
+    block_t *p_chain = p_slot->p_first;
+
+    p_slot->p_first = NULL;
+    p_slot->pp_last = &p_slot->p_first;
+    return p_chain;
+}
+
+static void WheelInsert( sout_access_out_sys_t *p_sys, block_t *p_pk )
+{
+    mtime_t i_tick = (p_pk->i_dts + p_sys->i_caching) / SLOT_DURATION;
+
+    if( p_sys->i_wheel_count == 0 && p_sys->overflow.p_first == NULL )
+        p_sys->i_wheel_tick = i_tick;
+
+    if( i_tick >= p_sys->i_wheel_tick + WHEEL_SLOTS )
+    {   /* Too far ahead: keep it aside until the wheel gets there */
+        SlotAppend( &p_sys->overflow, p_pk );
+        return;
+    }
+    if( i_tick < p_sys->i_wheel_tick )
+        i_tick = p_sys->i_wheel_tick; /* late: send as soon as possible */
+
+    SlotAppend( &p_sys->wheel[i_tick % WHEEL_SLOTS], p_pk );
+    p_sys->i_wheel_count++;
+}
+
+/* Moves packets from the overflow list into the wheel if they now fit */
+static void WheelRefill( sout_access_out_sys_t *p_sys )
+{
+    block_t *p_pk;
+
+    while( (p_pk = p_sys->overflow.p_first) != NULL
+        && (p_pk->i_dts + p_sys->i_caching) / SLOT_DURATION
+            < p_sys->i_wheel_tick + WHEEL_SLOTS )
+    {
+        p_sys->overflow.p_first = p_pk->p_next;
+        if( p_sys->overflow.p_first == NULL )
+            p_sys->overflow.pp_last = &p_sys->overflow.p_first;
+        WheelInsert( p_sys, p_pk );
+    }
+}
+
+/* Advances the wheel to the next non-empty slot, returns its date */
+static mtime_t WheelNext( sout_access_out_sys_t *p_sys )
+{
+    if( p_sys->i_wheel_count == 0 )
+    {
+        block_t *p_pk = p_sys->overflow.p_first;
+
+        assert( p_pk != NULL );
+        p_sys->i_wheel_tick = (p_pk->i_dts + p_sys->i_caching)
+                            / SLOT_DURATION;
+        WheelRefill( p_sys );
+    }
+
+    while( p_sys->wheel[p_sys->i_wheel_tick % WHEEL_SLOTS].p_first == NULL )
+    {
+        p_sys->i_wheel_tick++;
+        WheelRefill( p_sys );
+    }
+    return p_sys->i_wheel_tick * SLOT_DURATION;
+}
+
+static void WheelFlush( void *data )
+{
+    sout_access_out_sys_t *p_sys = data;
+
+    for( unsigned i = 0; i < WHEEL_SLOTS; i++ )
+        block_ChainRelease( SlotTake( &p_sys->wheel[i] ) );
+    block_ChainRelease( SlotTake( &p_sys->overflow ) );
+    block_ChainRelease( p_sys->p_sending );
+    p_sys->p_sending = NULL;
+    p_sys->i_wheel_count = 0;
+}
+
+/* Schedules packets from the FIFO, dropping them across large holes */
+static void Schedule( sout_access_out_t *p_access, block_t *p_chain )
 {
-    sout_access_out_t *p_access = data;
     sout_access_out_sys_t *p_sys = p_access->p_sys;
-    mtime_t i_date_last = -1;
-    const unsigned i_group = var_GetInteger( p_access,
-                                             SOUT_CFG_PREFIX "group" );
-    mtime_t i_to_send = i_group;
-    unsigned i_dropped_packets = 0;
 
-    for (;;)
+    while( p_chain != NULL )
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
-        mtime_t       i_date, i_sent;
+        block_t *p_pk = p_chain;
+        mtime_t i_date = p_sys->i_caching + p_pk->i_dts;
+
+        p_chain = p_pk->p_next;
 
-        i_date = p_sys->i_caching + p_pk->i_dts;
-        if( i_date_last > 0 )
+        if( p_sys->i_date_last > 0 )
         {
-            if( i_date - i_date_last > 2000000 )
+            if( i_date - p_sys->i_date_last > 2000000 )
             {
-                if( !i_dropped_packets )
+                if( !p_sys->i_dropped_packets )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
-                             i_date - i_date_last );
+                             i_date - p_sys->i_date_last );
 
+                p_pk->p_next = NULL;
                 block_FifoPut( p_sys->p_empty_blocks, p_pk );
 
-                i_date_last = i_date;
-                i_dropped_packets++;
+                p_sys->i_date_last = i_date;
+                p_sys->i_dropped_packets++;
                 continue;
             }
-            else if( i_date - i_date_last < -1000 )
+            else if( i_date - p_sys->i_date_last < -1000 )
             {
-                if( !i_dropped_packets )
+                if( !p_sys->i_dropped_packets )
                     msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
-                             i_date_last - i_date );
+                             p_sys->i_date_last - i_date );
             }
         }
 
-        block_cleanup_push( p_pk );
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+        if( p_sys->i_dropped_packets )
         {
-            mwait( i_date );
-            i_to_send = i_group;
+            msg_Dbg( p_access, "dropped %u packets",
+                     p_sys->i_dropped_packets );
+            p_sys->i_dropped_packets = 0;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
-        vlc_cleanup_pop();
 
-        if( i_dropped_packets )
-        {
-            msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
-            i_dropped_packets = 0;
-        }
+        WheelInsert( p_sys, p_pk );
+        p_sys->i_date_last = i_date;
+    }
+}
+
+/*****************************************************************************
+ * SendBatch: send up to SEND_BATCH packets from a chain with as few system
+ * calls as possible. Returns the first packet not sent yet.
+ *****************************************************************************/
+#ifdef HAVE_SENDMMSG
+static block_t *SendBatch( sout_access_out_t *p_access, block_t *p_chain )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct mmsghdr msgs[SEND_BATCH];
+    struct iovec iovs[SEND_BATCH];
+    block_t *firsts[SEND_BATCH + 1];
+#ifdef GSO_MAX_SEGMENTS
+    union
+    {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof (uint16_t))];
+    } ctrls[SEND_BATCH];
+#endif
+    unsigned i_msg = 0, i_iov = 0;
+    block_t *p_pk = p_chain;
+
+    while( p_pk != NULL && i_iov < SEND_BATCH )
+    {
+        struct msghdr *hdr = &msgs[i_msg].msg_hdr;
+        size_t i_segment = p_pk->i_buffer;
+
+        firsts[i_msg] = p_pk;
+        *hdr = (struct msghdr){ .msg_iov = &iovs[i_iov], .msg_iovlen = 1 };
+        iovs[i_iov++] = (struct iovec){ p_pk->p_buffer, p_pk->i_buffer };
+        p_pk = p_pk->p_next;
 
-#if 1
-        i_sent = mdate();
-        if ( i_sent > i_date + 20000 )
+#ifdef GSO_MAX_SEGMENTS
+        if( p_sys->b_gso && i_segment > 0 )
         {
-            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
-                     i_sent - i_date );
+            /* Coalesce packets of the same size (the last one may be
+             * shorter) into a single segmented datagram */
+            size_t i_total = i_segment;
+
+            while( p_pk != NULL && i_iov < SEND_BATCH
+                && hdr->msg_iovlen < GSO_MAX_SEGMENTS
+                && p_pk->i_buffer > 0 && p_pk->i_buffer <= i_segment
+                && i_total + p_pk->i_buffer <= GSO_MAX_SIZE )
+            {
+                bool b_last = p_pk->i_buffer < i_segment;
+
+                iovs[i_iov++] = (struct iovec){ p_pk->p_buffer,
+                                                p_pk->i_buffer };
+                hdr->msg_iovlen++;
+                i_total += p_pk->i_buffer;
+                p_pk = p_pk->p_next;
+                if( b_last )
+                    break;
+            }
+
+            if( hdr->msg_iovlen > 1 )
+            {
+                struct cmsghdr *cmsg;
+
+                hdr->msg_control = ctrls[i_msg].buf;
+                hdr->msg_controllen = sizeof (ctrls[i_msg].buf);
+                cmsg = CMSG_FIRSTHDR( hdr );
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof (uint16_t));
+                *(uint16_t *)CMSG_DATA( cmsg ) = i_segment;
+            }
         }
+#else
+        (void) i_segment;
+#endif
+        i_msg++;
+    }
+    firsts[i_msg] = p_pk;
+
+    int val = sendmmsg( p_sys->i_handle, msgs, i_msg, 0 );
+    if( val == (int)i_msg )
+        return firsts[i_msg];
+
+    /* sendmmsg() stops at the first datagram that cannot be sent, and only
+     * reports its error if no datagram was sent at all: send it again on its
+     * own to get the error */
+    unsigned i_failed = 0;
+
+    if( val > 0 )
+    {
+        i_failed = val;
+        if( sendmsg( p_sys->i_handle, &msgs[i_failed].msg_hdr, 0 ) >= 0 )
+            return firsts[i_failed + 1];
+    }
+
+#ifdef GSO_MAX_SEGMENTS
+    if( p_sys->b_gso && (errno == EIO || errno == EINVAL) )
+    {   /* The device or the path cannot segment: send datagrams one by one */
+        msg_Warn( p_access, "UDP segmentation offload failed: %s",
+                  vlc_strerror_c(errno) );
+        p_sys->b_gso = false;
+        return firsts[i_failed];
+    }
 #endif
+    msg_Warn( p_access, "send error on datagram %u of %u: %s", i_failed + 1,
+              i_msg, vlc_strerror_c(errno) );
+    return firsts[i_failed + 1]; /* skip the failing datagram only */
+}
+#else
+static block_t *SendBatch( sout_access_out_t *p_access, block_t *p_pk )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    for( unsigned i = 0; i < SEND_BATCH && p_pk != NULL; i++ )
+    {
+        if( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+        p_pk = p_pk->p_next;
+    }
+    return p_pk;
+}
+#endif
+
+/*****************************************************************************
+ * PublishStats: export the send timing statistics to the object variables.
+ *****************************************************************************/
+static void PublishStats( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    var_SetInteger( p_access, "late-packets", p_sys->i_late_packets );
+    var_SetInteger( p_access, "max-lateness", p_sys->i_max_lateness );
+    var_SetInteger( p_access, "send-jitter", p_sys->i_jitter );
+}
+
+/*****************************************************************************
+ * SendSlot: send the packets of the current slot and account their timing.
+ *****************************************************************************/
+static void SendSlot( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    udp_slot_t *p_slot = &p_sys->wheel[p_sys->i_wheel_tick % WHEEL_SLOTS];
+    block_t *p_pk;
+
+    p_sys->p_sending = SlotTake( p_slot );
+
+    for( p_pk = p_sys->p_sending; p_pk != NULL; p_pk = SendBatch( p_access,
+                                                                   p_pk ) );
+
+    /* Account the send lateness, and the jitter as in RFC 3550 */
+    mtime_t i_sent = mdate();
+    mtime_t i_lateness = 0;
+    unsigned i_late = 0;
 
+    while( (p_pk = p_sys->p_sending) != NULL )
+    {
+        mtime_t i_delta = i_sent - (p_sys->i_caching + p_pk->i_dts);
+
+        if( i_delta < 0 )
+            i_delta = 0; /* up to one slot early */
+        if( i_delta > LATE_THRESHOLD )
+            i_late++;
+        if( i_delta > i_lateness )
+            i_lateness = i_delta;
+
+        mtime_t i_diff = i_delta - p_sys->i_last_lateness;
+        if( i_diff < 0 )
+            i_diff = -i_diff;
+        p_sys->i_jitter += (i_diff - p_sys->i_jitter) / 16;
+        p_sys->i_last_lateness = i_delta;
+
+        p_sys->p_sending = p_pk->p_next;
+        p_sys->i_wheel_count--;
+        p_pk->p_next = NULL;
         block_FifoPut( p_sys->p_empty_blocks, p_pk );
+    }
+
+    if( i_late > 0 )
+    {
+        msg_Dbg( p_access, "%u packet(s) sent too late (%"PRId64 ")",
+                 i_late, i_lateness );
+        p_sys->i_late_packets += i_late;
+    }
+    if( i_lateness > p_sys->i_max_lateness )
+        p_sys->i_max_lateness = i_lateness;
 
-        i_date_last = i_date;
+    if( i_sent >= p_sys->i_stats_date )
+    {
+        PublishStats( p_access );
+        p_sys->i_stats_date = i_sent + STATS_PERIOD;
     }
+}
+
+/*****************************************************************************
+ * ThreadWrite: Write packets on the network at the good time.
+ *****************************************************************************/
+static void* ThreadWrite( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    block_fifo_t *p_fifo = p_sys->p_fifo;
+
+    vlc_cleanup_push( WheelFlush, p_sys );
+    for (;;)
+    {
+        block_t *p_chain;
+
+        vlc_fifo_Lock( p_fifo );
+        vlc_fifo_CleanupPush( p_fifo );
+        while( vlc_fifo_IsEmpty( p_fifo ) && p_sys->i_wheel_count == 0
+            && p_sys->overflow.p_first == NULL )
+            vlc_fifo_Wait( p_fifo );
+        p_chain = vlc_fifo_DequeueAllUnlocked( p_fifo );
+        vlc_cleanup_pop();
+        vlc_fifo_Unlock( p_fifo );
+
+        Schedule( p_access, p_chain );
+        if( p_sys->i_wheel_count == 0 && p_sys->overflow.p_first == NULL )
+            continue; /* everything was dropped */
+
+        mwait( WheelNext( p_sys ) );
+
+        /* Packets queued in the mean time may belong to this slot */
+        vlc_fifo_Lock( p_fifo );
+        p_chain = vlc_fifo_DequeueAllUnlocked( p_fifo );
+        vlc_fifo_Unlock( p_fifo );
+        Schedule( p_access, p_chain );
+
+        int canc = vlc_savecancel();
+        SendSlot( p_access );
+        vlc_restorecancel( canc );
+    }
+    vlc_cleanup_pop();
+
     return NULL;
 }
@@ -56,9 +56,10 @@ PlaylistManager::PlaylistManager( AbstractPlaylist *pl,
 
 PlaylistManager::~PlaylistManager   ()
 {
-    delete conManager;
+    /* streams first, they stop their downloads */
     for(int i=0; i<StreamTypeCount; i++)
         delete streams[i];
+    delete conManager;
 }
 
 bool PlaylistManager::start(demux_t *demux)
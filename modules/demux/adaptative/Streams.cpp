@@ -21,6 +21,7 @@
 #include "StreamsType.hpp"
 #include "http/HTTPConnection.hpp"
 #include "http/HTTPConnectionManager.h"
+#include "http/Downloader.hpp"
 #include "http/Chunk.h"
 #include "logic/AbstractAdaptationLogic.h"
 #include "SegmentTracker.hpp"
@@ -31,6 +32,9 @@ using namespace adaptative;
 using namespace adaptative::http;
 using namespace adaptative::logic;
 
+/* Number of chunks downloaded ahead of the demuxer, including the current one */
+const unsigned Stream::PREFETCHCHUNKS = 3;
+
 Stream::Stream(const std::string &mime)
 {
     init(mimeToType(mime), mimeToFormat(mime));
@@ -45,16 +49,17 @@ void Stream::init(const StreamType type_, const StreamFormat format_)
 {
     type = type_;
     format = format_;
+    realdemux = NULL;
     output = NULL;
     adaptationLogic = NULL;
-    currentChunk = NULL;
+    downloader = NULL;
     eof = false;
     segmentTracker = NULL;
 }
 
 Stream::~Stream()
 {
-    delete currentChunk;
+    delete downloader;
     delete adaptationLogic;
     delete output;
     delete segmentTracker;
@@ -92,6 +97,7 @@ StreamFormat Stream::mimeToFormat(const std::string &mime)
 void Stream::create(demux_t *demux, AbstractAdaptationLogic *logic,
                     SegmentTracker *tracker, AbstractStreamOutputFactory &factory)
 {
+    realdemux = demux;
     output = factory.create(demux, format);
     adaptationLogic = logic;
     segmentTracker = tracker;
@@ -127,15 +133,20 @@ bool Stream::operator ==(const Stream &stream) const
     return stream.type == type;
 }
 
-Chunk * Stream::getChunk()
+/* Representations are selected when the chunks are scheduled, so the
+ * adaptation happens PREFETCHCHUNKS chunks ahead of the demuxer */
+void Stream::prefetch()
 {
-    if (currentChunk == NULL)
+    while(downloader->getScheduled() < PREFETCHCHUNKS)
     {
-        currentChunk = segmentTracker->getNextChunk(type, output->switchAllowed());
-        if (currentChunk == NULL)
+        Chunk *chunk = segmentTracker->getNextChunk(type, output->switchAllowed());
+        if(chunk == NULL)
+        {
             eof = true;
+            break;
+        }
+        downloader->schedule(chunk);
     }
-    return currentChunk;
 }
 
 bool Stream::seekAble() const
@@ -162,68 +173,27 @@ Stream::status Stream::demux(HTTPConnectionManager *connManager, mtime_t nz_dead
 
 size_t Stream::read(HTTPConnectionManager *connManager)
 {
-    Chunk *chunk = getChunk();
-    if(!chunk)
-        return 0;
-
-    if(!chunk->getConnection())
+    if(!downloader)
     {
-       if(!connManager->connectChunk(chunk))
-        return 0;
-    }
-
-    size_t readsize = 0;
-
-    /* New chunk, do query */
-    if(chunk->getBytesRead() == 0)
-    {
-        if(chunk->getConnection()->query(chunk->getPath()) != VLC_SUCCESS)
+        downloader = new (std::nothrow) Downloader(VLC_OBJECT(realdemux), connManager,
+                                                   adaptationLogic);
+        if(!downloader)
+            return 0;
+        if(!downloader->start())
         {
-            chunk->getConnection()->releaseChunk();
-            currentChunk = NULL;
-            delete chunk;
+            delete downloader;
+            downloader = NULL;
             return 0;
         }
     }
 
-    /* Because we don't know Chunk size at start, we need to get size
-       from content length */
-    readsize = chunk->getBytesToRead();
-    if (readsize > 32768)
-        readsize = 32768;
+    prefetch();
 
-    block_t *block = block_Alloc(readsize);
+    block_t *block = downloader->read();
     if(!block)
         return 0;
 
-    mtime_t time = mdate();
-    ssize_t ret = chunk->getConnection()->read(block->p_buffer, readsize);
-    time = mdate() - time;
-
-    if(ret < 0)
-    {
-        block_Release(block);
-        chunk->getConnection()->releaseChunk();
-        currentChunk = NULL;
-        delete chunk;
-        return 0;
-    }
-    else
-    {
-        block->i_buffer = (size_t)ret;
-
-        adaptationLogic->updateDownloadRate(block->i_buffer, time);
-        chunk->onDownload(&block);
-
-        if (chunk->getBytesToRead() == 0)
-        {
-            chunk->getConnection()->releaseChunk();
-            currentChunk = NULL;
-            delete chunk;
-        }
-    }
-
-    readsize = block->i_buffer;
+    size_t readsize = block->i_buffer;
 
     output->pushBlock(block);
 
@@ -236,15 +206,9 @@ bool Stream::setPosition(mtime_t time, bool tryonly)
     if(!tryonly && ret)
     {
         output->setPosition(time);
-        if(output->reinitsOnSeek())
-        {
-            if(currentChunk)
-            {
-                currentChunk->getConnection()->releaseChunk();
-                delete currentChunk;
-            }
-            currentChunk = NULL;
-        }
+        /* chunks prefetched from the previous position are now useless */
+        if(downloader)
+            downloader->flush(!output->reinitsOnSeek());
     }
     return ret;
 }
@@ -37,7 +37,7 @@ namespace adaptative
     namespace http
     {
         class HTTPConnectionManager;
-        class Chunk;
+        class Downloader;
     }
 
     namespace logic
@@ -75,16 +75,19 @@ namespace adaptative
         mtime_t getPosition() const;
         void prune();
 
+        static const unsigned PREFETCHCHUNKS;
+
     private:
-        Chunk *getChunk();
+        void prefetch();
         void init(const StreamType, const StreamFormat);
         size_t read(HTTPConnectionManager *);
         StreamType type;
         StreamFormat format;
+        demux_t *realdemux;
         AbstractStreamOutput *output;
         AbstractAdaptationLogic *adaptationLogic;
         SegmentTracker *segmentTracker;
-        http::Chunk *currentChunk;
+        http::Downloader *downloader;
         bool eof;
     };
 
@@ -0,0 +1,367 @@
+/*
+ * Downloader.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "Downloader.hpp"
+#include "HTTPConnection.hpp"
+#include "HTTPConnectionManager.h"
+#include "Chunk.h"
+#include "../logic/IDownloadRateObserver.h"
+
+#include <vlc_block.h>
+
+using namespace adaptative::http;
+using namespace adaptative::logic;
+
+/* No new chunk is started above that, the current one is always completed */
+const size_t Downloader::MAXBUFFERSIZE = 8 * 1024 * 1024;
+
+Downloader::Downloader(vlc_object_t *stream_, HTTPConnectionManager *manager,
+                       IDownloadRateObserver *observer)
+{
+    stream = stream_;
+    connManager = manager;
+    rateObserver = observer;
+    current = NULL;
+    interrupt = NULL;
+    aborted = false;
+    buffered = 0;
+    killed = false;
+    started = false;
+    vlc_mutex_init(&lock);
+    vlc_cond_init(&cond);
+}
+
+Downloader::~Downloader()
+{
+    if(started)
+    {
+        vlc_mutex_lock(&lock);
+        killed = true;
+        /* the thread may be blocked on the network */
+        if(interrupt)
+            vlc_interrupt_kill(interrupt);
+        vlc_cond_signal(&cond);
+        vlc_mutex_unlock(&lock);
+
+        vlc_join(thread, NULL);
+    }
+
+    std::list<Download *>::const_iterator it;
+    for(it = downloads.begin(); it != downloads.end(); ++it)
+        release(*it);
+
+    vlc_cond_destroy(&cond);
+    vlc_mutex_destroy(&lock);
+}
+
+bool Downloader::start()
+{
+    if(vlc_clone(&thread, downloadThread, this, VLC_THREAD_PRIORITY_INPUT))
+        return false;
+    started = true;
+    return true;
+}
+
+void Downloader::schedule(Chunk *chunk)
+{
+    Download *dl = new (std::nothrow) Download(chunk);
+    if(!dl)
+    {
+        delete chunk;
+        return;
+    }
+
+    vlc_mutex_lock(&lock);
+    downloads.push_back(dl);
+    vlc_cond_broadcast(&cond);
+    vlc_mutex_unlock(&lock);
+}
+
+size_t Downloader::getScheduled() const
+{
+    vlc_mutex_lock(&lock);
+    size_t count = downloads.size();
+    vlc_mutex_unlock(&lock);
+    return count;
+}
+
+block_t * Downloader::read()
+{
+    block_t *block = NULL;
+
+    vlc_mutex_lock(&lock);
+    aborted = false;
+    vlc_mutex_unlock(&lock);
+
+    /* the demux thread must not wait for the network once interrupted */
+    vlc_interrupt_register(interrupted, this);
+
+    vlc_mutex_lock(&lock);
+
+    /* report completed downloads as soon as possible, not when read */
+    std::list<Download *>::const_iterator it;
+    for(it = downloads.begin(); it != downloads.end(); ++it)
+    {
+        Download *dl = *it;
+        if(dl->done && !dl->failed && !dl->reported)
+        {
+            rateObserver->updateDownloadRate(dl->size, dl->time);
+            dl->reported = true;
+        }
+    }
+
+    while(!downloads.empty())
+    {
+        Download *dl = downloads.front();
+        if(dl->p_queue)
+        {
+            block = dl->p_queue;
+            dl->p_queue = block->p_next;
+            if(dl->p_queue == NULL)
+                dl->pp_queue_last = &dl->p_queue;
+            block->p_next = NULL;
+            buffered -= block->i_buffer;
+            vlc_cond_broadcast(&cond);
+            break;
+        }
+
+        if(!dl->done)
+        {
+            if(aborted)
+                break;
+            vlc_cond_wait(&cond, &lock);
+            continue;
+        }
+
+        if(!dl->failed && !dl->reported)
+            rateObserver->updateDownloadRate(dl->size, dl->time);
+
+        downloads.pop_front();
+        const bool failed = dl->failed;
+        release(dl);
+        if(failed)
+            break;
+    }
+
+    vlc_mutex_unlock(&lock);
+    vlc_interrupt_unregister();
+
+    return block;
+}
+
+void Downloader::flush(bool keephead)
+{
+    vlc_mutex_lock(&lock);
+
+    std::list<Download *>::iterator first = downloads.begin();
+    if(keephead && first != downloads.end())
+        ++first;
+
+    std::list<Download *>::iterator it;
+    for(it = first; it != downloads.end(); ++it)
+        (*it)->cancel = true;
+
+    /* abort the transfer in progress rather than wait for its end */
+    if(current && current->cancel && interrupt)
+        vlc_interrupt_kill(interrupt);
+    while(current && current->cancel)
+        vlc_cond_wait(&cond, &lock);
+
+    for(it = first; it != downloads.end(); ++it)
+        release(*it);
+    downloads.erase(first, downloads.end());
+
+    vlc_cond_broadcast(&cond);
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::release(Download *dl)
+{
+    for(block_t *p_block = dl->p_queue; p_block; p_block = p_block->p_next)
+        buffered -= p_block->i_buffer;
+    connManager->releaseChunk(dl->chunk);
+    delete dl;
+}
+
+Downloader::Download * Downloader::getPending() const
+{
+    std::list<Download *>::const_iterator it;
+    for(it = downloads.begin(); it != downloads.end(); ++it)
+    {
+        if(!(*it)->done && !(*it)->cancel)
+            return *it;
+    }
+    return NULL;
+}
+
+void * Downloader::downloadThread(void *opaque)
+{
+    Downloader *me = (Downloader *) opaque;
+    me->run();
+    return NULL;
+}
+
+/* Aborts the transfer the demux thread waits for in read() */
+void Downloader::interrupted(void *opaque)
+{
+    Downloader *me = (Downloader *) opaque;
+
+    vlc_mutex_lock(&me->lock);
+    me->aborted = true;
+    if(me->interrupt)
+        vlc_interrupt_kill(me->interrupt);
+    vlc_cond_broadcast(&me->cond);
+    vlc_mutex_unlock(&me->lock);
+}
+
+void Downloader::run()
+{
+    vlc_mutex_lock(&lock);
+    for(;;)
+    {
+        Download *dl;
+        while(!killed &&
+              ((dl = getPending()) == NULL || buffered >= MAXBUFFERSIZE))
+            vlc_cond_wait(&cond, &lock);
+
+        if(killed)
+            break;
+
+        /* a killed context cannot be reused: one per transfer */
+        interrupt = vlc_interrupt_create();
+        if(unlikely(interrupt == NULL))
+        {
+            dl->failed = true;
+            dl->done = true;
+            vlc_cond_broadcast(&cond);
+            continue;
+        }
+        current = dl;
+        vlc_mutex_unlock(&lock);
+
+        vlc_interrupt_set(interrupt);
+        transfer(dl);
+        vlc_interrupt_set(NULL);
+
+        vlc_mutex_lock(&lock);
+        vlc_interrupt_destroy(interrupt);
+        interrupt = NULL;
+        dl->done = true;
+        current = NULL;
+        vlc_cond_broadcast(&cond);
+    }
+    vlc_mutex_unlock(&lock);
+}
+
+void Downloader::transfer(Download *dl)
+{
+    Chunk *chunk = dl->chunk;
+    bool failed = false;
+
+    /* Measure the time spent on the network only, from the request to the
+     * last byte, so that waiting for the demuxer does not lower the rate */
+    mtime_t time = mdate();
+    if(!connManager->connectChunk(chunk) ||
+       chunk->getConnection()->query(chunk->getPath()) != VLC_SUCCESS)
+    {
+        connManager->releaseChunk(chunk);
+        vlc_mutex_lock(&lock);
+        dl->failed = true;
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+    time = mdate() - time;
+
+    /* Because we don't know Chunk size at start, we need to get size
+       from content length */
+    while(chunk->getBytesToRead() > 0)
+    {
+        size_t readsize = chunk->getBytesToRead();
+        if (readsize > 32768)
+            readsize = 32768;
+
+        block_t *block = block_Alloc(readsize);
+        if(!block)
+        {
+            failed = true;
+            break;
+        }
+
+        mtime_t start = mdate();
+        ssize_t ret = chunk->getConnection()->read(block->p_buffer, readsize);
+        time += mdate() - start;
+
+        if(ret < 0)
+        {
+            block_Release(block);
+            failed = true;
+            break;
+        }
+
+        block->i_buffer = (size_t)ret;
+        chunk->onDownload(&block);
+
+        vlc_mutex_lock(&lock);
+        dl->size += ret;
+        buffered += block->i_buffer;
+        block_ChainLastAppend(&dl->pp_queue_last, block);
+        vlc_cond_broadcast(&cond);
+        const bool stop = killed || dl->cancel;
+        vlc_mutex_unlock(&lock);
+
+        if(stop)
+        {
+            failed = true;
+            break;
+        }
+    }
+
+    connManager->releaseChunk(chunk);
+    vlc_mutex_lock(&lock);
+    dl->time = time;
+    dl->failed = failed;
+    vlc_mutex_unlock(&lock);
+
+    if(!failed)
+        msg_Dbg(stream, "Downloaded %s: %zu bytes in %" PRId64 " us",
+                chunk->getUrl().c_str(), dl->size, time);
+}
+
+Downloader::Download::Download(Chunk *chunk_)
+{
+    chunk = chunk_;
+    p_queue = NULL;
+    pp_queue_last = &p_queue;
+    size = 0;
+    time = 0;
+    done = false;
+    failed = false;
+    cancel = false;
+    reported = false;
+}
+
+Downloader::Download::~Download()
+{
+    block_ChainRelease(p_queue);
+    delete chunk;
+}
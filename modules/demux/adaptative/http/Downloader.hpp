@@ -0,0 +1,105 @@
+/*
+ * Downloader.hpp
+ *****************************************************************************
+ * Copyright (C) 2026 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef DOWNLOADER_HPP
+#define DOWNLOADER_HPP
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_interrupt.h>
+#include <list>
+
+namespace adaptative
+{
+    namespace logic
+    {
+        class IDownloadRateObserver;
+    }
+
+    namespace http
+    {
+        class HTTPConnectionManager;
+        class Chunk;
+
+        /* Downloads the scheduled chunks of one stream, in order, on its own
+         * thread. The data is buffered until read() by the demux thread,
+         * which also deletes the chunks and reports the throughput of each
+         * of them to the rate observer. Each transfer has its own interrupt
+         * context, killed to abort it, and an interruption of the demux
+         * thread aborts the transfer it waits for. */
+        class Downloader
+        {
+            public:
+                Downloader(vlc_object_t *, HTTPConnectionManager *,
+                           logic::IDownloadRateObserver *);
+                ~Downloader();
+
+                bool    start       ();
+                void    schedule    (Chunk *);
+                size_t  getScheduled() const;
+                block_t *read       ();
+                void    flush       (bool);
+
+                static const size_t MAXBUFFERSIZE;
+
+            private:
+                class Download
+                {
+                    friend class Downloader;
+                    Download(Chunk *);
+                    ~Download();
+                    Chunk    *chunk;
+                    block_t  *p_queue;
+                    block_t **pp_queue_last;
+                    size_t    size;
+                    mtime_t   time;
+                    bool      done;
+                    bool      failed;
+                    bool      cancel;
+                    bool      reported;
+                };
+
+                static void *downloadThread(void *);
+                static void interrupted(void *);
+                void run();
+                void transfer(Download *);
+                void release(Download *);
+                Download *getPending() const;
+
+                vlc_object_t                  *stream;
+                HTTPConnectionManager         *connManager;
+                logic::IDownloadRateObserver  *rateObserver;
+                std::list<Download *>          downloads;
+                Download                      *current;
+                vlc_interrupt_t               *interrupt;
+                bool                           aborted;
+                size_t                         buffered;
+                bool                           killed;
+                bool                           started;
+                vlc_thread_t                   thread;
+                mutable vlc_mutex_t            lock;
+                vlc_cond_t                     cond;
+        };
+    }
+}
+
+#endif // DOWNLOADER_HPP
@@ -34,6 +34,7 @@ HTTPConnection::HTTPConnection(vlc_object_t *stream_, Socket *socket_,
     stream = stream_;
     psz_useragent = var_InheritString(stream, "http-user-agent");
     toRead = 0;
+    port = 0;
     chunk = NULL;
     queryOk = false;
     retries = 0;
@@ -53,6 +54,7 @@ bool HTTPConnection::connect(const std::string &hostname, int port)
         return false;
 
     this->hostname = hostname;
+    this->port = port;
 
     return true;
 }
@@ -88,10 +90,9 @@ int HTTPConnection::query(const std::string &path)
     if(!send( header ))
     {
         socket->disconnect();
-        if(!connectionClose)
+        if(!connectionClose && retries++ < retryCount)
         {
-            /* server closed connection pipeline after last req. need new */
-            connectionClose = true;
+            /* server closed the kept alive connection after last req. need new */
             return query(path);
         }
         return VLC_EGENERIC;
@@ -101,15 +102,13 @@ int HTTPConnection::query(const std::string &path)
     if(i_ret == VLC_SUCCESS)
     {
         queryOk = true;
+        retries = 0;
     }
     else if(i_ret == VLC_EGENERIC)
     {
         socket->disconnect();
-        if(!connectionClose)
-        {
-            connectionClose = true;
+        if(!connectionClose && retries++ < retryCount)
             return query(path);
-        }
     }
 
     return i_ret;
@@ -172,14 +171,19 @@ int HTTPConnection::parseReply()
     if (replycode != 200 && replycode != 206)
         return VLC_ENOOBJ;
 
-    readLine();
+    line = readLine();
 
     while(!line.empty() && line.compare("\r\n"))
     {
         size_t split = line.find_first_of(':');
+        if(split == std::string::npos)
+        {
+            line = readLine();
+            continue;
+        }
         size_t value = split + 1;
 
-        while(line.at(value) == ' ')
+        while(value < line.length() && line.at(value) == ' ')
             value++;
 
         onHeader(line.substr(0, split), line.substr(value));
@@ -199,6 +203,11 @@ const std::string& HTTPConnection::getHostname() const
     return hostname;
 }
 
+int HTTPConnection::getPort() const
+{
+    return port;
+}
+
 void HTTPConnection::bindChunk(Chunk *chunk_)
 {
     if(chunk_ == chunk)
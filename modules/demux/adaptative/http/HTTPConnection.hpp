@@ -54,6 +54,7 @@ namespace adaptative
                 virtual bool    send        (const std::string &data);
 
                 const std::string&  getHostname () const;
+                int             getPort     () const;
                 virtual void    bindChunk   (Chunk *chunk);
                 virtual bool    isAvailable () const;
                 virtual void    releaseChunk();
@@ -68,6 +69,7 @@ namespace adaptative
                 int parseReply();
                 std::string readLine();
                 std::string hostname;
+                int port;
                 char * psz_useragent;
                 vlc_object_t *stream;
                 size_t toRead;
@@ -37,31 +37,42 @@ const uint64_t  HTTPConnectionManager::CHUNKDEFAULTBITRATE    = 1;
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *stream) :
                        stream                   (stream)
 {
+    vlc_mutex_init(&lock);
 }
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     this->closeAllConnections();
+    vlc_mutex_destroy(&lock);
 }
 
 void HTTPConnectionManager::closeAllConnections      ()
 {
     releaseAllConnections();
+    vlc_mutex_lock(&lock);
     vlc_delete_all(this->connectionPool);
+    vlc_mutex_unlock(&lock);
 }
 
 void HTTPConnectionManager::releaseAllConnections()
 {
+    vlc_mutex_lock(&lock);
     std::vector<HTTPConnection *>::iterator it;
     for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
         (*it)->releaseChunk();
+    vlc_mutex_unlock(&lock);
 }
 
-HTTPConnection * HTTPConnectionManager::getConnectionForHost(const std::string &hostname)
+/* Connections are kept alive once their chunk is released, and handed over
+ * to the next chunk from the same host. The pool only grows when all the
+ * connections to a host are busy, so it is bounded by the number of
+ * concurrent downloads. */
+HTTPConnection * HTTPConnectionManager::getConnectionForHost(const std::string &hostname, int port)
 {
     std::vector<HTTPConnection *>::const_iterator it;
     for(it = connectionPool.begin(); it != connectionPool.end(); ++it)
     {
-        if(!(*it)->getHostname().compare(hostname) && (*it)->isAvailable())
+        if(!(*it)->getHostname().compare(hostname) && (*it)->getPort() == port &&
+           (*it)->isAvailable())
             return *it;
     }
     return NULL;
@@ -77,29 +88,56 @@ bool HTTPConnectionManager::connectChunk(Chunk *chunk)
     msg_Dbg(stream, "Retrieving %s @%zu", chunk->getUrl().c_str(),
             chunk->getStartByte());
 
-    HTTPConnection *conn = getConnectionForHost(chunk->getHostname());
+    vlc_mutex_lock(&lock);
+    HTTPConnection *conn = getConnectionForHost(chunk->getHostname(), chunk->getPort());
     if(!conn)
     {
         const bool tls = (chunk->getScheme() == "https");
         Socket *socket = tls ? new (std::nothrow) TLSSocket(): new (std::nothrow) Socket();
         if(!socket)
+        {
+            vlc_mutex_unlock(&lock);
             return false;
+        }
         /* disable pipelined tls until we have ticket/resume session support */
         conn = new (std::nothrow) HTTPConnection(stream, socket, chunk, !tls);
         if(!conn)
         {
+            vlc_mutex_unlock(&lock);
             delete socket;
             return false;
         }
         connectionPool.push_back(conn);
-        if (!chunk->getConnection()->connect(chunk->getHostname(), chunk->getPort()))
-            return false;
     }
+    else
+    {
+        msg_Dbg(stream, "Reusing connection to %s:%d", chunk->getHostname().c_str(),
+                chunk->getPort());
+        conn->bindChunk(chunk);
+    }
+    vlc_mutex_unlock(&lock);
 
-    conn->bindChunk(chunk);
+    /* the connection is bound to the chunk, no other thread will use it */
+    if(!conn->connected() &&
+       !conn->connect(chunk->getHostname(), chunk->getPort()))
+    {
+        releaseChunk(chunk);
+        return false;
+    }
 
     if(chunk->getBitrate() <= 0)
         chunk->setBitrate(HTTPConnectionManager::CHUNKDEFAULTBITRATE);
 
     return true;
 }
+
+void HTTPConnectionManager::releaseChunk(Chunk *chunk)
+{
+    if(chunk == NULL)
+        return;
+
+    vlc_mutex_lock(&lock);
+    if(chunk->getConnection())
+        chunk->getConnection()->releaseChunk();
+    vlc_mutex_unlock(&lock);
+}
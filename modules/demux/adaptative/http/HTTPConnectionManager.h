@@ -49,14 +49,16 @@ namespace adaptative
                 void    closeAllConnections ();
                 void    releaseAllConnections ();
                 bool    connectChunk        (Chunk *chunk);
+                void    releaseChunk        (Chunk *chunk);
 
             private:
                 std::vector<HTTPConnection *>                       connectionPool;
                 vlc_object_t                                       *stream;
+                vlc_mutex_t                                         lock;
 
                 static const uint64_t   CHUNKDEFAULTBITRATE;
 
-                HTTPConnection * getConnectionForHost    (const std::string &hostname);
+                HTTPConnection * getConnectionForHost    (const std::string &hostname, int port);
         };
     }
 }
@@ -42,7 +42,7 @@ uint64_t Retrieve::HTTP(vlc_object_t *obj, const std::string &uri, void **pp_dat
         datachunk->getConnection()->query(datachunk->getPath()) != VLC_SUCCESS ||
         datachunk->getBytesToRead() == 0 )
     {
-        datachunk->getConnection()->releaseChunk();
+        connManager.releaseChunk(datachunk);
         delete datachunk;
         *pp_data = NULL;
         return 0;
@@ -64,7 +64,7 @@ uint64_t Retrieve::HTTP(vlc_object_t *obj, const std::string &uri, void **pp_dat
             i_data = ret;
         }
     }
-    datachunk->getConnection()->releaseChunk();
+    connManager.releaseChunk(datachunk);
     delete datachunk;
     return i_data;
 }
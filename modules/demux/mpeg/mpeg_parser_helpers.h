@@ -23,8 +23,11 @@
 #ifndef MPEG_PARSER_HELPERS_H
 #define MPEG_PARSER_HELPERS_H
 #include <stdint.h>
+#include <string.h>
 #include <vlc_bits.h>
 
+#include "../../packetizer/startcode_helper.h"
+
 static inline void hevc_skip_profile_tiers_level( bs_t * bs, int32_t max_sub_layer_minus1 )
 {
     uint8_t sub_layer_profile_present_flag[8];
@@ -70,20 +73,25 @@ static inline int32_t bs_read_se( bs_t *s )
     return val&0x01 ? (val+1)/2 : -(val/2);
 }
 
+/* Removes the emulation prevention bytes (00 00 03 -> 00 00), but for a 03
+ * ending the buffer */
 static inline size_t nal_decode(const uint8_t * p_src, uint8_t * p_dst, size_t i_size)
 {
-    size_t j = 0;
-    for (size_t i = 0; i < i_size; i++) {
-        if (i < i_size - 3 &&
-            p_src[i] == 0 && p_src[i+1] == 0 && p_src[i+2] == 3) {
-            p_dst[j++] = 0;
-            p_dst[j++] = 0;
-            i += 2;
-            continue;
-        }
-        p_dst[j++] = p_src[i];
+    const uint8_t *p_end = p_src + i_size;
+    uint8_t *p = p_dst;
+
+    while (p_end - p_src > 3) {
+        const uint8_t *p_esc = startcode_FindEmulation(p_src, p_end - 1);
+        if (!p_esc)
+            break;
+        memcpy(p, p_src, p_esc + 2 - p_src);
+        p += p_esc + 2 - p_src;
+        p_src = p_esc + 3;
     }
-    return j;
+    memcpy(p, p_src, p_end - p_src);
+    p += p_end - p_src;
+
+    return p - p_dst;
 }
 
 #endif /*MPEG_PARSER_HELPERS_H*/
@@ -42,6 +42,7 @@
 #include <vlc_epg.h>
 #include <vlc_charset.h>   /* FromCharset, for EIT */
 #include <vlc_bits.h>
+#include <vlc_atomic.h>
 
 #include "../../mux/mpeg/csa.h"
 
@@ -137,6 +138,13 @@ static void Close ( vlc_object_t * );
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
+#define WORKERS_TEXT N_("Program threads")
+#define WORKERS_LONGTEXT N_( \
+    "Number of threads reassembling, descrambling and sending the PES of " \
+    "the selected programs, each program being handled by one thread. " \
+    "Useful when demuxing many programs of a full multiplex. " \
+    "0 demuxes everything on the input thread." )
+
 static const int const arib_mode_list[] =
   { ARIBMODE_AUTO, ARIBMODE_ENABLED, ARIBMODE_DISABLED };
 static const char *const arib_mode_list_text[] =
@@ -169,6 +177,7 @@ vlc_module_begin ()
 
     add_bool( "ts-split-es", true, SPLIT_ES_TEXT, SPLIT_ES_LONGTEXT, false )
     add_bool( "ts-seek-percent", false, SEEK_PERCENT_TEXT, SEEK_PERCENT_LONGTEXT, true )
+    add_integer_with_range( "ts-workers", 0, 0, 64, WORKERS_TEXT, WORKERS_LONGTEXT, true )
 
     add_integer( "ts-arib", ARIBMODE_AUTO, SUPPORT_ARIB_TEXT, SUPPORT_ARIB_LONGTEXT, false )
         change_integer_list( arib_mode_list, arib_mode_list_text )
@@ -209,6 +218,7 @@ typedef struct
     int             i_version;
     int             i_number;
     int             i_pid_pcr;
+    unsigned        i_worker; /* order in PAT, selects the program thread */
     /* IOD stuff (mpeg4) */
     od_descriptor_t *iod;
     od_descriptors_t od;
@@ -224,6 +234,7 @@ typedef struct
         mtime_t i_pcroffset;
         bool    b_disable; /* ignore PCR field, use dts */
         bool    b_fix_done;
+        int     i_pid_fix; /* PCR pid picked by a program thread, or -1 */
     } pcr;
 
     mtime_t i_last_dts;
@@ -332,6 +343,14 @@ struct ts_pid_t
         int i_pcr_count;
     } probed;
 
+    struct
+    {
+        uint64_t i_packets;
+        uint64_t i_scrambled;
+        unsigned i_discontinuities;
+        uint8_t  i_last_cc; /* 0x10 | last continuity counter, 0 if none */
+    } stats;
+
 };
 
 typedef struct
@@ -345,12 +364,36 @@ typedef struct
 
 #define PID_ALLOC_CHUNK 16
 
+/* Packets queued to a program thread before the input thread waits */
+#define TS_WORKER_QUEUE_MAX 4096
+
+/* PID index pages, 32 pages of 256 entries cover the 13 bits PID space */
+#define PID_PAGE_BITS 8
+#define PID_PAGE_SIZE (1 << PID_PAGE_BITS)
+
+/* TS packets fetched per stream_Block() (7 packets fit a 1316 bytes UDP datagram) */
+#define TS_BATCH_PACKETS (7 * 16)
+
+typedef struct
+{
+    demux_t      *p_demux;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+    vlc_cond_t    wait;     /* packets queued or exit requested */
+    vlc_cond_t    done;     /* queue taken or processed */
+    block_t      *p_first;
+    block_t     **pp_last;
+    unsigned      i_queued;
+    bool          b_busy;
+    bool          b_exit;
+} ts_worker_t;
+
 struct demux_sys_t
 {
     stream_t   *stream;
     bool        b_canseek;
     bool        b_canfastseek;
-    vlc_mutex_t     csa_lock;
+    vlc_rwlock_t    csa_lock;
 
     /* TS packet size (188, 192, 204) */
     unsigned    i_packet_size;
@@ -361,6 +404,27 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* TS packets read ahead, p_buffer points to the next unparsed one */
+    block_t    *p_batch;
+    unsigned    i_batch_packets;
+
+    /* PES packets waiting to be descrambled together */
+    struct
+    {
+        block_t   *p_first;
+        block_t  **pp_last;
+        unsigned   i_count;
+    } csa_batch;
+
+    /* Program threads. PSI, routing and control stay on the input thread,
+     * which waits for the workers to be idle before changing tables. */
+    struct
+    {
+        ts_worker_t *p_list;
+        unsigned     i_count;
+        atomic_bool  b_update_filters; /* PCR pid picked by a worker */
+    } workers;
+
     bool        b_force_seek_per_percent;
 
     struct
@@ -381,9 +445,8 @@ struct demux_sys_t
         ts_pid_t **pp_all;
         int        i_all;
         int        i_all_alloc;
-        /* last recently used */
-        uint16_t   i_last_pid;
-        ts_pid_t  *p_last;
+        /* pp_all indexed by pid, pages allocated on first use */
+        ts_pid_t **pp_index[0x2000 / PID_PAGE_SIZE];
     } pids;
 
     bool        b_user_pmt;
@@ -468,9 +531,29 @@ static bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 static void UpdatePESFilters( demux_t *p_demux, bool b_all );
 static inline void FlushESBuffer( ts_pes_t *p_pes );
 static void UpdateScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool );
-static inline int PIDGet( block_t *p )
+static inline int PIDGet( const uint8_t *p )
+{
+    return ( (p[1]&0x1f)<<8 )|p[2];
+}
+
+static inline void PIDUpdateStats( ts_pid_t *pid, const uint8_t *p )
 {
-    return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
+    pid->stats.i_packets++;
+    if( p[3]&0x80 )
+        pid->stats.i_scrambled++;
+
+    /* Continuity counter only increments with payload, may be duplicated
+     * once, and is undefined for null packets */
+    if( (p[3]&0x10) && pid->i_pid != 0x1FFF )
+    {
+        const uint8_t i_cc = 0x10 | (p[3]&0x0f);
+        const bool b_discontinuity = (p[3]&0x20) && p[4] > 0 && (p[5]&0x80);
+        if( pid->stats.i_last_cc && !b_discontinuity &&
+            i_cc != pid->stats.i_last_cc &&
+            i_cc != (0x10 | ((pid->stats.i_last_cc + 1)&0x0f)) )
+            pid->stats.i_discontinuities++;
+        pid->stats.i_last_cc = i_cc;
+    }
 }
 
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
@@ -478,11 +561,26 @@ static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, mtime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static uint8_t *ReadTSPacketBatch( demux_t *p_demux );
+static void FlushTSBatch( demux_sys_t * );
+static int64_t TSBatchTell( demux_sys_t * );
+static stream_t *TSBatchFilterNew( demux_t *, const char * );
+
+static void WorkersStart( demux_t * );
+static void WorkersStop( demux_sys_t * );
+static void WorkersDrain( demux_sys_t * );
+static void WorkersApplyPCRFix( demux_t * );
+static ts_worker_t *GetWorker( demux_sys_t *, const ts_pid_t * );
+static void WorkerQueue( ts_worker_t *, block_t * );
+static void DescrambleChain( demux_t *, block_t * );
+static bool FlushCSABatch( demux_t * );
 static int ProbeStart( demux_t *p_demux, int i_program );
 static int ProbeEnd( demux_t *p_demux, int i_program );
 static int SeekToTime( demux_t *p_demux, ts_pmt_t *, int64_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
-static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
+static void PCRHandle( demux_t *p_demux, ts_pid_t *, const uint8_t * );
+static void PCRHandleShared( demux_t *p_demux, ts_pid_t *, const uint8_t * );
+static mtime_t GetPCR( const uint8_t * );
 static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 static int64_t TimeStampWrapAround( ts_pmt_t *, int64_t );
 
@@ -975,7 +1073,7 @@ static int Open( vlc_object_t *p_this )
     if( !p_sys )
         return VLC_ENOMEM;
     memset( p_sys, 0, sizeof( demux_sys_t ) );
-    vlc_mutex_init( &p_sys->csa_lock );
+    vlc_rwlock_init( &p_sys->csa_lock );
 
     p_demux->pf_demux = Demux;
     p_demux->pf_control = Control;
@@ -1003,6 +1101,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->p_batch = NULL;
+    p_sys->i_batch_packets = 1;
+    p_sys->csa_batch.pp_last = &p_sys->csa_batch.p_first;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -1018,14 +1119,14 @@ static int Open( vlc_object_t *p_this )
     patpid = GetPID(p_sys, 0);
     if ( !PIDSetup( p_demux, TYPE_PAT, patpid, NULL ) )
     {
-        vlc_mutex_destroy( &p_sys->csa_lock );
+        vlc_rwlock_destroy( &p_sys->csa_lock );
         free( p_sys );
         return VLC_ENOMEM;
     }
     if( !dvbpsi_pat_attach( patpid->u.p_pat->handle, PATCallBack, p_demux ) )
     {
         PIDRelease( p_demux, patpid );
-        vlc_mutex_destroy( &p_sys->csa_lock );
+        vlc_rwlock_destroy( &p_sys->csa_lock );
         free( p_sys );
         return VLC_EGENERIC;
     }
@@ -1131,6 +1232,16 @@ static int Open( vlc_object_t *p_this )
     stream_Control( p_sys->stream, STREAM_CAN_SEEK, &p_sys->b_canseek );
     stream_Control( p_sys->stream, STREAM_CAN_FASTSEEK, &p_sys->b_canfastseek );
 
+    /* Batch reads on stored streams only: a live source would otherwise hold
+     * back packets until a full batch arrived. The ARIB descrambler reads
+     * packets one at a time, see SetTSBatchStream(). */
+    if( p_sys->arib.e_mode == ARIBMODE_ENABLED )
+        p_sys->i_batch_packets = 1;
+    else if( p_sys->b_canseek )
+        p_sys->i_batch_packets = TS_BATCH_PACKETS;
+    else
+        p_sys->i_batch_packets = 7;
+
     /* Preparse time */
     if( p_sys->b_canseek )
     {
@@ -1143,6 +1254,8 @@ static int Open( vlc_object_t *p_this )
     else
         p_sys->es_creation = ( p_sys->b_access_control ? CREATE_ES : DELAY_ES );
 
+    WorkersStart( p_demux );
+
     return VLC_SUCCESS;
 }
 
@@ -1154,6 +1267,8 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    WorkersStop( p_sys );
+
     PIDRelease( p_demux, GetPID(p_sys, 0) );
 
     if( p_sys->b_dvb_meta )
@@ -1163,14 +1278,14 @@ static void Close( vlc_object_t *p_this )
         PIDRelease( p_demux, GetPID(p_sys, 0x14) );
     }
 
-    vlc_mutex_lock( &p_sys->csa_lock );
+    vlc_rwlock_wrlock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
         var_DelCallback( p_demux, "ts-csa-ck", ChangeKeyCallback, NULL );
         var_DelCallback( p_demux, "ts-csa2-ck", ChangeKeyCallback, NULL );
         csa_Delete( p_sys->csa );
     }
-    vlc_mutex_unlock( &p_sys->csa_lock );
+    vlc_rwlock_unlock( &p_sys->csa_lock );
 
     ARRAY_RESET( p_sys->programs );
 
@@ -1185,12 +1300,18 @@ static void Close( vlc_object_t *p_this )
         stream_Delete( p_sys->arib.b25stream );
     }
 
-    vlc_mutex_destroy( &p_sys->csa_lock );
+    vlc_rwlock_destroy( &p_sys->csa_lock );
+
+    FlushTSBatch( p_sys );
 
     /* Release all non default pids */
     for( int i = 0; i < p_sys->pids.i_all; i++ )
     {
         ts_pid_t *pid = p_sys->pids.pp_all[i];
+        if( pid->stats.i_packets )
+            msg_Dbg( p_demux, "pid[%d] %"PRIu64" packets, %u discontinuities, "
+                     "%"PRIu64" scrambled", pid->i_pid, pid->stats.i_packets,
+                     pid->stats.i_discontinuities, pid->stats.i_scrambled );
 #ifndef NDEBUG
         if( pid->type != TYPE_FREE )
             msg_Err( p_demux, "PID %d type %d not freed", pid->i_pid, pid->type );
@@ -1198,6 +1319,8 @@ static void Close( vlc_object_t *p_this )
         free( pid );
     }
     free( p_sys->pids.pp_all );
+    for( size_t i = 0; i < ARRAY_SIZE(p_sys->pids.pp_index); i++ )
+        free( p_sys->pids.pp_index[i] );
 
     free( p_sys );
 }
@@ -1214,13 +1337,13 @@ static int ChangeKeyCallback( vlc_object_t *p_this, char const *psz_cmd,
     demux_sys_t *p_sys = p_demux->p_sys;
     int         i_tmp = (intptr_t)p_data;
 
-    vlc_mutex_lock( &p_sys->csa_lock );
+    vlc_rwlock_wrlock( &p_sys->csa_lock );
     if ( i_tmp )
         i_tmp = csa_SetCW( p_this, p_sys->csa, newval.psz_string, true );
     else
         i_tmp = csa_SetCW( p_this, p_sys->csa, newval.psz_string, false );
 
-    vlc_mutex_unlock( &p_sys->csa_lock );
+    vlc_rwlock_unlock( &p_sys->csa_lock );
     return i_tmp;
 }
 
@@ -1236,13 +1359,20 @@ static int Demux( demux_t *p_demux )
     if( p_sys->i_pmt_es == 0 && !SEEN(GetPID(p_sys, 0)) && p_sys->patfix.b_pat_deadline )
         MissingPATPMTFixup( p_demux );
 
+    if( p_sys->workers.i_count &&
+        atomic_exchange( &p_sys->workers.b_update_filters, false ) )
+        WorkersApplyPCRFix( p_demux );
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
-        block_t     *p_pkt;
-        if( !(p_pkt = ReadTSPacket( p_demux )) )
+        uint8_t     *p_pkt;
+        if( !(p_pkt = ReadTSPacketBatch( p_demux )) )
         {
+            /* Let the programs threads send everything before reporting EOF */
+            FlushCSABatch( p_demux );
+            WorkersDrain( p_sys );
             return VLC_DEMUXER_EOF;
         }
 
@@ -1253,11 +1383,18 @@ static int Demux( demux_t *p_demux )
             p_sys->b_start_record = false;
         }
 
-        /* Parse the TS packet */
+        /* Parse the TS packet in place, only PES payloads get copied out */
         ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+        PIDUpdateStats( p_pid, p_pkt );
 
-        if( SCRAMBLED(*p_pid) != !!(p_pkt->p_buffer[3] & 0x80) )
-            UpdateScrambledState( p_demux, p_pid, p_pkt->p_buffer[3] & 0x80 );
+        /* Keep the pending PES packets in order with anything else */
+        if( p_sys->csa_batch.i_count > 0 &&
+            ( p_pid->type != TYPE_PES || p_sys->es_creation == DELAY_ES ||
+              SCRAMBLED(*p_pid) != !!(p_pkt[3] & 0x80) ) )
+            b_frame = FlushCSABatch( p_demux );
+
+        if( SCRAMBLED(*p_pid) != !!(p_pkt[3] & 0x80) )
+            UpdateScrambledState( p_demux, p_pid, p_pkt[3] & 0x80 );
 
         if( !SEEN(p_pid) )
         {
@@ -1267,34 +1404,31 @@ static int Demux( demux_t *p_demux )
         }
 
         if ( SCRAMBLED(*p_pid) && !p_demux->p_sys->csa )
-        {
-            block_Release( p_pkt );
             continue;
-        }
 
         /* Probe streams to build PAT/PMT after MIN_PAT_INTERVAL in case we don't see any PAT */
         if( !SEEN( GetPID( p_sys, 0 ) ) &&
             (p_pid->probed.i_type == 0 || p_pid->i_pid == p_sys->patfix.i_timesourcepid) &&
-            (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
-            (p_pkt->p_buffer[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
+            (p_pkt[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
+            (p_pkt[3] & 0xD0) == 0x10 )  /* Has payload but is not encrypted */
         {
-            ProbePES( p_demux, p_pid, p_pkt->p_buffer + TS_HEADER_SIZE,
-                      p_pkt->i_buffer - TS_HEADER_SIZE, p_pkt->p_buffer[3] & 0x20 /* Adaptation field */);
+            ProbePES( p_demux, p_pid, p_pkt + TS_HEADER_SIZE,
+                      p_sys->i_packet_size - p_sys->i_packet_header_size - TS_HEADER_SIZE,
+                      p_pkt[3] & 0x20 /* Adaptation field */);
         }
 
         switch( p_pid->type )
         {
         case TYPE_PAT:
-            dvbpsi_packet_push( p_pid->u.p_pat->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            dvbpsi_packet_push( p_pid->u.p_pat->handle, p_pkt );
             break;
 
         case TYPE_PMT:
-            dvbpsi_packet_push( p_pid->u.p_pmt->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
+            dvbpsi_packet_push( p_pid->u.p_pmt->handle, p_pkt );
             break;
 
         case TYPE_PES:
+        {
             p_sys->b_end_preparse = true;
 
             if( p_sys->es_creation == DELAY_ES ) /* No longer delay ES since that pid's program sends data */
@@ -1306,32 +1440,70 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
-                block_Release( p_pkt );
                 continue;
             }
 
-            b_frame = GatherData( p_demux, p_pid, p_pkt );
+            /* The batch may be a read-only mapping, and the packet is descrambled in place */
+            block_t *p_block = block_Alloc( p_sys->i_packet_size - p_sys->i_packet_header_size );
+            if( unlikely(p_block == NULL) )
+                break;
+            memcpy( p_block->p_buffer, p_pkt, p_block->i_buffer );
+
+            if( p_sys->workers.i_count && GetPCR( p_pkt ) >= 0 )
+                PCRHandleShared( p_demux, p_pid, p_pkt );
+
+            ts_worker_t *p_worker = GetWorker( p_sys, p_pid );
+            if( p_worker )
+                WorkerQueue( p_worker, p_block );
+            else if( p_sys->csa )
+            {
+                block_ChainLastAppend( &p_sys->csa_batch.pp_last, p_block );
+                if( ++p_sys->csa_batch.i_count >= TS_BATCH_PACKETS )
+                    b_frame |= FlushCSABatch( p_demux );
+            }
+            else
+                b_frame |= GatherData( p_demux, p_pid, p_block );
             break;
+        }
 
         case TYPE_SDT:
         case TYPE_TDT:
         case TYPE_EIT:
             if( p_sys->b_dvb_meta )
-                dvbpsi_packet_push( p_pid->u.p_psi->handle, p_pkt->p_buffer );
-            block_Release( p_pkt );
+                dvbpsi_packet_push( p_pid->u.p_psi->handle, p_pkt );
             break;
 
         default:
-            /* We have to handle PCR if present */
-            PCRHandle( p_demux, p_pid, p_pkt );
-            block_Release( p_pkt );
+        {
+            /* We have to handle PCR if present, by the thread of its program */
+            ts_worker_t *p_worker = NULL;
+            if( p_sys->workers.i_count && GetPCR( p_pkt ) >= 0 )
+            {
+                PCRHandleShared( p_demux, p_pid, p_pkt );
+                p_worker = GetWorker( p_sys, p_pid );
+            }
+
+            if( p_worker == NULL )
+            {
+                PCRHandle( p_demux, p_pid, p_pkt );
+                break;
+            }
+
+            block_t *p_block = block_Alloc( TS_PACKET_SIZE_188 );
+            if( likely(p_block != NULL) )
+            {
+                memcpy( p_block->p_buffer, p_pkt, TS_PACKET_SIZE_188 );
+                WorkerQueue( p_worker, p_block );
+            }
             break;
         }
+        }
 
         if( b_frame || ( b_wait_es && p_sys->i_pmt_es > 0 ) )
             break;
     }
 
+    FlushCSABatch( p_demux );
     demux_UpdateTitleFromStream( p_demux );
     return VLC_DEMUXER_SUCCESS;
 }
@@ -1433,6 +1605,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     ts_pmt_t *p_pmt;
     int i_first_program = ( p_sys->programs.i_size ) ? p_sys->programs.p_elems[0] : 0;
 
+    WorkersDrain( p_sys );
+
     if( PREPARSING || !i_first_program || p_sys->b_default_selection )
     {
         if( likely(GetPID(p_sys, 0)->type == TYPE_PAT) )
@@ -1483,7 +1657,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            int64_t offset = stream_Tell( p_sys->stream );
+            int64_t offset = TSBatchTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -1527,6 +1701,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
         }
 
         i64 = stream_Size( p_sys->stream );
+        FlushTSBatch( p_sys );
         if( i64 > 0 &&
             stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
@@ -1717,6 +1892,7 @@ static int UserPmt( demux_t *p_demux, const char *psz_fmt )
     /* Dummy PMT */
     ts_pmt_t *p_pmt = pmtpid->u.p_pmt;
     p_pmt->i_number   = i_number != 0 ? i_number : TS_USER_PMT_NUMBER;
+    p_pmt->i_worker   = GetPID(p_sys, 0)->u.p_pat->programs.i_size;
     if( !dvbpsi_pmt_attach( p_pmt->handle,
                             ((i_number != TS_USER_PMT_NUMBER ? i_number : 1)),
                             PMTCallBack, p_demux ) )
@@ -2486,6 +2662,42 @@ static void ParseData( demux_t *p_demux, ts_pid_t *pid )
     }
 }
 
+/* Skips garbage until two sync bytes one packet apart */
+static bool ResyncTSStream( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        int i_peek = 0;
+        unsigned i_skip = 0;
+
+        i_peek = stream_Peek( p_sys->stream, &p_peek,
+                p_sys->i_packet_size * 10 );
+        if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return false;
+        }
+
+        while( i_skip < i_peek - p_sys->i_packet_size )
+        {
+            if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
+                    p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+            {
+                break;
+            }
+            i_skip++;
+        }
+        msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
+        stream_Read( p_sys->stream, NULL, i_skip );
+
+        if( i_skip < i_peek - p_sys->i_packet_size )
+            return true;
+    }
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -2520,44 +2732,389 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     {
         msg_Warn( p_demux, "lost synchro" );
         block_Release( p_pkt );
-        for( ;; )
+        if( !ResyncTSStream( p_demux ) )
+            return NULL;
+        if( !( p_pkt = stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
         {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
+            msg_Dbg( p_demux, "eof ?" );
+            return NULL;
+        }
+    }
+    return p_pkt;
+}
+
+static void FlushTSBatch( demux_sys_t *p_sys )
+{
+    if( p_sys->p_batch )
+    {
+        block_Release( p_sys->p_batch );
+        p_sys->p_batch = NULL;
+    }
+}
+
+/* Stream position of the next packet to be parsed */
+static int64_t TSBatchTell( demux_sys_t *p_sys )
+{
+    int64_t i_pos = stream_Tell( p_sys->stream );
+    if( p_sys->p_batch )
+        i_pos -= p_sys->p_batch->i_buffer;
+    return i_pos;
+}
 
-            i_peek = stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+/* Inserts a stream filter, reading one packet at a time from then on. The
+ * packets left in the batch were not filtered: the source is rewound so that
+ * they are read again through the filter. The current packet may still be in
+ * use, so the batch is only emptied. */
+static stream_t *TSBatchFilterNew( demux_t *p_demux, const char *psz_name )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_batch = p_sys->p_batch;
+    const int64_t i_end = stream_Tell( p_demux->s );
+    bool b_rewound = false;
+
+    if( p_batch && p_batch->i_buffer > 0 )
+    {
+        b_rewound = stream_Seek( p_demux->s, TSBatchTell( p_sys ) ) == VLC_SUCCESS;
+        if( !b_rewound )
+            msg_Warn( p_demux, "dropping %zu bytes read before the %s filter",
+                      p_batch->i_buffer, psz_name );
+    }
+
+    stream_t *s = stream_FilterNew( p_demux->s, psz_name );
+    if( s == NULL )
+    {
+        if( b_rewound )
+            stream_Seek( p_demux->s, i_end );
+        return NULL;
+    }
+
+    if( p_batch )
+        p_batch->i_buffer = 0;
+    p_sys->stream = s;
+    p_sys->i_batch_packets = 1;
+    return s;
+}
+
+/* Returns the next TS packet (sync byte first) within the current batch,
+ * fetching a new batch with a single stream_Block() once exhausted. For
+ * memory mapped files the batch shares the mapping, so packets are parsed
+ * without any copy. The packet stays valid until the next call. */
+static uint8_t *ReadTSPacketBatch( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+    const unsigned i_header = p_sys->i_packet_header_size;
+    block_t *p_batch = p_sys->p_batch;
+
+    for( ;; )
+    {
+        if( p_batch == NULL || p_batch->i_buffer < i_size )
+        {
+            FlushTSBatch( p_sys );
+            p_batch = stream_Block( p_sys->stream, i_size * p_sys->i_batch_packets );
+            if( p_batch == NULL || p_batch->i_buffer < i_size )
             {
-                msg_Dbg( p_demux, "eof ?" );
+                if( p_batch )
+                    block_Release( p_batch );
+                if( stream_Tell( p_sys->stream ) == stream_Size( p_sys->stream ) )
+                    msg_Dbg( p_demux, "EOF at %"PRId64, stream_Tell( p_sys->stream ) );
+                else
+                    msg_Dbg( p_demux, "Can't read TS packet at %"PRId64, stream_Tell(p_sys->stream) );
                 return NULL;
             }
+            p_sys->p_batch = p_batch;
+        }
 
-            while( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
-            }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            stream_Read( p_sys->stream, NULL, i_skip );
+        if( p_batch->p_buffer[i_header] == 0x47 )
+            break;
+
+        msg_Warn( p_demux, "lost synchro" );
+
+        /* Look for the next packet within the batch first */
+        size_t i_skip = 1;
+        while( i_skip + i_header + i_size < p_batch->i_buffer &&
+               ( p_batch->p_buffer[i_skip + i_header] != 0x47 ||
+                 p_batch->p_buffer[i_skip + i_header + i_size] != 0x47 ) )
+            i_skip++;
 
-            if( i_skip < i_peek - p_sys->i_packet_size )
+        if( i_skip + i_header + i_size < p_batch->i_buffer )
+        {
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+            p_batch->p_buffer += i_skip;
+            p_batch->i_buffer -= i_skip;
+            break;
+        }
+
+        FlushTSBatch( p_sys );
+        p_batch = NULL;
+        if( !ResyncTSStream( p_demux ) )
+            return NULL;
+    }
+
+    uint8_t *p_pkt = &p_batch->p_buffer[i_header];
+    p_batch->p_buffer += i_size;
+    p_batch->i_buffer -= i_size;
+    return p_pkt;
+}
+
+static void *WorkerThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    demux_t     *p_demux = p_worker->p_demux;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    vlc_mutex_lock( &p_worker->lock );
+    for( ;; )
+    {
+        while( p_worker->p_first == NULL && !p_worker->b_exit )
+            vlc_cond_wait( &p_worker->wait, &p_worker->lock );
+        if( p_worker->p_first == NULL )
+            break;
+
+        block_t *p_chain = p_worker->p_first;
+        p_worker->p_first = NULL;
+        p_worker->pp_last = &p_worker->p_first;
+        p_worker->i_queued = 0;
+        p_worker->b_busy = true;
+        vlc_cond_signal( &p_worker->done );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        DescrambleChain( p_demux, p_chain );
+
+        while( p_chain )
+        {
+            block_t *p_pkt = p_chain;
+            p_chain = p_chain->p_next;
+            p_pkt->p_next = NULL;
+
+            /* Tables are only changed while the worker is idle */
+            ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt->p_buffer ) );
+            if( p_pid->type == TYPE_PES )
+                GatherData( p_demux, p_pid, p_pkt );
+            else
             {
-                break;
+                PCRHandle( p_demux, p_pid, p_pkt->p_buffer );
+                block_Release( p_pkt );
             }
         }
-        if( !( p_pkt = stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_busy = false;
+        vlc_cond_signal( &p_worker->done );
+    }
+    vlc_mutex_unlock( &p_worker->lock );
+
+    return NULL;
+}
+
+static void WorkersStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    unsigned i_count = var_InheritInteger( p_demux, "ts-workers" );
+
+    atomic_init( &p_sys->workers.b_update_filters, false );
+    if( i_count == 0 )
+        return;
+
+    p_sys->workers.p_list = calloc( i_count, sizeof(ts_worker_t) );
+    if( !p_sys->workers.p_list )
+        return;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_list[i];
+
+        p_worker->p_demux = p_demux;
+        vlc_mutex_init( &p_worker->lock );
+        vlc_cond_init( &p_worker->wait );
+        vlc_cond_init( &p_worker->done );
+        p_worker->pp_last = &p_worker->p_first;
+
+        if( vlc_clone( &p_worker->thread, WorkerThread, p_worker,
+                       VLC_THREAD_PRIORITY_INPUT ) )
         {
-            msg_Dbg( p_demux, "eof ?" );
-            return NULL;
+            vlc_cond_destroy( &p_worker->done );
+            vlc_cond_destroy( &p_worker->wait );
+            vlc_mutex_destroy( &p_worker->lock );
+            break;
         }
+        p_sys->workers.i_count++;
     }
-    return p_pkt;
+
+    if( p_sys->workers.i_count == 0 )
+    {
+        free( p_sys->workers.p_list );
+        p_sys->workers.p_list = NULL;
+    }
+    else
+        msg_Dbg( p_demux, "demuxing programs on %u threads", p_sys->workers.i_count );
+}
+
+/* Processes the pending packets and terminates the program threads */
+static void WorkersStop( demux_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_list[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        p_worker->b_exit = true;
+        vlc_cond_signal( &p_worker->wait );
+        vlc_mutex_unlock( &p_worker->lock );
+
+        vlc_join( p_worker->thread, NULL );
+        vlc_cond_destroy( &p_worker->done );
+        vlc_cond_destroy( &p_worker->wait );
+        vlc_mutex_destroy( &p_worker->lock );
+    }
+    free( p_sys->workers.p_list );
+    p_sys->workers.p_list = NULL;
+    p_sys->workers.i_count = 0;
+}
+
+/* Waits until all the queued packets are processed */
+static void WorkersDrain( demux_sys_t *p_sys )
+{
+    for( unsigned i = 0; i < p_sys->workers.i_count; i++ )
+    {
+        ts_worker_t *p_worker = &p_sys->workers.p_list[i];
+
+        vlc_mutex_lock( &p_worker->lock );
+        while( p_worker->p_first != NULL || p_worker->b_busy )
+            vlc_cond_wait( &p_worker->done, &p_worker->lock );
+        vlc_mutex_unlock( &p_worker->lock );
+    }
+}
+
+/* Returns the thread of a program, or NULL without program threads */
+static ts_worker_t *ProgramWorker( demux_sys_t *p_sys, const ts_pmt_t *p_pmt )
+{
+    if( p_sys->workers.i_count == 0 )
+        return NULL;
+    return &p_sys->workers.p_list[p_pmt->i_worker % p_sys->workers.i_count];
+}
+
+/* Returns the thread of the program the pid belongs to, or NULL if the
+ * packet must be handled by the input thread. All the packets of a program
+ * go to the same thread so that its PES and clock are kept in order. */
+static ts_worker_t *GetWorker( demux_sys_t *p_sys, const ts_pid_t *p_pid )
+{
+    if( p_sys->workers.i_count == 0 )
+        return NULL;
+
+    const ts_pmt_t *p_pmt = NULL;
+    if( p_pid->type == TYPE_PES )
+    {
+        if( p_pid->p_parent && p_pid->p_parent->type == TYPE_PMT )
+            p_pmt = p_pid->p_parent->u.p_pmt;
+    }
+    else if( p_pid->i_pid != 0x1FFF && GetPID(p_sys, 0)->type == TYPE_PAT )
+    {
+        /* Dedicated PCR pid */
+        const ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+        for( int i = 0; !p_pmt && i < p_pat->programs.i_size; i++ )
+        {
+            if( p_pat->programs.p_elems[i]->u.p_pmt->i_pid_pcr == p_pid->i_pid )
+                p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        }
+    }
+
+    if( p_pmt == NULL )
+        return NULL;
+    return ProgramWorker( p_sys, p_pmt );
+}
+
+/* Switches the programs to the PCR pids picked by their threads, which
+ * must not change the routing of the packets while running */
+static void WorkersApplyPCRFix( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    WorkersDrain( p_sys );
+
+    if( GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+        if( p_pmt->pcr.i_pid_fix != -1 )
+        {
+            p_pmt->i_pid_pcr = p_pmt->pcr.i_pid_fix;
+            p_pmt->pcr.i_pid_fix = -1;
+        }
+    }
+
+    UpdatePESFilters( p_demux, p_sys->b_es_all );
+}
+
+static void WorkerQueue( ts_worker_t *p_worker, block_t *p_pkt )
+{
+    vlc_mutex_lock( &p_worker->lock );
+    while( p_worker->i_queued >= TS_WORKER_QUEUE_MAX )
+        vlc_cond_wait( &p_worker->done, &p_worker->lock );
+
+    block_ChainLastAppend( &p_worker->pp_last, p_pkt );
+    if( p_worker->i_queued++ == 0 )
+        vlc_cond_signal( &p_worker->wait );
+    vlc_mutex_unlock( &p_worker->lock );
+}
+
+/* Descrambles the scrambled PES packets of a chain in bitsliced batches,
+ * GatherData() then leaves them alone */
+static void DescrambleChain( demux_t *p_demux, block_t *p_chain )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    uint8_t *pp_pkt[CSA_BATCH_MAX];
+    unsigned i_count = 0;
+
+    if( !p_sys->csa )
+        return;
+
+    vlc_rwlock_rdlock( &p_sys->csa_lock );
+    for( block_t *p_pkt = p_chain; p_pkt; p_pkt = p_pkt->p_next )
+    {
+        if( !(p_pkt->p_buffer[3] & 0x80) ||
+            GetPID( p_sys, PIDGet( p_pkt->p_buffer ) )->type != TYPE_PES )
+            continue;
+
+        pp_pkt[i_count++] = p_pkt->p_buffer;
+        if( i_count == CSA_BATCH_MAX )
+        {
+            csa_DecryptBatch( p_sys->csa, pp_pkt, i_count, p_sys->i_csa_pkt_size );
+            i_count = 0;
+        }
+    }
+    if( i_count > 0 )
+        csa_DecryptBatch( p_sys->csa, pp_pkt, i_count, p_sys->i_csa_pkt_size );
+    vlc_rwlock_unlock( &p_sys->csa_lock );
+}
+
+/* Descrambles and gathers the pending PES packets, returns true if a frame
+ * was completed */
+static bool FlushCSABatch( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_chain = p_sys->csa_batch.p_first;
+    bool b_frame = false;
+
+    p_sys->csa_batch.p_first = NULL;
+    p_sys->csa_batch.pp_last = &p_sys->csa_batch.p_first;
+    p_sys->csa_batch.i_count = 0;
+
+    DescrambleChain( p_demux, p_chain );
+
+    while( p_chain )
+    {
+        block_t *p_pkt = p_chain;
+        p_chain = p_chain->p_next;
+        p_pkt->p_next = NULL;
+
+        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt->p_buffer ) );
+        b_frame |= GatherData( p_demux, p_pid, p_pkt );
+    }
+    return b_frame;
 }
 
 static int64_t TimeStampWrapAround( ts_pmt_t *p_pmt, int64_t i_time )
@@ -2569,10 +3126,8 @@ static int64_t TimeStampWrapAround( ts_pmt_t *p_pmt, int64_t i_time )
     return i_time + i_adjust;
 }
 
-static mtime_t GetPCR( block_t *p_pkt )
+static mtime_t GetPCR( const uint8_t *p )
 {
-    const uint8_t *p = p_pkt->p_buffer;
-
     mtime_t i_pcr = -1;
 
     if( ( p[3]&0x20 ) && /* adaptation */
@@ -2597,6 +3152,8 @@ static void UpdateScrambledState( demux_t *p_demux, ts_pid_t *p_pid, bool b_scra
     msg_Warn( p_demux, "scrambled state changed on pid %d (%d->%d)",
               p_pid->i_pid, SCRAMBLED(*p_pid), b_scrambled );
 
+    WorkersDrain( p_demux->p_sys );
+
     if( b_scrambled )
         p_pid->i_flags |= FLAG_SCRAMBLED;
     else
@@ -2679,12 +3236,16 @@ static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
+    {
+        FlushTSBatch( p_sys );
         return stream_Seek( p_sys->stream, 0 );
+    }
 
     if( !p_sys->b_canfastseek )
         return VLC_EGENERIC;
 
-    int64_t i_initial_pos = stream_Tell( p_sys->stream );
+    int64_t i_initial_pos = TSBatchTell( p_sys );
+    FlushTSBatch( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     int64_t i_head_pos = 0;
@@ -2716,7 +3277,7 @@ static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
             else
                 i_pos = stream_Tell( p_sys->stream );
 
-            int i_pid = PIDGet( p_pkt );
+            int i_pid = PIDGet( p_pkt->p_buffer );
             if( i_pid != 0x1FFF && GetPID(p_sys, i_pid)->type == TYPE_PES &&
                 GetPID(p_sys, i_pid)->p_parent->u.p_pmt == p_pmt &&
                (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* Payload start but not corrupt */
@@ -2728,7 +3289,7 @@ static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
                 {
                     if( p_pkt->i_buffer >= 4 + 2 + 5 )
                     {
-                        i_pcr = GetPCR( p_pkt );
+                        i_pcr = GetPCR( p_pkt->p_buffer );
                         i_skip += 1 + p_pkt->p_buffer[4];
                     }
                 }
@@ -2776,26 +3337,24 @@ static int SeekToTime( demux_t *p_demux, ts_pmt_t *p_pmt, int64_t i_scaledtime )
 
 static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
 {
-    switch( i_pid )
+    if( i_pid == 0 )
+        return &p_sys->pids.pat;
+    if( unlikely(i_pid >= 0x1FFF) )
+        return &p_sys->pids.dummy;
+
+    ts_pid_t **pp_page = p_sys->pids.pp_index[i_pid >> PID_PAGE_BITS];
+    if( likely(pp_page != NULL) )
     {
-        case 0:
-            return &p_sys->pids.pat;
-        case 0x1FFF:
-            return &p_sys->pids.dummy;
-        default:
-            if( p_sys->pids.i_last_pid == i_pid )
-                return p_sys->pids.p_last;
-        break;
+        ts_pid_t *p_pid = pp_page[i_pid & (PID_PAGE_SIZE - 1)];
+        if( likely(p_pid != NULL) )
+            return p_pid;
     }
-
-    for( int i=0; i < p_sys->pids.i_all; i++ )
+    else
     {
-        if( p_sys->pids.pp_all[i]->i_pid == i_pid )
-        {
-            p_sys->pids.p_last = p_sys->pids.pp_all[i];
-            p_sys->pids.i_last_pid = i_pid;
-            return p_sys->pids.p_last;
-        }
+        pp_page = calloc( PID_PAGE_SIZE, sizeof(*pp_page) );
+        if( !pp_page )
+            return NULL;
+        p_sys->pids.pp_index[i_pid >> PID_PAGE_BITS] = pp_page;
     }
 
     if( p_sys->pids.i_all >= p_sys->pids.i_all_alloc )
@@ -2817,9 +3376,7 @@ static ts_pid_t *GetPID( demux_sys_t *p_sys, uint16_t i_pid )
 
     p_pid->i_pid = i_pid;
     p_sys->pids.pp_all[p_sys->pids.i_all++] = p_pid;
-
-    p_sys->pids.p_last = p_pid;
-    p_sys->pids.i_last_pid = i_pid;
+    pp_page[i_pid & (PID_PAGE_SIZE - 1)] = p_pid;
 
     return p_pid;
 }
@@ -2857,7 +3414,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             break;
         }
 
-        const int i_pid = PIDGet( p_pkt );
+        const int i_pid = PIDGet( p_pkt->p_buffer );
         ts_pid_t *p_pid = GetPID(p_sys, i_pid);
 
         p_pid->i_flags |= FLAG_SEEN;
@@ -2868,7 +3425,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, int64_t *pi_
             bool b_adaptfield = p_pkt->p_buffer[3] & 0x20;
 
             if( b_adaptfield && p_pkt->i_buffer >= 4 + 2 + 5 )
-                *pi_pcr = GetPCR( p_pkt );
+                *pi_pcr = GetPCR( p_pkt->p_buffer );
 
             if( *pi_pcr == -1 &&
                 (p_pkt->p_buffer[1] & 0xC0) == 0x40 && /* payload start */
@@ -3005,10 +3562,13 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
         ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
         for( int i=0; i< p_pat->programs.i_size; i++ )
         {
-            ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
-            for( int j=0; j<p_pmt->e_streams.i_size; j++ )
+            ts_pmt_t *p_opmt = p_pat->programs.p_elems[i]->u.p_pmt;
+            /* Other programs queues belong to other threads */
+            if( p_sys->workers.i_count && p_opmt != p_pmt )
+                continue;
+            for( int j=0; j<p_opmt->e_streams.i_size; j++ )
             {
-                ts_pid_t *p_pid = p_pmt->e_streams.p_elems[j];
+                ts_pid_t *p_pid = p_opmt->e_streams.p_elems[j];
                 block_t *p_block = p_pid->u.p_pes->p_prepcr_outqueue;
                 while( p_block && p_block->i_dts == VLC_TS_INVALID )
                     p_block = p_block->p_next;
@@ -3039,11 +3599,27 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, mtime_t i_pcr )
     }
 }
 
-static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
+/* Returns whether the program takes its clock from that pid */
+static bool ProgramUsesPCRPid( const ts_pat_t *p_pat, int i_program,
+                               const ts_pid_t *pid )
+{
+    const ts_pmt_t *p_pmt = p_pat->programs.p_elems[i_program]->u.p_pmt;
+
+    if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
+        return pid->p_parent == p_pat->programs.p_elems[i_program]; /* PCR shall be on pid itself */
+
+    /* Can be dedicated PCR pid (no owned then) or another pid (owner == pmt) */
+    return p_pmt->i_pid_pcr == pid->i_pid;
+}
+
+/* Sets the PCR of the programs taking their clock from that pid. With
+ * program threads, only the programs of the thread handling the pid are
+ * updated: PCRHandleShared() takes care of the other ones. */
+static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, const uint8_t *p_pkt )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
 
-    mtime_t i_pcr = GetPCR( p_bk );
+    mtime_t i_pcr = GetPCR( p_pkt );
     if( i_pcr < 0 )
         return;
 
@@ -3055,31 +3631,50 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     if(unlikely(GetPID(p_sys, 0)->type != TYPE_PAT))
         return;
 
+    const ts_worker_t *p_worker = GetWorker( p_sys, pid );
+
     /* Search program and set the PCR */
     ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
     for( int i = 0; i < p_pat->programs.i_size; i++ )
     {
         ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
-        mtime_t i_program_pcr = TimeStampWrapAround( p_pmt, i_pcr );
 
-        if( p_pmt->i_pid_pcr == 0x1FFF ) /* That program has no dedicated PCR pid ISO/IEC 13818-1 2.4.4.9 */
-        {
-            if( pid->p_parent == p_pat->programs.p_elems[i] ) /* PCR shall be on pid itself */
-            {
-                /* ? update PCR for the whole group program ? */
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
-            }
-        }
-        else /* set PCR provided by current pid to program(s) referencing it */
+        if( ProgramWorker( p_sys, p_pmt ) == p_worker &&
+            ProgramUsesPCRPid( p_pat, i, pid ) )
+            ProgramSetPCR( p_demux, p_pmt, TimeStampWrapAround( p_pmt, i_pcr ) );
+    }
+}
+
+/* Sets the PCR of the programs taking their clock from a pid handled by
+ * another thread. Called by the input thread, which waits for the program
+ * threads to be idle first. */
+static void PCRHandleShared( demux_t *p_demux, ts_pid_t *pid, const uint8_t *p_pkt )
+{
+    demux_sys_t   *p_sys = p_demux->p_sys;
+
+    mtime_t i_pcr = GetPCR( p_pkt );
+    if( i_pcr < 0 || p_sys->i_pmt_es <= 0 ||
+        GetPID(p_sys, 0)->type != TYPE_PAT )
+        return;
+
+    const ts_worker_t *p_worker = GetWorker( p_sys, pid );
+    bool b_drained = false;
+
+    ts_pat_t *p_pat = GetPID(p_sys, 0)->u.p_pat;
+    for( int i = 0; i < p_pat->programs.i_size; i++ )
+    {
+        ts_pmt_t *p_pmt = p_pat->programs.p_elems[i]->u.p_pmt;
+
+        if( ProgramWorker( p_sys, p_pmt ) == p_worker ||
+            !ProgramUsesPCRPid( p_pat, i, pid ) )
+            continue;
+
+        if( !b_drained )
         {
-            /* Can be dedicated PCR pid (no owned then) or another pid (owner == pmt) */
-            if( p_pmt->i_pid_pcr == pid->i_pid ) /* If that program references current pid as PCR */
-            {
-                /* We've found a target group for update */
-                ProgramSetPCR( p_demux, p_pmt, i_program_pcr );
-            }
+            WorkersDrain( p_sys );
+            b_drained = true;
         }
-
+        ProgramSetPCR( p_demux, p_pmt, TimeStampWrapAround( p_pmt, i_pcr ) );
     }
 }
 
@@ -3140,12 +3735,22 @@ static void PCRFixHandle( demux_t *p_demux, ts_pmt_t *p_pmt, block_t *p_block )
             GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
         {
             int i_cand = FindPCRCandidate( p_pmt );
-            p_pmt->i_pid_pcr = i_cand;
-            if ( GetPID( p_demux->p_sys, p_pmt->i_pid_pcr )->probed.i_pcr_count == 0 )
+            if ( GetPID( p_demux->p_sys, i_cand )->probed.i_pcr_count == 0 )
                 p_pmt->pcr.b_disable = true;
             msg_Warn( p_demux, "No PCR received for program %d, set up workaround using pid %d",
                       p_pmt->i_number, i_cand );
-            UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+            if( p_demux->p_sys->workers.i_count )
+            {
+                /* The PCR pid routes the packets: let the input thread
+                 * switch it once the program threads are idle */
+                p_pmt->pcr.i_pid_fix = i_cand;
+                atomic_store( &p_demux->p_sys->workers.b_update_filters, true );
+            }
+            else
+            {
+                p_pmt->i_pid_pcr = i_cand;
+                UpdatePESFilters( p_demux, p_demux->p_sys->b_es_all );
+            }
         }
         p_pmt->pcr.b_fix_done = true;
     }
@@ -3184,9 +3789,9 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
 
     if( p_demux->p_sys->csa )
     {
-        vlc_mutex_lock( &p_demux->p_sys->csa_lock );
+        vlc_rwlock_rdlock( &p_demux->p_sys->csa_lock );
         csa_Decrypt( p_demux->p_sys->csa, p_bk->p_buffer, p_demux->p_sys->i_csa_pkt_size );
-        vlc_mutex_unlock( &p_demux->p_sys->csa_lock );
+        vlc_rwlock_unlock( &p_demux->p_sys->csa_lock );
     }
 
     if( !b_adaptation )
@@ -3252,7 +3857,7 @@ static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         }
     }
 
-    PCRHandle( p_demux, pid, p_bk );
+    PCRHandle( p_demux, pid, p_bk->p_buffer );
 
     if( i_skip >= 188 )
     {
@@ -4939,6 +5544,8 @@ static void AddAndCreateES( demux_t *p_demux, ts_pid_t *pid, bool b_create_delay
 {
     demux_sys_t  *p_sys = p_demux->p_sys;
 
+    WorkersDrain( p_sys );
+
     if( b_create_delayed )
         p_sys->es_creation = CREATE_ES;
 
@@ -5039,6 +5646,8 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
         return;
     }
 
+    WorkersDrain( p_sys );
+
     /* Save old es array */
     DECL_ARRAY(ts_pid_t *) old_es_rm;
     old_es_rm.i_alloc = p_pmt->e_streams.i_alloc;
@@ -5385,8 +5994,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
     {
         if ( p_sys->arib.e_mode == ARIBMODE_ENABLED && !p_sys->arib.b25stream )
         {
-            p_sys->arib.b25stream = stream_FilterNew( p_demux->s, "aribcam" );
-            p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
+            p_sys->arib.b25stream = TSBatchFilterNew( p_demux, "aribcam" );
             if (!p_sys->arib.b25stream)
                 dvbpsi_pmt_delete( p_dvbpsipmt );
         } else dvbpsi_pmt_delete( p_dvbpsipmt );
@@ -5466,6 +6074,8 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
     msg_Dbg( p_demux, "new PAT ts_id=%d version=%d current_next=%d",
              p_dvbpsipat->i_ts_id, p_dvbpsipat->i_version, p_dvbpsipat->b_current_next );
 
+    WorkersDrain( p_sys );
+
     /* Save old programs array */
     DECL_ARRAY(ts_pid_t *) old_pmt_rm;
     old_pmt_rm.i_alloc = p_pat->programs.i_alloc;
@@ -5495,6 +6105,7 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_dvbpsipat )
         }
 
         pmtpid->u.p_pmt->i_number = p_program->i_number;
+        pmtpid->u.p_pmt->i_worker = p_pat->programs.i_size;
 
         if( !dvbpsi_pmt_attach( pmtpid->u.p_pmt->handle, p_program->i_number, PMTCallBack, p_demux ) )
             msg_Err( p_demux, "PATCallback failed attaching PMTCallback to program %d",
@@ -5601,6 +6212,7 @@ static ts_pmt_t *ts_pmt_New( demux_t *p_demux )
     pmt->pcr.i_pcroffset = -1;
 
     pmt->pcr.b_fix_done = false;
+    pmt->pcr.i_pid_fix = -1;
 
     return pmt;
 }
@@ -185,6 +185,7 @@ static int vlclua_input_item_stats( lua_State *L )
                          lua_setfield( L, -2, #n );
         STATS_INT( read_packets )
         STATS_INT( read_bytes )
+        STATS_INT( dropped_packets )
         STATS_FLOAT( input_bitrate )
         STATS_FLOAT( average_input_bitrate )
         STATS_INT( demux_read_packets )
@@ -193,6 +194,12 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_FLOAT( average_demux_bitrate )
         STATS_INT( demux_corrupted )
         STATS_INT( demux_discontinuity )
+        STATS_INT( cache_hits )
+        STATS_INT( cache_misses )
+        STATS_INT( readahead_hits )
+        STATS_INT( readahead_stalls )
+        STATS_INT( readahead_stall_time )
+        STATS_INT( readahead_misses )
         STATS_INT( decoded_audio )
         STATS_INT( decoded_video )
         STATS_INT( displayed_pictures )
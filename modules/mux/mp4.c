@@ -55,6 +55,19 @@
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
 
+#define DURATION_TEXT N_("Expected duration (s)")
+#define DURATION_LONGTEXT N_(\
+    "Expected duration of the file, in seconds. For \"Fast Start\" files, " \
+    "room for the index is then reserved in front of the data, so that the " \
+    "data is only moved if the index does not fit. 0 disables the " \
+    "reservation, the whole data is moved when the file is closed.")
+
+#define FRAGMENT_TEXT N_("Fragment duration (ms)")
+#define FRAGMENT_LONGTEXT N_(\
+    "Target duration of the fragments of streamable files, in milliseconds. " \
+    "Fragments start on a keyframe whenever there is one in time. Short " \
+    "fragments lower the latency of segmented live outputs.")
+
 static int  Open   (vlc_object_t *);
 static void Close  (vlc_object_t *);
 static int  OpenFrag   (vlc_object_t *);
@@ -71,6 +84,10 @@ vlc_module_begin ()
     add_bool(SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true)
+    add_integer(SOUT_CFG_PREFIX "duration", 0,
+                DURATION_TEXT, DURATION_LONGTEXT, true)
+    add_integer_with_range(SOUT_CFG_PREFIX "fragment", 1500, 100, 60000,
+                           FRAGMENT_TEXT, FRAGMENT_LONGTEXT, true)
     set_capability("sout mux", 5)
     add_shortcut("mp4", "mov", "3gp")
     set_callbacks(Open, Close)
@@ -90,7 +107,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "duration", "fragment", NULL
 };
 
 static int Control(sout_mux_t *, int, va_list);
@@ -193,6 +210,12 @@ struct sout_mux_sys_t
     uint64_t i_pos;
     mtime_t  i_read_duration;
 
+    /* room reserved for the moov box, in front of mdat (fast start) */
+    uint64_t i_moov_reserve_pos;
+    uint64_t i_moov_reserve;
+    unsigned i_duration_hint; /* s, 0 if no reservation */
+    bool     b_mdat_started;
+
     unsigned int   i_nb_streams;
     mp4_stream_t **pp_streams;
 
@@ -200,6 +223,7 @@ struct sout_mux_sys_t
     bool           b_fragmented;
     bool           b_header_sent;
     mtime_t        i_written_duration;
+    mtime_t        i_fragment_length;
     uint32_t       i_mfhd_sequence;
 };
 
@@ -219,6 +243,7 @@ static inline void bo_add_mp4_tag_descr(bo_t *box, uint8_t tag, uint32_t size)
 static void box_send(sout_mux_t *p_mux,  bo_t *box);
 
 static bo_t *GetMoovBox(sout_mux_t *p_mux);
+static int   MdatStart (sout_mux_t *p_mux);
 
 static block_t *ConvertSUBT(block_t *);
 static block_t *ConvertFromAnnexB(block_t *);
@@ -253,6 +278,9 @@ static int Open(vlc_object_t *p_this)
     p_sys->b_3gp        = p_mux->psz_mux && !strcmp(p_mux->psz_mux, "3gp");
     p_sys->i_read_duration   = 0;
     p_sys->b_fragmented = false;
+    p_sys->i_moov_reserve = 0;
+    p_sys->i_duration_hint = 0;
+    p_sys->b_mdat_started = false;
 
     if (!p_sys->b_mov) {
         /* Now add ftyp header */
@@ -286,20 +314,117 @@ static int Open(vlc_object_t *p_this)
      * Quicktime actually doesn't like the 64 bits extensions !!! */
     p_sys->b_64_ext = false;
 
-    /* Now add mdat header */
-    box = box_new("mdat");
-    if(!box)
+    p_sys->i_moov_reserve_pos = p_sys->i_mdat_pos;
+
+    /* The room for the index depends on the tracks: wait for them */
+    if (var_GetBool(p_this, SOUT_CFG_PREFIX "faststart"))
+        p_sys->i_duration_hint = var_GetInteger(p_this, SOUT_CFG_PREFIX "duration");
+    if (p_sys->i_duration_hint > 0)
+        return VLC_SUCCESS;
+
+    if (MdatStart(p_mux))
     {
         free(p_sys);
         return VLC_ENOMEM;
     }
+    return VLC_SUCCESS;
+}
+
+/* Index bytes per second of the stream, in the worst case */
+static uint64_t EstimateIndexRate(const es_format_t *p_fmt, unsigned i_offset_size)
+{
+    unsigned i_samples; /* per second */
+
+    switch (p_fmt->i_cat)
+    {
+    case VIDEO_ES:
+        if (p_fmt->video.i_frame_rate && p_fmt->video.i_frame_rate_base)
+            i_samples = 1 + p_fmt->video.i_frame_rate / p_fmt->video.i_frame_rate_base;
+        else
+            i_samples = 60;
+        /* stsz, stts, ctts, stss, and one chunk per sample */
+        return i_samples * (4 + 8 + 8 + 4 + i_offset_size);
+
+    case AUDIO_ES:
+        if (p_fmt->audio.i_rate)
+            i_samples = 1 + p_fmt->audio.i_rate /
+                        (p_fmt->audio.i_frame_length ? p_fmt->audio.i_frame_length : 1024);
+        else
+            i_samples = 50;
+        return i_samples * (4 + 8 + i_offset_size);
+
+    default:
+        return 4 * (4 + 8 + i_offset_size);
+    }
+}
+
+/* Writes the mdat header, after a free box large enough for the moov box of
+ * a file of the expected duration, if any */
+static int MdatStart(sout_mux_t *p_mux)
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    p_sys->b_mdat_started = true;
+    p_sys->i_moov_reserve_pos = p_sys->i_pos;
+
+    if (p_sys->i_duration_hint > 0) {
+        uint64_t i_bitrate = 0;
+        bool b_bitrate = true;
+
+        for (unsigned i = 0; i < p_sys->i_nb_streams; i++) {
+            i_bitrate += p_sys->pp_streams[i]->fmt.i_bitrate;
+            if (p_sys->pp_streams[i]->fmt.i_bitrate == 0)
+                b_bitrate = false;
+        }
+        /* 64 bits chunk offsets unless the bitrates tell otherwise */
+        unsigned i_offset_size = (b_bitrate &&
+            i_bitrate * p_sys->i_duration_hint / 8 < (((uint64_t)1)<<32)) ? 4 : 8;
+
+        uint64_t i_reserve = 1024; /* ftyp-less moov, mvhd, udta */
+        for (unsigned i = 0; i < p_sys->i_nb_streams; i++) {
+            const es_format_t *p_fmt = &p_sys->pp_streams[i]->fmt;
+            i_reserve += 1024 + p_fmt->i_extra + p_sys->i_duration_hint *
+                         EstimateIndexRate(p_fmt, i_offset_size);
+        }
+        i_reserve += i_reserve / 16;
+        if (i_reserve > UINT32_MAX)
+            i_reserve = UINT32_MAX;
+
+        msg_Dbg(p_mux, "reserving %"PRIu64" bytes for %u s of index",
+                i_reserve, p_sys->i_duration_hint);
+
+        /* free box, filled with zeroes */
+        bo_t *box = box_new("free");
+        if (!box)
+            return VLC_ENOMEM;
+        box_fix(box, i_reserve);
+        box_send(p_mux, box);
+
+        for (uint64_t i_left = i_reserve - 8; i_left > 0; ) {
+            size_t i_chunk = __MIN(i_left, 65536);
+            block_t *p_zero = block_Alloc(i_chunk);
+            if (!p_zero)
+                return VLC_ENOMEM;
+            memset(p_zero->p_buffer, 0, i_chunk);
+            sout_AccessOutWrite(p_mux->p_access, p_zero);
+            i_left -= i_chunk;
+        }
+
+        p_sys->i_moov_reserve = i_reserve;
+        p_sys->i_pos += i_reserve;
+    }
+    p_sys->i_mdat_pos = p_sys->i_pos;
+
+    /* Now add mdat header */
+    bo_t *box = box_new("mdat");
+    if(!box)
+        return VLC_ENOMEM;
     bo_add_64be  (box, 0); // enough to store an extended size
 
     if(box->b)
         p_sys->i_pos += box->b->i_buffer;
 
     box_send(p_mux, box);
-
     return VLC_SUCCESS;
 }
 
@@ -313,6 +438,9 @@ static void Close(vlc_object_t *p_this)
 
     msg_Dbg(p_mux, "Close");
 
+    if (!p_sys->b_mdat_started && MdatStart(p_mux))
+        goto cleanup;
+
     /* Update mdat size */
     bo_t bo;
     if (!bo_init(&bo, 16))
@@ -338,11 +466,22 @@ static void Close(vlc_object_t *p_this)
 
     /* Check we need to create "fast start" files */
     p_sys->b_fast_start = var_GetBool(p_this, SOUT_CFG_PREFIX "faststart");
+    uint64_t i_moved = 0;
+    uint64_t i_free = 0;
     while (p_sys->b_fast_start && moov && moov->b) {
         /* Move data to the end of the file so we can fit the moov header
-         * at the start */
-        int64_t i_size = p_sys->i_pos - p_sys->i_mdat_pos;
-        int i_moov_size = moov->b->i_buffer;
+         * at the start, unless it fits in the reserved room. What is left
+         * of the room must be large enough for a free box. */
+        uint64_t i_moov_size = moov->b->i_buffer;
+        uint64_t i_shift = 0;
+
+        if (i_moov_size > p_sys->i_moov_reserve)
+            i_shift = i_moov_size - p_sys->i_moov_reserve;
+        else if (p_sys->i_moov_reserve - i_moov_size < 8 &&
+                 p_sys->i_moov_reserve != i_moov_size)
+            i_shift = i_moov_size + 8 - p_sys->i_moov_reserve;
+
+        int64_t i_size = i_shift ? p_sys->i_pos - p_sys->i_mdat_pos : 0;
 
         while (i_size > 0) {
             int64_t i_chunk = __MIN(32768, i_size);
@@ -357,28 +496,30 @@ static void Close(vlc_object_t *p_this)
                 break;
             }
             sout_AccessOutSeek(p_mux->p_access, p_sys->i_mdat_pos + i_size +
-                                i_moov_size - i_chunk);
+                                i_shift - i_chunk);
             sout_AccessOutWrite(p_mux->p_access, p_buf);
             i_size -= i_chunk;
+            i_moved += i_chunk;
         }
 
         if (!p_sys->b_fast_start)
             break;
 
         /* Update pos pointers */
-        i_moov_pos = p_sys->i_mdat_pos;
-        p_sys->i_mdat_pos += moov->b->i_buffer;
+        i_moov_pos = p_sys->i_moov_reserve_pos;
+        p_sys->i_mdat_pos += i_shift;
+        i_free = p_sys->i_moov_reserve + i_shift - i_moov_size;
 
         /* Fix-up samples to chunks table in MOOV header */
-        for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
+        for (unsigned int i_trak = 0; i_shift && i_trak < p_sys->i_nb_streams; i_trak++) {
             mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
             unsigned i_written = 0;
             for (unsigned i = 0; i < p_stream->i_entry_count; ) {
                 mp4_entry_t *entry = p_stream->entry;
                 if (p_stream->b_stco64)
-                    bo_set_64be(moov, p_stream->i_stco_pos + i_written++ * 8, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
+                    bo_set_64be(moov, p_stream->i_stco_pos + i_written++ * 8, entry[i].i_pos + i_shift);
                 else
-                    bo_set_32be(moov, p_stream->i_stco_pos + i_written++ * 4, entry[i].i_pos + p_sys->i_mdat_pos - i_moov_pos);
+                    bo_set_32be(moov, p_stream->i_stco_pos + i_written++ * 4, entry[i].i_pos + i_shift);
 
                 for (; i < p_stream->i_entry_count; i++)
                     if (i >= p_stream->i_entry_count - 1 ||
@@ -392,10 +533,24 @@ static void Close(vlc_object_t *p_this)
         p_sys->b_fast_start = false;
     }
 
+    if (p_sys->i_moov_reserve > 0 || i_moved > 0)
+        msg_Info(p_mux, "fast start: moved %"PRIu64" bytes, %"PRIu64
+                 " bytes of %"PRIu64" reserved left unused", i_moved, i_free,
+                 p_sys->i_moov_reserve);
+
     /* Write MOOV header */
     sout_AccessOutSeek(p_mux->p_access, i_moov_pos);
     box_send(p_mux, moov);
 
+    /* and turn the rest of the reserved room into a free box */
+    if (i_free > 0) {
+        bo_t *box = box_new("free");
+        if (box) {
+            box_fix(box, i_free);
+            box_send(p_mux, box);
+        }
+    }
+
 cleanup:
     /* Clean-up */
     for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++) {
@@ -566,6 +721,9 @@ static int Mux(sout_mux_t *p_mux)
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
 
+    if (!p_sys->b_mdat_started && MdatStart(p_mux))
+        return VLC_ENOMEM;
+
     for (;;) {
         int i_stream = sout_MuxGetStream(p_mux, 2, NULL);
         if (i_stream < 0)
@@ -585,7 +743,7 @@ static int Mux(sout_mux_t *p_mux)
             else if (p_stream->fmt.i_codec == VLC_CODEC_A52 ||
                      p_stream->fmt.i_codec == VLC_CODEC_EAC3) {
                 if (p_stream->a52_frame == NULL && p_data->i_buffer >= 8)
-                    p_stream->a52_frame = block_Duplicate(p_data);
+                    p_stream->a52_frame = block_Share(p_data);
             }
         } while (!p_data);
 
@@ -767,6 +925,11 @@ static block_t *ConvertFromAnnexB(block_t *p_block)
         return NULL;
     }
 
+    /* Start codes are rewritten in place */
+    p_block = block_Unshare(p_block);
+    if( !p_block )
+        return NULL;
+
     if(memcmp(p_block->p_buffer, avc1_start_code, 4))
     {
         if(!memcmp(p_block->p_buffer, avc1_short_start_code, 3))
@@ -2481,8 +2644,6 @@ static int64_t get_timestamp(void)
 /***************************************************************************
     MP4 Live submodule
 ****************************************************************************/
-#define FRAGMENT_LENGTH  (CLOCK_FREQ * 3/2)
-
 #define ENQUEUE_ENTRY(object, entry) \
     do {\
         if (object.p_last)\
@@ -2547,9 +2708,22 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
 
     bo_t            *moof, *mfhd;
     size_t           i_fixupoffset = 0;
+    bool             b_random_access = true;
+    unsigned int     i_ref_trak = 0;
+    mtime_t          i_length = 0;
 
     *pi_mdat_total_size = 0;
 
+    /* The first video track gives the decode time of the fragment */
+    for (unsigned int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++)
+    {
+        if (p_sys->pp_streams[i_trak]->fmt.i_cat == VIDEO_ES)
+        {
+            i_ref_trak = i_trak;
+            break;
+        }
+    }
+
     moof = box_new("moof");
     if(!moof)
         return NULL;
@@ -2646,7 +2820,10 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
             uint32_t i_trun_flags = 0x0;
 
             if (p_stream->b_hasiframes && !(p_stream->read.p_first->p_block->i_flags & BLOCK_FLAG_TYPE_I))
+            {
                 i_trun_flags |= MP4_TRUN_FIRST_FLAGS;
+                b_random_access = false;
+            }
 
             if (!b_allsamelength ||
                 ( !(i_tfhd_flags & MP4_TFHD_DFLT_SAMPLE_DURATION) && p_stream->i_trex_length == 0 ))
@@ -2729,6 +2906,9 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
                 i_time += p_entry->p_block->i_length;
             }
 
+            if (i_trak == i_ref_trak)
+                i_length = i_time - p_stream->i_written_duration;
+
             box_gather(traf, trun);
         }
 
@@ -2750,8 +2930,16 @@ static bo_t *GetMoofBox(sout_mux_t *p_mux, size_t *pi_mdat_total_size,
         bo_set_32be(moof, i_fixupoffset, moof->b->i_buffer + 8);
     }
 
-    /* set iframe flag, so the streaming server always starts from moof */
-    moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+    /* set iframe flag only if every track can be decoded from this moof,
+     * so that the streaming server and segmenters start from it */
+    if (b_random_access)
+        moof->b->i_flags |= BLOCK_FLAG_TYPE_I;
+
+    /* carry the tfdt of the reference track, segmenters compute their
+     * durations as differences of it */
+    if (p_sys->i_nb_streams)
+        moof->b->i_dts = VLC_TS_0 + p_sys->pp_streams[i_ref_trak]->i_written_duration;
+    moof->b->i_length = i_length;
 
     return moof;
 }
@@ -2870,6 +3058,8 @@ static int OpenFrag(vlc_object_t *p_this)
     p_mux->pf_delstream = DelStream;
     p_mux->pf_mux       = MuxFrag;
 
+    config_ChainParse(p_mux, SOUT_CFG_PREFIX, ppsz_sout_options, p_mux->p_cfg);
+
     /* unused */
     p_sys->b_mov        = false;
     p_sys->b_3gp        = false;
@@ -2882,6 +3072,7 @@ static int OpenFrag(vlc_object_t *p_this)
     p_sys->i_mdat_pos   = 0;
     p_sys->i_read_duration   = 0;
     p_sys->i_written_duration= 0;
+    p_sys->i_fragment_length = var_GetInteger(p_this, SOUT_CFG_PREFIX "fragment") * 1000;
 
     p_sys->b_header_sent = false;
     p_sys->b_fragmented  = true;
@@ -2894,7 +3085,7 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
 {
     sout_mux_sys_t *p_sys = (sout_mux_sys_t*) p_mux->p_sys;
     bo_t *moof = NULL;
-    mtime_t i_barrier_time = p_sys->i_written_duration + FRAGMENT_LENGTH;
+    mtime_t i_barrier_time = p_sys->i_written_duration + p_sys->i_fragment_length;
     size_t i_mdat_size = 0;
     bool b_has_samples = false;
 
@@ -2932,7 +3123,6 @@ static void WriteFragments(sout_mux_t *p_mux, bool b_flush)
     {
         msg_Dbg(p_mux, "writing moof @ %"PRId64, p_sys->i_pos);
         p_sys->i_pos += moof->b->i_buffer;
-        assert(moof->b->i_flags & BLOCK_FLAG_TYPE_I); /* http sout */
         box_send(p_mux, moof);
         msg_Dbg(p_mux, "writing mdat @ %"PRId64, p_sys->i_pos);
         WriteFragmentMDAT(p_mux, i_mdat_size);
@@ -3096,7 +3286,7 @@ static int MuxFrag(sout_mux_t *p_mux)
         p_stream->p_held_entry = NULL;
 
         if (p_stream->b_hasiframes && (p_heldblock->i_flags & BLOCK_FLAG_TYPE_I) &&
-            p_stream->i_read_duration - p_sys->i_written_duration < FRAGMENT_LENGTH)
+            p_stream->i_read_duration - p_sys->i_written_duration < p_sys->i_fragment_length)
         {
             /* Flag the last iframe time, we'll use it as boundary so it will start
                next fragment */
@@ -3145,7 +3335,7 @@ static int MuxFrag(sout_mux_t *p_mux)
     p_sys->i_written_duration = i_min_written_duration;
 
     /* we have prerolled enough to know all streams, and have enough date to create a fragment */
-    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= FRAGMENT_LENGTH)
+    if (p_stream->read.p_first && p_sys->i_read_duration - p_sys->i_written_duration >= p_sys->i_fragment_length)
         WriteFragments(p_mux, false);
 
     return VLC_SUCCESS;
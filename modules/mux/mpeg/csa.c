@@ -27,6 +27,7 @@
 #endif
 
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
@@ -39,19 +40,27 @@ struct csa_t
     uint8_t o_kk[57];
     uint8_t e_kk[57];
 
-    /* cypher state */
+    bool    use_odd;
+};
+
+/* stream cypher state, kept out of csa_t so that several threads can
+ * (de)scramble with the same keys */
+typedef struct
+{
     int     A[11];
     int     B[11];
     int     X, Y, Z;
     int     D, E, F;
     int     p, q, r;
-
-    bool    use_odd;
-};
+} csa_stream_t;
 
 static void csa_ComputeKey( uint8_t kk[57], uint8_t ck[8] );
 
-static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, uint8_t *cb );
+static void csa_StreamCypher( csa_stream_t *c, int b_init, const uint8_t *ck,
+                              const uint8_t *sb, uint8_t *cb );
+static void csa_StreamBatch( const uint64_t *p_ck, const uint64_t *p_sb,
+                             uint8_t *const *pp_dst, const int *pi_len,
+                             unsigned i_count );
 
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
@@ -140,6 +149,7 @@ int csa_UseKey( vlc_object_t *p_caller, csa_t *c, bool use_odd )
  *****************************************************************************/
 void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
 {
+    csa_stream_t s;
     uint8_t *ck;
     uint8_t *kk;
 
@@ -179,7 +189,7 @@ void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
         return;
 
     /* init csa state */
-    csa_StreamCypher( c, 1, ck, &pkt[i_hdr], ib );
+    csa_StreamCypher( &s, 1, ck, &pkt[i_hdr], ib );
 
     /* */
     n = (i_pkt_size - i_hdr) / 8;
@@ -192,7 +202,7 @@ void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
         csa_BlockDecypher( kk, ib, block );
         if( i != n )
         {
-            csa_StreamCypher( c, 0, ck, NULL, stream );
+            csa_StreamCypher( &s, 0, ck, NULL, stream );
             for( j = 0; j < 8; j++ )
             {
                 /* xor ib with stream */
@@ -216,7 +226,7 @@ void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
 
     if( i_residue > 0 )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
+        csa_StreamCypher( &s, 0, ck, NULL, stream );
         for( j = 0; j < i_residue; j++ )
         {
             pkt[i_pkt_size - i_residue + j] ^= stream[j];
@@ -229,6 +239,7 @@ void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
  *****************************************************************************/
 void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
 {
+    csa_stream_t s;
     uint8_t *ck;
     uint8_t *kk;
 
@@ -283,7 +294,7 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 
     /* init csa state */
-    csa_StreamCypher( c, 1, ck, ib[1], stream );
+    csa_StreamCypher( &s, 1, ck, ib[1], stream );
 
     for( i = 0; i < 8; i++ )
     {
@@ -291,7 +302,7 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
     for( i = 2; i < n+1; i++ )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
+        csa_StreamCypher( &s, 0, ck, NULL, stream );
         for( j = 0; j < 8; j++ )
         {
             pkt[i_hdr+8*(i-1)+j] = ib[i][j] ^ stream[j];
@@ -299,7 +310,7 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
     if( i_residue > 0 )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
+        csa_StreamCypher( &s, 0, ck, NULL, stream );
         for( j = 0; j < i_residue; j++ )
         {
             pkt[i_pkt_size - i_residue + j] ^= stream[j];
@@ -307,6 +318,163 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_DecryptBatch:
+ *****************************************************************************/
+void csa_DecryptBatch( csa_t *c, uint8_t *const *pp_pkt, unsigned i_count,
+                       int i_pkt_size )
+{
+    uint64_t p_ck[CSA_BATCH_MAX], p_sb[CSA_BATCH_MAX];
+    uint8_t *pp_dst[CSA_BATCH_MAX];
+    int      pi_len[CSA_BATCH_MAX];
+    struct
+    {
+        uint8_t *p_data;
+        uint8_t *kk;
+        int      n;
+    } lane[CSA_BATCH_MAX];
+
+    while( i_count > 0 )
+    {
+        const unsigned i_batch = __MIN( i_count, CSA_BATCH_MAX );
+        unsigned i_lanes = 0;
+
+        if( i_batch < CSA_BATCH_MIN )
+        {
+            for( unsigned i = 0; i < i_batch; i++ )
+                csa_Decrypt( c, pp_pkt[i], i_pkt_size );
+            return;
+        }
+
+        for( unsigned i = 0; i < i_batch; i++ )
+        {
+            uint8_t *pkt = pp_pkt[i];
+            int i_hdr;
+
+            if( (pkt[3]&0x80) == 0 )
+                continue;
+            const bool b_odd = pkt[3]&0x40;
+
+            /* clear transport scrambling control */
+            pkt[3] &= 0x3f;
+
+            i_hdr = 4;
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+            if( 188 - i_hdr < 8 )
+                continue;
+
+            const int n = (i_pkt_size - i_hdr) / 8;
+            const int i_start = i_hdr + (n > 0 ? 8 : 0);
+
+            p_ck[i_lanes]   = GetQWBE( b_odd ? c->o_ck : c->e_ck );
+            p_sb[i_lanes]   = GetQWBE( &pkt[i_hdr] );
+            pp_dst[i_lanes] = &pkt[i_start];
+            pi_len[i_lanes] = __MAX( i_pkt_size - i_start, 0 );
+            lane[i_lanes].p_data = &pkt[i_hdr];
+            lane[i_lanes].kk     = b_odd ? c->o_kk : c->e_kk;
+            lane[i_lanes].n      = n;
+            i_lanes++;
+        }
+
+        /* xor the stream into blocks 1..n and the residue */
+        csa_StreamBatch( p_ck, p_sb, pp_dst, pi_len, i_lanes );
+
+        /* then run the block decypher chain of each packet in place */
+        for( unsigned l = 0; l < i_lanes; l++ )
+        {
+            uint8_t *p_data = lane[l].p_data;
+            uint8_t ib[8], block[8];
+
+            memcpy( ib, p_data, 8 );
+            for( int i = 1; i < lane[l].n + 1; i++ )
+            {
+                csa_BlockDecypher( lane[l].kk, ib, block );
+                if( i != lane[l].n )
+                    memcpy( ib, &p_data[8*i], 8 );
+                else
+                    memset( ib, 0, 8 );
+                for( int j = 0; j < 8; j++ )
+                    p_data[8*(i-1)+j] = ib[j] ^ block[j];
+            }
+        }
+
+        pp_pkt  += i_batch;
+        i_count -= i_batch;
+    }
+}
+
+/*****************************************************************************
+ * csa_EncryptBatch:
+ *****************************************************************************/
+void csa_EncryptBatch( csa_t *c, uint8_t *const *pp_pkt, unsigned i_count,
+                       int i_pkt_size )
+{
+    uint64_t p_ck[CSA_BATCH_MAX], p_sb[CSA_BATCH_MAX];
+    uint8_t *pp_dst[CSA_BATCH_MAX];
+    int      pi_len[CSA_BATCH_MAX];
+
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+
+    while( i_count > 0 )
+    {
+        const unsigned i_batch = __MIN( i_count, CSA_BATCH_MAX );
+        unsigned i_lanes = 0;
+
+        if( i_batch < CSA_BATCH_MIN )
+        {
+            for( unsigned i = 0; i < i_batch; i++ )
+                csa_Encrypt( c, pp_pkt[i], i_pkt_size );
+            return;
+        }
+
+        for( unsigned i = 0; i < i_batch; i++ )
+        {
+            uint8_t *pkt = pp_pkt[i];
+            uint8_t  block[8], ib[8];
+            int i_hdr;
+
+            /* set transport scrambling control */
+            pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+            i_hdr = 4;
+            if( pkt[3]&0x20 )
+                i_hdr += pkt[4] + 1;
+
+            const int n = (i_pkt_size - i_hdr) / 8;
+            if( n <= 0 )
+            {
+                pkt[3] &= 0x3f;
+                continue;
+            }
+
+            /* block cypher chain, backward and in place */
+            memset( ib, 0, 8 );
+            for( int i = n; i > 0; i-- )
+            {
+                uint8_t *p_block = &pkt[i_hdr+8*(i-1)];
+
+                for( int j = 0; j < 8; j++ )
+                    block[j] = p_block[j] ^ ib[j];
+                csa_BlockCypher( kk, block, ib );
+                memcpy( p_block, ib, 8 );
+            }
+
+            p_ck[i_lanes]   = GetQWBE( ck );
+            p_sb[i_lanes]   = GetQWBE( &pkt[i_hdr] );
+            pp_dst[i_lanes] = &pkt[i_hdr+8];
+            pi_len[i_lanes] = i_pkt_size - i_hdr - 8;
+            i_lanes++;
+        }
+
+        csa_StreamBatch( p_ck, p_sb, pp_dst, pi_len, i_lanes );
+
+        pp_pkt  += i_batch;
+        i_count -= i_batch;
+    }
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -374,7 +542,8 @@ static const int sbox5[0x20] = {2,0,0,1,3,2,3,2, 0,1,3,3,1,0,2,1, 2,3,2,0,0,3,1,
 static const int sbox6[0x20] = {0,1,2,3,1,2,2,0, 0,1,3,0,2,3,1,3, 2,3,0,2,3,0,1,1, 2,1,1,2,0,3,3,0};
 static const int sbox7[0x20] = {0,3,2,2,3,0,0,1, 3,0,1,3,1,2,2,1, 1,0,3,3,0,1,1,2, 2,3,1,0,2,3,0,2};
 
-static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, uint8_t *cb )
+static void csa_StreamCypher( csa_stream_t *c, int b_init, const uint8_t *ck,
+                              const uint8_t *sb, uint8_t *cb )
 {
     int i,j, k;
     int extra_B;
@@ -610,3 +779,82 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************/
+#define CSA_BS_SIZE   8
+#define CSA_BS_FN(x)  x##64
+#define CSA_BS_TARGET
+#include "csa_bitslice.h"
+#undef CSA_BS_TARGET
+#undef CSA_BS_FN
+#undef CSA_BS_SIZE
+
+#if defined(__i386__) || defined(__x86_64__)
+# define CSA_BS_SIZE   16
+# define CSA_BS_FN(x)  x##128
+# define CSA_BS_TARGET __attribute__((__target__("sse2")))
+# include "csa_bitslice.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS_FN
+# undef CSA_BS_SIZE
+# define csa_CPU_128() vlc_CPU_SSE2()
+
+# define CSA_BS_SIZE   32
+# define CSA_BS_FN(x)  x##256
+# define CSA_BS_TARGET __attribute__((__target__("avx2")))
+# include "csa_bitslice.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS_FN
+# undef CSA_BS_SIZE
+# define csa_CPU_256() vlc_CPU_AVX2()
+
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+# define CSA_BS_SIZE   16
+# define CSA_BS_FN(x)  x##128
+# define CSA_BS_TARGET
+# include "csa_bitslice.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS_FN
+# undef CSA_BS_SIZE
+# define csa_CPU_128() (1)
+#endif
+
+static void csa_StreamBatch( const uint64_t *p_ck, const uint64_t *p_sb,
+                             uint8_t *const *pp_dst, const int *pi_len,
+                             unsigned i_count )
+{
+    /* use the narrowest words that hold the whole batch */
+    while( i_count > 0 )
+    {
+        unsigned i_lanes;
+
+#ifdef csa_CPU_256
+        if( i_count > 128 && csa_CPU_256() )
+        {
+            i_lanes = __MIN( i_count, 256 );
+            csa_StreamBatch256( p_ck, p_sb, pp_dst, pi_len, i_lanes );
+        }
+        else
+#endif
+#ifdef csa_CPU_128
+        if( i_count > 64 && csa_CPU_128() )
+        {
+            i_lanes = __MIN( i_count, 128 );
+            csa_StreamBatch128( p_ck, p_sb, pp_dst, pi_len, i_lanes );
+        }
+        else
+#endif
+        {
+            i_lanes = __MIN( i_count, 64 );
+            csa_StreamBatch64( p_ck, p_sb, pp_dst, pi_len, i_lanes );
+        }
+
+        p_ck    += i_lanes;
+        p_sb    += i_lanes;
+        pp_dst  += i_lanes;
+        pi_len  += i_lanes;
+        i_count -= i_lanes;
+    }
+}
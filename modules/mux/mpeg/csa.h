@@ -31,6 +31,13 @@ typedef struct csa_t csa_t;
 #define csa_UseKey  __csa_UseKey
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_DecryptBatch __csa_decrypt_batch
+#define csa_EncryptBatch __csa_encrypt_batch
+
+/* Batches are bitsliced by up to CSA_BATCH_MAX packets; batches of fewer
+ * than CSA_BATCH_MIN packets are (de)scrambled one packet at a time. */
+#define CSA_BATCH_MIN 4
+#define CSA_BATCH_MAX 256
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
@@ -41,4 +48,10 @@ int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 
+/* Same as csa_Decrypt/csa_Encrypt on each packet of pp_pkt */
+void   csa_DecryptBatch( csa_t *, uint8_t *const *pp_pkt, unsigned i_count,
+                         int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t *const *pp_pkt, unsigned i_count,
+                         int i_pkt_size );
+
 #endif /* _CSA_H */
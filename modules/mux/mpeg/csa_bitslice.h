@@ -0,0 +1,377 @@
+/*****************************************************************************
+ * csa_bitslice.h: bitsliced CSA stream cypher
+ *****************************************************************************
+ * Copyright (C) 2004-2005 Laurent Aimar
+ * Copyright (C) the deCSA authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by csa.c once per register width, with:
+ *  CSA_BS_SIZE   the width of a bitslice word in bytes (8, 16 or 32),
+ *  CSA_BS_FN(x)  the name of symbol x for this width,
+ *  CSA_BS_TARGET the function attributes selecting the instruction set.
+ *
+ * Every bit of a word is a different packet (lane): lane e*64+b is bit b of
+ * the 64-bit element e. The 11 nibble registers of csa_StreamCypher become
+ * 4 words each, and the sboxes become boolean circuits (multiplexer trees
+ * over their 5 input bits), so that one pass runs the cypher for all the
+ * lanes at once. */
+
+#define BS_T     CSA_BS_FN(csa_bs_t)
+#define BS_LANES (CSA_BS_SIZE * 8)
+#define BS_ELEMS (CSA_BS_SIZE / 8)
+
+/* s ? b : a */
+#define BS_MUX( s, a, b ) ((a) ^ (((a) ^ (b)) & (s)))
+
+typedef uint64_t BS_T __attribute__((vector_size(CSA_BS_SIZE)));
+
+typedef struct
+{
+    /* A[k] and B[k] are a[base+k] and b[base+k]: shifting the registers
+     * only decrements base, see CSA_BS_FN(csa_bs_Cypher) */
+    BS_T a[32+10][4];
+    BS_T b[32+10][4];
+    BS_T x[4], y[4], z[4];
+    BS_T d[4], e[4], f[4];
+    BS_T p, q, r;
+} CSA_BS_FN(csa_bs_state_t);
+
+/* Transposes the 64x64 bit matrix held in each element of w[0..63] */
+CSA_BS_TARGET
+static inline void CSA_BS_FN(csa_bs_Transpose)( BS_T w[64] )
+{
+    uint64_t m = UINT64_C(0x00000000ffffffff);
+
+    for( unsigned j = 32; j != 0; j >>= 1, m ^= m << j )
+    {
+        for( unsigned k = 0; k < 64; k = ((k | j) + 1) & ~j )
+        {
+            const BS_T t = ((w[k] >> j) ^ w[k|j]) & m;
+            w[k|j] ^= t;
+            w[k] ^= t << j;
+        }
+    }
+}
+
+/* Loads one big endian 64-bit value per lane and transposes them:
+ * bit i of the value of lane l ends up in lane l of w[i]. */
+CSA_BS_TARGET
+static inline void CSA_BS_FN(csa_bs_Load)( BS_T w[64], const uint64_t *p_val,
+                                           unsigned i_count )
+{
+    for( unsigned b = 0; b < 64; b++ )
+        for( unsigned e = 0; e < BS_ELEMS; e++ )
+        {
+            const unsigned l = e * 64 + b;
+            w[b][e] = l < i_count ? p_val[l] : 0;
+        }
+    CSA_BS_FN(csa_bs_Transpose)( w );
+}
+
+/* Runs 32 steps of the cypher (8 bytes). During the initialisation, in
+ * holds the bits of the 8 bytes of the first scrambled block, otherwise the
+ * output bits are stored in out. */
+CSA_BS_TARGET
+static inline void CSA_BS_FN(csa_bs_Cypher)( CSA_BS_FN(csa_bs_state_t) *s,
+                                             const BS_T in[64], BS_T out[64] )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+        {
+            const int base = 31 - (4 * i + j);
+#define A( k, m ) s->a[base + (k)][m]
+#define B( k, m ) s->b[base + (k)][m]
+            BS_T s1h, s1l, s2h, s2l, s3h, s3l, s4h, s4l;
+            BS_T s5h, s5l, s6h, s6l, s7h, s7l;
+            BS_T next_A1[4], next_B1[4], extra_B[4];
+
+            /* sbox1 */
+            {
+                const BS_T t0 = ~A(9,0) ^ A(4,0);
+                const BS_T t1 = A(4,0) & ~A(9,0);
+                const BS_T t2 = BS_MUX( A(7,3), t0, t1 );
+                const BS_T t3 = ~A(9,0) & ~A(4,0);
+                const BS_T t4 = t3 | ~A(7,3);
+                const BS_T t5 = BS_MUX( A(6,1), t2, t4 );
+                const BS_T t6 = t0 | ~A(7,3);
+                const BS_T t7 = t6 ^ A(6,1);
+                const BS_T t8 = BS_MUX( A(1,2), t5, t7 );
+                const BS_T t9 = A(4,0) & A(9,0);
+                const BS_T t10 = t9 ^ A(7,3);
+                const BS_T t11 = A(9,0) & ~A(4,0);
+                const BS_T t12 = t11 ^ A(7,3);
+                const BS_T t13 = BS_MUX( A(6,1), t10, t12 );
+                const BS_T t14 = BS_MUX( A(7,3), t3, t9 );
+                const BS_T t15 = A(9,0) ^ A(4,0);
+                const BS_T t16 = t15 | ~A(7,3);
+                const BS_T t17 = BS_MUX( A(6,1), t14, t16 );
+                const BS_T t18 = BS_MUX( A(1,2), t13, t17 );
+                s1h = t8;
+                s1l = t18;
+            }
+            /* sbox2 */
+            {
+                const BS_T t0 = ~A(9,1) ^ A(7,0);
+                const BS_T t1 = ~A(9,1) | ~A(7,0);
+                const BS_T t2 = BS_MUX( A(6,3), t0, t1 );
+                const BS_T t3 = t2 ^ A(3,2);
+                const BS_T t4 = A(9,1) | ~A(7,0);
+                const BS_T t5 = BS_MUX( A(6,3), t0, t4 );
+                const BS_T t6 = A(7,0) & A(9,1);
+                const BS_T t7 = BS_MUX( A(6,3), t6, ~A(9,1) );
+                const BS_T t8 = BS_MUX( A(3,2), t5, t7 );
+                const BS_T t9 = BS_MUX( A(2,1), t3, t8 );
+                const BS_T t10 = A(9,1) ^ A(7,0);
+                const BS_T t11 = BS_MUX( A(6,3), ~A(7,0), t10 );
+                const BS_T t12 = t4 ^ A(6,3);
+                const BS_T t13 = BS_MUX( A(3,2), t11, t12 );
+                const BS_T t14 = ~A(9,1) & ~A(7,0);
+                const BS_T t15 = BS_MUX( A(6,3), t4, t14 );
+                const BS_T t16 = t15 ^ A(3,2);
+                const BS_T t17 = BS_MUX( A(2,1), t13, t16 );
+                s2h = t9;
+                s2l = t17;
+            }
+            /* sbox3 */
+            {
+                const BS_T t0 = ~A(5,3) & ~A(1,3);
+                const BS_T t1 = t0 | A(5,1);
+                const BS_T t2 = A(5,3) ^ A(1,3);
+                const BS_T t3 = t2 ^ A(5,1);
+                const BS_T t4 = BS_MUX( A(6,2), t1, t3 );
+                const BS_T t5 = A(1,3) & ~A(5,3);
+                const BS_T t6 = t5 ^ A(5,1);
+                const BS_T t7 = BS_MUX( A(5,1), A(5,3), t5 );
+                const BS_T t8 = BS_MUX( A(6,2), t6, t7 );
+                const BS_T t9 = BS_MUX( A(2,0), t4, t8 );
+                const BS_T t10 = A(1,3) ^ A(5,1);
+                const BS_T t11 = BS_MUX( A(6,2), t2, t10 );
+                const BS_T t12 = t11 ^ A(2,0);
+                s3h = t9;
+                s3l = t12;
+            }
+            /* sbox4 */
+            {
+                const BS_T t0 = ~A(8,0) | A(4,2);
+                const BS_T t1 = BS_MUX( A(2,3), t0, A(8,0) );
+                const BS_T t2 = A(8,0) & ~A(4,2);
+                const BS_T t3 = ~A(8,0) ^ A(4,2);
+                const BS_T t4 = BS_MUX( A(2,3), t2, t3 );
+                const BS_T t5 = BS_MUX( A(1,1), t1, t4 );
+                const BS_T t6 = A(4,2) & ~A(8,0);
+                const BS_T t7 = t6 ^ A(2,3);
+                const BS_T t8 = A(8,0) ^ A(4,2);
+                const BS_T t9 = BS_MUX( A(1,1), t7, t8 );
+                const BS_T t10 = BS_MUX( A(3,3), t5, t9 );
+                const BS_T t11 = A(8,0) | ~A(4,2);
+                const BS_T t12 = t11 ^ A(2,3);
+                const BS_T t13 = BS_MUX( A(1,1), t12, t3 );
+                const BS_T t14 = BS_MUX( A(3,3), t13, t5 );
+                s4h = t10;
+                s4l = t14;
+            }
+            /* sbox5 */
+            {
+                const BS_T t0 = ~A(8,1) ^ A(4,3);
+                const BS_T t1 = A(8,1) | ~A(4,3);
+                const BS_T t2 = BS_MUX( A(6,0), t0, t1 );
+                const BS_T t3 = t1 ^ A(6,0);
+                const BS_T t4 = BS_MUX( A(5,2), t2, t3 );
+                const BS_T t5 = A(4,3) & A(8,1);
+                const BS_T t6 = BS_MUX( A(6,0), t5, ~A(4,3) );
+                const BS_T t7 = BS_MUX( A(5,2), t6, t0 );
+                const BS_T t8 = BS_MUX( A(9,2), t4, t7 );
+                const BS_T t9 = t5 ^ A(6,0);
+                const BS_T t10 = A(8,1) ^ A(4,3);
+                const BS_T t11 = BS_MUX( A(6,0), A(4,3), t10 );
+                const BS_T t12 = BS_MUX( A(5,2), t9, t11 );
+                const BS_T t13 = A(8,1) | A(4,3);
+                const BS_T t14 = BS_MUX( A(6,0), t13, t5 );
+                const BS_T t15 = t14 ^ A(5,2);
+                const BS_T t16 = BS_MUX( A(9,2), t12, t15 );
+                s5h = t8;
+                s5l = t16;
+            }
+            /* sbox6 */
+            {
+                const BS_T t0 = A(7,2) ^ A(3,1);
+                const BS_T t1 = A(7,2) | A(3,1);
+                const BS_T t2 = t1 ^ A(5,0);
+                const BS_T t3 = BS_MUX( A(9,3), t0, t2 );
+                const BS_T t4 = t0 ^ A(5,0);
+                const BS_T t5 = A(3,1) & A(7,2);
+                const BS_T t6 = t5 ^ A(5,0);
+                const BS_T t7 = BS_MUX( A(9,3), t4, t6 );
+                const BS_T t8 = BS_MUX( A(4,1), t3, t7 );
+                const BS_T t9 = ~A(7,2) | A(3,1);
+                const BS_T t10 = A(5,0) & t9;
+                const BS_T t11 = ~A(7,2) | ~A(3,1);
+                const BS_T t12 = t11 ^ A(5,0);
+                const BS_T t13 = BS_MUX( A(9,3), t10, t12 );
+                const BS_T t14 = BS_MUX( A(5,0), ~A(7,2), t11 );
+                const BS_T t15 = BS_MUX( A(9,3), A(7,2), t14 );
+                const BS_T t16 = BS_MUX( A(4,1), t13, t15 );
+                s6h = t8;
+                s6l = t16;
+            }
+            /* sbox7 */
+            {
+                const BS_T t0 = A(8,3) ^ A(7,1);
+                const BS_T t1 = t0 & ~A(2,2);
+                const BS_T t2 = t1 ^ A(3,0);
+                const BS_T t3 = A(8,3) | ~A(7,1);
+                const BS_T t4 = BS_MUX( A(2,2), ~A(7,1), t3 );
+                const BS_T t5 = A(7,1) & A(8,3);
+                const BS_T t6 = BS_MUX( A(2,2), t0, t5 );
+                const BS_T t7 = BS_MUX( A(3,0), t4, t6 );
+                const BS_T t8 = BS_MUX( A(8,2), t2, t7 );
+                const BS_T t9 = t0 ^ A(2,2);
+                const BS_T t10 = ~A(8,3) ^ A(2,2);
+                const BS_T t11 = BS_MUX( A(3,0), t9, t10 );
+                const BS_T t12 = t5 ^ A(2,2);
+                const BS_T t13 = ~A(8,3) & ~A(7,1);
+                const BS_T t14 = BS_MUX( A(2,2), t3, t13 );
+                const BS_T t15 = BS_MUX( A(3,0), t12, t14 );
+                const BS_T t16 = BS_MUX( A(8,2), t11, t15 );
+                s7h = t8;
+                s7l = t16;
+            }
+
+            /* use 4x4 xor to produce extra nibble for T3 */
+            extra_B[3] = B(3,0) ^ B(6,1) ^ B(7,2) ^ B(9,3);
+            extra_B[2] = B(6,0) ^ B(8,1) ^ B(3,3) ^ B(4,2);
+            extra_B[1] = B(5,3) ^ B(8,2) ^ B(4,0) ^ B(5,1);
+            extra_B[0] = B(9,2) ^ B(6,3) ^ B(3,1) ^ B(8,0);
+
+            for( int m = 0; m < 4; m++ )
+            {
+                /* T1 and T2, in1/in2 and D are only used during the
+                 * initialisation */
+                next_A1[m] = A(10,m) ^ s->x[m];
+                next_B1[m] = B(7,m) ^ B(10,m) ^ s->y[m];
+                if( in != NULL )
+                {
+                    const BS_T in1 = in[56 - 8 * i + 4 + m];
+                    const BS_T in2 = in[56 - 8 * i + m];
+
+                    next_A1[m] ^= s->d[m] ^ ((j % 2) ? in2 : in1);
+                    next_B1[m] ^= (j % 2) ? in1 : in2;
+                }
+            }
+
+            /* if p=1, rotate next_B1 left */
+            const BS_T b3 = next_B1[3];
+            for( int m = 3; m > 0; m-- )
+                B(0,m) = BS_MUX( s->p, next_B1[m], next_B1[m-1] );
+            B(0,0) = BS_MUX( s->p, next_B1[0], b3 );
+            for( int m = 0; m < 4; m++ )
+                A(0,m) = next_A1[m];
+
+            /* T3 = xor all inputs */
+            for( int m = 0; m < 4; m++ )
+                s->d[m] = s->e[m] ^ s->z[m] ^ extra_B[m];
+
+            /* T4 = sum, carry of Z + E + r if q=1 */
+            BS_T carry = s->r;
+            for( int m = 0; m < 4; m++ )
+            {
+                const BS_T ze = s->z[m] ^ s->e[m];
+                const BS_T sum = ze ^ carry;
+                const BS_T next_E = s->f[m];
+
+                carry = (s->z[m] & s->e[m]) | (carry & ze);
+                s->f[m] = BS_MUX( s->q, s->e[m], sum );
+                s->e[m] = next_E;
+            }
+            s->r = BS_MUX( s->q, s->r, carry );
+
+            s->x[3] = s4l; s->x[2] = s3l; s->x[1] = s2h; s->x[0] = s1h;
+            s->y[3] = s6l; s->y[2] = s5l; s->y[1] = s4h; s->y[0] = s3h;
+            s->z[3] = s2l; s->z[2] = s1l; s->z[1] = s6h; s->z[0] = s5h;
+            s->p = s7h;
+            s->q = s7l;
+
+            /* 2 output bits are a function of the 4 bits of D */
+            if( out != NULL )
+            {
+                out[56 - 8 * i + 7 - 2 * j] = s->d[3] ^ s->d[2];
+                out[56 - 8 * i + 6 - 2 * j] = s->d[1] ^ s->d[0];
+            }
+#undef B
+#undef A
+        }
+    }
+
+    /* move the last 10 entries back to the top of the window */
+    memcpy( &s->a[32], &s->a[0], sizeof(s->a[0]) * 10 );
+    memcpy( &s->b[32], &s->b[0], sizeof(s->b[0]) * 10 );
+}
+
+/* Generates the key stream of up to BS_LANES packets and xors it into
+ * pp_dst[l][0..pi_len[l]-1], p_ck being the control word and p_sb the
+ * first scrambled block of each lane. */
+CSA_BS_TARGET
+static void CSA_BS_FN(csa_StreamBatch)( const uint64_t *p_ck,
+                                        const uint64_t *p_sb,
+                                        uint8_t *const *pp_dst,
+                                        const int *pi_len, unsigned i_count )
+{
+    CSA_BS_FN(csa_bs_state_t) s;
+    BS_T w[64];
+    int i_len = 0;
+
+    memset( &s, 0, sizeof(s) );
+
+    /* load first 32 bits of CK into A[1]..A[8]
+     * load last  32 bits of CK into B[1]..B[8] */
+    CSA_BS_FN(csa_bs_Load)( w, p_ck, i_count );
+    for( int i = 0; i < 4; i++ )
+        for( int m = 0; m < 4; m++ )
+        {
+            s.a[31 + 1 + 2 * i][m] = w[56 - 8 * i + 4 + m];
+            s.a[31 + 2 + 2 * i][m] = w[56 - 8 * i + m];
+            s.b[31 + 1 + 2 * i][m] = w[24 - 8 * i + 4 + m];
+            s.b[31 + 2 + 2 * i][m] = w[24 - 8 * i + m];
+        }
+
+    CSA_BS_FN(csa_bs_Load)( w, p_sb, i_count );
+    CSA_BS_FN(csa_bs_Cypher)( &s, w, NULL );
+
+    for( unsigned l = 0; l < i_count; l++ )
+        i_len = __MAX( i_len, pi_len[l] );
+
+    for( int i_pos = 0; i_pos < i_len; i_pos += 8 )
+    {
+        CSA_BS_FN(csa_bs_Cypher)( &s, NULL, w );
+        CSA_BS_FN(csa_bs_Transpose)( w );
+
+        for( unsigned l = 0; l < i_count; l++ )
+        {
+            const int i_size = __MIN( pi_len[l] - i_pos, 8 );
+            const uint64_t i_stream = w[l % 64][l / 64];
+
+            for( int k = 0; k < i_size; k++ )
+                pp_dst[l][i_pos + k] ^= i_stream >> (56 - 8 * k);
+        }
+    }
+}
+
+#undef BS_MUX
+#undef BS_ELEMS
+#undef BS_LANES
+#undef BS_T
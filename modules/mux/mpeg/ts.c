@@ -41,6 +41,7 @@
 #include <vlc_rand.h>
 
 #include <vlc_iso_lang.h>
+#include <vlc_atomic.h>
 
 #include "bits.h"
 #include "pes.h"
@@ -177,6 +178,22 @@ static void    Close  ( vlc_object_t * );
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define ARENA_TEXT N_("Packet arena")
+#define ARENA_LONGTEXT N_("Send the TS packets in blocks of several " \
+  "packets: one datagram (7 packets) for UDP and RTP, 64 kB otherwise. " \
+  "The packets are written in place in large buffers, which saves memory " \
+  "allocations, copies and access output calls.")
+
+#define MUXRATE_TEXT N_("Constant bitrate (bits/s)")
+#define MUXRATE_LONGTEXT N_("Output a constant bitrate stream of the given " \
+  "rate, stuffed with null packets. PCRs are stamped from the position of " \
+  "the packet in the output and the transport buffers of the decoder are " \
+  "modelled (ISO/IEC 13818-1 T-STD). 0 disables it.")
+
+#define PSI_TEXT N_("PSI interval (ms)")
+#define PSI_LONGTEXT N_("Set at which interval PAT and PMT are sent " \
+  "in constant bitrate mode. DVB requires at most 100 ms.")
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -223,6 +240,12 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_bool( SOUT_CFG_PREFIX "arena", false, ARENA_TEXT, ARENA_LONGTEXT, true)
+
+    add_integer(SOUT_CFG_PREFIX "muxrate", 0, MUXRATE_TEXT, MUXRATE_LONGTEXT, true)
+        change_integer_range( 0, 1000000000 )
+    add_integer(SOUT_CFG_PREFIX "psi-interval", 100, PSI_TEXT, PSI_LONGTEXT, true)
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -234,7 +257,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "arena", "muxrate", "psi-interval",
     NULL
 };
 
@@ -323,8 +346,41 @@ typedef struct
     ts_stream_t  ts;
     pes_stream_t pes;
     pes_state_t  state;
+
+    /* T-STD transport buffer (constant bitrate only), in bits times the
+     * mux rate, so that it drains by an integer amount at each slot */
+    struct
+    {
+        int64_t i_fill;
+        int64_t i_leak; /* Rx, bits/s */
+    } tb;
 } sout_input_sys_t;
 
+#define TS_ARENA_DATAGRAM 7    /* 1316 bytes */
+#define TS_ARENA_CHUNK    348  /* 65424 bytes */
+#define TS_ARENA_SLOTS    696  /* packets per arena chunk, 130848 bytes */
+
+typedef struct ts_arena_chunk_t ts_arena_chunk_t;
+
+/* TS packet written in place in an arena chunk. The first packet of a run
+ * of contiguous packets grows over the others, and is sent as one block. */
+typedef struct
+{
+    block_t           self;
+    ts_arena_chunk_t *p_chunk;
+} ts_arena_packet_t;
+
+struct ts_arena_chunk_t
+{
+    atomic_uint       i_refs; /* packets in use, plus one for the arena */
+    unsigned          i_used;
+    unsigned          i_size;
+    uint8_t          *p_data;
+    ts_arena_packet_t packets[];
+};
+
+#define TS_TB_SIZE        512  /* T-STD transport buffer, bytes */
+
 struct sout_mux_sys_t
 {
     int             i_pcr_pid;
@@ -371,6 +427,31 @@ struct sout_mux_sys_t
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* Packet arena: TS packets are written in place in p_current, and sent
+     * by blocks of up to i_chunk packets (0 if disabled) */
+    struct
+    {
+        unsigned          i_chunk;
+        ts_arena_chunk_t *p_current;
+    } arena;
+
+    /* Constant bitrate: one packet per slot of 1504/i_rate seconds, from
+     * the input date i_start (i_rate is 0 if disabled) */
+    struct
+    {
+        int64_t     i_rate;
+        mtime_t     i_start;
+        int64_t     i_pcr;        /* 27 MHz date of the current slot */
+        int64_t     i_pcr_frac;   /* remainder, in 1/i_rate of 27 MHz tick */
+        int64_t     i_pcr_next;   /* 27 MHz date of the next PCR */
+        int64_t     i_psi_next;   /* and of the next PAT/PMT */
+        int64_t     i_psi_delay;
+        bool        b_discontinuity;
+        unsigned    i_late;       /* packets sent after their DTS */
+        sout_buffer_chain_t psi;  /* pending PAT/PMT packets */
+        sout_input_sys_t *p_key_stream; /* PAT/PMT queued for its keyframe */
+    } cbr;
 };
 
 
@@ -463,11 +544,102 @@ static void TSSchedule  ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
 static void TSDate      ( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                           mtime_t i_pcr_length, mtime_t i_pcr_dts );
+static void TSMuxCBR    ( sout_mux_t *p_mux, mtime_t i_pcr_length,
+                          mtime_t i_pcr_dts );
+static void TSWrite     ( sout_mux_t *p_mux, block_t *p_ts, block_t **pp_chunk );
 static void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
 static void TSSetPCR( block_t *p_ts, mtime_t i_dts );
+static void TSSetPCR27( block_t *p_ts, int64_t i_pcr );
+
+/*****************************************************************************
+ * Packet arena
+ *****************************************************************************/
+static void TSArenaUnref( ts_arena_chunk_t *p_chunk )
+{
+    if( atomic_fetch_sub( &p_chunk->i_refs, 1 ) == 1 )
+        free( p_chunk );
+}
+
+static void TSArenaPacketRelease( block_t *p_ts )
+{
+    TSArenaUnref( ((ts_arena_packet_t *)p_ts)->p_chunk );
+}
+
+static ts_arena_chunk_t *TSArenaChunkNew( unsigned i_size )
+{
+    ts_arena_chunk_t *p_chunk = malloc( sizeof( *p_chunk )
+                          + i_size * ( sizeof( ts_arena_packet_t ) + 188 ) );
+    if( unlikely(p_chunk == NULL) )
+        return NULL;
+
+    atomic_init( &p_chunk->i_refs, 1 );
+    p_chunk->i_used = 0;
+    p_chunk->i_size = i_size;
+    p_chunk->p_data = (uint8_t *)&p_chunk->packets[i_size];
+    return p_chunk;
+}
+
+/* Returns an empty TS packet, in the current arena chunk if enabled */
+static block_t *TSPacketNew( sout_mux_sys_t *p_sys )
+{
+    ts_arena_chunk_t *p_chunk = p_sys->arena.p_current;
+
+    if( p_sys->arena.i_chunk == 0 )
+        return block_Alloc( 188 );
+
+    if( p_chunk == NULL || p_chunk->i_used == p_chunk->i_size )
+    {
+        if( p_chunk )
+            TSArenaUnref( p_chunk );
+        /* Whole blocks of i_chunk packets fit in a chunk */
+        p_chunk = TSArenaChunkNew( TS_ARENA_SLOTS / p_sys->arena.i_chunk
+                                   * p_sys->arena.i_chunk );
+        p_sys->arena.p_current = p_chunk;
+        if( unlikely(p_chunk == NULL) )
+            return block_Alloc( 188 );
+    }
+
+    ts_arena_packet_t *p_pkt = &p_chunk->packets[p_chunk->i_used];
+    block_Init( &p_pkt->self, &p_chunk->p_data[p_chunk->i_used * 188], 188 );
+    p_pkt->self.pf_release = TSArenaPacketRelease;
+    p_pkt->p_chunk = p_chunk;
+    p_chunk->i_used++;
+    atomic_fetch_add( &p_chunk->i_refs, 1 );
+    return &p_pkt->self;
+}
+
+/* Moves a packet built outside of the mux (PSI tables) to the arena, so that
+ * it does not cut the block it is sent in */
+static block_t *TSPacketCopy( sout_mux_sys_t *p_sys, block_t *p_ts )
+{
+    if( p_sys->arena.i_chunk == 0 || p_ts == NULL )
+        return p_ts;
+
+    block_t *p_copy = TSPacketNew( p_sys );
+    if( unlikely(p_copy == NULL) )
+        return p_ts;
+
+    memcpy( p_copy->p_buffer, p_ts->p_buffer, 188 );
+    block_CopyProperties( p_copy, p_ts );
+    block_Release( p_ts );
+    return p_copy;
+}
+
+/* Appends the PAT and the PMT to the chain */
+static void GetPSI( sout_mux_t *p_mux, sout_buffer_chain_t *c )
+{
+    sout_buffer_chain_t psi;
+    block_t *p_ts;
+
+    BufferChainInit( &psi );
+    GetPAT( p_mux, &psi );
+    GetPMT( p_mux, &psi );
+    while( ( p_ts = BufferChainGet( &psi ) ) )
+        BufferChainAppend( c, TSPacketCopy( p_mux->p_sys, p_ts ) );
+}
 
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
@@ -720,6 +892,32 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_use_key_frames = var_GetBool( p_mux, SOUT_CFG_PREFIX "use-key-frames" );
 
+    if( var_GetBool( p_mux, SOUT_CFG_PREFIX "arena" ) )
+    {
+        const char *psz_access = p_mux->p_access->psz_access;
+
+        if( !strncmp( psz_access, "udp", 3 ) || !strncmp( psz_access, "rtp", 3 ) )
+            p_sys->arena.i_chunk = TS_ARENA_DATAGRAM;
+        else
+            p_sys->arena.i_chunk = TS_ARENA_CHUNK;
+        msg_Dbg( p_mux, "sending blocks of %u packets", p_sys->arena.i_chunk );
+    }
+
+    p_sys->cbr.i_rate = var_GetInteger( p_mux, SOUT_CFG_PREFIX "muxrate" );
+    if( p_sys->cbr.i_rate > 0 )
+    {
+        var_Get( p_mux, SOUT_CFG_PREFIX "psi-interval", &val );
+        if( val.i_int <= 0 )
+        {
+            msg_Err( p_mux, "invalid PSI interval (%"PRId64"ms) resetting "
+                     "to 100ms", val.i_int );
+            val.i_int = 100;
+        }
+        p_sys->cbr.i_psi_delay = val.i_int * 27000;
+        BufferChainInit( &p_sys->cbr.psi );
+        msg_Dbg( p_mux, "constant bitrate %"PRId64" bits/s", p_sys->cbr.i_rate );
+    }
+
     p_mux->p_sys        = p_sys;
 
     p_sys->csa = csaSetup(p_this);
@@ -758,6 +956,10 @@ static void Close( vlc_object_t * p_this )
         free( p_sys->sdt.desc[i].psz_provider );
     }
 
+    BufferChainClean( &p_sys->cbr.psi );
+    /* Packets still in use keep their chunk */
+    if( p_sys->arena.p_current )
+        TSArenaUnref( p_sys->arena.p_current );
     free( p_sys );
 }
 
@@ -866,6 +1068,188 @@ static const char *GetIso639_2LangCode(const char *lang)
     return pl->psz_iso639_2T;   /* returns the english code */
 }
 
+/*****************************************************************************
+ * T-STD transport buffer leak rate of the video streams
+ *****************************************************************************/
+
+/* Copies the start of a NAL unit without its emulation prevention bytes */
+static size_t NalUnescape( uint8_t *p_dst, size_t i_dst,
+                           const uint8_t *p, const uint8_t *p_end )
+{
+    size_t i = 0;
+    unsigned i_zero = 0;
+
+    for( ; p < p_end && i < i_dst; p++ )
+    {
+        if( i_zero >= 2 && *p == 0x03 )
+        {
+            i_zero = 0;
+            continue;
+        }
+        i_zero = *p ? 0 : i_zero + 1;
+        p_dst[i++] = *p;
+    }
+    return i;
+}
+
+/* Returns the first NAL unit of an Annex B buffer accepted by pf_match */
+static const uint8_t *NalFind( const uint8_t *p, const uint8_t *p_end,
+                               bool (*pf_match)( uint8_t ) )
+{
+    for( ; p + 4 <= p_end; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 && pf_match( p[3] ) )
+            return &p[3];
+    return NULL;
+}
+
+static bool IsH264SPS( uint8_t i_header )
+{
+    return ( i_header & 0x1f ) == 7;
+}
+
+static bool IsHEVCSPS( uint8_t i_header )
+{
+    return ( ( i_header >> 1 ) & 0x3f ) == 33;
+}
+
+/* Max bit rate of the H.264 levels in 1000 bits/s (ITU-T H.264 table A-1) */
+static unsigned H264MaxBR( int i_level )
+{
+    static const struct { int i_level; unsigned i_max; } levels[] = {
+        {  9,    128 }, { 10,     64 }, { 11,    192 }, { 12,    384 },
+        { 13,    768 }, { 20,   2000 }, { 21,   4000 }, { 22,   4000 },
+        { 30,  10000 }, { 31,  14000 }, { 32,  20000 }, { 40,  20000 },
+        { 41,  50000 }, { 42,  50000 }, { 50, 135000 }, { 51, 240000 },
+        { 52, 240000 }, { 60, 240000 }, { 61, 480000 }, { 62, 800000 },
+    };
+    for( size_t i = 0; i < ARRAY_SIZE(levels); i++ )
+        if( levels[i].i_level == i_level )
+            return levels[i].i_max;
+    return 0;
+}
+
+/* Max bit rate of the HEVC levels in 1000 bits/s (ITU-T H.265 table A.8),
+ * main and high tiers */
+static unsigned HEVCMaxBR( int i_level, bool b_high_tier )
+{
+    static const struct { int i_level; unsigned i_main, i_high; } levels[] = {
+        {  30,    128,      0 }, {  60,   1500,      0 }, {  63,   3000,      0 },
+        {  90,   6000,      0 }, {  93,  10000,      0 }, { 120,  12000,  30000 },
+        { 123,  20000,  50000 }, { 150,  25000, 100000 }, { 153,  40000, 160000 },
+        { 156,  60000, 240000 }, { 180,  60000, 240000 }, { 183, 120000, 480000 },
+        { 186, 240000, 800000 },
+    };
+    for( size_t i = 0; i < ARRAY_SIZE(levels); i++ )
+        if( levels[i].i_level == i_level )
+            return ( b_high_tier && levels[i].i_high ) ? levels[i].i_high
+                                                       : levels[i].i_main;
+    return 0;
+}
+
+/* Returns the transport buffer leak rate Rx of a video stream, 1.2 times the
+ * maximum bit rate of its profile and level (ISO/IEC 13818-1 2.4.2.3,
+ * 2.14.3.1 and 2.17.2). The level comes from the packetizer, or from the
+ * decoder configuration. */
+static int64_t TSTDVideoLeak( const es_format_t *p_fmt )
+{
+    const uint8_t *p_extra = p_fmt->p_extra;
+    const uint8_t *p_end = p_extra + p_fmt->i_extra;
+    int i_profile = p_fmt->i_profile;
+    int i_level = p_fmt->i_level;
+    uint8_t nal[15];
+
+    switch( p_fmt->i_codec )
+    {
+    case VLC_CODEC_H264:
+    {
+        if( i_level <= 0 && p_fmt->i_extra >= 4 && p_extra[0] == 1 ) /* avcC */
+        {
+            i_profile = p_extra[1];
+            i_level = p_extra[3];
+        }
+        else if( i_level <= 0 && p_extra != NULL )
+        {
+            const uint8_t *p_sps = NalFind( p_extra, p_end, IsH264SPS );
+            if( p_sps && NalUnescape( nal, 4, p_sps, p_end ) == 4 )
+            {
+                i_profile = nal[1];
+                i_level = nal[3];
+            }
+        }
+        if( i_level <= 0 )
+            i_level = 41; /* most HD broadcasts */
+
+        /* cpbBrNalFactor of the profile (table A-2), 1.2 times the VCL one */
+        unsigned i_factor;
+        switch( i_profile )
+        {
+        case 100:                     i_factor = 1500; break; /* High */
+        case 110:                     i_factor = 3600; break; /* High 10 */
+        case 122: case 244: case 44:  i_factor = 4800; break; /* 4:2:2 and 4:4:4 */
+        default:                      i_factor = 1200; break;
+        }
+        if( H264MaxBR( i_level ) )
+            return (int64_t)H264MaxBR( i_level ) * i_factor;
+        break;
+    }
+
+    case VLC_CODEC_HEVC:
+    {
+        bool b_high_tier = false;
+
+        if( i_level <= 0 && p_fmt->i_extra >= 13 && p_extra[0] == 1 ) /* hvcC */
+        {
+            b_high_tier = p_extra[1] & 0x20;
+            i_level = p_extra[12];
+        }
+        else if( i_level <= 0 && p_extra != NULL )
+        {
+            const uint8_t *p_sps = NalFind( p_extra, p_end, IsHEVCSPS );
+            /* NAL header, sub-layers, then general profile_tier_level */
+            if( p_sps && NalUnescape( nal, 15, p_sps, p_end ) == 15 )
+            {
+                b_high_tier = nal[3] & 0x20;
+                i_level = nal[14];
+            }
+        }
+        if( i_level <= 0 )
+            i_level = 123; /* most HD broadcasts */
+
+        if( HEVCMaxBR( i_level, b_high_tier ) )
+            return (int64_t)HEVCMaxBR( i_level, b_high_tier ) * 1200;
+        break;
+    }
+
+    case VLC_CODEC_MPGV:
+    case VLC_CODEC_MP2V:
+    case VLC_CODEC_MP1V:
+        if( i_level <= 0 && p_extra != NULL )
+        {
+            /* profile_and_level_indication of the sequence extension */
+            for( const uint8_t *p = p_extra; p + 6 <= p_end; p++ )
+                if( p[0] == 0 && p[1] == 0 && p[2] == 1 && p[3] == 0xb5 &&
+                    ( p[4] >> 4 ) == 1 )
+                {
+                    i_level = p[5] >> 4;
+                    break;
+                }
+        }
+
+        switch( i_level )
+        {
+        case 10: return INT64_C(4800000);  /* Low */
+        case 6:  return INT64_C(72000000); /* High 1440 */
+        case 4:  return INT64_C(96000000); /* High */
+        default: return INT64_C(18000000); /* Main, and MPEG-1 */
+        }
+    }
+
+    /* Other codecs: from the announced bit rate */
+    if( p_fmt->i_bitrate > 0 )
+        return (int64_t)p_fmt->i_bitrate * 6 / 5;
+    return INT64_C(18000000);
+}
+
 /*****************************************************************************
  * AddStream: called for each stream addition
  *****************************************************************************/
@@ -1088,6 +1472,25 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* Init pes chain */
     BufferChainInit( &p_stream->state.chain_pes );
 
+    /* T-STD leak rates (ISO/IEC 13818-1 2.4.2.3) */
+    switch( p_input->p_fmt->i_cat )
+    {
+    case VIDEO_ES:
+        p_stream->tb.i_leak = TSTDVideoLeak( p_input->p_fmt );
+        msg_Dbg( p_mux, "transport buffer leak rate %"PRId64" bits/s",
+                 p_stream->tb.i_leak );
+        break;
+    case AUDIO_ES:
+        p_stream->tb.i_leak = 2000000;
+        break;
+    default:
+        if( p_input->p_fmt->i_codec == VLC_CODEC_TELETEXT )
+            p_stream->tb.i_leak = 6750000; /* EN 300 472 */
+        else
+            p_stream->tb.i_leak = 1000000;
+        break;
+    }
+
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
 
@@ -1166,6 +1569,9 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
     /* Empty all data in chain_pes */
     BufferChainClean( &p_stream->state.chain_pes );
 
+    if( p_sys->cbr.p_key_stream == p_stream )
+        p_sys->cbr.p_key_stream = NULL;
+
     free(p_stream->pes.lang);
     free( p_stream->pes.p_extra );
 
@@ -1453,6 +1859,12 @@ static bool MuxStreams(sout_mux_t *p_mux )
     const mtime_t i_pcr_length = p_pcr_stream->state.i_pes_length;
     p_pcr_stream->state.b_key_frame = 0;
 
+    if( p_sys->cbr.i_rate > 0 )
+    {
+        TSMuxCBR( p_mux, i_pcr_length, p_pcr_stream->state.i_pes_dts );
+        return false;
+    }
+
     /* msg_Dbg( p_mux, "starting muxing %lldms", i_pcr_length / 1000 ); */
     /* 2: calculate non accurate total size of muxed ts */
     int i_packet_count = 0;
@@ -1487,8 +1899,7 @@ static bool MuxStreams(sout_mux_t *p_mux )
     BufferChainInit( &chain_ts );
     /* append PAT/PMT  -> FIXME with big pcr delay it won't have enough pat/pmt */
     bool pat_was_previous = true; //This is to prevent unnecessary double PAT/PMT insertions
-    GetPAT( p_mux, &chain_ts );
-    GetPMT( p_mux, &chain_ts );
+    GetPSI( p_mux, &chain_ts );
     int i_packet_pos = 0;
     i_packet_count += chain_ts.i_depth;
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
@@ -1534,26 +1945,19 @@ static bool MuxStreams(sout_mux_t *p_mux )
                 i_pcr_length / i_packet_count;
         }
 
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
-        {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
-        }
-        i_packet_pos++;
-
         /* Write PAT/PMT before every keyframe if use-key-frames is enabled,
          * this helps to do segmenting with livehttp-output so it can cut segment
-         * and start new one with pat,pmt,keyframe*/
-        if( ( p_sys->b_use_key_frames ) && ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) )
+         * and start new one with pat,pmt,keyframe. They are built before the
+         * keyframe packet, so that they precede it in the packet arena too. */
+        const block_t *p_pes = p_stream->state.chain_pes.p_first;
+        if( p_sys->b_use_key_frames && p_stream->state.i_pes_used <= 0 &&
+            (p_pes->i_flags & BLOCK_FLAG_TYPE_I) &&
+            !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) )
         {
             if( likely( !pat_was_previous ) )
             {
                 int startcount = chain_ts.i_depth;
-                GetPAT( p_mux, &chain_ts );
-                GetPMT( p_mux, &chain_ts );
+                GetPSI( p_mux, &chain_ts );
                 SetHeader( &chain_ts, startcount );
                 i_packet_count += (chain_ts.i_depth - startcount );
             } else {
@@ -1562,7 +1966,16 @@ static bool MuxStreams(sout_mux_t *p_mux )
         }
         pat_was_previous = false;
 
-        /* */
+        /* Build the TS packet */
+        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
+        if( p_sys->csa != NULL &&
+             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        {
+            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        }
+        i_packet_pos++;
+
         BufferChainAppend( &chain_ts, p_ts );
     }
 
@@ -1755,6 +2168,30 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles the packets of the chain in bitsliced batches */
+static void TSScramble( sout_mux_sys_t *p_sys, sout_buffer_chain_t *p_chain_ts )
+{
+    uint8_t *pp_pkt[CSA_BATCH_MAX];
+    unsigned i_count = 0;
+
+    vlc_mutex_lock( &p_sys->csa_lock );
+    for( block_t *p_ts = p_chain_ts->p_first; p_ts; p_ts = p_ts->p_next )
+    {
+        if( !(p_ts->i_flags & BLOCK_FLAG_SCRAMBLED) )
+            continue;
+
+        pp_pkt[i_count++] = p_ts->p_buffer;
+        if( i_count == CSA_BATCH_MAX )
+        {
+            csa_EncryptBatch( p_sys->csa, pp_pkt, i_count, p_sys->i_csa_pkt_size );
+            i_count = 0;
+        }
+    }
+    if( i_count > 0 )
+        csa_EncryptBatch( p_sys->csa, pp_pkt, i_count, p_sys->i_csa_pkt_size );
+    vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     mtime_t i_pcr_length, mtime_t i_pcr_dts )
 {
@@ -1780,6 +2217,11 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->csa )
+        TSScramble( p_sys, p_chain_ts );
+
+    block_t *p_chunk = NULL;
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1794,24 +2236,300 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+        /* latency */
+        p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
+
+        TSWrite( p_mux, p_ts, &p_chunk );
+    }
+
+    /* Blocks never span two slices, so that they keep their date */
+    if( p_chunk )
+        sout_AccessOutWrite( p_mux->p_access, p_chunk );
+}
+
+/* Sends a dated packet, or appends it to *pp_chunk if the arena is enabled.
+ * A block is the run of contiguous packets of one arena chunk, starting
+ * with the packet heading it: packets are never copied. */
+static void TSWrite( sout_mux_t *p_mux, block_t *p_ts, block_t **pp_chunk )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_chunk = *pp_chunk;
+    const bool b_arena = p_ts->pf_release == TSArenaPacketRelease;
+
+    if( p_sys->arena.i_chunk == 0 )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        return;
+    }
+
+    /* Segmenters cut before header packets and the HTTP output starts
+     * clients on keyframes, they must start a block. A keyframe right
+     * after its PAT/PMT stays in their block, which becomes a keyframe. */
+    if( p_chunk && ( !b_arena ||
+                     p_chunk->i_buffer == p_sys->arena.i_chunk * 188 ||
+                     ((ts_arena_packet_t *)p_chunk)->p_chunk
+                      != ((ts_arena_packet_t *)p_ts)->p_chunk ||
+                     p_ts->p_buffer != &p_chunk->p_buffer[p_chunk->i_buffer] ||
+                     ( p_ts->i_flags & BLOCK_FLAG_HEADER ) ||
+                     ( ( p_ts->i_flags & BLOCK_FLAG_TYPE_I ) &&
+                       ( p_chunk->i_flags & (BLOCK_FLAG_HEADER|BLOCK_FLAG_TYPE_I) )
+                         != BLOCK_FLAG_HEADER ) ) )
+    {
+        sout_AccessOutWrite( p_mux->p_access, p_chunk );
+        *pp_chunk = p_chunk = NULL;
+    }
+    if( !b_arena )
+    {   /* out of memory for the arena */
+        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        return;
+    }
+    if( p_chunk == NULL )
+    {
+        p_ts->i_flags &= BLOCK_FLAG_HEADER|BLOCK_FLAG_TYPE_I|BLOCK_FLAG_CLOCK;
+        *pp_chunk = p_ts;
+        return;
+    }
+
+    p_chunk->i_buffer += 188;
+    p_chunk->i_size   += 188;
+    p_chunk->i_length += p_ts->i_length;
+    p_chunk->i_flags  |= p_ts->i_flags & (BLOCK_FLAG_CLOCK|BLOCK_FLAG_TYPE_I);
+
+    block_Release( p_ts );
+}
+
+/* Input date of the current constant bitrate slot */
+static inline mtime_t CBRDate( const sout_mux_sys_t *p_sys )
+{
+    return p_sys->cbr.i_start + p_sys->cbr.i_pcr / 27;
+}
+
+static inline bool CBRRoom( const sout_mux_sys_t *p_sys,
+                            const sout_input_sys_t *p_stream )
+{
+    return p_stream->tb.i_fill + 188 * 8 * p_sys->cbr.i_rate
+        <= TS_TB_SIZE * 8 * p_sys->cbr.i_rate;
+}
+
+/* Returns a packet with only an adaptation field carrying the PCR */
+static block_t *CBRPacketPCR( sout_mux_t *p_mux, sout_input_sys_t *p_stream )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    block_t *p_ts = TSPacketNew( p_sys );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = ( p_stream->ts.i_pid >> 8 ) & 0x1f;
+    p_ts->p_buffer[2] = p_stream->ts.i_pid & 0xff;
+    /* no payload: the continuity counter is not incremented */
+    p_ts->p_buffer[3] = 0x20 | ( ( p_stream->ts.i_continuity_counter + 15 ) % 16 );
+    p_ts->p_buffer[4] = 183;
+    p_ts->p_buffer[5] = 1 << 4; /* PCR_flag */
+    if( p_sys->cbr.b_discontinuity || p_stream->ts.b_discontinuity )
+    {
+        p_ts->p_buffer[5] |= 0x80; /* flag TS dicontinuity */
+        p_sys->cbr.b_discontinuity = false;
+        p_stream->ts.b_discontinuity = false;
+    }
+    memset( &p_ts->p_buffer[12], 0xff, 188 - 12 );
+
+    p_ts->i_flags |= BLOCK_FLAG_CLOCK;
+    TSSetPCR27( p_ts, p_sys->cbr.i_pcr + 27 * ( p_sys->cbr.i_start
+                      - p_sys->i_dts_delay - p_sys->first_dts ) );
+    return p_ts;
+}
+
+static block_t *CBRPacketNull( sout_mux_sys_t *p_sys )
+{
+    block_t *p_ts = TSPacketNew( p_sys );
+    if( unlikely(p_ts == NULL) )
+        return NULL;
+
+    p_ts->p_buffer[0] = 0x47;
+    p_ts->p_buffer[1] = 0x1f;
+    p_ts->p_buffer[2] = 0xff;
+    p_ts->p_buffer[3] = 0x10;
+    memset( &p_ts->p_buffer[4], 0xff, 184 );
+    return p_ts;
+}
+
+/* Returns the packet of the current slot: PCR, PAT/PMT, elementary stream
+ * data whose transport buffer has room, or stuffing, in that order */
+static block_t *CBRPacket( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_pcr_stream = p_sys->p_pcr_input->p_sys;
+    const mtime_t i_date = CBRDate( p_sys );
+    block_t *p_ts;
+
+    if( p_sys->cbr.i_pcr >= p_sys->cbr.i_pcr_next &&
+        CBRRoom( p_sys, p_pcr_stream ) )
+    {
+        p_sys->cbr.i_pcr_next += p_sys->i_pcr_delay * 27;
+        if( p_sys->cbr.i_pcr_next <= p_sys->cbr.i_pcr )
+            p_sys->cbr.i_pcr_next = p_sys->cbr.i_pcr + p_sys->i_pcr_delay * 27;
+
+        p_ts = CBRPacketPCR( p_mux, p_pcr_stream );
+        if( likely(p_ts != NULL) )
+            p_pcr_stream->tb.i_fill += 188 * 8 * p_sys->cbr.i_rate;
+        return p_ts;
+    }
+
+    if( p_sys->cbr.i_pcr >= p_sys->cbr.i_psi_next && p_sys->cbr.psi.i_depth == 0 )
+    {
+        p_sys->cbr.i_psi_next += p_sys->cbr.i_psi_delay;
+        if( p_sys->cbr.i_psi_next <= p_sys->cbr.i_pcr )
+            p_sys->cbr.i_psi_next = p_sys->cbr.i_pcr + p_sys->cbr.i_psi_delay;
+        GetPAT( p_mux, &p_sys->cbr.psi );
+        GetPMT( p_mux, &p_sys->cbr.psi );
+    }
+    /* Copied to the arena when sent, as the PCR may come in between */
+    if( p_sys->cbr.psi.i_depth > 0 )
+        return TSPacketCopy( p_sys, BufferChainGet( &p_sys->cbr.psi ) );
+
+    /* Select stream (lowest dts), among those whose data is due */
+    sout_input_t *p_input = NULL;
+    sout_input_sys_t *p_stream = NULL;
+    for (int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        sout_input_sys_t *p_cand = p_mux->pp_inputs[i]->p_sys;
+
+        if( p_cand->state.i_pes_dts == 0 || p_cand->state.i_pes_dts > i_date ||
+            !CBRRoom( p_sys, p_cand ) )
+            continue;
+
+        if( p_stream == NULL || p_cand->state.i_pes_dts < p_stream->state.i_pes_dts )
+        {
+            p_input = p_mux->pp_inputs[i];
+            p_stream = p_cand;
+        }
+    }
+    if( p_stream == NULL )
+        return CBRPacketNull( p_sys );
+
+    block_t *p_pes = p_stream->state.chain_pes.p_first;
+
+    /* Write PAT/PMT before every keyframe if use-key-frames is enabled */
+    if( p_sys->b_use_key_frames && p_stream->state.i_pes_used <= 0 &&
+        p_sys->cbr.p_key_stream != p_stream &&
+        (p_pes->i_flags & BLOCK_FLAG_TYPE_I) &&
+        !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) )
+    {
+        p_sys->cbr.p_key_stream = p_stream;
+        GetPAT( p_mux, &p_sys->cbr.psi );
+        GetPMT( p_mux, &p_sys->cbr.psi );
+        SetHeader( &p_sys->cbr.psi, 0 );
+        return TSPacketCopy( p_sys, BufferChainGet( &p_sys->cbr.psi ) );
+    }
+    if( p_sys->cbr.p_key_stream == p_stream )
+        p_sys->cbr.p_key_stream = NULL;
+
+    /* The decoder gets the packet at i_date - i_dts_delay */
+    if( i_date - p_sys->i_dts_delay > p_pes->i_dts )
+        p_sys->cbr.i_late++;
+
+    p_ts = TSNew( p_mux, p_stream, false );
+    if( p_sys->csa != NULL &&
+         (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+         (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+    {
+        p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+    }
+    p_stream->tb.i_fill += 188 * 8 * p_sys->cbr.i_rate;
+    return p_ts;
+}
+
+/* Moves to the next slot and drains the transport buffers */
+static void CBRNextSlot( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    const int64_t i_slot27 = INT64_C(188 * 8 * 27000000);
+
+    p_sys->cbr.i_pcr      += i_slot27 / p_sys->cbr.i_rate;
+    p_sys->cbr.i_pcr_frac += i_slot27 % p_sys->cbr.i_rate;
+    if( p_sys->cbr.i_pcr_frac >= p_sys->cbr.i_rate )
+    {
+        p_sys->cbr.i_pcr_frac -= p_sys->cbr.i_rate;
+        p_sys->cbr.i_pcr++;
+    }
+
+    for (int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        sout_input_sys_t *p_stream = p_mux->pp_inputs[i]->p_sys;
+
+        p_stream->tb.i_fill -= p_stream->tb.i_leak * 188 * 8;
+        if( p_stream->tb.i_fill < 0 )
+            p_stream->tb.i_fill = 0;
+    }
+}
+
+/* Fills the output slots up to the end of the collected data. Unlike
+ * TSSchedule(), packets are dated by their slot, not by their input DTS. */
+static void TSMuxCBR( sout_mux_t *p_mux, mtime_t i_pcr_length,
+                      mtime_t i_pcr_dts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_pcr_stream = p_sys->p_pcr_input->p_sys;
+    sout_buffer_chain_t chain_ts;
+
+    if( p_sys->cbr.i_start == 0 )
+        p_sys->cbr.i_start = i_pcr_dts;
+    else if( llabs( CBRDate( p_sys ) - i_pcr_dts ) > 10 * CLOCK_FREQ )
+    {
+        msg_Warn( p_mux, "input date jumped by %"PRId64" us, restarting clock",
+                  i_pcr_dts - CBRDate( p_sys ) );
+        p_sys->cbr.i_start = i_pcr_dts - p_sys->cbr.i_pcr / 27;
+        p_sys->cbr.b_discontinuity = true;
+        p_sys->cbr.i_pcr_next = p_sys->cbr.i_pcr;
+    }
+
+    BufferChainInit( &chain_ts );
+    p_sys->cbr.i_late = 0;
+
+    /* If the rate is too low, the data already due is sent anyway */
+    const mtime_t i_end = i_pcr_dts + i_pcr_length;
+    while( CBRDate( p_sys ) < i_end ||
+           ( p_pcr_stream->state.i_pes_dts != 0 &&
+             p_pcr_stream->state.i_pes_dts <= CBRDate( p_sys ) ) )
+    {
+        block_t *p_ts = CBRPacket( p_mux );
+        if( likely(p_ts != NULL) )
         {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
+            p_ts->i_dts = CBRDate( p_sys );
+            BufferChainAppend( &chain_ts, p_ts );
         }
+        CBRNextSlot( p_mux );
+    }
+
+    if( p_sys->cbr.i_late > 0 )
+        msg_Warn( p_mux, "%u packets late, mux rate too low",
+                  p_sys->cbr.i_late );
+
+    if( p_sys->csa )
+        TSScramble( p_sys, &chain_ts );
+
+    const int i_packet_count = chain_ts.i_depth;
+    block_t *p_chunk = NULL;
 
+    for (int i = 0; i < i_packet_count; i++ )
+    {
+        block_t *p_ts = BufferChainGet( &chain_ts );
+
+        p_ts->i_length = INT64_C(188 * 8) * CLOCK_FREQ / p_sys->cbr.i_rate;
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
 
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
+        TSWrite( p_mux, p_ts, &p_chunk );
     }
+
+    if( p_chunk )
+        sout_AccessOutWrite( p_mux->p_access, p_chunk );
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
                        bool b_pcr )
 {
-    VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
 
     bool b_new_pes = false;
@@ -1831,7 +2549,7 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
         b_adaptation_field = true;
     }
 
-    block_t *p_ts = block_Alloc( 188 );
+    block_t *p_ts = TSPacketNew( p_mux->p_sys );
 
     if (b_new_pes && !(p_pes->i_flags & BLOCK_FLAG_NO_KEYFRAME) && p_pes->i_flags & BLOCK_FLAG_TYPE_I)
     {
@@ -1924,6 +2642,24 @@ static void TSSetPCR( block_t *p_ts, mtime_t i_dts )
     p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
 }
 
+/* Stamps a 27 MHz PCR, extension included */
+static void TSSetPCR27( block_t *p_ts, int64_t i_pcr )
+{
+    i_pcr %= INT64_C(300) << 33;
+    if( i_pcr < 0 )
+        i_pcr += INT64_C(300) << 33;
+
+    const int64_t i_base = i_pcr / 300;
+    const int i_ext = i_pcr % 300;
+
+    p_ts->p_buffer[6]  = ( i_base >> 25 )&0xff;
+    p_ts->p_buffer[7]  = ( i_base >> 17 )&0xff;
+    p_ts->p_buffer[8]  = ( i_base >> 9  )&0xff;
+    p_ts->p_buffer[9]  = ( i_base >> 1  )&0xff;
+    p_ts->p_buffer[10] = ( ( i_base << 7 )&0x80 ) | 0x7e | ( i_ext >> 8 );
+    p_ts->p_buffer[11] = i_ext & 0xff;
+}
+
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
 {
     sout_mux_sys_t       *p_sys = p_mux->p_sys;
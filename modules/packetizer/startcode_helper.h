@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * startcode_helper.h: Annex B start code and emulation prevention scanners
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* All the scanners below look for the first 00 00 i_third sequence lying
+ * entirely within [p, end), and return a pointer to its first byte, or NULL
+ * if there is none. */
+
+static inline const uint8_t *startcode_FindC( const uint8_t *p,
+                                              const uint8_t *end,
+                                              uint8_t i_third )
+{
+    while( end - p >= 3 )
+    {
+        /* p[2] is the third byte of a sequence starting at p, and one of the
+         * zeros of sequences starting at p + 1 and p + 2 */
+        if( p[2] != 0 && p[2] != i_third )
+            p += 3;
+        else if( p[1] != 0 )
+            p += 2;
+        else if( p[0] != 0 || p[2] != i_third )
+            p++;
+        else
+            return p;
+    }
+    return NULL;
+}
+
+#ifdef CAN_COMPILE_SSE2
+VLC_SSE
+static inline const uint8_t *startcode_FindSSE2( const uint8_t *p,
+                                                 const uint8_t *end,
+                                                 uint8_t i_third )
+{
+    const uint32_t i_thirds = 0x01010101 * i_third;
+
+    /* Each step checks the sequences starting at p[0] to p[15] */
+    for( ; end - p >= 18; p += 16 )
+    {
+        unsigned i_mask;
+
+        __asm__ volatile(
+            "movd          %[t], %%xmm3\n"
+            "pshufd  $0, %%xmm3, %%xmm3\n"
+            "movdqu       (%[p]), %%xmm0\n"
+            "movdqu      1(%[p]), %%xmm1\n"
+            "movdqu      2(%[p]), %%xmm2\n"
+            "por         %%xmm1, %%xmm0\n"
+            "pxor        %%xmm1, %%xmm1\n"
+            "pcmpeqb     %%xmm1, %%xmm0\n" /* p[i] == 0 && p[i+1] == 0 */
+            "pcmpeqb     %%xmm3, %%xmm2\n" /* p[i+2] == i_third */
+            "pand        %%xmm2, %%xmm0\n"
+            "pmovmskb    %%xmm0, %[mask]\n"
+            : [mask]"=r"(i_mask)
+            : [p]"r"(p), [t]"r"(i_thirds)
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+
+        if( i_mask )
+            return p + ctz( i_mask );
+    }
+    return startcode_FindC( p, end, i_third );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+static inline const uint8_t *startcode_FindAVX2( const uint8_t *p,
+                                                 const uint8_t *end,
+                                                 uint8_t i_third )
+{
+    const uint32_t i_thirds = 0x01010101 * i_third;
+    const uint8_t *p_match = NULL;
+
+    /* Each step checks the sequences starting at p[0] to p[31] */
+    for( ; end - p >= 34; p += 32 )
+    {
+        unsigned i_mask;
+
+        __asm__ volatile(
+            "vmovd               %[t], %%xmm3\n"
+            "vpbroadcastd     %%xmm3, %%ymm3\n"
+            "vmovdqu          (%[p]), %%ymm0\n"
+            "vpor            1(%[p]), %%ymm0, %%ymm0\n"
+            "vpxor            %%ymm1, %%ymm1, %%ymm1\n"
+            "vpcmpeqb         %%ymm1, %%ymm0, %%ymm0\n"
+            "vmovdqu         2(%[p]), %%ymm2\n"
+            "vpcmpeqb         %%ymm3, %%ymm2, %%ymm2\n"
+            "vpand            %%ymm2, %%ymm0, %%ymm0\n"
+            "vpmovmskb        %%ymm0, %[mask]\n"
+            : [mask]"=r"(i_mask)
+            : [p]"r"(p), [t]"r"(i_thirds)
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+
+        if( i_mask )
+        {
+            p_match = p + ctz( i_mask );
+            break;
+        }
+    }
+    /* avoid the AVX to SSE transition penalty in the caller */
+    __asm__ volatile( "vzeroupper" ::: "xmm0", "xmm1", "xmm2", "xmm3" );
+
+    return p_match ? p_match : startcode_FindC( p, end, i_third );
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline const uint8_t *startcode_FindNEON( const uint8_t *p,
+                                                 const uint8_t *end,
+                                                 uint8_t i_third )
+{
+    const uint8x16_t zero = vdupq_n_u8( 0 );
+    const uint8x16_t third = vdupq_n_u8( i_third );
+
+    for( ; end - p >= 18; p += 16 )
+    {
+        uint8x16_t zeros = vceqq_u8( vorrq_u8( vld1q_u8( p ), vld1q_u8( p + 1 ) ),
+                                     zero );
+        uint8x16_t match = vandq_u8( zeros, vceqq_u8( vld1q_u8( p + 2 ), third ) );
+        uint64x2_t any = vreinterpretq_u64_u8( match );
+
+        if( vgetq_lane_u64( any, 0 ) | vgetq_lane_u64( any, 1 ) )
+            return startcode_FindC( p, p + 18, i_third );
+    }
+    return startcode_FindC( p, end, i_third );
+}
+#endif
+
+static inline const uint8_t *startcode_Find( const uint8_t *p,
+                                             const uint8_t *end,
+                                             uint8_t i_third )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+        return startcode_FindAVX2( p, end, i_third );
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU_SSE2() )
+        return startcode_FindSSE2( p, end, i_third );
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return startcode_FindNEON( p, end, i_third );
+#else
+    return startcode_FindC( p, end, i_third );
+#endif
+}
+
+/* Finds the first Annex B start code prefix (00 00 01) in [p, end) */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+    return startcode_Find( p, end, 0x01 );
+}
+
+/* Finds the first emulation prevention sequence (00 00 03) in [p, end) */
+static inline const uint8_t *startcode_FindEmulation( const uint8_t *p,
+                                                      const uint8_t *end )
+{
+    return startcode_Find( p, end, 0x03 );
+}
+
+#endif
@@ -296,16 +296,16 @@ static void Deactivate( vlc_object_t *p_this )
 }
 
 #ifndef PLAIN
-VIDEO_FILTER_WRAPPER( I420_R5G5B5 )
-VIDEO_FILTER_WRAPPER( I420_R5G6B5 )
-VIDEO_FILTER_WRAPPER( I420_A8R8G8B8 )
-VIDEO_FILTER_WRAPPER( I420_R8G8B8A8 )
-VIDEO_FILTER_WRAPPER( I420_B8G8R8A8 )
-VIDEO_FILTER_WRAPPER( I420_A8B8G8R8 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_R5G5B5 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_R5G6B5 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_A8R8G8B8 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_R8G8B8A8 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_B8G8R8A8 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_A8B8G8R8 )
 #else
-VIDEO_FILTER_WRAPPER( I420_RGB8 )
-VIDEO_FILTER_WRAPPER( I420_RGB16 )
-VIDEO_FILTER_WRAPPER( I420_RGB32 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_RGB8 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_RGB16 )
+VIDEO_FILTER_SLICE_WRAPPER( I420_RGB32 )
 
 /*****************************************************************************
  * SetGammaTable: return intensity table transformed by gamma curve.
@@ -104,13 +104,15 @@ static void SetOffset( int i_width, int i_height, int i_pic_width,
  *  - output: 1 line
  *****************************************************************************/
 
-void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_RGB16( filter_t *p_filter, picture_t *p_src,
+                 picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint16_t *p_pic = (uint16_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint16_t *p_pic = (uint16_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -157,7 +159,7 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_scale_count = ( i_vscale == 1 ) ?
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -207,13 +209,15 @@ void I420_RGB16( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
  *  - output: 1 line
  *****************************************************************************/
 
-void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_RGB32( filter_t *p_filter, picture_t *p_src,
+                 picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint32_t *p_pic = (uint32_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -260,7 +264,7 @@ void I420_RGB32( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_scale_count = ( i_vscale == 1 ) ?
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
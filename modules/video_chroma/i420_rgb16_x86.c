@@ -100,13 +100,15 @@ static void SetOffset( int i_width, int i_height, int i_pic_width,
 }
 
 VLC_TARGET
-void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R5G5B5( filter_t *p_filter, picture_t *p_src,
+                  picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint16_t *p_pic = (uint16_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint16_t *p_pic = (uint16_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -166,7 +168,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -217,7 +219,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -274,7 +276,7 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -330,13 +332,15 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R5G6B5( filter_t *p_filter, picture_t *p_src,
+                  picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint16_t *p_pic = (uint16_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint16_t *p_pic = (uint16_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -396,7 +400,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -447,7 +451,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -504,7 +508,7 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -561,13 +565,14 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
 VLC_TARGET
 void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
-                                            picture_t *p_dest )
+                    picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint32_t *p_pic = (uint32_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -625,7 +630,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -676,7 +681,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -733,7 +738,7 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -789,13 +794,15 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
 }
 
 VLC_TARGET
-void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src,
+                    picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint32_t *p_pic = (uint32_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -853,7 +860,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -904,7 +911,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -961,7 +968,7 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -1017,13 +1024,15 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src,
+                    picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint32_t *p_pic = (uint32_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -1081,7 +1090,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -1132,7 +1141,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -1186,7 +1195,7 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -1242,13 +1251,15 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 }
 
 VLC_TARGET
-void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src,
+                    picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint32_t *p_pic = (uint32_t*)p_dest->p->p_pixels;
-    uint8_t  *p_y   = p_src->Y_PIXELS;
-    uint8_t  *p_u   = p_src->U_PIXELS;
-    uint8_t  *p_v   = p_src->V_PIXELS;
+    uint32_t *p_pic = (uint32_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t  *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t  *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t  *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     unsigned int i_vscale;                          /* vertical scaling type */
@@ -1306,7 +1317,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     ((intptr_t)p_buffer))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
 
@@ -1357,7 +1368,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+        for( i_y = i_start; i_y < i_end; i_y++ )
         {
             p_pic_start = p_pic;
             p_buffer = b_hscale ? p_buffer_start : p_pic;
@@ -1411,7 +1422,7 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 
     i_rewind = (-p_filter->fmt_in.video.i_width) & 7;
 
-    for( i_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start; i_y < i_end; i_y++ )
     {
         p_pic_start = p_pic;
         p_buffer = b_hscale ? p_buffer_start : p_pic;
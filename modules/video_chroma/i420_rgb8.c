@@ -40,13 +40,15 @@ static void SetOffset( int, int, int, int, bool *, int *, int * );
 /*****************************************************************************
  * I420_RGB8: color YUV 4:2:0 to RGB 8 bpp
  *****************************************************************************/
-void I420_RGB8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
+void I420_RGB8( filter_t *p_filter, picture_t *p_src,
+                picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
     /* We got this one from the old arguments */
-    uint8_t *p_pic = (uint8_t*)p_dest->p->p_pixels;
-    uint8_t *p_y   = p_src->Y_PIXELS;
-    uint8_t *p_u   = p_src->U_PIXELS;
-    uint8_t *p_v   = p_src->V_PIXELS;
+    uint8_t *p_pic = (uint8_t*)( p_dest->p->p_pixels
+                                   + i_start * p_dest->p->i_pitch );
+    uint8_t *p_y   = p_src->Y_PIXELS + i_start * p_src->Y_PITCH;
+    uint8_t *p_u   = p_src->U_PIXELS + i_start / 2 * p_src->U_PITCH;
+    uint8_t *p_v   = p_src->V_PIXELS + i_start / 2 * p_src->V_PITCH;
 
     bool  b_hscale;                         /* horizontal scaling type */
     int i_vscale;                                 /* vertical scaling type */
@@ -93,7 +95,7 @@ void I420_RGB8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
     i_scale_count = ( i_vscale == 1 ) ?
                     p_filter->fmt_out.video.i_height :
                     p_filter->fmt_in.video.i_height;
-    for( i_y = 0, i_real_y = 0; i_y < p_filter->fmt_in.video.i_height; i_y++ )
+    for( i_y = i_start, i_real_y = i_start & 3; i_y < i_end; i_y++ )
     {
         /* Do horizontal and vertical scaling */
         SCALE_WIDTH_DITHER( 420 );
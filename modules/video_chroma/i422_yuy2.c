@@ -49,9 +49,12 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void I422_YUY2               ( filter_t *, picture_t *, picture_t * );
-static void I422_YVYU               ( filter_t *, picture_t *, picture_t * );
-static void I422_UYVY               ( filter_t *, picture_t *, picture_t * );
+static void I422_YUY2               ( filter_t *, picture_t *, picture_t *,
+                                      unsigned, unsigned );
+static void I422_YVYU               ( filter_t *, picture_t *, picture_t *,
+                                      unsigned, unsigned );
+static void I422_UYVY               ( filter_t *, picture_t *, picture_t *,
+                                      unsigned, unsigned );
 static void I422_IUYV               ( filter_t *, picture_t *, picture_t * );
 static picture_t *I422_YUY2_Filter  ( filter_t *, picture_t * );
 static picture_t *I422_YVYU_Filter  ( filter_t *, picture_t * );
@@ -147,9 +150,9 @@ static int Activate( vlc_object_t *p_this )
 
 /* Following functions are local */
 
-VIDEO_FILTER_WRAPPER( I422_YUY2 )
-VIDEO_FILTER_WRAPPER( I422_YVYU )
-VIDEO_FILTER_WRAPPER( I422_UYVY )
+VIDEO_FILTER_SLICE_WRAPPER( I422_YUY2 )
+VIDEO_FILTER_SLICE_WRAPPER( I422_YVYU )
+VIDEO_FILTER_SLICE_WRAPPER( I422_UYVY )
 VIDEO_FILTER_WRAPPER( I422_IUYV )
 #if defined (MODULE_NAME_IS_i422_yuy2)
 VIDEO_FILTER_WRAPPER( I422_Y211 )
@@ -160,12 +163,12 @@ VIDEO_FILTER_WRAPPER( I422_Y211 )
  *****************************************************************************/
 VLC_TARGET
 static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                       picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
-    uint8_t *p_line = p_dest->p->p_pixels;
-    uint8_t *p_y = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line = p_dest->p->p_pixels + i_start * p_dest->p->i_pitch;
+    uint8_t *p_y = p_source->Y_PIXELS + i_start * p_source->Y_PITCH;
+    uint8_t *p_u = p_source->U_PIXELS + i_start * p_source->U_PITCH;
+    uint8_t *p_v = p_source->V_PIXELS + i_start * p_source->V_PITCH;
 
     int i_x, i_y;
 
@@ -182,7 +185,7 @@ static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line|(intptr_t)p_y))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -200,7 +203,7 @@ static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
     }
     else {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -220,7 +223,7 @@ static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
 
 #else
 
-    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    for( i_y = i_end - i_start ; i_y-- ; )
     {
         for( i_x = p_filter->fmt_in.video.i_width / 8 ; i_x-- ; )
         {
@@ -254,12 +257,12 @@ static void I422_YUY2( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                       picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
-    uint8_t *p_line = p_dest->p->p_pixels;
-    uint8_t *p_y = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line = p_dest->p->p_pixels + i_start * p_dest->p->i_pitch;
+    uint8_t *p_y = p_source->Y_PIXELS + i_start * p_source->Y_PITCH;
+    uint8_t *p_u = p_source->U_PIXELS + i_start * p_source->U_PITCH;
+    uint8_t *p_v = p_source->V_PIXELS + i_start * p_source->V_PITCH;
 
     int i_x, i_y;
 
@@ -276,7 +279,7 @@ static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line|(intptr_t)p_y))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -294,7 +297,7 @@ static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
     }
     else {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -314,7 +317,7 @@ static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
 
 #else
 
-    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    for( i_y = i_end - i_start ; i_y-- ; )
     {
         for( i_x = p_filter->fmt_in.video.i_width / 8 ; i_x-- ; )
         {
@@ -348,12 +351,12 @@ static void I422_YVYU( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                       picture_t *p_dest, unsigned i_start, unsigned i_end )
 {
-    uint8_t *p_line = p_dest->p->p_pixels;
-    uint8_t *p_y = p_source->Y_PIXELS;
-    uint8_t *p_u = p_source->U_PIXELS;
-    uint8_t *p_v = p_source->V_PIXELS;
+    uint8_t *p_line = p_dest->p->p_pixels + i_start * p_dest->p->i_pitch;
+    uint8_t *p_y = p_source->Y_PIXELS + i_start * p_source->Y_PITCH;
+    uint8_t *p_u = p_source->U_PIXELS + i_start * p_source->U_PITCH;
+    uint8_t *p_v = p_source->V_PIXELS + i_start * p_source->V_PITCH;
 
     int i_x, i_y;
 
@@ -370,7 +373,7 @@ static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line|(intptr_t)p_y))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -388,7 +391,7 @@ static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
     }
     else {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+        for( i_y = i_end - i_start ; i_y-- ; )
         {
             for( i_x = p_filter->fmt_in.video.i_width / 16 ; i_x-- ; )
             {
@@ -408,7 +411,7 @@ static void I422_UYVY( filter_t *p_filter, picture_t *p_source,
 
 #else
 
-    for( i_y = p_filter->fmt_in.video.i_height ; i_y-- ; )
+    for( i_y = i_end - i_start ; i_y-- ; )
     {
         for( i_x = p_filter->fmt_in.video.i_width / 8 ; i_x-- ; )
         {
@@ -120,9 +120,21 @@ struct filter_sys_t
     float f_gamma;
     bool  b_brightness_threshold;
     int (*pf_process_sat_hue)( picture_t *, picture_t *, int, int, int,
-                               int, int );
+                               int, int, int, int );
     int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
-                                    int, int, int );
+                                    int, int, int, int, int );
+};
+
+/* Arguments of the slice functions */
+struct adjust_slice
+{
+    picture_t *p_pic;
+    picture_t *p_outpic;
+    const int *pi_luma;
+    int i_y_offset;
+    int (*pf_process)( picture_t *, picture_t *, int, int, int, int, int,
+                       int, int );
+    int i_sin, i_cos, i_sat, i_x, i_y;
 };
 
 /*****************************************************************************
@@ -222,6 +234,149 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
+/*****************************************************************************
+ * Slices of the pictures, processed in parallel by filter_Slice
+ *****************************************************************************/
+static void PlanarLumaSlice( void *opaque, unsigned i_slice, int i_first,
+                             int i_start, int i_end )
+{
+    const struct adjust_slice *p = opaque;
+    const plane_t *p_src = &p->p_pic->p[Y_PLANE];
+    const plane_t *p_dst = &p->p_outpic->p[Y_PLANE];
+    const int *pi_luma = p->pi_luma;
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+
+    VLC_UNUSED(i_slice); VLC_UNUSED(i_first);
+
+    p_in = p_src->p_pixels + i_start * p_src->i_pitch;
+    p_in_end = p_in + (i_end - i_start) * p_src->i_pitch - 8;
+
+    p_out = p_dst->p_pixels + i_start * p_dst->i_pitch;
+
+    for( ; p_in < p_in_end ; )
+    {
+        p_line_end = p_in + p_src->i_visible_pitch - 8;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+        }
+
+        p_line_end += 8;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out++ = pi_luma[ *p_in++ ];
+        }
+
+        p_in += p_src->i_pitch - p_src->i_visible_pitch;
+        p_out += p_dst->i_pitch - p_dst->i_visible_pitch;
+    }
+}
+
+static void PlanarLuma16Slice( void *opaque, unsigned i_slice, int i_first,
+                               int i_start, int i_end )
+{
+    const struct adjust_slice *p = opaque;
+    const plane_t *p_src = &p->p_pic->p[Y_PLANE];
+    const plane_t *p_dst = &p->p_outpic->p[Y_PLANE];
+    const int *pi_luma = p->pi_luma;
+    uint16_t *p_in, *p_in_end, *p_line_end;
+    uint16_t *p_out;
+
+    VLC_UNUSED(i_slice); VLC_UNUSED(i_first);
+
+    p_in = (uint16_t *) (p_src->p_pixels + i_start * p_src->i_pitch);
+    p_in_end = p_in + (i_end - i_start) * (p_src->i_pitch >> 1) - 8;
+
+    p_out = (uint16_t *) (p_dst->p_pixels + i_start * p_dst->i_pitch);
+
+    for( ; p_in < p_in_end ; )
+    {
+        p_line_end = p_in + (p_src->i_visible_pitch >> 1) - 8;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+            *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
+        }
+
+        p_line_end += 8;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out++ = pi_luma[ *p_in++ ];
+        }
+
+        p_in += (p_src->i_pitch >> 1) - (p_src->i_visible_pitch >> 1);
+        p_out += (p_dst->i_pitch >> 1) - (p_dst->i_visible_pitch >> 1);
+    }
+}
+
+static void PackedLumaSlice( void *opaque, unsigned i_slice, int i_first,
+                             int i_start, int i_end )
+{
+    const struct adjust_slice *p = opaque;
+    const plane_t *p_src = p->p_pic->p;
+    const plane_t *p_dst = p->p_outpic->p;
+    const int *pi_luma = p->pi_luma;
+    uint8_t *p_in, *p_in_end, *p_line_end;
+    uint8_t *p_out;
+
+    VLC_UNUSED(i_slice); VLC_UNUSED(i_first);
+
+    p_in = p_src->p_pixels + i_start * p_src->i_pitch + p->i_y_offset;
+    p_in_end = p_in + (i_end - i_start) * p_src->i_pitch - 8 * 4;
+
+    p_out = p_dst->p_pixels + i_start * p_src->i_pitch + p->i_y_offset;
+
+    for( ; p_in < p_in_end ; )
+    {
+        p_line_end = p_in + p_src->i_visible_pitch - 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_line_end += 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_in += p_src->i_pitch - p_src->i_visible_pitch;
+        p_out += p_src->i_pitch - p_dst->i_visible_pitch;
+    }
+}
+
+static void SatHueSlice( void *opaque, unsigned i_slice, int i_first,
+                         int i_start, int i_end )
+{
+    const struct adjust_slice *p = opaque;
+
+    VLC_UNUSED(i_slice); VLC_UNUSED(i_first);
+    p->pf_process( p->p_pic, p->p_outpic, p->i_sin, p->i_cos, p->i_sat,
+                   p->i_x, p->i_y, i_start, i_end );
+}
+
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
@@ -319,78 +474,13 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     /*
      * Do the Y plane
      */
-    if ( b_16bit )
-    {
-        uint16_t *p_in, *p_in_end, *p_line_end;
-        uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
-
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
-        }
-    }
-    else
-    {
-        uint8_t *p_in, *p_in_end, *p_line_end;
-        uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
-
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
-        }
-    }
+    struct adjust_slice slice = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pi_luma = pi_luma,
+    };
+    filter_Slice( p_filter, b_16bit ? PlanarLuma16Slice : PlanarLumaSlice,
+                  &slice, p_pic->p[Y_PLANE].i_visible_lines, 1, 0 );
 
     /*
      * Do the U and V planes
@@ -403,20 +493,15 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
     int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
-    if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
+    slice.pf_process = ( i_sat > i_range ) ? p_sys->pf_process_sat_hue_clip
+                                           : p_sys->pf_process_sat_hue;
+    slice.i_sin = i_sin;
+    slice.i_cos = i_cos;
+    slice.i_sat = i_sat;
+    slice.i_x = i_x;
+    slice.i_y = i_y;
+    filter_Slice( p_filter, SatHueSlice, &slice,
+                  p_pic->p[U_PLANE].i_visible_lines, 1, 0 );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -430,12 +515,8 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     int pi_gamma[256];
 
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
     int i_y_offset, i_u_offset, i_v_offset;
 
-    int i_pitch, i_visible_pitch;
-
     bool b_thres;
     double  f_hue;
     double  f_gamma;
@@ -447,9 +528,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
     if( !p_pic ) return NULL;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
     if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                              &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
@@ -521,39 +599,14 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     /*
      * Do the Y plane
      */
-
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
-
-    for( ; p_in < p_in_end ; )
-    {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            /* Do 8 pixels at a time */
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_line_end += 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
-    }
+    struct adjust_slice slice = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pi_luma = pi_luma,
+        .i_y_offset = i_y_offset,
+    };
+    filter_Slice( p_filter, PackedLumaSlice, &slice,
+                  p_pic->p->i_visible_lines, 1, 0 );
 
     /*
      * Do the U and V planes
@@ -565,32 +618,16 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
     i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
 
-    if ( i_sat > 256 )
-    {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
-    else
-    {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
+    /* The chroma was checked above, the functions cannot fail */
+    slice.pf_process = ( i_sat > 256 ) ? p_sys->pf_process_sat_hue_clip
+                                       : p_sys->pf_process_sat_hue;
+    slice.i_sin = i_sin;
+    slice.i_cos = i_cos;
+    slice.i_sat = i_sat;
+    slice.i_x = i_x;
+    slice.i_y = i_y;
+    filter_Slice( p_filter, SatHueSlice, &slice,
+                  p_pic->p->i_visible_lines, 1, 0 );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -32,6 +32,7 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "blend.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -39,24 +40,22 @@
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define LINES_TEXT N_("Blend whole lines")
+#define LINES_LONGTEXT N_("Blend whole lines with vectorized kernels for " \
+    "the common chromas, instead of one pixel at a time.")
+
 vlc_module_begin()
     set_description(N_("Video pictures blending"))
     set_capability("video blending", 100)
+    add_bool("blend-lines", true, LINES_TEXT, LINES_LONGTEXT, true)
+        change_private()
     set_callbacks(Open, Close)
 vlc_module_end()
 
-static inline unsigned div255(unsigned v)
-{
-    /* It is exact for 8 bits, and has a max error of 1 for 9 and 10 bits
-     * while respecting full opacity/transparency */
-    return ((v >> 8) + v + 1) >> 8;
-    //return v / 255;
-}
-
 template <typename T>
 void merge(T *dst, unsigned src, unsigned f)
 {
-    *dst = div255((255 - f) * (*dst) + src * f);
+    *dst = blend_Div255((255 - f) * (*dst) + src * f);
 }
 
 struct CPixel {
@@ -533,7 +532,7 @@ void Blend(const CPicture &dst_data, const CPicture &src_data,
             src.get(&spx, x);
             convert(spx);
 
-            unsigned a = div255(alpha * spx.a);
+            unsigned a = blend_Div255(alpha * spx.a);
             if (a <= 0)
                 continue;
 
@@ -622,11 +621,286 @@ static const struct {
 #undef YUV
 };
 
+/* Whole lines blending with the kernels of blend.h, for the 8 bits YUV 4:2:0
+ * and 32 bits RGB destinations. The sources give their lines by chunks of at
+ * most BLEND_CHUNK pixels, as YUVA planes or as RGBA pixels, and the
+ * destinations merge them. */
+#define BLEND_CHUNK 512
+
+struct CLineYUVA {
+    const uint8_t *y, *u, *v, *a;
+};
+
+class CLines : public CPicture {
+public:
+    CLines(const CPicture &cfg, const blend_kernels_t *kernels) : CPicture(cfg), kernels(kernels)
+    {
+    }
+protected:
+    const blend_kernels_t *kernels;
+};
+
+class CLinesYUVA : public CLines {
+public:
+    typedef CLineYUVA line_t;
+
+    CLinesYUVA(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            data[i] = CPicture::getLine<1>(i);
+    }
+    void get(line_t *line, unsigned dx, unsigned) const
+    {
+        line->y = &data[0][x + dx];
+        line->u = &data[1][x + dx];
+        line->v = &data[2][x + dx];
+        line->a = &data[3][x + dx];
+    }
+    void nextLine()
+    {
+        y++;
+        for (unsigned i = 0; i < 4; i++)
+            data[i] += picture->p[i].i_pitch;
+    }
+private:
+    const uint8_t *data[4];
+};
+
+class CLinesRGBA : public CLines {
+public:
+    typedef const uint8_t *line_t;
+
+    CLinesRGBA(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        data = CPicture::getLine<1>(0);
+    }
+    void get(line_t *line, unsigned dx, unsigned) const
+    {
+        *line = &data[(x + dx) * 4];
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+protected:
+    const uint8_t *data;
+};
+
+class CLinesRGBAToYUVA : public CLinesRGBA {
+public:
+    typedef CLineYUVA line_t;
+
+    CLinesRGBAToYUVA(const CPicture &cfg, const blend_kernels_t *kernels) : CLinesRGBA(cfg, kernels)
+    {
+    }
+    void get(line_t *line, unsigned dx, unsigned count)
+    {
+        kernels->pf_rgba_to_yuva(buffer[0], buffer[1], buffer[2], buffer[3],
+                                 &data[(x + dx) * 4], count);
+        line->y = buffer[0];
+        line->u = buffer[1];
+        line->v = buffer[2];
+        line->a = buffer[3];
+    }
+private:
+    uint8_t buffer[4][BLEND_CHUNK];
+};
+
+class CLinesYUVP : public CLines {
+public:
+    typedef CLineYUVA line_t;
+
+    CLinesYUVP(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        data = CPicture::getLine<1>(0);
+        palette = fmt->p_palette;
+    }
+    void get(line_t *line, unsigned dx, unsigned count)
+    {
+        const uint8_t *index = &data[x + dx];
+        for (unsigned i = 0; i < count; i++) {
+            const uint8_t *entry = palette->palette[index[i]];
+            buffer[0][i] = entry[0];
+            buffer[1][i] = entry[1];
+            buffer[2][i] = entry[2];
+            buffer[3][i] = entry[3];
+        }
+        line->y = buffer[0];
+        line->u = buffer[1];
+        line->v = buffer[2];
+        line->a = buffer[3];
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    const uint8_t *data;
+    const video_palette_t *palette;
+    uint8_t buffer[4][BLEND_CHUNK];
+};
+
+template <bool swap_uv>
+class CLinesI420 : public CLines {
+public:
+    CLinesI420(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(swap_uv ? 2 : 1);
+        data[2] = CPicture::getLine<2>(swap_uv ? 1 : 2);
+    }
+    void merge(unsigned dx, const CLineYUVA &line, unsigned count, int alpha)
+    {
+        kernels->pf_merge(&data[0][x + dx], line.y, line.a, alpha, count);
+        if ((y % 2) == 0) {
+            /* The chroma samples take the even pixels of the picture */
+            const unsigned odd = (x + dx) % 2;
+            const unsigned width = (count - odd + 1) / 2;
+            kernels->pf_merge_half(&data[1][(x + dx + 1) / 2], line.u + odd,
+                                   line.a + odd, alpha, width);
+            kernels->pf_merge_half(&data[2][(x + dx + 1) / 2], line.v + odd,
+                                   line.a + odd, alpha, width);
+        }
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0) {
+            data[1] += picture->p[swap_uv ? 2 : 1].i_pitch;
+            data[2] += picture->p[swap_uv ? 1 : 2].i_pitch;
+        }
+    }
+private:
+    uint8_t *data[3];
+};
+
+template <bool swap_uv>
+class CLinesNV12 : public CLines {
+public:
+    CLinesNV12(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        data[0] = CPicture::getLine<1>(0);
+        data[1] = CPicture::getLine<2>(1);
+    }
+    void merge(unsigned dx, const CLineYUVA &line, unsigned count, int alpha)
+    {
+        kernels->pf_merge(&data[0][x + dx], line.y, line.a, alpha, count);
+        if ((y % 2) == 0) {
+            const unsigned odd = (x + dx) % 2;
+            const unsigned width = (count - odd + 1) / 2;
+            kernels->pf_merge_uv(&data[1][(x + dx + 1) / 2 * 2],
+                                 (swap_uv ? line.v : line.u) + odd,
+                                 (swap_uv ? line.u : line.v) + odd,
+                                 line.a + odd, alpha, width);
+        }
+    }
+    void nextLine()
+    {
+        y++;
+        data[0] += picture->p[0].i_pitch;
+        if ((y % 2) == 0)
+            data[1] += picture->p[1].i_pitch;
+    }
+private:
+    uint8_t *data[2];
+};
+
+template <bool swap_rb>
+class CLinesRGB32 : public CLines {
+public:
+    CLinesRGB32(const CPicture &cfg, const blend_kernels_t *kernels) : CLines(cfg, kernels)
+    {
+        data = CPicture::getLine<1>(0);
+    }
+    void merge(unsigned dx, const uint8_t *rgba, unsigned count, int alpha)
+    {
+        kernels->pf_merge_rgb32(&data[(x + dx) * 4], rgba, alpha, count, swap_rb);
+    }
+    void nextLine()
+    {
+        y++;
+        data += picture->p[0].i_pitch;
+    }
+private:
+    uint8_t *data;
+};
+
+template <class TDst, class TSrc>
+void BlendLines(const blend_kernels_t *kernels,
+                const CPicture &dst_data, const CPicture &src_data,
+                unsigned width, unsigned height, int alpha)
+{
+    TSrc src(src_data, kernels);
+    TDst dst(dst_data, kernels);
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x += BLEND_CHUNK) {
+            const unsigned count = __MIN(width - x, BLEND_CHUNK);
+            typename TSrc::line_t line;
+
+            src.get(&line, x, count);
+            dst.merge(x, line, count, alpha);
+        }
+        src.nextLine();
+        dst.nextLine();
+    }
+}
+
+typedef void (*blend_lines_function_t)(const blend_kernels_t *kernels,
+                                       const CPicture &dst_data, const CPicture &src_data,
+                                       unsigned width, unsigned height, int alpha);
+
+static const struct {
+    vlc_fourcc_t           dst;
+    vlc_fourcc_t           src;
+    blend_lines_function_t blend;
+} blends_lines[] = {
+#define YUV420(csp, lines) \
+    { csp, VLC_CODEC_YUVA, BlendLines<lines, CLinesYUVA> }, \
+    { csp, VLC_CODEC_RGBA, BlendLines<lines, CLinesRGBAToYUVA> }, \
+    { csp, VLC_CODEC_YUVP, BlendLines<lines, CLinesYUVP> }
+
+    YUV420(VLC_CODEC_YV12,  CLinesI420<true>),
+    YUV420(VLC_CODEC_NV12,  CLinesNV12<false>),
+    YUV420(VLC_CODEC_NV21,  CLinesNV12<true>),
+    YUV420(VLC_CODEC_J420,  CLinesI420<false>),
+    YUV420(VLC_CODEC_I420,  CLinesI420<false>),
+
+#undef YUV420
+};
+
+/* The line blending of 32 bits RGB, for the layouts with R and B in the
+ * bytes 0 and 2, found as CPictureRGBX does */
+static blend_lines_function_t GetBlendLinesRGB32(const video_format_t *fmt)
+{
+#ifdef WORDS_BIGENDIAN
+    const int offset_r = (32 - fmt->i_lrshift) / 8;
+    const int offset_g = (32 - fmt->i_lgshift) / 8;
+    const int offset_b = (32 - fmt->i_lbshift) / 8;
+#else
+    const int offset_r = fmt->i_lrshift / 8;
+    const int offset_g = fmt->i_lgshift / 8;
+    const int offset_b = fmt->i_lbshift / 8;
+#endif
+    if (offset_g != 1)
+        return NULL;
+    if (offset_r == 0 && offset_b == 2)
+        return BlendLines<CLinesRGB32<false>, CLinesRGBA>;
+    if (offset_r == 2 && offset_b == 0)
+        return BlendLines<CLinesRGB32<true>, CLinesRGBA>;
+    return NULL;
+}
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), blend_lines(NULL)
     {
     }
     blend_function_t blend;
+    blend_lines_function_t blend_lines;
+    blend_kernels_t kernels;
 };
 
 /**
@@ -654,13 +928,16 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+    if (sys->blend_lines)
+        sys->blend_lines(&sys->kernels, dst_data, src_data, width, height, alpha);
+    else
+        sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -682,6 +959,19 @@ static int Open(vlc_object_t *object)
         return VLC_EGENERIC;
     }
 
+    if (var_InheritBool(filter, "blend-lines")) {
+        for (size_t i = 0; i < sizeof(blends_lines) / sizeof(*blends_lines); i++) {
+            if (blends_lines[i].src == src && blends_lines[i].dst == dst)
+                sys->blend_lines = blends_lines[i].blend;
+        }
+        if (src == VLC_CODEC_RGBA && dst == VLC_CODEC_RGB32) {
+            video_format_t fmt = filter->fmt_out.video;
+            video_format_FixRgb(&fmt);
+            sys->blend_lines = GetBlendLinesRGB32(&fmt);
+        }
+        blend_GetKernels(&sys->kernels);
+    }
+
     filter->pf_video_blend = Blend;
     filter->p_sys          = sys;
     return VLC_SUCCESS;
@@ -0,0 +1,649 @@
+/*****************************************************************************
+ * blend.h: line kernels of the picture blending
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BLEND_H_
+#define VLC_BLEND_H_
+
+#include <string.h>
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+static inline unsigned blend_Div255(unsigned v)
+{
+    /* It is exact for 8 bits, and has a max error of 1 for 9 and 10 bits
+     * while respecting full opacity/transparency */
+    return ((v >> 8) + v + 1) >> 8;
+    //return v / 255;
+}
+
+/* The kernels below merge 8 bits samples the way blend.cpp does pixel per
+ * pixel: with f = blend_Div255(alpha * a), where a is the alpha of the
+ * source pixel, the destination becomes
+ * blend_Div255((255 - f) * dst + src * f). A null f leaves the destination
+ * unchanged, so the SIMD kernels skip the blocks of transparent pixels and
+ * blend the other ones as a whole. */
+
+/* dst[i] merged with src[i] at the alpha a[i], for i below width */
+typedef void (*blend_merge_t)(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *a, int alpha, unsigned width);
+
+/* dst[i] merged with src[2 * i] at the alpha a[2 * i], for i below width,
+ * the chroma of the even pixels of a line; src and a are read over
+ * 2 * width - 1 bytes */
+typedef void (*blend_merge_half_t)(uint8_t *dst, const uint8_t *src,
+                                   const uint8_t *a, int alpha,
+                                   unsigned width);
+
+/* dst[2 * i] merged with u[2 * i] and dst[2 * i + 1] with v[2 * i] at the
+ * alpha a[2 * i], for i below width, the interleaved chroma of the even
+ * pixels of a line; u, v and a are read over 2 * width - 1 bytes */
+typedef void (*blend_merge_uv_t)(uint8_t *dst, const uint8_t *u,
+                                 const uint8_t *v, const uint8_t *a,
+                                 int alpha, unsigned width);
+
+/* The width RGBA pixels of rgba merged with the 32 bits pixels of dst, with
+ * R in the byte 0 and B in the byte 2 of dst, or the other way round if
+ * swap_rb; the byte 3 of dst is left as is */
+typedef void (*blend_merge_rgb32_t)(uint8_t *dst, const uint8_t *rgba,
+                                    int alpha, unsigned width, bool swap_rb);
+
+/* The width RGBA pixels of rgba converted to Y, U, V and A planes, as
+ * rgb_to_yuv() does */
+typedef void (*blend_rgba_to_yuva_t)(uint8_t *y, uint8_t *u, uint8_t *v,
+                                     uint8_t *a, const uint8_t *rgba,
+                                     unsigned width);
+
+/* Whether the 8 alpha samples at a are all null */
+static inline bool blend_IsTransparent(const uint8_t *a)
+{
+    uint64_t v;
+    memcpy(&v, a, sizeof(v));
+    return v == 0;
+}
+
+static inline void blend_MergeC(uint8_t *dst, const uint8_t *src,
+                                const uint8_t *a, int alpha, unsigned width)
+{
+    for (unsigned i = 0; i < width; i++) {
+        const unsigned f = blend_Div255(alpha * a[i]);
+        if (f == 0)
+            continue;
+        dst[i] = blend_Div255((255 - f) * dst[i] + src[i] * f);
+    }
+}
+
+static inline void blend_MergeHalfC(uint8_t *dst, const uint8_t *src,
+                                    const uint8_t *a, int alpha,
+                                    unsigned width)
+{
+    for (unsigned i = 0; i < width; i++) {
+        const unsigned f = blend_Div255(alpha * a[2 * i]);
+        if (f == 0)
+            continue;
+        dst[i] = blend_Div255((255 - f) * dst[i] + src[2 * i] * f);
+    }
+}
+
+static inline void blend_MergeUVC(uint8_t *dst, const uint8_t *u,
+                                  const uint8_t *v, const uint8_t *a,
+                                  int alpha, unsigned width)
+{
+    for (unsigned i = 0; i < width; i++) {
+        const unsigned f = blend_Div255(alpha * a[2 * i]);
+        if (f == 0)
+            continue;
+        dst[2 * i + 0] = blend_Div255((255 - f) * dst[2 * i + 0] + u[2 * i] * f);
+        dst[2 * i + 1] = blend_Div255((255 - f) * dst[2 * i + 1] + v[2 * i] * f);
+    }
+}
+
+static inline void blend_MergeRGB32C(uint8_t *dst, const uint8_t *rgba,
+                                     int alpha, unsigned width, bool swap_rb)
+{
+    const unsigned r = swap_rb ? 2 : 0, b = swap_rb ? 0 : 2;
+
+    for (unsigned i = 0; i < width; i++, dst += 4, rgba += 4) {
+        const unsigned f = blend_Div255(alpha * rgba[3]);
+        if (f == 0)
+            continue;
+        dst[0] = blend_Div255((255 - f) * dst[0] + rgba[r] * f);
+        dst[1] = blend_Div255((255 - f) * dst[1] + rgba[1] * f);
+        dst[2] = blend_Div255((255 - f) * dst[2] + rgba[b] * f);
+    }
+}
+
+static inline void blend_RGBAToYUVAC(uint8_t *y, uint8_t *u, uint8_t *v,
+                                     uint8_t *a, const uint8_t *rgba,
+                                     unsigned width)
+{
+    for (unsigned i = 0; i < width; i++, rgba += 4) {
+        const int r = rgba[0], g = rgba[1], b = rgba[2];
+
+        y[i] = ((  66 * r + 129 * g +  25 * b + 128) >> 8) + 16;
+        u[i] = (( -38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+        v[i] = (( 112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+        a[i] = rgba[3];
+    }
+}
+
+#ifdef CAN_COMPILE_SSE2
+/* The SSE2 kernels blend one block per asm statement, with xmm5 holding the
+ * global alpha, xmm6 words of 1 and xmm7 zero */
+#define BLEND_SSE2_SETUP \
+    "movd        %[alpha], %%xmm5 \n" \
+    "pshuflw $0, %%xmm5, %%xmm5 \n" \
+    "punpcklqdq  %%xmm5, %%xmm5 \n" \
+    "pcmpeqw     %%xmm6, %%xmm6 \n" \
+    "psrlw          $15, %%xmm6 \n" \
+    "pxor        %%xmm7, %%xmm7 \n"
+
+/* v = blend_Div255(v) on words, t is clobbered */
+#define BLEND_SSE2_DIV255(v, t) \
+    "movdqa    %%" v ", %%" t " \n" \
+    "psrlw         $8, %%" t " \n" \
+    "paddw     %%" t ", %%" v " \n" \
+    "paddw     %%xmm6, %%" v " \n" \
+    "psrlw         $8, %%" v " \n"
+
+/* f = blend_Div255(alpha * f) on words, t is clobbered */
+#define BLEND_SSE2_ALPHA(f, t) \
+    "pmullw    %%xmm5, %%" f " \n" \
+    BLEND_SSE2_DIV255(f, t)
+
+/* d = blend_Div255((255 - f) * d + s * f) on words, s and t are clobbered */
+#define BLEND_SSE2_MERGE(d, s, f, t) \
+    "pmullw    %%" f ", %%" s " \n" \
+    "pcmpeqw   %%" t ", %%" t " \n" \
+    "psrlw         $8, %%" t " \n" \
+    "psubw     %%" f ", %%" t " \n" \
+    "pmullw    %%" t ", %%" d " \n" \
+    "paddw     %%" s ", %%" d " \n" \
+    BLEND_SSE2_DIV255(d, t)
+
+VLC_SSE
+static inline void blend_MergeSSE2(uint8_t *dst, const uint8_t *src,
+                                   const uint8_t *a, int alpha,
+                                   unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        if (blend_IsTransparent(&a[i]))
+            continue;
+        __asm__ volatile(
+            BLEND_SSE2_SETUP
+            "movq         (%[a]), %%xmm0 \n"
+            "punpcklbw    %%xmm7, %%xmm0 \n"
+            BLEND_SSE2_ALPHA("xmm0", "xmm1")
+            "movq       (%[src]), %%xmm1 \n"
+            "punpcklbw    %%xmm7, %%xmm1 \n"
+            "movq       (%[dst]), %%xmm2 \n"
+            "punpcklbw    %%xmm7, %%xmm2 \n"
+            BLEND_SSE2_MERGE("xmm2", "xmm1", "xmm0", "xmm3")
+            "packuswb     %%xmm2, %%xmm2 \n"
+            "movq         %%xmm2, (%[dst]) \n"
+            :
+            : [dst]"r"(&dst[i]), [src]"r"(&src[i]), [a]"r"(&a[i]),
+              [alpha]"m"(alpha)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7",
+              "memory");
+    }
+
+    blend_MergeC(dst + i, src + i, a + i, alpha, width - i);
+}
+
+VLC_SSE
+static inline void blend_MergeHalfSSE2(uint8_t *dst, const uint8_t *src,
+                                       const uint8_t *a, int alpha,
+                                       unsigned width)
+{
+    unsigned i = 0;
+
+    /* The blocks read 16 bytes of src and a */
+    for (; i + 8 < width; i += 8) {
+        if (blend_IsTransparent(&a[2 * i])
+         && blend_IsTransparent(&a[2 * i + 8]))
+            continue;
+        __asm__ volatile(
+            BLEND_SSE2_SETUP
+            "pcmpeqw      %%xmm4, %%xmm4 \n"
+            "psrlw            $8, %%xmm4 \n"
+            "movdqu       (%[a]), %%xmm0 \n"
+            "pand         %%xmm4, %%xmm0 \n"
+            BLEND_SSE2_ALPHA("xmm0", "xmm1")
+            "movdqu     (%[src]), %%xmm1 \n"
+            "pand         %%xmm4, %%xmm1 \n"
+            "movq       (%[dst]), %%xmm2 \n"
+            "punpcklbw    %%xmm7, %%xmm2 \n"
+            BLEND_SSE2_MERGE("xmm2", "xmm1", "xmm0", "xmm3")
+            "packuswb     %%xmm2, %%xmm2 \n"
+            "movq         %%xmm2, (%[dst]) \n"
+            :
+            : [dst]"r"(&dst[i]), [src]"r"(&src[2 * i]), [a]"r"(&a[2 * i]),
+              [alpha]"m"(alpha)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+              "xmm7", "memory");
+    }
+
+    blend_MergeHalfC(dst + i, src + 2 * i, a + 2 * i, alpha, width - i);
+}
+
+VLC_SSE
+static inline void blend_MergeUVSSE2(uint8_t *dst, const uint8_t *u,
+                                     const uint8_t *v, const uint8_t *a,
+                                     int alpha, unsigned width)
+{
+    unsigned i = 0;
+
+    /* The blocks read 16 bytes of u, v and a */
+    for (; i + 8 < width; i += 8) {
+        if (blend_IsTransparent(&a[2 * i])
+         && blend_IsTransparent(&a[2 * i + 8]))
+            continue;
+        __asm__ volatile(
+            BLEND_SSE2_SETUP
+            "pcmpeqw      %%xmm3, %%xmm3 \n"
+            "psrlw            $8, %%xmm3 \n"
+            "movdqu       (%[a]), %%xmm0 \n"
+            "pand         %%xmm3, %%xmm0 \n"
+            BLEND_SSE2_ALPHA("xmm0", "xmm1")
+            "movdqu       (%[u]), %%xmm1 \n"
+            "pand         %%xmm3, %%xmm1 \n"
+            "movdqu       (%[v]), %%xmm2 \n"
+            "pand         %%xmm3, %%xmm2 \n"
+            /* interleave the chroma and repeat the alpha of each pair */
+            "movdqa       %%xmm1, %%xmm4 \n"
+            "punpcklwd    %%xmm2, %%xmm1 \n"
+            "punpckhwd    %%xmm2, %%xmm4 \n"
+            "movdqa       %%xmm0, %%xmm2 \n"
+            "punpcklwd    %%xmm0, %%xmm0 \n"
+            "punpckhwd    %%xmm2, %%xmm2 \n"
+            "movq       (%[dst]), %%xmm3 \n"
+            "punpcklbw    %%xmm7, %%xmm3 \n"
+            BLEND_SSE2_MERGE("xmm3", "xmm1", "xmm0", "xmm5")
+            "movq      8(%[dst]), %%xmm0 \n"
+            "punpcklbw    %%xmm7, %%xmm0 \n"
+            BLEND_SSE2_MERGE("xmm0", "xmm4", "xmm2", "xmm1")
+            "packuswb     %%xmm0, %%xmm3 \n"
+            "movdqu       %%xmm3, (%[dst]) \n"
+            :
+            : [dst]"r"(&dst[2 * i]), [u]"r"(&u[2 * i]), [v]"r"(&v[2 * i]),
+              [a]"r"(&a[2 * i]), [alpha]"m"(alpha)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+              "xmm7", "memory");
+    }
+
+    blend_MergeUVC(dst + 2 * i, u + 2 * i, v + 2 * i, a + 2 * i, alpha,
+                   width - i);
+}
+
+/* Blends the 4 pixels at %[rgba] into %[dst], the RGBA words being shuffled
+ * by order first */
+#define BLEND_SSE2_RGB32(order) \
+    BLEND_SSE2_SETUP \
+    "movdqu    (%[rgba]), %%xmm0 \n" \
+    "movdqa       %%xmm0, %%xmm1 \n" \
+    "punpcklbw    %%xmm7, %%xmm0 \n" \
+    "punpckhbw    %%xmm7, %%xmm1 \n" \
+    "pshuflw $" order ", %%xmm0, %%xmm0 \n" \
+    "pshufhw $" order ", %%xmm0, %%xmm0 \n" \
+    "pshuflw $" order ", %%xmm1, %%xmm1 \n" \
+    "pshufhw $" order ", %%xmm1, %%xmm1 \n" \
+    /* the alpha of each pixel for its 3 colors and 0 for the byte 3 */ \
+    "pshuflw $0xff, %%xmm0, %%xmm2 \n" \
+    "pshufhw $0xff, %%xmm2, %%xmm2 \n" \
+    BLEND_SSE2_ALPHA("xmm2", "xmm3") \
+    "pshuflw $0xff, %%xmm1, %%xmm3 \n" \
+    "pshufhw $0xff, %%xmm3, %%xmm3 \n" \
+    BLEND_SSE2_ALPHA("xmm3", "xmm4") \
+    "pcmpeqw      %%xmm5, %%xmm5 \n" \
+    "psrlq           $16, %%xmm5 \n" \
+    "pand         %%xmm5, %%xmm2 \n" \
+    "pand         %%xmm5, %%xmm3 \n" \
+    "movq       (%[dst]), %%xmm4 \n" \
+    "punpcklbw    %%xmm7, %%xmm4 \n" \
+    BLEND_SSE2_MERGE("xmm4", "xmm0", "xmm2", "xmm5") \
+    "movq      8(%[dst]), %%xmm0 \n" \
+    "punpcklbw    %%xmm7, %%xmm0 \n" \
+    BLEND_SSE2_MERGE("xmm0", "xmm1", "xmm3", "xmm2") \
+    "packuswb     %%xmm0, %%xmm4 \n" \
+    "movdqu       %%xmm4, (%[dst]) \n"
+
+VLC_SSE
+static inline void blend_MergeRGB32SSE2(uint8_t *dst, const uint8_t *rgba,
+                                        int alpha, unsigned width,
+                                        bool swap_rb)
+{
+    unsigned i = 0;
+
+    for (; i + 4 <= width; i += 4) {
+        const uint8_t *p = &rgba[4 * i];
+        if ((p[3] | p[7] | p[11] | p[15]) == 0)
+            continue;
+        if (swap_rb)
+            __asm__ volatile(
+                BLEND_SSE2_RGB32("0xc6")
+                :
+                : [dst]"r"(&dst[4 * i]), [rgba]"r"(p), [alpha]"m"(alpha)
+                : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+                  "xmm7", "memory");
+        else
+            __asm__ volatile(
+                BLEND_SSE2_RGB32("0xe4")
+                :
+                : [dst]"r"(&dst[4 * i]), [rgba]"r"(p), [alpha]"m"(alpha)
+                : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+                  "xmm7", "memory");
+    }
+
+    blend_MergeRGB32C(dst + 4 * i, rgba + 4 * i, alpha, width - i, swap_rb);
+}
+
+/* Pairs of coefficients of rgb_to_yuv(), applied with pmaddwd on (R, G) and
+ * (B, 1) words, the second one adding the rounding */
+#define BLEND_PAIR(a, b) ((uint32_t)(uint16_t)(a) | (uint32_t)(uint16_t)(b) << 16)
+static const uint32_t blend_rgb_coefs[3][2] = {
+    { BLEND_PAIR( 66, 129), BLEND_PAIR( 25, 128) }, /* Y */
+    { BLEND_PAIR(-38, -74), BLEND_PAIR(112, 128) }, /* U */
+    { BLEND_PAIR(112, -94), BLEND_PAIR(-18, 128) }, /* V */
+};
+static const uint32_t blend_yuv_offsets[3] = {
+    BLEND_PAIR(16, 16), BLEND_PAIR(128, 128), BLEND_PAIR(128, 128),
+};
+#undef BLEND_PAIR
+
+/* One component of 8 pixels into out, from the (R, G) words of xmm0 and
+ * xmm1 and the (B, 1) words of xmm2 and xmm3, with the coefficients rg and
+ * b1 */
+#define BLEND_SSE2_RGB_TO(rg, b1, offset, out) \
+    "movd        " rg ", %%xmm4 \n" \
+    "pshufd $0, %%xmm4, %%xmm4 \n" \
+    "movd        " b1 ", %%xmm5 \n" \
+    "pshufd $0, %%xmm5, %%xmm5 \n" \
+    "movdqa   %%xmm0, %%xmm6 \n" \
+    "pmaddwd  %%xmm4, %%xmm6 \n" \
+    "movdqa   %%xmm2, %%xmm7 \n" \
+    "pmaddwd  %%xmm5, %%xmm7 \n" \
+    "paddd    %%xmm7, %%xmm6 \n" \
+    "psrad        $8, %%xmm6 \n" \
+    "movdqa   %%xmm1, %%xmm7 \n" \
+    "pmaddwd  %%xmm4, %%xmm7 \n" \
+    "movdqa   %%xmm3, %%xmm4 \n" \
+    "pmaddwd  %%xmm5, %%xmm4 \n" \
+    "paddd    %%xmm4, %%xmm7 \n" \
+    "psrad        $8, %%xmm7 \n" \
+    "packssdw %%xmm7, %%xmm6 \n" \
+    "movd    " offset ", %%xmm4 \n" \
+    "pshufd $0, %%xmm4, %%xmm4 \n" \
+    "paddw    %%xmm4, %%xmm6 \n" \
+    "packuswb %%xmm6, %%xmm6 \n" \
+    "movq     %%xmm6, " out " \n"
+
+VLC_SSE
+static inline void blend_RGBAToYUVASSE2(uint8_t *y, uint8_t *u, uint8_t *v,
+                                        uint8_t *a, const uint8_t *rgba,
+                                        unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        uint8_t out[4][8];
+
+        __asm__ volatile(
+            "movdqu    (%[rgba]), %%xmm0 \n"
+            "movdqu  16(%[rgba]), %%xmm1 \n"
+            "pcmpeqw      %%xmm7, %%xmm7 \n"
+            "psrlw            $8, %%xmm7 \n"
+            /* A */
+            "movdqa       %%xmm0, %%xmm2 \n"
+            "psrld           $24, %%xmm2 \n"
+            "movdqa       %%xmm1, %%xmm3 \n"
+            "psrld           $24, %%xmm3 \n"
+            "packssdw     %%xmm3, %%xmm2 \n"
+            "packuswb     %%xmm2, %%xmm2 \n"
+            "movq         %%xmm2, %[a] \n"
+            /* (B, 1) words */
+            "movdqa       %%xmm0, %%xmm2 \n"
+            "psrld           $16, %%xmm2 \n"
+            "movdqa       %%xmm1, %%xmm3 \n"
+            "psrld           $16, %%xmm3 \n"
+            "pcmpeqw      %%xmm6, %%xmm6 \n"
+            "pslld           $16, %%xmm6 \n"
+            "psrlw           $15, %%xmm6 \n"
+            "pand         %%xmm7, %%xmm2 \n"
+            "pand         %%xmm7, %%xmm3 \n"
+            "por          %%xmm6, %%xmm2 \n"
+            "por          %%xmm6, %%xmm3 \n"
+            /* (R, G) words */
+            "movdqa       %%xmm0, %%xmm4 \n"
+            "psrlw            $8, %%xmm4 \n"
+            "pslld           $16, %%xmm4 \n"
+            "pslld           $24, %%xmm0 \n"
+            "psrld           $24, %%xmm0 \n"
+            "movdqa       %%xmm1, %%xmm5 \n"
+            "psrlw            $8, %%xmm5 \n"
+            "pslld           $16, %%xmm5 \n"
+            "pslld           $24, %%xmm1 \n"
+            "psrld           $24, %%xmm1 \n"
+            "por          %%xmm4, %%xmm0 \n"
+            "por          %%xmm5, %%xmm1 \n"
+            BLEND_SSE2_RGB_TO("%[y0]", "%[y1]", "%[oy]", "%[y]")
+            BLEND_SSE2_RGB_TO("%[u0]", "%[u1]", "%[ou]", "%[u]")
+            BLEND_SSE2_RGB_TO("%[v0]", "%[v1]", "%[ov]", "%[v]")
+            : [y]"=m"(out[0]), [u]"=m"(out[1]), [v]"=m"(out[2]),
+              [a]"=m"(out[3])
+            : [rgba]"r"(&rgba[4 * i]),
+              [y0]"m"(blend_rgb_coefs[0][0]), [y1]"m"(blend_rgb_coefs[0][1]),
+              [u0]"m"(blend_rgb_coefs[1][0]), [u1]"m"(blend_rgb_coefs[1][1]),
+              [v0]"m"(blend_rgb_coefs[2][0]), [v1]"m"(blend_rgb_coefs[2][1]),
+              [oy]"m"(blend_yuv_offsets[0]), [ou]"m"(blend_yuv_offsets[1]),
+              [ov]"m"(blend_yuv_offsets[2])
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6",
+              "xmm7");
+        memcpy(&y[i], out[0], 8);
+        memcpy(&u[i], out[1], 8);
+        memcpy(&v[i], out[2], 8);
+        memcpy(&a[i], out[3], 8);
+    }
+
+    blend_RGBAToYUVAC(y + i, u + i, v + i, a + i, rgba + 4 * i, width - i);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+/* blend_Div255() of 16 bits words */
+static inline uint16x8_t blend_Div255NEON(uint16x8_t v)
+{
+    return vshrq_n_u16(vaddq_u16(vaddq_u16(v, vshrq_n_u16(v, 8)),
+                                 vdupq_n_u16(1)), 8);
+}
+
+/* The alpha of 8 pixels */
+static inline uint8x8_t blend_AlphaNEON(uint8x8_t a, int alpha)
+{
+    return vmovn_u16(blend_Div255NEON(vmull_u8(a, vdup_n_u8(alpha))));
+}
+
+static inline uint8x8_t blend_MergeBlockNEON(uint8x8_t dst, uint8x8_t src,
+                                             uint8x8_t f)
+{
+    uint16x8_t m = vmull_u8(dst, vsub_u8(vdup_n_u8(255), f));
+    return vmovn_u16(blend_Div255NEON(vmlal_u8(m, src, f)));
+}
+
+static inline void blend_MergeNEON(uint8_t *dst, const uint8_t *src,
+                                   const uint8_t *a, int alpha,
+                                   unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        if (blend_IsTransparent(&a[i]))
+            continue;
+        uint8x8_t f = blend_AlphaNEON(vld1_u8(&a[i]), alpha);
+        vst1_u8(&dst[i], blend_MergeBlockNEON(vld1_u8(&dst[i]),
+                                              vld1_u8(&src[i]), f));
+    }
+
+    blend_MergeC(dst + i, src + i, a + i, alpha, width - i);
+}
+
+static inline void blend_MergeHalfNEON(uint8_t *dst, const uint8_t *src,
+                                       const uint8_t *a, int alpha,
+                                       unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 < width; i += 8) {
+        if (blend_IsTransparent(&a[2 * i])
+         && blend_IsTransparent(&a[2 * i + 8]))
+            continue;
+        uint8x8_t f = blend_AlphaNEON(vld2_u8(&a[2 * i]).val[0], alpha);
+        vst1_u8(&dst[i], blend_MergeBlockNEON(vld1_u8(&dst[i]),
+                                              vld2_u8(&src[2 * i]).val[0],
+                                              f));
+    }
+
+    blend_MergeHalfC(dst + i, src + 2 * i, a + 2 * i, alpha, width - i);
+}
+
+static inline void blend_MergeUVNEON(uint8_t *dst, const uint8_t *u,
+                                     const uint8_t *v, const uint8_t *a,
+                                     int alpha, unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 < width; i += 8) {
+        if (blend_IsTransparent(&a[2 * i])
+         && blend_IsTransparent(&a[2 * i + 8]))
+            continue;
+        uint8x8_t f = blend_AlphaNEON(vld2_u8(&a[2 * i]).val[0], alpha);
+        uint8x8x2_t uv = vld2_u8(&dst[2 * i]);
+
+        uv.val[0] = blend_MergeBlockNEON(uv.val[0],
+                                         vld2_u8(&u[2 * i]).val[0], f);
+        uv.val[1] = blend_MergeBlockNEON(uv.val[1],
+                                         vld2_u8(&v[2 * i]).val[0], f);
+        vst2_u8(&dst[2 * i], uv);
+    }
+
+    blend_MergeUVC(dst + 2 * i, u + 2 * i, v + 2 * i, a + 2 * i, alpha,
+                   width - i);
+}
+
+static inline void blend_MergeRGB32NEON(uint8_t *dst, const uint8_t *rgba,
+                                        int alpha, unsigned width,
+                                        bool swap_rb)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        uint8x8x4_t s = vld4_u8(&rgba[4 * i]);
+        if (vget_lane_u64(vreinterpret_u64_u8(s.val[3]), 0) == 0)
+            continue;
+        uint8x8x4_t d = vld4_u8(&dst[4 * i]);
+        uint8x8_t f = blend_AlphaNEON(s.val[3], alpha);
+
+        d.val[0] = blend_MergeBlockNEON(d.val[0], s.val[swap_rb ? 2 : 0], f);
+        d.val[1] = blend_MergeBlockNEON(d.val[1], s.val[1], f);
+        d.val[2] = blend_MergeBlockNEON(d.val[2], s.val[swap_rb ? 0 : 2], f);
+        vst4_u8(&dst[4 * i], d);
+    }
+
+    blend_MergeRGB32C(dst + 4 * i, rgba + 4 * i, alpha, width - i, swap_rb);
+}
+
+/* ((c0 * s0 + c1 * s1 + c2 * s2 + 128) >> 8) + offset, in signed words */
+static inline uint8x8_t blend_RGBToNEON(int16x8_t r, int16x8_t g, int16x8_t b,
+                                        int16_t c0, int16_t c1, int16_t c2,
+                                        int16_t offset)
+{
+    int16x8_t s = vmlaq_n_s16(vmlaq_n_s16(vmulq_n_s16(r, c0), g, c1), b, c2);
+    s = vshrq_n_s16(vaddq_s16(s, vdupq_n_s16(128)), 8);
+    return vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(s, vdupq_n_s16(offset))));
+}
+
+static inline void blend_RGBAToYUVANEON(uint8_t *y, uint8_t *u, uint8_t *v,
+                                        uint8_t *a, const uint8_t *rgba,
+                                        unsigned width)
+{
+    unsigned i = 0;
+
+    for (; i + 8 <= width; i += 8) {
+        uint8x8x4_t s = vld4_u8(&rgba[4 * i]);
+        int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(s.val[0]));
+        int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(s.val[1]));
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(s.val[2]));
+
+        /* the luma sums go up to 56228, they are unsigned */
+        uint16x8_t l = vmull_u8(s.val[0], vdup_n_u8(66));
+        l = vmlal_u8(l, s.val[1], vdup_n_u8(129));
+        l = vmlal_u8(l, s.val[2], vdup_n_u8(25));
+        l = vaddq_u16(l, vdupq_n_u16(128));
+        vst1_u8(&y[i], vadd_u8(vshrn_n_u16(l, 8), vdup_n_u8(16)));
+        vst1_u8(&u[i], blend_RGBToNEON(r, g, b, -38, -74, 112, 128));
+        vst1_u8(&v[i], blend_RGBToNEON(r, g, b, 112, -94, -18, 128));
+        vst1_u8(&a[i], s.val[3]);
+    }
+
+    blend_RGBAToYUVAC(y + i, u + i, v + i, a + i, rgba + 4 * i, width - i);
+}
+#endif
+
+typedef struct
+{
+    blend_merge_t        pf_merge;
+    blend_merge_half_t   pf_merge_half;
+    blend_merge_uv_t     pf_merge_uv;
+    blend_merge_rgb32_t  pf_merge_rgb32;
+    blend_rgba_to_yuva_t pf_rgba_to_yuva;
+} blend_kernels_t;
+
+static inline void blend_GetKernels(blend_kernels_t *kernels)
+{
+#ifdef CAN_COMPILE_SSE2
+    if (vlc_CPU_SSE2()) {
+        kernels->pf_merge        = blend_MergeSSE2;
+        kernels->pf_merge_half   = blend_MergeHalfSSE2;
+        kernels->pf_merge_uv     = blend_MergeUVSSE2;
+        kernels->pf_merge_rgb32  = blend_MergeRGB32SSE2;
+        kernels->pf_rgba_to_yuva = blend_RGBAToYUVASSE2;
+        return;
+    }
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    kernels->pf_merge        = blend_MergeNEON;
+    kernels->pf_merge_half   = blend_MergeHalfNEON;
+    kernels->pf_merge_uv     = blend_MergeUVNEON;
+    kernels->pf_merge_rgb32  = blend_MergeRGB32NEON;
+    kernels->pf_rgba_to_yuva = blend_RGBAToYUVANEON;
+#else
+    kernels->pf_merge        = blend_MergeC;
+    kernels->pf_merge_half   = blend_MergeHalfC;
+    kernels->pf_merge_uv     = blend_MergeUVC;
+    kernels->pf_merge_rgb32  = blend_MergeRGB32C;
+    kernels->pf_rgba_to_yuva = blend_RGBAToYUVAC;
+#endif
+}
+
+#endif
@@ -56,13 +56,17 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
-#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
+#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto. " \
+    "A gradient is generated when none is given.")
 
 #define BASE_CHROMA_TEXT N_("Chroma for the base image")
 #define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
-#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
+#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image. " \
+    "When none is given, an overlay with the same dimensions is generated, " \
+    "transparent over its top half and with subtitle like glyphs and a " \
+    "translucent OSD bar over the bottom one.")
 
 #define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
 #define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
@@ -70,6 +74,10 @@ static picture_t *Filter( filter_t *, picture_t * );
 
 #define CFG_PREFIX "blendbench-"
 
+/* Dimensions of the generated base image */
+#define BLENDBENCH_WIDTH  1280
+#define BLENDBENCH_HEIGHT 720
+
 vlc_module_begin ()
     set_description( N_("Blending benchmark filter") )
     set_shortname( N_("Blendbench" ))
@@ -116,8 +124,125 @@ struct filter_sys_t
 
     vlc_fourcc_t i_base_chroma;
     vlc_fourcc_t i_blend_chroma;
+
+    /* of the generated YUVP blend image */
+    video_palette_t palette;
 };
 
+/* Fills a picture with a gradient, the same on every run */
+static picture_t *blendbench_NewBase( vlc_fourcc_t i_chroma,
+                                      unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height, i_width, i_height,
+                        1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+                p->p_pixels[y * p->i_pitch + x] = (x + y) / 4 + 85 * i;
+    }
+    return p_pic;
+}
+
+/* Alpha of the generated blend image: transparent over the top half, then
+ * glyphs with soft edges in a subtitle area, and a translucent OSD bar */
+static uint8_t blendbench_Alpha( unsigned x, unsigned y, unsigned i_height )
+{
+    if( y < i_height / 2 )
+        return 0;
+    if( y >= i_height - i_height / 8 )
+        return 160;
+
+    const unsigned cx = x % 24, cy = y % 32;
+    if( (x / 24 + y / 32) % 3 == 0 || cy >= 28 )
+        return 0;
+    if( cx < 2 || cx >= 22 || cy < 2 )
+        return 32 + 24 * (cx % 4 + cy % 4);
+    return 255;
+}
+
+static uint8_t blendbench_Color( unsigned x, unsigned y, unsigned i_plane )
+{
+    return 2 * x + y + 80 * i_plane;
+}
+
+static picture_t *blendbench_NewBlend( filter_sys_t *p_sys,
+                                       vlc_fourcc_t i_chroma,
+                                       unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height, i_width, i_height,
+                        1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    switch( i_chroma )
+    {
+        case VLC_CODEC_YUVA:
+            for( unsigned y = 0; y < i_height; y++ )
+                for( unsigned x = 0; x < i_width; x++ )
+                {
+                    for( unsigned i = 0; i < 3; i++ )
+                        p_pic->p[i].p_pixels[y * p_pic->p[i].i_pitch + x] =
+                            blendbench_Color( x, y, i );
+                    p_pic->p[A_PLANE].p_pixels[y * p_pic->p[A_PLANE].i_pitch + x] =
+                        blendbench_Alpha( x, y, i_height );
+                }
+            break;
+
+        case VLC_CODEC_RGBA:
+            for( unsigned y = 0; y < i_height; y++ )
+                for( unsigned x = 0; x < i_width; x++ )
+                {
+                    uint8_t *p = &p_pic->p->p_pixels[y * p_pic->p->i_pitch + 4 * x];
+                    for( unsigned i = 0; i < 3; i++ )
+                        p[i] = blendbench_Color( x, y, i );
+                    p[3] = blendbench_Alpha( x, y, i_height );
+                }
+            break;
+
+        case VLC_CODEC_YUVP:
+            /* the index of a pixel is its alpha */
+            p_sys->palette.i_entries = 256;
+            for( unsigned i = 0; i < 256; i++ )
+            {
+                p_sys->palette.palette[i][0] = blendbench_Color( i, 0, 0 );
+                p_sys->palette.palette[i][1] = blendbench_Color( i, 0, 1 );
+                p_sys->palette.palette[i][2] = blendbench_Color( i, 0, 2 );
+                p_sys->palette.palette[i][3] = i;
+            }
+            for( unsigned y = 0; y < i_height; y++ )
+                for( unsigned x = 0; x < i_width; x++ )
+                    p_pic->p->p_pixels[y * p_pic->p->i_pitch + x] =
+                        blendbench_Alpha( x, y, i_height );
+            break;
+
+        default:
+            /* no alpha, only the global one applies */
+            for( int i = 0; i < p_pic->i_planes; i++ )
+            {
+                plane_t *p = &p_pic->p[i];
+
+                for( int y = 0; y < p->i_lines; y++ )
+                    for( int x = 0; x < p->i_pitch; x++ )
+                        p->p_pixels[y * p->i_pitch + x] =
+                            blendbench_Color( x, y, i );
+            }
+            break;
+    }
+    return p_pic;
+}
+
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
                                  vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
 {
@@ -162,6 +287,7 @@ static int Create( vlc_object_t *p_this )
 
     p_sys = p_filter->p_sys;
     p_sys->b_done = false;
+    p_sys->palette.i_entries = 0;
 
     p_filter->pf_video_filter = Filter;
 
@@ -179,8 +305,16 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
                                        psz_temp[2], psz_temp[3] );
     psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
+    if( EMPTY_STR( psz_cmd ) )
+    {
+        p_sys->p_base_image = blendbench_NewBase( p_sys->i_base_chroma,
+                                                  BLENDBENCH_WIDTH,
+                                                  BLENDBENCH_HEIGHT );
+        i_ret = p_sys->p_base_image != NULL ? VLC_SUCCESS : VLC_ENOMEM;
+    }
+    else
+        i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
+                                      p_sys->i_base_chroma, psz_cmd, "Base" );
     free( psz_temp );
     free( psz_cmd );
     if( i_ret != VLC_SUCCESS )
@@ -194,10 +328,27 @@ static int Create( vlc_object_t *p_this )
     p_sys->i_blend_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
                                         psz_temp[2], psz_temp[3] );
     psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                          psz_cmd, "Blend" );
+    if( EMPTY_STR( psz_cmd ) )
+    {
+        const video_format_t *p_base = &p_sys->p_base_image->format;
+
+        p_sys->p_blend_image = blendbench_NewBlend( p_sys,
+                                                    p_sys->i_blend_chroma,
+                                                    p_base->i_visible_width,
+                                                    p_base->i_visible_height );
+        i_ret = p_sys->p_blend_image != NULL ? VLC_SUCCESS : VLC_ENOMEM;
+    }
+    else
+        i_ret = blendbench_LoadImage( p_this, &p_sys->p_blend_image,
+                                      p_sys->i_blend_chroma, psz_cmd, "Blend" );
     free( psz_temp );
     free( psz_cmd );
+    if( i_ret != VLC_SUCCESS )
+    {
+        picture_Release( p_sys->p_base_image );
+        free( p_sys );
+        return i_ret;
+    }
 
     return VLC_SUCCESS;
 }
@@ -212,34 +363,83 @@ static void Destroy( vlc_object_t *p_this )
 
     picture_Release( p_sys->p_base_image );
     picture_Release( p_sys->p_blend_image );
+    free( p_sys );
 }
 
-/*****************************************************************************
- * Render: displays previously rendered output
- *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+/* Creates a blender from the blend image to the base one, with or without
+ * the line blenders */
+static filter_t *blendbench_NewBlender( filter_t *p_filter, bool b_lines )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
-
-    if( p_sys->b_done )
-        return p_pic;
-
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
+    filter_t *p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
         return NULL;
-    }
+
+    var_Create( p_blend, "blend-lines", VLC_VAR_BOOL );
+    var_SetBool( p_blend, "blend-lines", b_lines );
+
     p_blend->fmt_out.video = p_sys->p_base_image->format;
     p_blend->fmt_in.video = p_sys->p_blend_image->format;
+    if( p_blend->fmt_in.video.p_palette == NULL && p_sys->palette.i_entries > 0 )
+        p_blend->fmt_in.video.p_palette = &p_sys->palette;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
         vlc_object_release( p_blend );
         return NULL;
     }
+    return p_blend;
+}
+
+static void blendbench_DeleteBlender( filter_t *p_blend )
+{
+    module_unneed( p_blend, p_blend->p_module );
+    vlc_object_release( p_blend );
+}
+
+/* Blends once with both blenders on copies of the base image, and compares
+ * the results */
+static void blendbench_Check( filter_t *p_filter, filter_t *p_lines,
+                              filter_t *p_ref )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_out = picture_NewFromFormat( &p_sys->p_base_image->format );
+    picture_t *p_expected = picture_NewFromFormat( &p_sys->p_base_image->format );
+    if( p_out == NULL || p_expected == NULL )
+        goto end;
+
+    picture_Copy( p_out, p_sys->p_base_image );
+    picture_Copy( p_expected, p_sys->p_base_image );
+    p_lines->pf_video_blend( p_lines, p_out, p_sys->p_blend_image,
+                             0, 0, p_sys->i_alpha );
+    p_ref->pf_video_blend( p_ref, p_expected, p_sys->p_blend_image,
+                           0, 0, p_sys->i_alpha );
+
+    for( int i = 0; i < p_out->i_planes; i++ )
+    {
+        const plane_t *p = &p_out->p[i], *q = &p_expected->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            if( memcmp( &p->p_pixels[y * p->i_pitch],
+                        &q->p_pixels[y * q->i_pitch], p->i_visible_pitch ) )
+            {
+                msg_Err( p_filter, "Blending differs from the reference "
+                         "from plane %d line %d", i, y );
+                goto end;
+            }
+    }
+    msg_Info( p_filter, "Blending matches the reference" );
+end:
+    if( p_expected != NULL )
+        picture_Release( p_expected );
+    if( p_out != NULL )
+        picture_Release( p_out );
+}
+
+static void blendbench_Time( filter_t *p_filter, filter_t *p_blend,
+                             const char *psz_name )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
 
     mtime_t time = mdate();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
@@ -250,17 +450,43 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
     time = mdate() - time;
 
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              time / 1000000.0f );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * 1000000,
+    msg_Info( p_filter, "%s: blended %d images in %f sec", psz_name,
+              p_sys->i_loops, time / 1000000.0f );
+    msg_Info( p_filter, "%s: speed is: %f images/second, %f pixels/second",
+              psz_name, (float) p_sys->i_loops / time * 1000000,
               (float) p_sys->i_loops / time * 1000000 *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
                   p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+}
 
-    module_unneed( p_blend, p_blend->p_module );
+/*****************************************************************************
+ * Render: runs the benchmark on the first picture
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    vlc_object_release( p_blend );
+    if( p_sys->b_done )
+        return p_pic;
+
+    filter_t *p_lines = blendbench_NewBlender( p_filter, true );
+    filter_t *p_ref = blendbench_NewBlender( p_filter, false );
+    if( !p_lines || !p_ref )
+    {
+        if( p_lines )
+            blendbench_DeleteBlender( p_lines );
+        if( p_ref )
+            blendbench_DeleteBlender( p_ref );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    blendbench_Check( p_filter, p_lines, p_ref );
+    blendbench_Time( p_filter, p_lines, "lines" );
+    blendbench_Time( p_filter, p_ref, "reference" );
+
+    blendbench_DeleteBlender( p_ref );
+    blendbench_DeleteBlender( p_lines );
 
     p_sys->b_done = true;
     return p_pic;
@@ -47,6 +47,72 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+struct yadif_slice
+{
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    const plane_t *prevp;
+    const plane_t *curp;
+    const plane_t *nextp;
+    const plane_t *dstp;
+    int i_field;
+    int i_parity;
+};
+
+/* Renders the lines [start + 1, end + 1) of a plane, each from the lines
+ * above and below it in the three pictures */
+static void RenderYadifSlice( void *opaque, unsigned slice,
+                              int first, int start, int end )
+{
+    const struct yadif_slice *p = opaque;
+    const plane_t *prevp = p->prevp;
+    const plane_t *curp  = p->curp;
+    const plane_t *nextp = p->nextp;
+    const plane_t *dstp  = p->dstp;
+    VLC_UNUSED(slice); VLC_UNUSED(first);
+
+    for( int y = start + 1; y < end + 1; y++ )
+    {
+        if( (y % 2) == p->i_field  ||  p->i_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            p->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                       &prevp->p_pixels[y * prevp->i_pitch],
+                       &curp->p_pixels[y * curp->i_pitch],
+                       &nextp->p_pixels[y * nextp->i_pitch],
+                       dstp->i_visible_pitch,
+                       y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                       y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                       p->i_parity,
+                       mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+#if defined(HAVE_YADIF_MMX)
+    /* The thread may run the slices of other filters next */
+    if( p->filter == yadif_filter_line_mmx )
+        __asm__ volatile( "emms" );
+#endif
+}
+
 int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
                  int i_order, int i_field )
 {
@@ -130,46 +196,19 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
 
         for( int n = 0; n < p_dst->i_planes; n++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            struct yadif_slice slice = {
+                .filter = filter,
+                .prevp  = &p_prev->p[n],
+                .curp   = &p_cur->p[n],
+                .nextp  = &p_next->p[n],
+                .dstp   = &p_dst->p[n],
+                .i_field = i_field,
+                .i_parity = yadif_parity,
+            };
+
+            /* The first and last lines are copies */
+            filter_Slice( p_filter, RenderYadifSlice, &slice,
+                          slice.dstp->i_visible_lines - 2, 1, 0 );
         }
 
         p_sys->i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
@@ -35,6 +35,7 @@
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "gaussianblur.h"
 
 #include <math.h>                                          /* exp(), sqrt() */
 
@@ -76,18 +77,9 @@ static const char *const ppsz_filter_options[] = {
     "sigma", NULL
 };
 
-/* Comment this to use floats instead of integers (faster for bigger sigma
- * values)
- * For sigma = 2 ints are faster
- * For sigma = 4 floats are faster
- */
-#define DONT_USE_FLOATS
-
-#ifdef DONT_USE_FLOATS
-#   define type_t int
-#else
-#   define type_t float
-#endif
+/* The distribution is scaled by 256 and stored as integers, which the line
+ * kernels work on */
+#define type_t int32_t
 
 struct filter_sys_t
 {
@@ -97,6 +89,10 @@ struct filter_sys_t
     type_t *pt_distribution;
     type_t *pt_buffer;
     type_t *pt_scale;
+    type_t *pt_acc;
+
+    gaussianblur_taps_t taps[2]; /* horizontal taps of 1:1 and 2:1 planes */
+    gaussianblur_kernels_t kernels;
 };
 
 static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
@@ -109,11 +105,7 @@ static void gaussianblur_InitDistribution( filter_sys_t *p_sys )
     for( x = -i_dim; x <= i_dim; x++ )
     {
         const float f_distribution = sqrt( exp(-(x*x)/(f_sigma*f_sigma) ) / (2.*M_PI*f_sigma*f_sigma) );
-#ifdef DONT_USE_FLOATS
         const float f_factor = 1 << 8;
-#else
-        const float f_factor = 1;
-#endif
 
         pt_distribution[i_dim+x] = (type_t)( f_distribution * f_factor );
         //printf("%f\n",(float)pt_distribution[i_dim+x]);
@@ -166,8 +158,22 @@ static int Create( vlc_object_t *p_this )
     msg_Dbg( p_filter, "gaussian distribution is %d pixels wide",
              p_filter->p_sys->i_dim*2+1 );
 
+    for( int i = 0; i < 2; i++ )
+        if( gaussianblur_InitTaps( &p_filter->p_sys->taps[i],
+                                   p_filter->p_sys->pt_distribution,
+                                   p_filter->p_sys->i_dim, i ) )
+        {
+            if( i > 0 )
+                gaussianblur_CleanTaps( &p_filter->p_sys->taps[0] );
+            free( p_filter->p_sys->pt_distribution );
+            free( p_filter->p_sys );
+            return VLC_ENOMEM;
+        }
+    gaussianblur_GetKernels( &p_filter->p_sys->kernels );
+
     p_filter->p_sys->pt_buffer = NULL;
     p_filter->p_sys->pt_scale = NULL;
+    p_filter->p_sys->pt_acc = NULL;
 
     return VLC_SUCCESS;
 }
@@ -179,6 +185,9 @@ static void Destroy( vlc_object_t *p_this )
     free( p_filter->p_sys->pt_distribution );
     free( p_filter->p_sys->pt_buffer );
     free( p_filter->p_sys->pt_scale );
+    free( p_filter->p_sys->pt_acc );
+    gaussianblur_CleanTaps( &p_filter->p_sys->taps[0] );
+    gaussianblur_CleanTaps( &p_filter->p_sys->taps[1] );
 
     free( p_filter->p_sys );
 }
@@ -208,6 +217,15 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                                p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
     }
 
+    if( !p_sys->pt_acc )
+        p_sys->pt_acc = malloc( p_pic->p[Y_PLANE].i_pitch * sizeof( type_t ) );
+    if( !p_sys->pt_buffer || !p_sys->pt_acc )
+    {
+        picture_Release( p_outpic );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
     pt_buffer = p_sys->pt_buffer;
     if( !p_sys->pt_scale )
     {
@@ -258,6 +276,23 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         const int x_factor = p_pic->p[Y_PLANE].i_visible_pitch/i_visible_pitch-1;
         const int y_factor = p_pic->p[Y_PLANE].i_visible_lines/i_visible_lines-1;
 
+        /* The columns [i_first, i_last) see the whole distribution, and are
+         * filtered by the horizontal kernel */
+        const gaussianblur_taps_t *p_taps =
+            x_factor < 2 ? &p_sys->taps[x_factor] : NULL;
+        int i_first = 0, i_last = 0;
+        if( p_taps != NULL )
+        {
+            while( i_first*(x_factor+1) < i_dim )
+                i_first++;
+            i_last = i_visible_pitch;
+            while( i_last > i_first &&
+                   (i_visible_pitch - i_last + 1)*(x_factor+1) + 1 < i_dim )
+                i_last--;
+        }
+        const gaussianblur_divide_t pf_divide =
+            x_factor < 2 ? p_sys->kernels.pf_divide : gaussianblur_DivideC;
+
         for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
         {
             for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
@@ -265,6 +300,14 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                 type_t t_value = 0;
                 int x;
                 const int c = i_line*i_in_pitch+i_col;
+                if( i_col == i_first && i_last > i_first )
+                {
+                    p_sys->kernels.pf_horizontal( &pt_buffer[c],
+                                                  &p_in[c + p_taps->i_offset],
+                                                  i_last - i_first, p_taps );
+                    i_col = i_last - 1;
+                    continue;
+                }
                 for( x = __MAX( -i_dim, -i_col*(x_factor+1) );
                      x <= __MIN( i_dim, (i_visible_pitch - i_col)*(x_factor+1) + 1 );
                      x++ )
@@ -277,22 +320,34 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         }
         for( i_line = 0 ; i_line < i_visible_lines ; i_line++ )
         {
-            for( i_col = 0; i_col < i_visible_pitch ; i_col++ )
+            const int y_min = __MAX( -i_dim, (-i_line)*(y_factor+1) );
+            const int y_max = __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
+            const type_t *pt_row = NULL;
+            type_t t_weight = 0;
+
+            /* Sums the lines of the buffer weighted by the distribution, the
+             * weights of the luma lines sharing a chroma line together */
+            memset( p_sys->pt_acc, 0, i_visible_pitch * sizeof( type_t ) );
+            for( int y = y_min; y <= y_max; y++ )
             {
-                type_t t_value = 0;
-                int y;
-                const int c = i_line*i_in_pitch+i_col;
-                for( y = __MAX( -i_dim, (-i_line)*(y_factor+1) );
-                     y <= __MIN( i_dim, (i_visible_lines - i_line)*(y_factor+1) - 1 );
-                     y++ )
+                const type_t *pt = &pt_buffer[(i_line + (y>>y_factor))*i_in_pitch];
+                if( pt != pt_row && pt_row != NULL )
                 {
-                    t_value += pt_distribution[y+i_dim] *
-                               pt_buffer[c+(y>>y_factor)*i_in_pitch];
+                    p_sys->kernels.pf_accumulate( p_sys->pt_acc, pt_row,
+                                                  t_weight, i_visible_pitch );
+                    t_weight = 0;
                 }
-
-                const type_t t_scale = pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)+(i_col<<x_factor)];
-                p_out[i_line * p_outpic->p[i_plane].i_pitch + i_col] = (uint8_t)(t_value / t_scale); // FIXME wouldn't it be better to round instead of trunc ?
+                pt_row = pt;
+                t_weight += pt_distribution[y+i_dim];
             }
+            if( pt_row != NULL )
+                p_sys->kernels.pf_accumulate( p_sys->pt_acc, pt_row,
+                                              t_weight, i_visible_pitch );
+
+            pf_divide( &p_out[i_line * p_outpic->p[i_plane].i_pitch],
+                       p_sys->pt_acc,
+                       &pt_scale[(i_line<<y_factor)*(i_in_pitch<<x_factor)],
+                       x_factor, i_visible_pitch ); // FIXME wouldn't it be better to round instead of trunc ?
         }
     }
 
@@ -0,0 +1,549 @@
+/*****************************************************************************
+ * gaussianblur.h: gaussian blur line kernels
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_GAUSSIANBLUR_H_
+#define VLC_GAUSSIANBLUR_H_
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* Horizontal taps of a plane subsampled by 1 << i_factor: the distribution
+ * of the luma plane, with the weights of the samples sharing a chroma
+ * sample summed. */
+typedef struct
+{
+    int i_offset;          /* offset of the first tap */
+    int i_count;           /* number of taps */
+    int32_t *pi_weight;    /* weights of the taps */
+    /* weights of the taps 2k and 2k + 1 packed as 16 bits words, followed
+     * if i_count is odd by the last weight paired with a null weight for the
+     * previous tap; NULL if a weight does not fit in a signed word */
+    uint32_t *pi_pairs;
+} gaussianblur_taps_t;
+
+static inline int gaussianblur_InitTaps( gaussianblur_taps_t *p_taps,
+                                         const int32_t *pi_distribution,
+                                         int i_dim, int i_factor )
+{
+    const int i_first = -i_dim >> i_factor;
+    const int i_count = ( i_dim >> i_factor ) - i_first + 1;
+
+    p_taps->i_offset = i_first;
+    p_taps->i_count = i_count;
+    p_taps->pi_weight = calloc( i_count, sizeof( *p_taps->pi_weight ) );
+    p_taps->pi_pairs = malloc( ( i_count + 1 ) / 2 *
+                               sizeof( *p_taps->pi_pairs ) );
+    if( p_taps->pi_weight == NULL || p_taps->pi_pairs == NULL )
+    {
+        free( p_taps->pi_weight );
+        free( p_taps->pi_pairs );
+        return VLC_ENOMEM;
+    }
+
+    for( int x = -i_dim; x <= i_dim; x++ )
+        p_taps->pi_weight[(x >> i_factor) - i_first] += pi_distribution[x + i_dim];
+
+    bool b_words = i_count >= 2;
+    for( int i = 0; i < i_count; i++ )
+        if( p_taps->pi_weight[i] > INT16_MAX )
+            b_words = false;
+
+    if( !b_words )
+    {
+        free( p_taps->pi_pairs );
+        p_taps->pi_pairs = NULL;
+        return VLC_SUCCESS;
+    }
+
+    for( int i = 0; i + 1 < i_count; i += 2 )
+        p_taps->pi_pairs[i / 2] = p_taps->pi_weight[i]
+                                | p_taps->pi_weight[i + 1] << 16;
+    if( i_count & 1 )
+        p_taps->pi_pairs[i_count / 2] = p_taps->pi_weight[i_count - 1] << 16;
+    return VLC_SUCCESS;
+}
+
+static inline void gaussianblur_CleanTaps( gaussianblur_taps_t *p_taps )
+{
+    free( p_taps->pi_weight );
+    free( p_taps->pi_pairs );
+}
+
+/* Horizontal pass: p_out[i] = sum of the weight of tap t * p_in[i + t], for
+ * i below i_width, where p_in points to the first tap of the first pixel. */
+typedef void (*gaussianblur_horizontal_t)( int32_t *, const uint8_t *, int,
+                                           const gaussianblur_taps_t * );
+
+/* Vertical pass: p_acc[i] += i_weight * p_row[i], for i below i_width */
+typedef void (*gaussianblur_accumulate_t)( int32_t *, const int32_t *,
+                                           int32_t, int );
+
+/* Normalization: p_out[i] = (uint8_t)(p_acc[i] / p_scale[i << i_shift]),
+ * for i below i_width and i_shift 0 or 1 */
+typedef void (*gaussianblur_divide_t)( uint8_t *, const int32_t *,
+                                       const int32_t *, int, int );
+
+static inline void gaussianblur_HorizontalC( int32_t *p_out, const uint8_t *p_in,
+                                             int i_width,
+                                             const gaussianblur_taps_t *p_taps )
+{
+    for( int i = 0; i < i_width; i++ )
+    {
+        int32_t i_value = 0;
+
+        for( int t = 0; t < p_taps->i_count; t++ )
+            i_value += p_taps->pi_weight[t] * p_in[i + t];
+        p_out[i] = i_value;
+    }
+}
+
+static inline void gaussianblur_AccumulateC( int32_t *p_acc, const int32_t *p_row,
+                                             int32_t i_weight, int i_width )
+{
+    for( int i = 0; i < i_width; i++ )
+        p_acc[i] += i_weight * p_row[i];
+}
+
+static inline void gaussianblur_DivideC( uint8_t *p_out, const int32_t *p_acc,
+                                         const int32_t *p_scale, int i_shift,
+                                         int i_width )
+{
+    for( int i = 0; i < i_width; i++ )
+        p_out[i] = (uint8_t)( p_acc[i] / p_scale[i << i_shift] );
+}
+
+/* The SIMD divisions go through doubles: the quotients are pixel values, far
+ * too small for the rounding of a 53 bits mantissa to reach the next
+ * integer, so truncating them gives the integer division. */
+
+#ifdef CAN_COMPILE_SSE2
+/* Adds the products of the 8 pixels at %[p] and %[p] + 1 with the pair of
+ * weights at %[w] to the dwords of xmm4 and xmm5; xmm6 is zero */
+#define GAUSSIANBLUR_SSE2_PAIR \
+    "movd       (%[w]), %%xmm3 \n" \
+    "pshufd $0, %%xmm3, %%xmm3 \n" \
+    "movq       (%[p]), %%xmm0 \n" \
+    "movq      1(%[p]), %%xmm1 \n" \
+    "punpcklbw  %%xmm1, %%xmm0 \n" \
+    "movdqa     %%xmm0, %%xmm1 \n" \
+    "punpcklbw  %%xmm6, %%xmm0 \n" \
+    "punpckhbw  %%xmm6, %%xmm1 \n" \
+    "pmaddwd    %%xmm3, %%xmm0 \n" \
+    "pmaddwd    %%xmm3, %%xmm1 \n" \
+    "paddd      %%xmm0, %%xmm4 \n" \
+    "paddd      %%xmm1, %%xmm5 \n"
+
+VLC_SSE
+static inline void gaussianblur_HorizontalSSE2( int32_t *p_out,
+                                                const uint8_t *p_in,
+                                                int i_width,
+                                                const gaussianblur_taps_t *p_taps )
+{
+    const int i_simd = i_width & ~7;
+    const int i_odd = p_taps->i_count & 1;
+
+    if( p_taps->pi_pairs == NULL )
+    {
+        gaussianblur_HorizontalC( p_out, p_in, i_width, p_taps );
+        return;
+    }
+
+    for( int i = 0; i < i_simd; i += 8 )
+    {
+        const uint8_t *p = &p_in[i];
+        const uint32_t *w = p_taps->pi_pairs;
+        int n = p_taps->i_count / 2;
+
+        __asm__ volatile(
+            "pxor       %%xmm4, %%xmm4 \n"
+            "pxor       %%xmm5, %%xmm5 \n"
+            "pxor       %%xmm6, %%xmm6 \n"
+            "1: \n"
+            GAUSSIANBLUR_SSE2_PAIR
+            "add            $2, %[p] \n"
+            "add            $4, %[w] \n"
+            "dec          %[n] \n"
+            "jnz 1b \n"
+            "cmpl           $0, %[odd] \n"
+            "je 2f \n"
+            "dec          %[p] \n"
+            GAUSSIANBLUR_SSE2_PAIR
+            "2: \n"
+            "movdqu     %%xmm4,   (%[out]) \n"
+            "movdqu     %%xmm5, 16(%[out]) \n"
+            : [p]"+&r"(p), [w]"+&r"(w), [n]"+&r"(n)
+            : [out]"r"(&p_out[i]), [odd]"m"(i_odd)
+            : "xmm0", "xmm1", "xmm3", "xmm4", "xmm5", "xmm6", "memory"
+        );
+    }
+
+    gaussianblur_HorizontalC( p_out + i_simd, p_in + i_simd,
+                              i_width - i_simd, p_taps );
+}
+
+VLC_SSE
+static inline void gaussianblur_AccumulateSSE2( int32_t *p_acc,
+                                                const int32_t *p_row,
+                                                int32_t i_weight, int i_width )
+{
+    const int i_simd = i_width & ~3;
+    intptr_t x = -i_simd;
+
+    gaussianblur_AccumulateC( p_acc + i_simd, p_row + i_simd, i_weight,
+                              i_width - i_simd );
+    if( x == 0 )
+        return;
+
+    /* SSE2 has no 32 bits multiplication: the products of the even and odd
+     * dwords are computed separately in 64 bits */
+    __asm__ volatile(
+        "movd           %3, %%xmm3 \n"
+        "pshufd $0, %%xmm3, %%xmm3 \n"
+        "1: \n"
+        "movdqu (%2,%0,4), %%xmm0 \n"
+        "movdqa     %%xmm0, %%xmm1 \n"
+        "psrlq         $32, %%xmm1 \n"
+        "pmuludq    %%xmm3, %%xmm0 \n"
+        "pmuludq    %%xmm3, %%xmm1 \n"
+        "pshufd $0x08, %%xmm0, %%xmm0 \n"
+        "pshufd $0x08, %%xmm1, %%xmm1 \n"
+        "punpckldq  %%xmm1, %%xmm0 \n"
+        "movdqu (%1,%0,4), %%xmm1 \n"
+        "paddd      %%xmm1, %%xmm0 \n"
+        "movdqu     %%xmm0, (%1,%0,4) \n"
+        "add            $4, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(p_acc+i_simd), "r"(p_row+i_simd), "r"(i_weight)
+        :"xmm0", "xmm1", "xmm3", "memory"
+    );
+}
+
+/* Converts the 4 dwords of xmm0 and xmm2 to pairs of doubles and divides
+ * them, then stores the low bytes of the quotients at %[out] */
+#define GAUSSIANBLUR_SSE2_DIVIDE \
+    "cvtdq2pd   %%xmm0, %%xmm1 \n" \
+    "pshufd $0xee, %%xmm0, %%xmm0 \n" \
+    "cvtdq2pd   %%xmm0, %%xmm0 \n" \
+    "cvtdq2pd   %%xmm2, %%xmm3 \n" \
+    "pshufd $0xee, %%xmm2, %%xmm2 \n" \
+    "cvtdq2pd   %%xmm2, %%xmm2 \n" \
+    "divpd      %%xmm3, %%xmm1 \n" \
+    "divpd      %%xmm2, %%xmm0 \n" \
+    "cvttpd2dq  %%xmm1, %%xmm1 \n" \
+    "cvttpd2dq  %%xmm0, %%xmm0 \n" \
+    "punpcklqdq %%xmm0, %%xmm1 \n" \
+    "pand       %%xmm7, %%xmm1 \n" \
+    "packssdw   %%xmm1, %%xmm1 \n" \
+    "packuswb   %%xmm1, %%xmm1 \n" \
+    "movd       %%xmm1, (%[out],%[x]) \n" \
+    "add            $4, %[x] \n" \
+    "jl 1b \n"
+
+VLC_SSE
+static inline void gaussianblur_DivideSSE2( uint8_t *p_out, const int32_t *p_acc,
+                                            const int32_t *p_scale, int i_shift,
+                                            int i_width )
+{
+    const int i_simd = i_width & ~3;
+    intptr_t x = -i_simd;
+
+    gaussianblur_DivideC( p_out + i_simd, p_acc + i_simd,
+                          p_scale + ( i_simd << i_shift ), i_shift,
+                          i_width - i_simd );
+    if( x == 0 )
+        return;
+
+    p_out += i_simd;
+    p_acc += i_simd;
+    p_scale += i_simd << i_shift;
+
+    if( i_shift == 0 )
+        __asm__ volatile(
+            "pcmpeqd    %%xmm7, %%xmm7 \n"
+            "psrld         $24, %%xmm7 \n"
+            "1: \n"
+            "movdqu (%[acc],%[x],4), %%xmm0 \n"
+            "movdqu (%[scale],%[x],4), %%xmm2 \n"
+            GAUSSIANBLUR_SSE2_DIVIDE
+            : [x]"+&r"(x)
+            : [out]"r"(p_out), [acc]"r"(p_acc), [scale]"r"(p_scale)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm7", "memory"
+        );
+    else
+        __asm__ volatile(
+            "pcmpeqd    %%xmm7, %%xmm7 \n"
+            "psrld         $24, %%xmm7 \n"
+            "1: \n"
+            "movdqu (%[acc],%[x],4), %%xmm0 \n"
+            "movdqu   (%[scale],%[x],8), %%xmm2 \n"
+            "movdqu 16(%[scale],%[x],8), %%xmm3 \n"
+            "shufps $0x88, %%xmm3, %%xmm2 \n" // even scales
+            GAUSSIANBLUR_SSE2_DIVIDE
+            : [x]"+&r"(x)
+            : [out]"r"(p_out), [acc]"r"(p_acc), [scale]"r"(p_scale)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm7", "memory"
+        );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+/* Adds the products of the 16 pixels at %[p] and %[p] + 1 with the pair of
+ * weights at %[w] to the dwords of ymm4 (pixels 0-3 and 8-11) and ymm5
+ * (pixels 4-7 and 12-15), as the unpacks work per 128 bits lane */
+#define GAUSSIANBLUR_AVX2_PAIR \
+    "vpbroadcastd  (%[w]), %%ymm3 \n" \
+    "vpmovzxbw     (%[p]), %%ymm0 \n" \
+    "vpmovzxbw    1(%[p]), %%ymm1 \n" \
+    "vpunpcklwd %%ymm1, %%ymm0, %%ymm2 \n" \
+    "vpunpckhwd %%ymm1, %%ymm0, %%ymm0 \n" \
+    "vpmaddwd   %%ymm3, %%ymm2, %%ymm2 \n" \
+    "vpmaddwd   %%ymm3, %%ymm0, %%ymm0 \n" \
+    "vpaddd     %%ymm2, %%ymm4, %%ymm4 \n" \
+    "vpaddd     %%ymm0, %%ymm5, %%ymm5 \n"
+
+static inline void gaussianblur_HorizontalAVX2( int32_t *p_out,
+                                                const uint8_t *p_in,
+                                                int i_width,
+                                                const gaussianblur_taps_t *p_taps )
+{
+    const int i_simd = i_width & ~15;
+    const int i_odd = p_taps->i_count & 1;
+
+    if( p_taps->pi_pairs == NULL )
+    {
+        gaussianblur_HorizontalC( p_out, p_in, i_width, p_taps );
+        return;
+    }
+
+    for( int i = 0; i < i_simd; i += 16 )
+    {
+        const uint8_t *p = &p_in[i];
+        const uint32_t *w = p_taps->pi_pairs;
+        int n = p_taps->i_count / 2;
+
+        __asm__ volatile(
+            "vpxor      %%ymm4, %%ymm4, %%ymm4 \n"
+            "vpxor      %%ymm5, %%ymm5, %%ymm5 \n"
+            "1: \n"
+            GAUSSIANBLUR_AVX2_PAIR
+            "add            $2, %[p] \n"
+            "add            $4, %[w] \n"
+            "dec          %[n] \n"
+            "jnz 1b \n"
+            "cmpl           $0, %[odd] \n"
+            "je 2f \n"
+            "dec          %[p] \n"
+            GAUSSIANBLUR_AVX2_PAIR
+            "2: \n"
+            "vperm2i128 $0x20, %%ymm5, %%ymm4, %%ymm0 \n"
+            "vperm2i128 $0x31, %%ymm5, %%ymm4, %%ymm1 \n"
+            "vmovdqu    %%ymm0,   (%[out]) \n"
+            "vmovdqu    %%ymm1, 32(%[out]) \n"
+            : [p]"+&r"(p), [w]"+&r"(w), [n]"+&r"(n)
+            : [out]"r"(&p_out[i]), [odd]"m"(i_odd)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "memory"
+        );
+    }
+    /* avoid the AVX to SSE transition penalty in the caller */
+    __asm__ volatile( "vzeroupper" ::: "xmm0", "xmm1", "xmm2", "xmm3",
+                                       "xmm4", "xmm5" );
+
+    gaussianblur_HorizontalC( p_out + i_simd, p_in + i_simd,
+                              i_width - i_simd, p_taps );
+}
+
+static inline void gaussianblur_AccumulateAVX2( int32_t *p_acc,
+                                                const int32_t *p_row,
+                                                int32_t i_weight, int i_width )
+{
+    const int i_simd = i_width & ~7;
+    intptr_t x = -i_simd;
+
+    gaussianblur_AccumulateC( p_acc + i_simd, p_row + i_simd, i_weight,
+                              i_width - i_simd );
+    if( x == 0 )
+        return;
+
+    __asm__ volatile(
+        "vmovd              %3, %%xmm3 \n"
+        "vpbroadcastd   %%xmm3, %%ymm3 \n"
+        "1: \n"
+        "vpmulld (%2,%0,4), %%ymm3, %%ymm0 \n"
+        "vpaddd  (%1,%0,4), %%ymm0, %%ymm0 \n"
+        "vmovdqu    %%ymm0, (%1,%0,4) \n"
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        "vzeroupper \n"
+        :"+&r"(x)
+        :"r"(p_acc+i_simd), "r"(p_row+i_simd), "r"(i_weight)
+        :"xmm0", "xmm3", "memory"
+    );
+}
+
+/* Divides the 8 dwords at %[acc] by the ones in ymm2, stores the low bytes
+ * of the quotients at %[out] */
+#define GAUSSIANBLUR_AVX2_DIVIDE \
+    "vcvtdq2pd   (%[acc],%[x],4), %%ymm0 \n" \
+    "vcvtdq2pd 16(%[acc],%[x],4), %%ymm1 \n" \
+    "vextracti128 $1, %%ymm2, %%xmm3 \n" \
+    "vcvtdq2pd  %%xmm2, %%ymm2 \n" \
+    "vcvtdq2pd  %%xmm3, %%ymm3 \n" \
+    "vdivpd     %%ymm2, %%ymm0, %%ymm0 \n" \
+    "vdivpd     %%ymm3, %%ymm1, %%ymm1 \n" \
+    "vcvttpd2dq %%ymm0, %%xmm0 \n" \
+    "vcvttpd2dq %%ymm1, %%xmm1 \n" \
+    "vpand      %%xmm7, %%xmm0, %%xmm0 \n" \
+    "vpand      %%xmm7, %%xmm1, %%xmm1 \n" \
+    "vpackssdw  %%xmm1, %%xmm0, %%xmm0 \n" \
+    "vpackuswb  %%xmm0, %%xmm0, %%xmm0 \n" \
+    "vmovq      %%xmm0, (%[out],%[x]) \n" \
+    "add            $8, %[x] \n" \
+    "jl 1b \n" \
+    "vzeroupper \n"
+
+static inline void gaussianblur_DivideAVX2( uint8_t *p_out, const int32_t *p_acc,
+                                            const int32_t *p_scale, int i_shift,
+                                            int i_width )
+{
+    const int i_simd = i_width & ~7;
+    intptr_t x = -i_simd;
+
+    gaussianblur_DivideC( p_out + i_simd, p_acc + i_simd,
+                          p_scale + ( i_simd << i_shift ), i_shift,
+                          i_width - i_simd );
+    if( x == 0 )
+        return;
+
+    p_out += i_simd;
+    p_acc += i_simd;
+    p_scale += i_simd << i_shift;
+
+    if( i_shift == 0 )
+        __asm__ volatile(
+            "vpcmpeqd   %%xmm7, %%xmm7, %%xmm7 \n"
+            "vpsrld    $24, %%xmm7, %%xmm7 \n"
+            "1: \n"
+            "vmovdqu (%[scale],%[x],4), %%ymm2 \n"
+            GAUSSIANBLUR_AVX2_DIVIDE
+            : [x]"+&r"(x)
+            : [out]"r"(p_out), [acc]"r"(p_acc), [scale]"r"(p_scale)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm7", "memory"
+        );
+    else
+        __asm__ volatile(
+            "vpcmpeqd   %%xmm7, %%xmm7, %%xmm7 \n"
+            "vpsrld    $24, %%xmm7, %%xmm7 \n"
+            "1: \n"
+            "vmovdqu (%[scale],%[x],8), %%ymm2 \n"
+            "vshufps $0x88, 32(%[scale],%[x],8), %%ymm2, %%ymm2 \n"
+            "vpermq  $0xd8, %%ymm2, %%ymm2 \n" // even scales
+            GAUSSIANBLUR_AVX2_DIVIDE
+            : [x]"+&r"(x)
+            : [out]"r"(p_out), [acc]"r"(p_acc), [scale]"r"(p_scale)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm7", "memory"
+        );
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline void gaussianblur_HorizontalNEON( int32_t *p_out,
+                                                const uint8_t *p_in,
+                                                int i_width,
+                                                const gaussianblur_taps_t *p_taps )
+{
+    int i = 0;
+
+    if( p_taps->pi_pairs != NULL )
+        for( ; i + 8 <= i_width; i += 8 )
+        {
+            uint32x4_t lo = vdupq_n_u32( 0 ), hi = vdupq_n_u32( 0 );
+
+            for( int t = 0; t < p_taps->i_count; t++ )
+            {
+                const uint16x8_t pix = vmovl_u8( vld1_u8( &p_in[i + t] ) );
+                const uint16_t w = p_taps->pi_weight[t];
+
+                lo = vmlal_n_u16( lo, vget_low_u16( pix ), w );
+                hi = vmlal_n_u16( hi, vget_high_u16( pix ), w );
+            }
+            vst1q_s32( &p_out[i], vreinterpretq_s32_u32( lo ) );
+            vst1q_s32( &p_out[i + 4], vreinterpretq_s32_u32( hi ) );
+        }
+
+    gaussianblur_HorizontalC( p_out + i, p_in + i, i_width - i, p_taps );
+}
+
+static inline void gaussianblur_AccumulateNEON( int32_t *p_acc,
+                                                const int32_t *p_row,
+                                                int32_t i_weight, int i_width )
+{
+    int i = 0;
+
+    for( ; i + 4 <= i_width; i += 4 )
+        vst1q_s32( &p_acc[i], vmlaq_n_s32( vld1q_s32( &p_acc[i] ),
+                                           vld1q_s32( &p_row[i] ),
+                                           i_weight ) );
+
+    gaussianblur_AccumulateC( p_acc + i, p_row + i, i_weight, i_width - i );
+}
+#endif
+
+typedef struct
+{
+    gaussianblur_horizontal_t pf_horizontal;
+    gaussianblur_accumulate_t pf_accumulate;
+    gaussianblur_divide_t     pf_divide;
+} gaussianblur_kernels_t;
+
+static inline void gaussianblur_GetKernels( gaussianblur_kernels_t *p_kernels )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+    {
+        p_kernels->pf_horizontal = gaussianblur_HorizontalAVX2;
+        p_kernels->pf_accumulate = gaussianblur_AccumulateAVX2;
+        p_kernels->pf_divide = gaussianblur_DivideAVX2;
+        return;
+    }
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU_SSE2() )
+    {
+        p_kernels->pf_horizontal = gaussianblur_HorizontalSSE2;
+        p_kernels->pf_accumulate = gaussianblur_AccumulateSSE2;
+        p_kernels->pf_divide = gaussianblur_DivideSSE2;
+        return;
+    }
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    p_kernels->pf_horizontal = gaussianblur_HorizontalNEON;
+    p_kernels->pf_accumulate = gaussianblur_AccumulateNEON;
+#else
+    p_kernels->pf_horizontal = gaussianblur_HorizontalC;
+    p_kernels->pf_accumulate = gaussianblur_AccumulateC;
+#endif
+    p_kernels->pf_divide = gaussianblur_DivideC;
+}
+
+#endif
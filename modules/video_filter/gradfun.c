@@ -171,6 +171,30 @@ static void Close(vlc_object_t *object)
     free(sys);
 }
 
+struct slice
+{
+    struct vf_priv_s *cfg;
+    const plane_t    *src;
+    const plane_t    *dst;
+    int              width;
+    int              height;
+    int              radius;
+};
+
+static void FilterSlice(void *opaque, unsigned index,
+                        int first, int start, int end)
+{
+    const struct slice *slice = opaque;
+    struct vf_priv_s *cfg = slice->cfg;
+    VLC_UNUSED(first);
+
+    filter_plane(cfg, &cfg->buf[index * cfg->buf_size],
+                 slice->dst->p_pixels, slice->src->p_pixels,
+                 slice->width, slice->height,
+                 slice->dst->i_pitch, slice->src->i_pitch, slice->radius,
+                 start, end);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -192,8 +216,9 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
         cfg->radius = radius;
-        cfg->buf    = vlc_memalign(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        cfg->buf_size = ((((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) + 7) & ~7;
+        vlc_free(cfg->buf);
+        cfg->buf    = vlc_memalign(16, FILTER_SLICES_MAX * cfg->buf_size * sizeof(*cfg->buf));
     }
 
     for (int i = 0; i < dst->i_planes; i++) {
@@ -207,8 +232,15 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
         if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+            struct slice slice = {
+                .cfg = cfg,
+                .src = srcp,
+                .dst = dstp,
+                .width = w,
+                .height = h,
+                .radius = r,
+            };
+            filter_Slice(filter, FilterSlice, &slice, h, 1, 0);
         } else {
             plane_CopyPixels(dstp, srcp);
         }
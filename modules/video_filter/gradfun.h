@@ -31,7 +31,8 @@
 struct vf_priv_s {
     int thresh;
     int radius;
-    uint16_t *buf;
+    uint16_t *buf;      /* scratch memory of each slice */
+    size_t buf_size;
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -223,45 +224,67 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Blurs the next pair of lines into dc, for the output line y */
+static void blur_step(struct vf_priv_s *ctx, uint16_t *dc, uint16_t *buf,
+                      uint8_t *src, int width, int sstride, int r, int y)
 {
     int bstride = ((width+15)&~15)/2;
-    int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    int mod = ((y+r)/2)%r;
+    uint16_t *buf0 = buf+mod*bstride;
+    uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
+    int x, v;
+    ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
+    for (x=v=0; x<r; x++)
+        v += dc[x];
+    for (; x<width/2; x++) {
+        v += dc[x] - dc[x-r];
+        dc[x-r] = v * dc_factor >> 16;
+    }
+    for (; x<(width+r+1)/2; x++)
+        dc[x-r] = v * dc_factor >> 16;
+    for (x=-r/2; x<0; x++)
+        dc[x] = dc[0];
+}
+
+/* Filters the lines [start, end) of a plane, using the scratch memory buffer
+ * of (((width+15)&~15)*(r+1)/2+32) words.
+ *
+ * The blur of the lines y and y+1 is the box of the lines y-r+2 to y+r+1,
+ * the top r lines use the blur of the line r, and the bottom r lines the
+ * blur of the last line below height-r. It is the difference of two running
+ * sums of pairs of lines, which wrap around exactly, so a slice only needs
+ * to sum the r pairs of lines before its first blur. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buffer,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int start, int end)
+{
+    int bstride = ((width+15)&~15)/2;
+    int y, q, last, blurred;
+    uint16_t *dc = buffer+16;
+    uint16_t *buf = buffer+bstride+32;
     int thresh = ctx->thresh;
 
+    /* last output line with its own blur */
+    last = (height-r-1) & ~1;
+    blurred = __MIN(__MAX(start & ~1, r), last);
+
     memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
-    for (;;) {
-        if (y < height-r) {
-            int mod = ((y+r)/2)%r;
-            uint16_t *buf0 = buf+mod*bstride;
-            uint16_t *buf1 = buf+(mod?mod-1:r-1)*bstride;
-            int x, v;
-            ctx->blur_line(dc, buf0, buf1, src+(y+r)*sstride, sstride, width/2);
-            for (x=v=0; x<r; x++)
-                v += dc[x];
-            for (; x<width/2; x++) {
-                v += dc[x] - dc[x-r];
-                dc[x-r] = v * dc_factor >> 16;
-            }
-            for (; x<(width+r+1)/2; x++)
-                dc[x-r] = v * dc_factor >> 16;
-            for (x=-r/2; x<0; x++)
-                dc[x] = dc[0];
-        }
-        if (y == r) {
-            for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+    /* the running sum starts from zero below the first pair */
+    for (q=(blurred+r)/2-r; q<(blurred+r)/2; q++) {
+        int mod = q%r;
+        uint16_t *buf1 = q == (blurred+r)/2-r ? buf-bstride
+                                              : buf+(mod?mod-1:r-1)*bstride;
+        ctx->blur_line(dc, buf+mod*bstride, buf1, src+2*q*sstride, sstride, width/2);
+    }
+    blur_step(ctx, dc, buf, src, width, sstride, r, blurred);
+
+    for (y=start; y<end; y++) {
+        if ((y & ~1) > blurred && blurred < last) {
+            blurred += 2;
+            blur_step(ctx, dc, buf, src, width, sstride, r, blurred);
         }
         ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
     }
 }
-
@@ -53,6 +53,10 @@ static int DenoiseCallback( vlc_object_t *p_this, char const *psz_var,
 
 #define FILTER_PREFIX       "hqdn3d-"
 
+/* Lines primed before each slice: the spatial low pass is recursive, so
+ * slices only converge to the output of a single one */
+#define SLICE_OVERLAP       16
+
 #define LUMA_SPAT_TEXT          N_("Spatial luma strength (0-254)")
 #define CHROMA_SPAT_TEXT        N_("Spatial chroma strength (0-254)")
 #define LUMA_TEMP_TEXT          N_("Temporal luma strength (0-254)")
@@ -89,7 +93,7 @@ static const char *const filter_options[] = {
 struct filter_sys_t
 {
     const vlc_chroma_description_t *chroma;
-    int w[3], h[3];
+    int w[3], h[3], wmax;
 
     struct vf_priv_s cfg;
     bool   b_recalc_coefs;
@@ -137,11 +141,22 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
+    sys->wmax = wmax;
+    cfg->Line = malloc(FILTER_SLICES_MAX*wmax*sizeof(unsigned int));
     if (!cfg->Line) {
         free(sys);
         return VLC_ENOMEM;
     }
+#ifdef CAN_COMPILE_AVX2
+    if (vlc_CPU_AVX2()) {
+        cfg->Tile = malloc(FILTER_SLICES_MAX*TILE_LINES*wmax*sizeof(unsigned int));
+        if (!cfg->Tile) {
+            free(cfg->Line);
+            free(sys);
+            return VLC_ENOMEM;
+        }
+    }
+#endif
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
@@ -185,12 +200,39 @@ static void Close(vlc_object_t *this)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    free(cfg->Tile);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct slice
+{
+    filter_sys_t  *sys;
+    int            plane;
+    const plane_t *src;
+    const plane_t *dst;
+};
+
+static void FilterSlice(void *opaque, unsigned index,
+                        int first, int start, int end)
+{
+    const struct slice *slice = opaque;
+    filter_sys_t *sys = slice->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    const int i = slice->plane;
+    int *spat = cfg->Coefs[i ? 2 : 0];
+    int *temp = cfg->Coefs[i ? 3 : 1];
+
+    deNoise(slice->src->p_pixels, slice->dst->p_pixels,
+            &cfg->Line[index * sys->wmax],
+            cfg->Tile ? &cfg->Tile[index * TILE_LINES * sys->wmax] : NULL,
+            cfg->Frame[i], sys->w[i],
+            slice->src->i_pitch, slice->dst->i_pitch,
+            spat, spat, temp, first, start, end);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,24 +262,27 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    for (int i = 0; i < 3; ++i) {
+        if (!cfg->Frame[i])
+            cfg->Frame[i] = deNoiseInit(src->p[i].p_pixels, sys->w[i],
+                                        sys->h[i], src->p[i].i_pitch);
+        if (unlikely(!cfg->Frame[i])) {
+            picture_Release(dst);
+            picture_Release(src);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        struct slice slice = {
+            .sys   = sys,
+            .plane = i,
+            .src   = &src->p[i],
+            .dst   = &dst->p[i],
+        };
+        filter_Slice(filter, FilterSlice, &slice, sys->h[i], 1,
+                     SLICE_OVERLAP);
+    }
 
     return CopyInfoAndRelease(dst, src);
 }
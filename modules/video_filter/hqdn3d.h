@@ -24,6 +24,8 @@
 #include <inttypes.h>
 #include <math.h>
 
+#include <vlc_cpu.h>
+
 #define PARAM1_DEFAULT 4.0
 #define PARAM2_DEFAULT 3.0
 #define PARAM3_DEFAULT 6.0
@@ -32,7 +34,8 @@
 
 struct vf_priv_s {
         int Coefs[4][512*16];
-        unsigned int *Line;
+        unsigned int *Line;             /* one line per slice */
+        unsigned int *Tile;             /* one tile per slice, NULL without AVX2 */
         unsigned short *Frame[3];
 };
 
@@ -46,17 +49,263 @@ static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int Cur
     return CurrMul + Coef[d];
 }
 
+/* The low passes are recursive along the lines and through the frames, and
+ * each step looks its coefficient up in a table: the AVX2 kernels run the
+ * horizontal low passes of TILE_LINES lines side by side, with the pixels of
+ * the lines interleaved in a tile, then the vertical and temporal low passes
+ * of each line over 8 pixels at a time. The lookups are gathers. */
+#define TILE_LINES 16
+
+#ifdef CAN_COMPILE_AVX2
+static const int32_t TileIndex[8] = {
+    0, TILE_LINES, 2*TILE_LINES, 3*TILE_LINES,
+    4*TILE_LINES, 5*TILE_LINES, 6*TILE_LINES, 7*TILE_LINES,
+};
+
+/* d = ((Prev - Curr + 0x10007FF) >> 12) of the ymm registers Prev and Curr
+ * into ymm2, and Coef[d] into ymm3. The gathers merge into their destination,
+ * which is cleared not to depend on the previous gather. */
+#define LOW_PASS_AVX2(Prev, Curr, Coef) \
+    "vpsubd    %%"Curr", %%"Prev", %%ymm2 \n" \
+    "vpaddd    %%ymm7, %%ymm2, %%ymm2 \n" \
+    "vpsrld       $12, %%ymm2, %%ymm2 \n" \
+    "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n" \
+    "vpxor     %%ymm3, %%ymm3, %%ymm3 \n" \
+    "vpgatherdd %%ymm4, ("Coef",%%ymm2,4), %%ymm3 \n"
+
+/* Stores the 8 PixelDst of ymm0 to FrameAnt and FrameDest */
+#define TEMPORAL_STORE_AVX2 \
+    "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n" \
+    "vpsrld       $16, %%ymm4, %%ymm4 \n" \
+    "vpbroadcastd %[r8], %%ymm2 \n" \
+    "vpaddd    %%ymm2, %%ymm0, %%ymm1 \n" \
+    "vpsrld        $8, %%ymm1, %%ymm1 \n" \
+    "vpand     %%ymm4, %%ymm1, %%ymm1 \n" \
+    "vpackusdw %%ymm1, %%ymm1, %%ymm1 \n" \
+    "vpermq    $0x08, %%ymm1, %%ymm1 \n" \
+    "vmovdqu   %%xmm1, (%[ant]) \n" \
+    DEST_STORE_AVX2
+
+/* Stores the low bytes of (ymm0 + 0x10007FFF) >> 16 to FrameDest */
+#define DEST_STORE_AVX2 \
+    "vpbroadcastd %[r16], %%ymm2 \n" \
+    "vpaddd    %%ymm2, %%ymm0, %%ymm0 \n" \
+    "vpsrld       $16, %%ymm0, %%ymm0 \n" \
+    "vpsrld        $8, %%ymm4, %%ymm4 \n" \
+    "vpand     %%ymm4, %%ymm0, %%ymm0 \n" \
+    "vpackusdw %%ymm0, %%ymm0, %%ymm0 \n" \
+    "vpermq    $0x08, %%ymm0, %%ymm0 \n" \
+    "vpackuswb %%xmm0, %%xmm0, %%xmm0 \n" \
+    "vmovq     %%xmm0, (%[dst]) \n"
+
+/* Horizontal low pass of 8 lines, from the previous pixels in Prev and the
+ * source pixels at the offsets Index from p, into Prev */
+#define HORIZONTAL_AVX2(Prev, Index) \
+    "vmovdqu   "Index", %%ymm6 \n" \
+    "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n" \
+    "vpxor     %%ymm1, %%ymm1, %%ymm1 \n" \
+    "vpgatherdd %%ymm4, (%[p],%%ymm6,1), %%ymm1 \n" \
+    "vpsrld       $24, %%ymm1, %%ymm1 \n" \
+    "vpslld       $16, %%ymm1, %%ymm1 \n" \
+    LOW_PASS_AVX2(Prev, "ymm1", "%[h]") \
+    "vpaddd    %%ymm3, %%ymm1, %%"Prev" \n"
+
+static void deNoiseTemporalLineAVX2(
+                    unsigned char *Frame,
+                    unsigned char *FrameDest,
+                    unsigned short *FrameAnt,
+                    int W, int *Temporal)
+{
+    const uint32_t Round = 0x10007FF, Round8 = 0x1000007F, Round16 = 0x10007FFF;
+    long X;
+
+    for (X = 0; X + 8 <= W; X += 8)
+        __asm__ volatile(
+            "vpbroadcastd %[round], %%ymm7 \n"
+            "vpmovzxbd   (%[src]), %%ymm1 \n"
+            "vpslld       $16, %%ymm1, %%ymm1 \n"
+            "vpmovzxwd   (%[ant]), %%ymm0 \n"
+            "vpslld        $8, %%ymm0, %%ymm0 \n"
+            LOW_PASS_AVX2("ymm0", "ymm1", "%[t]")
+            "vpaddd    %%ymm3, %%ymm1, %%ymm0 \n"
+            TEMPORAL_STORE_AVX2
+            :
+            : [src]"r"(&Frame[X]), [dst]"r"(&FrameDest[X]),
+              [ant]"r"(&FrameAnt[X]), [t]"r"(Temporal),
+              [round]"m"(Round), [r8]"m"(Round8), [r16]"m"(Round16)
+            : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm7", "memory");
+    __asm__ volatile( "vzeroupper" ::: "xmm0", "xmm1", "xmm2", "xmm3",
+                                       "xmm4", "xmm7" );
+
+    for (; X < W; X++){
+        unsigned int PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+}
+
+/* Horizontal low passes of the TILE_LINES lines from Frame into Tile, where
+ * the pixel X of the line k is at Tile[X*TILE_LINES+k]. The two halves of
+ * the tile are independent recursions, which hides the gathers latency. */
+static void deNoiseHorizontalAVX2(
+                    unsigned int *Tile,
+                    unsigned char *Frame,
+                    int W, int sStride, int *Horizontal)
+{
+    const uint32_t Round = 0x10007FF;
+    int32_t Index[TILE_LINES];
+    long X, k;
+
+    /* The source pixels are gathered as the last byte of 32 bits words, so
+     * the first three are done here, without reading before the lines */
+    for (k = 0; k < TILE_LINES; k++){
+        unsigned int PixelAnt = Frame[k*sStride]<<16;
+        Tile[k] = PixelAnt;
+        for (X = 1; X < 3 && X < W; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[k*sStride+X]<<16, Horizontal);
+            Tile[X*TILE_LINES+k] = PixelAnt;
+        }
+        Index[k] = k*sStride - 3;
+    }
+    if (W <= 3)
+        return;
+
+    const unsigned char *p = &Frame[3];
+    unsigned int *t = &Tile[3*TILE_LINES];
+    long n = W - 3;
+
+    __asm__ volatile(
+        "vpbroadcastd %[round], %%ymm7 \n"
+        "vmovdqu  -64(%[t]), %%ymm0 \n"
+        "vmovdqu  -32(%[t]), %%ymm5 \n"
+        "1: \n"
+        HORIZONTAL_AVX2("ymm0", "(%[idx])")
+        "vmovdqu   %%ymm0,   (%[t]) \n"
+        HORIZONTAL_AVX2("ymm5", "32(%[idx])")
+        "vmovdqu   %%ymm5, 32(%[t]) \n"
+        "inc          %[p] \n"
+        "add          $64, %[t] \n"
+        "dec          %[n] \n"
+        "jnz 1b \n"
+        "vzeroupper \n"
+        : [p]"+&r"(p), [t]"+&r"(t), [n]"+&r"(n)
+        : [h]"r"(Horizontal), [idx]"r"(Index), [round]"m"(Round)
+        : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+          "memory");
+}
+
+/* Vertical low pass of the line k of a tile into LineAnt, then temporal low
+ * pass with FrameAnt if not NULL, into FrameDest */
+static void deNoiseVerticalAVX2(
+                    unsigned char *FrameDest,
+                    unsigned int *LineAnt,
+                    unsigned short *FrameAnt,
+                    const unsigned int *Tile, int k,
+                    int W, int *Vertical, int *Temporal)
+{
+    const uint32_t Round = 0x10007FF, Round8 = 0x1000007F, Round16 = 0x10007FFF;
+    long X;
+
+    for (X = 0; X + 8 <= W; X += 8){
+        if (FrameAnt)
+            __asm__ volatile(
+                "vmovdqu     %[idx], %%ymm6 \n"
+                "vpbroadcastd %[round], %%ymm7 \n"
+                "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n"
+                "vpxor     %%ymm1, %%ymm1, %%ymm1 \n"
+                "vpgatherdd %%ymm4, (%[tile],%%ymm6,4), %%ymm1 \n"
+                "vmovdqu  (%[line]), %%ymm0 \n"
+                LOW_PASS_AVX2("ymm0", "ymm1", "%[v]")
+                "vpaddd    %%ymm3, %%ymm1, %%ymm1 \n"
+                "vmovdqu   %%ymm1, (%[line]) \n"
+                "vpmovzxwd   (%[ant]), %%ymm0 \n"
+                "vpslld        $8, %%ymm0, %%ymm0 \n"
+                LOW_PASS_AVX2("ymm0", "ymm1", "%[t]")
+                "vpaddd    %%ymm3, %%ymm1, %%ymm0 \n"
+                TEMPORAL_STORE_AVX2
+                :
+                : [tile]"r"(&Tile[X*TILE_LINES+k]), [line]"r"(&LineAnt[X]),
+                  [ant]"r"(&FrameAnt[X]), [dst]"r"(&FrameDest[X]),
+                  [v]"r"(Vertical), [t]"r"(Temporal), [idx]"m"(TileIndex),
+                  [round]"m"(Round), [r8]"m"(Round8), [r16]"m"(Round16)
+                : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm6", "xmm7",
+                  "memory");
+        else
+            __asm__ volatile(
+                "vmovdqu     %[idx], %%ymm6 \n"
+                "vpbroadcastd %[round], %%ymm7 \n"
+                "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n"
+                "vpxor     %%ymm1, %%ymm1, %%ymm1 \n"
+                "vpgatherdd %%ymm4, (%[tile],%%ymm6,4), %%ymm1 \n"
+                "vmovdqu  (%[line]), %%ymm0 \n"
+                LOW_PASS_AVX2("ymm0", "ymm1", "%[v]")
+                "vpaddd    %%ymm3, %%ymm1, %%ymm0 \n"
+                "vmovdqu   %%ymm0, (%[line]) \n"
+                "vpcmpeqd  %%ymm4, %%ymm4, %%ymm4 \n"
+                "vpsrld       $16, %%ymm4, %%ymm4 \n"
+                DEST_STORE_AVX2
+                :
+                : [tile]"r"(&Tile[X*TILE_LINES+k]), [line]"r"(&LineAnt[X]),
+                  [dst]"r"(&FrameDest[X]), [v]"r"(Vertical),
+                  [idx]"m"(TileIndex), [round]"m"(Round), [r16]"m"(Round16)
+                : "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm6", "xmm7",
+                  "memory");
+    }
+    __asm__ volatile( "vzeroupper" ::: "xmm0", "xmm1", "xmm2", "xmm3",
+                                       "xmm4", "xmm6", "xmm7" );
+
+    for (; X < W; X++){
+        unsigned int PixelDst;
+        PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], Tile[X*TILE_LINES+k], Vertical);
+        if (FrameAnt){
+            PixelDst = LowPassMul(FrameAnt[X]<<8, LineAnt[X], Temporal);
+            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        }
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+}
+
+/* Filters the TILE_LINES lines from Y, FrameAnt is NULL without temporal
+ * low pass */
+static void deNoiseTile(unsigned char *Frame,
+                        unsigned char *FrameDest,
+                        unsigned int *LineAnt,
+                        unsigned short *FrameAnt,
+                        unsigned int *Tile,
+                        int W, int sStride, int dStride,
+                        int *Horizontal, int *Vertical, int *Temporal,
+                        int Y)
+{
+    deNoiseHorizontalAVX2(Tile, &Frame[Y*sStride], W, sStride, Horizontal);
+    for (int k = 0; k < TILE_LINES; k++)
+        deNoiseVerticalAVX2(&FrameDest[(Y+k)*dStride], LineAnt,
+                            FrameAnt ? &FrameAnt[(Y+k)*W] : NULL,
+                            Tile, k, W, Vertical, Temporal);
+}
+#endif
+
+/* Tile is only checked for NULL, the SIMD kernels are used otherwise */
 static void deNoiseTemporal(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned short *FrameAnt,
-                    int W, int H, int sStride, int dStride,
-                    int *Temporal)
+                    unsigned int *Tile,
+                    int W, int sStride, int dStride,
+                    int *Temporal, int Start, int End)
 {
     long X, Y;
     unsigned int PixelDst;
 
-    for (Y = 0; Y < H; Y++){
+    Frame += Start*sStride;
+    FrameDest += Start*dStride;
+    FrameAnt += Start*W;
+
+    for (Y = Start; Y < End; Y++){
+#ifdef CAN_COMPILE_AVX2
+        if (Tile)
+            deNoiseTemporalLineAVX2(Frame, FrameDest, FrameAnt, W, Temporal);
+        else
+#endif
         for (X = 0; X < W; X++){
             PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
             FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
@@ -68,29 +317,67 @@ static void deNoiseTemporal(
     }
 }
 
+/* Spatial low pass of a line into LineAnt, which holds the previous line,
+ * without output: primes LineAnt on the lines before a slice. */
+static void deNoiseSpacialLine(
+                    unsigned char *Frame,
+                    unsigned int *LineAnt,
+                    int W, int *Horizontal, int *Vertical)
+{
+    long X;
+    unsigned int PixelAnt = Frame[0]<<16;
+
+    LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+    for (X = 1; X < W; X++){
+        PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+    }
+}
+
+/* The lines [Start, End) are filtered. The vertical low pass is recursive,
+ * it starts on line First, and only the lines from Start are written. */
 static void deNoiseSpacial(
                     unsigned char *Frame,        // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+                    unsigned int *Tile,          // vf->priv->Tile or NULL
+                    int W, int sStride, int dStride,
+                    int *Horizontal, int *Vertical,
+                    int First, int Start, int End)
 {
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
+    long sLineOffs = First*sStride, dLineOffs = First*dStride;
     unsigned int PixelAnt;
     unsigned int PixelDst;
 
     /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
 
     /* First line has no top neighbor, only left. */
-    for (X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    for (X = 1; X < W; X++)
+        LineAnt[X] = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+
+    if (First == Start)
+        for (X = 0; X < W; X++)
+            FrameDest[dLineOffs+X]= ((LineAnt[X]+0x10007FFF)>>16);
+
+    for (Y = First + 1; Y < Start; Y++){
+        sLineOffs += sStride, dLineOffs += dStride;
+        deNoiseSpacialLine(&Frame[sLineOffs], LineAnt, W,
+                           Horizontal, Vertical);
     }
 
-    for (Y = 1; Y < H; Y++){
+    Y = __MAX(First + 1, Start);
+#ifdef CAN_COMPILE_AVX2
+    if (Tile)
+        for (; Y + TILE_LINES <= End; Y += TILE_LINES){
+            deNoiseTile(Frame, FrameDest, LineAnt, NULL, Tile,
+                        W, sStride, dStride, Horizontal, Vertical, NULL, Y);
+            sLineOffs += TILE_LINES*sStride, dLineOffs += TILE_LINES*dStride;
+        }
+#endif
+
+    for (; Y < End; Y++){
         unsigned int PixelAnt;
         sLineOffs += sStride, dLineOffs += dStride;
         /* First pixel on each line doesn't have previous pixel */
@@ -108,55 +395,90 @@ static void deNoiseSpacial(
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical, int *Temporal)
+/* Allocates the temporal state from the first frame */
+static unsigned short *deNoiseInit(unsigned char *Frame,
+                                   int W, int H, int sStride)
 {
     long X, Y;
-    long sLineOffs = 0, dLineOffs = 0;
-    unsigned int PixelAnt;
-    unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
+    unsigned short* FrameAnt=malloc(W*H*sizeof(unsigned short));
 
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
+    if (FrameAnt)
         for (Y = 0; Y < H; Y++){
             unsigned short* dst=&FrameAnt[Y*W];
             unsigned char* src=Frame+Y*sStride;
             for (X = 0; X < W; X++) dst[X]=src[X]<<8;
         }
-    }
+    return FrameAnt;
+}
+
+/* Same as deNoiseSpacial, with the temporal low pass of the lines
+ * [Start, End) with FrameAnt from deNoiseInit(). */
+static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+                    unsigned char *FrameDest,    // dmpi->planes[x]
+                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
+                    unsigned int *Tile,         // vf->priv->Tile or NULL
+                    unsigned short *FrameAnt,
+                    int W, int sStride, int dStride,
+                    int *Horizontal, int *Vertical, int *Temporal,
+                    int First, int Start, int End)
+{
+    long X, Y;
+    long sLineOffs = First*sStride, dLineOffs = First*dStride;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
 
     if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
+        deNoiseTemporal(Frame, FrameDest, FrameAnt, Tile,
+                        W, sStride, dStride, Temporal, Start, End);
         return;
     }
     if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
+        deNoiseSpacial(Frame, FrameDest, LineAnt, Tile,
+                       W, sStride, dStride, Horizontal, Vertical,
+                       First, Start, End);
         return;
     }
 
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+    if (First == Start){
+        unsigned short* LinePrev=&FrameAnt[Start*W];
 
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        /* First pixel has no left nor top neighbor. Only previous frame */
+        LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
+        PixelDst = LowPassMul(LinePrev[0]<<8, PixelAnt, Temporal);
+        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        /* First line has no top neighbor. Only left one for each pixel and
+         * last frame */
+        for (X = 1; X < W; X++){
+            LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            PixelDst = LowPassMul(LinePrev[X]<<8, PixelAnt, Temporal);
+            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+    } else {
+        LineAnt[0] = PixelAnt = Frame[sLineOffs]<<16;
+        for (X = 1; X < W; X++)
+            LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+
+        for (Y = First + 1; Y < Start; Y++){
+            sLineOffs += sStride, dLineOffs += dStride;
+            deNoiseSpacialLine(&Frame[sLineOffs], LineAnt, W,
+                               Horizontal, Vertical);
+        }
     }
 
-    for (Y = 1; Y < H; Y++){
+    Y = __MAX(First + 1, Start);
+#ifdef CAN_COMPILE_AVX2
+    if (Tile)
+        for (; Y + TILE_LINES <= End; Y += TILE_LINES){
+            deNoiseTile(Frame, FrameDest, LineAnt, FrameAnt, Tile,
+                        W, sStride, dStride, Horizontal, Vertical, Temporal, Y);
+            sLineOffs += TILE_LINES*sStride, dLineOffs += TILE_LINES*dStride;
+        }
+#endif
+
+    for (; Y < End; Y++){
         unsigned int PixelAnt;
         unsigned short* LinePrev=&FrameAnt[Y*W];
         sLineOffs += sStride, dLineOffs += dStride;
@@ -36,6 +36,7 @@
 #include <vlc_filter.h>
 #include <vlc_atomic.h>
 #include "filter_picture.h"
+#include "motionblur.h"
 
 /*****************************************************************************
  * Local protypes
@@ -82,6 +83,7 @@ struct filter_sys_t
     picture_t *p_tmp;
     bool      b_first;
     atomic_int i_factor;
+    motionblur_line_t pf_line;
 };
 
 /*****************************************************************************
@@ -108,6 +110,7 @@ static int Create( vlc_object_t *p_this )
         return VLC_ENOMEM;
     }
     p_filter->p_sys->b_first = true;
+    p_filter->p_sys->pf_line = motionblur_GetLine();
 
     p_filter->pf_video_filter = Filter;
 
@@ -180,28 +183,16 @@ static void RenderBlur( filter_sys_t *p_sys, picture_t *p_newpic,
 
     for( i_plane = 0; i_plane < p_outpic->i_planes; i_plane++ )
     {
-        uint8_t *p_old, *p_new, *p_out, *p_out_end, *p_out_line_end;
-        const int i_visible_pitch = p_outpic->p[i_plane].i_visible_pitch;
-        const int i_visible_lines = p_outpic->p[i_plane].i_visible_lines;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_new = p_newpic->p[i_plane].p_pixels;
-        p_old = p_sys->p_tmp->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch * i_visible_lines;
-        while ( p_out < p_out_end )
-        {
-            p_out_line_end = p_out + i_visible_pitch;
-
-            while ( p_out < p_out_line_end )
-            {
-                *p_out++ = (((*p_old++) * i_oldfactor) +
-                            ((*p_new++) * i_newfactor)) >> 7;
-            }
-
-            p_old += p_sys->p_tmp->p[i_plane].i_pitch - i_visible_pitch;
-            p_new += p_newpic->p[i_plane].i_pitch     - i_visible_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch     - i_visible_pitch;
-        }
+        const plane_t *p_old = &p_sys->p_tmp->p[i_plane];
+        const plane_t *p_new = &p_newpic->p[i_plane];
+        const plane_t *p_out = &p_outpic->p[i_plane];
+
+        for( int y = 0; y < p_out->i_visible_lines; y++ )
+            p_sys->pf_line( &p_out->p_pixels[y * p_out->i_pitch],
+                            &p_old->p_pixels[y * p_old->i_pitch],
+                            &p_new->p_pixels[y * p_new->i_pitch],
+                            p_out->i_visible_pitch,
+                            i_oldfactor, i_newfactor );
     }
 }
 
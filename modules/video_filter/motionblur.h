@@ -0,0 +1,185 @@
+/*****************************************************************************
+ * motionblur.h: motion blur line kernels
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MOTIONBLUR_H_
+#define VLC_MOTIONBLUR_H_
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* All the kernels below blend i_width pixels of an old and a new line:
+ * out = (old * i_oldfactor + new * i_newfactor) >> 7,
+ * with i_oldfactor + i_newfactor == 128. */
+typedef void (*motionblur_line_t)( uint8_t *, const uint8_t *,
+                                   const uint8_t *, int, int, int );
+
+static inline void motionblur_LineC( uint8_t *p_out, const uint8_t *p_old,
+                                     const uint8_t *p_new, int i_width,
+                                     int i_oldfactor, int i_newfactor )
+{
+    for( int i = 0; i < i_width; i++ )
+        p_out[i] = ( p_old[i] * i_oldfactor + p_new[i] * i_newfactor ) >> 7;
+}
+
+#ifdef CAN_COMPILE_SSE2
+VLC_SSE
+static inline void motionblur_LineSSE2( uint8_t *p_out, const uint8_t *p_old,
+                                        const uint8_t *p_new, int i_width,
+                                        int i_oldfactor, int i_newfactor )
+{
+    const int i_simd = i_width & ~15;
+    intptr_t x = -i_simd;
+
+    motionblur_LineC( p_out + i_simd, p_old + i_simd, p_new + i_simd,
+                      i_width - i_simd, i_oldfactor, i_newfactor );
+    if( x == 0 )
+        return;
+
+    /* The products are below 255 * 128, the 16 bits sums do not overflow */
+    __asm__ volatile(
+        "movd           %4, %%xmm6 \n"
+        "pshuflw $0,%%xmm6, %%xmm6 \n"
+        "punpcklqdq %%xmm6, %%xmm6 \n" // old factors
+        "movd           %5, %%xmm7 \n"
+        "pshuflw $0,%%xmm7, %%xmm7 \n"
+        "punpcklqdq %%xmm7, %%xmm7 \n" // new factors
+        "pxor       %%xmm5, %%xmm5 \n"
+        "1: \n"
+        "movdqu   (%2,%0), %%xmm0 \n"
+        "movdqu   (%3,%0), %%xmm1 \n"
+        "movdqa     %%xmm0, %%xmm2 \n"
+        "movdqa     %%xmm1, %%xmm3 \n"
+        "punpcklbw  %%xmm5, %%xmm0 \n"
+        "punpckhbw  %%xmm5, %%xmm2 \n"
+        "punpcklbw  %%xmm5, %%xmm1 \n"
+        "punpckhbw  %%xmm5, %%xmm3 \n"
+        "pmullw     %%xmm6, %%xmm0 \n"
+        "pmullw     %%xmm6, %%xmm2 \n"
+        "pmullw     %%xmm7, %%xmm1 \n"
+        "pmullw     %%xmm7, %%xmm3 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "paddw      %%xmm3, %%xmm2 \n"
+        "psrlw          $7, %%xmm0 \n"
+        "psrlw          $7, %%xmm2 \n"
+        "packuswb   %%xmm2, %%xmm0 \n"
+        "movdqu     %%xmm0, (%1,%0) \n"
+        "add           $16, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x)
+        :"r"(p_out+i_simd), "r"(p_old+i_simd), "r"(p_new+i_simd),
+         "r"(i_oldfactor), "r"(i_newfactor)
+        :"xmm0", "xmm1", "xmm2", "xmm3", "xmm5", "xmm6", "xmm7", "memory"
+    );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+static inline void motionblur_LineAVX2( uint8_t *p_out, const uint8_t *p_old,
+                                        const uint8_t *p_new, int i_width,
+                                        int i_oldfactor, int i_newfactor )
+{
+    const int i_simd = i_width & ~31;
+    intptr_t x = -i_simd;
+
+    motionblur_LineC( p_out + i_simd, p_old + i_simd, p_new + i_simd,
+                      i_width - i_simd, i_oldfactor, i_newfactor );
+    if( x == 0 )
+        return;
+
+    __asm__ volatile(
+        "vmovd              %4, %%xmm6 \n"
+        "vpbroadcastw   %%xmm6, %%ymm6 \n" // old factors
+        "vmovd              %5, %%xmm7 \n"
+        "vpbroadcastw   %%xmm7, %%ymm7 \n" // new factors
+        "1: \n"
+        "vpmovzxbw   (%2,%0), %%ymm0 \n"
+        "vpmovzxbw 16(%2,%0), %%ymm2 \n"
+        "vpmovzxbw   (%3,%0), %%ymm1 \n"
+        "vpmovzxbw 16(%3,%0), %%ymm3 \n"
+        "vpmullw   %%ymm6, %%ymm0, %%ymm0 \n"
+        "vpmullw   %%ymm6, %%ymm2, %%ymm2 \n"
+        "vpmullw   %%ymm7, %%ymm1, %%ymm1 \n"
+        "vpmullw   %%ymm7, %%ymm3, %%ymm3 \n"
+        "vpaddw    %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpaddw    %%ymm3, %%ymm2, %%ymm2 \n"
+        "vpsrlw        $7, %%ymm0, %%ymm0 \n"
+        "vpsrlw        $7, %%ymm2, %%ymm2 \n"
+        "vpackuswb %%ymm2, %%ymm0, %%ymm0 \n"
+        "vpermq    $0xd8, %%ymm0, %%ymm0 \n" // packs work per 128 bits lane
+        "vmovdqu   %%ymm0, (%1,%0) \n"
+        "add          $32, %0 \n"
+        "jl 1b \n"
+        "vzeroupper \n"
+        :"+&r"(x)
+        :"r"(p_out+i_simd), "r"(p_old+i_simd), "r"(p_new+i_simd),
+         "r"(i_oldfactor), "r"(i_newfactor)
+        :"xmm0", "xmm1", "xmm2", "xmm3", "xmm6", "xmm7", "memory"
+    );
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline void motionblur_LineNEON( uint8_t *p_out, const uint8_t *p_old,
+                                        const uint8_t *p_new, int i_width,
+                                        int i_oldfactor, int i_newfactor )
+{
+    const uint8x8_t oldfactor = vdup_n_u8( i_oldfactor );
+    const uint8x8_t newfactor = vdup_n_u8( i_newfactor );
+    int i = 0;
+
+    for( ; i + 16 <= i_width; i += 16 )
+    {
+        uint8x16_t old = vld1q_u8( p_old + i );
+        uint8x16_t new = vld1q_u8( p_new + i );
+        uint16x8_t lo = vmull_u8( vget_low_u8( old ), oldfactor );
+        uint16x8_t hi = vmull_u8( vget_high_u8( old ), oldfactor );
+
+        lo = vmlal_u8( lo, vget_low_u8( new ), newfactor );
+        hi = vmlal_u8( hi, vget_high_u8( new ), newfactor );
+        vst1q_u8( p_out + i, vcombine_u8( vshrn_n_u16( lo, 7 ),
+                                          vshrn_n_u16( hi, 7 ) ) );
+    }
+
+    motionblur_LineC( p_out + i, p_old + i, p_new + i, i_width - i,
+                      i_oldfactor, i_newfactor );
+}
+#endif
+
+static inline motionblur_line_t motionblur_GetLine( void )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+        return motionblur_LineAVX2;
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU_SSE2() )
+        return motionblur_LineSSE2;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return motionblur_LineNEON;
+#else
+    return motionblur_LineC;
+#endif
+}
+
+#endif
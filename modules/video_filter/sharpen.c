@@ -42,6 +42,7 @@
 
 #include <vlc_filter.h>
 #include "filter_picture.h"
+#include "sharpen.h"
 
 #define SIG_TEXT N_("Sharpen strength (0-2)")
 #define SIG_LONGTEXT N_("Set the Sharpen strength, between 0 and 2. Defaults to 0.05.")
@@ -90,6 +91,7 @@ struct filter_sys_t
 {
     vlc_mutex_t lock;
     int tab_precalc[512];
+    sharpen_line_t pf_line;
 };
 
 /*****************************************************************************
@@ -130,6 +132,7 @@ static int Create( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     p_filter->pf_video_filter = Filter;
+    p_filter->p_sys->pf_line = sharpen_GetLine();
 
     config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
                    p_filter->p_cfg );
@@ -170,14 +173,11 @@ static void Destroy( vlc_object_t *p_this )
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
-    int i, j;
+    int i;
     uint8_t *restrict p_src = NULL;
     uint8_t *restrict p_out = NULL;
     int i_src_pitch;
     int i_out_pitch;
-    int pix;
-    const int v1 = -1;
-    const int v2 = 3; /* 2^3 = 8 */
     const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
     const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
     const int sigma = var_GetFloat( p_filter, FILTER_PREFIX "sigma" ) * (1 << 20);
@@ -202,26 +202,17 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 
     memcpy(p_out, p_src, i_visible_pitch);
 
+    /* the kernels only handle the strengths of the option range */
+    sharpen_line_t pf_line = p_filter->p_sys->pf_line;
+    if( sigma < 0 || sigma > (2 << 20) )
+        pf_line = sharpen_LineC;
+
     for( i = 1; i < i_visible_lines - 1; i++ )
     {
         p_out[i * i_out_pitch] = p_src[i * i_src_pitch];
 
-        for( j = 1; j < i_visible_pitch - 1; j++ )
-        {
-            pix = (p_src[(i - 1) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i - 1) * i_src_pitch + j    ] * v1) +
-                  (p_src[(i - 1) * i_src_pitch + j + 1] * v1) +
-                  (p_src[(i    ) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i    ) * i_src_pitch + j    ] << v2) +
-                  (p_src[(i    ) * i_src_pitch + j + 1] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j - 1] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j    ] * v1) +
-                  (p_src[(i + 1) * i_src_pitch + j + 1] * v1);
-
-           pix = pix >= 0 ? clip(pix) : -clip(pix * -1);
-           p_out[i * i_out_pitch + j] = clip( p_src[i * i_src_pitch + j]
-                                              + ((pix * sigma) >> 20));
-        }
+        pf_line( &p_out[i * i_out_pitch + 1], &p_src[i * i_src_pitch + 1],
+                 i_src_pitch, i_visible_pitch - 2, sigma );
 
         p_out[i * i_out_pitch + i_visible_pitch - 1] =
             p_src[i * i_src_pitch + i_visible_pitch - 1];
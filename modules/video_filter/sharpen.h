@@ -0,0 +1,270 @@
+/*****************************************************************************
+ * sharpen.h: sharpen line kernels
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_SHARPEN_H_
+#define VLC_SHARPEN_H_
+
+#include <vlc_cpu.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+#endif
+
+/* All the kernels below sharpen i_width pixels of the line p_src, whose
+ * neighbours lie at p_src[-1] and p_src[i_width], and at i_pitch bytes
+ * above and below:
+ *   pix = 8 * center - the 8 neighbours, clipped to [-255, 255]
+ *   out = clip( center + ((pix * i_sigma) >> 20) )
+ * with i_sigma between 0 and 2 << 20. */
+typedef void (*sharpen_line_t)( uint8_t *, const uint8_t *, ptrdiff_t, int,
+                                int );
+
+static inline void sharpen_LineC( uint8_t *p_out, const uint8_t *p_src,
+                                  ptrdiff_t i_pitch, int i_width, int i_sigma )
+{
+    for( int i = 0; i < i_width; i++ )
+    {
+        const uint8_t *p = &p_src[i];
+        int pix = ( p[0] << 3 )
+                - p[-i_pitch - 1] - p[-i_pitch] - p[-i_pitch + 1]
+                - p[-1]                         - p[1]
+                - p[ i_pitch - 1] - p[ i_pitch] - p[ i_pitch + 1];
+
+        pix = VLC_CLIP( pix, -255, 255 );
+        p_out[i] = VLC_CLIP( p[0] + ( ( pix * i_sigma ) >> 20 ), 0, 255 );
+    }
+}
+
+/* pmaddwd computes pix * sigma exactly from 16 bits halves:
+ * sigma = hi << 15 | lo and pix * sigma = pix * lo + (pix << 7) * (hi << 8),
+ * where |pix << 7| and hi << 8 fit in signed words as |pix| <= 255 and
+ * sigma <= 1 << 21. */
+static inline uint32_t sharpen_SigmaWords( int i_sigma )
+{
+    return ( i_sigma & 0x7fff ) | ( ( i_sigma >> 15 ) << 24 );
+}
+
+#ifdef CAN_COMPILE_SSE2
+VLC_SSE
+static inline void sharpen_LineSSE2( uint8_t *p_out, const uint8_t *p_src,
+                                     ptrdiff_t i_pitch, int i_width,
+                                     int i_sigma )
+{
+    const int i_simd = i_width & ~7;
+    intptr_t x = -i_simd;
+
+    sharpen_LineC( p_out + i_simd, p_src + i_simd, i_pitch,
+                   i_width - i_simd, i_sigma );
+    if( x == 0 )
+        return;
+
+    const uint8_t *p_end = p_src + i_simd, *p;
+    const uint32_t i_words = sharpen_SigmaWords( i_sigma );
+    __asm__ volatile(
+        "movd           %5, %%xmm7 \n"
+        "pshufd $0, %%xmm7, %%xmm7 \n" // sigma words
+        "pxor       %%xmm6, %%xmm6 \n"
+        "pcmpeqw    %%xmm5, %%xmm5 \n"
+        "psrlw          $8, %%xmm5 \n" // 255
+        "1: \n"
+        "mov            %3, %1 \n"
+        "sub            %4, %1 \n"
+        "movq    -1(%1,%0), %%xmm0 \n"
+        "movq      (%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm0 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "movq     1(%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "add            %4, %1 \n"
+        "movq    -1(%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "movq     1(%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "movq      (%1,%0), %%xmm4 \n" // center
+        "add            %4, %1 \n"
+        "movq    -1(%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "movq      (%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "movq     1(%1,%0), %%xmm1 \n"
+        "punpcklbw  %%xmm6, %%xmm1 \n"
+        "paddw      %%xmm1, %%xmm0 \n"
+        "punpcklbw  %%xmm6, %%xmm4 \n"
+        "movdqa     %%xmm4, %%xmm1 \n"
+        "psllw          $3, %%xmm1 \n"
+        "psubw      %%xmm0, %%xmm1 \n" // pix
+        "pxor       %%xmm0, %%xmm0 \n"
+        "psubw      %%xmm5, %%xmm0 \n" // -255
+        "pminsw     %%xmm5, %%xmm1 \n"
+        "pmaxsw     %%xmm0, %%xmm1 \n"
+        "movdqa     %%xmm1, %%xmm0 \n"
+        "psllw          $7, %%xmm0 \n"
+        "movdqa     %%xmm1, %%xmm2 \n"
+        "punpcklwd  %%xmm0, %%xmm1 \n"
+        "punpckhwd  %%xmm0, %%xmm2 \n"
+        "pmaddwd    %%xmm7, %%xmm1 \n"
+        "pmaddwd    %%xmm7, %%xmm2 \n"
+        "psrad         $20, %%xmm1 \n"
+        "psrad         $20, %%xmm2 \n"
+        "packssdw   %%xmm2, %%xmm1 \n"
+        "paddw      %%xmm4, %%xmm1 \n"
+        "packuswb   %%xmm1, %%xmm1 \n"
+        "movq       %%xmm1, (%2,%0) \n"
+        "add            $8, %0 \n"
+        "jl 1b \n"
+        :"+&r"(x), "=&r"(p)
+        :"r"(p_out+i_simd), "r"(p_end), "r"(i_pitch),
+         "m"(i_words)
+        :"xmm0", "xmm1", "xmm2", "xmm4", "xmm5", "xmm6", "xmm7", "memory"
+    );
+}
+#endif
+
+#ifdef CAN_COMPILE_AVX2
+static inline void sharpen_LineAVX2( uint8_t *p_out, const uint8_t *p_src,
+                                     ptrdiff_t i_pitch, int i_width,
+                                     int i_sigma )
+{
+    const int i_simd = i_width & ~15;
+    intptr_t x = -i_simd;
+
+    sharpen_LineC( p_out + i_simd, p_src + i_simd, i_pitch,
+                   i_width - i_simd, i_sigma );
+    if( x == 0 )
+        return;
+
+    const uint8_t *p_end = p_src + i_simd, *p;
+    const uint32_t i_words = sharpen_SigmaWords( i_sigma );
+    __asm__ volatile(
+        "vmovd              %5, %%xmm7 \n"
+        "vpbroadcastd   %%xmm7, %%ymm7 \n" // sigma words
+        "vpcmpeqw   %%ymm5, %%ymm5, %%ymm5 \n"
+        "vpsrlw        $8, %%ymm5, %%ymm5 \n" // 255
+        "vpxor      %%ymm6, %%ymm6, %%ymm6 \n"
+        "vpsubw     %%ymm5, %%ymm6, %%ymm6 \n" // -255
+        "1: \n"
+        "mov            %3, %1 \n"
+        "sub            %4, %1 \n"
+        "vpmovzxbw -1(%1,%0), %%ymm0 \n"
+        "vpmovzxbw   (%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpmovzxbw  1(%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "add            %4, %1 \n"
+        "vpmovzxbw -1(%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpmovzxbw  1(%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpmovzxbw   (%1,%0), %%ymm4 \n" // center
+        "add            %4, %1 \n"
+        "vpmovzxbw -1(%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpmovzxbw   (%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpmovzxbw  1(%1,%0), %%ymm1 \n"
+        "vpaddw     %%ymm1, %%ymm0, %%ymm0 \n"
+        "vpsllw        $3, %%ymm4, %%ymm1 \n"
+        "vpsubw     %%ymm0, %%ymm1, %%ymm1 \n" // pix
+        "vpminsw    %%ymm5, %%ymm1, %%ymm1 \n"
+        "vpmaxsw    %%ymm6, %%ymm1, %%ymm1 \n"
+        "vpsllw        $7, %%ymm1, %%ymm0 \n"
+        "vpunpckhwd %%ymm0, %%ymm1, %%ymm2 \n"
+        "vpunpcklwd %%ymm0, %%ymm1, %%ymm1 \n"
+        "vpmaddwd   %%ymm7, %%ymm1, %%ymm1 \n"
+        "vpmaddwd   %%ymm7, %%ymm2, %%ymm2 \n"
+        "vpsrad       $20, %%ymm1, %%ymm1 \n"
+        "vpsrad       $20, %%ymm2, %%ymm2 \n"
+        "vpackssdw  %%ymm2, %%ymm1, %%ymm1 \n" // unpack and pack per lane
+        "vpaddw     %%ymm4, %%ymm1, %%ymm1 \n"
+        "vpackuswb  %%ymm1, %%ymm1, %%ymm1 \n"
+        "vpermq     $0x08, %%ymm1, %%ymm1 \n"
+        "vmovdqu    %%xmm1, (%2,%0) \n"
+        "add           $16, %0 \n"
+        "jl 1b \n"
+        "vzeroupper \n"
+        :"+&r"(x), "=&r"(p)
+        :"r"(p_out+i_simd), "r"(p_end), "r"(i_pitch),
+         "m"(i_words)
+        :"xmm0", "xmm1", "xmm2", "xmm4", "xmm5", "xmm6", "xmm7", "memory"
+    );
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline void sharpen_LineNEON( uint8_t *p_out, const uint8_t *p_src,
+                                     ptrdiff_t i_pitch, int i_width,
+                                     int i_sigma )
+{
+    const int16x8_t max = vdupq_n_s16( 255 );
+    const int16x8_t min = vdupq_n_s16( -255 );
+    int i = 0;
+
+    for( ; i + 8 <= i_width; i += 8 )
+    {
+        const uint8_t *p = &p_src[i];
+        uint16x8_t sum = vaddl_u8( vld1_u8( p - i_pitch - 1 ),
+                                   vld1_u8( p - i_pitch ) );
+        sum = vaddw_u8( sum, vld1_u8( p - i_pitch + 1 ) );
+        sum = vaddw_u8( sum, vld1_u8( p - 1 ) );
+        sum = vaddw_u8( sum, vld1_u8( p + 1 ) );
+        sum = vaddw_u8( sum, vld1_u8( p + i_pitch - 1 ) );
+        sum = vaddw_u8( sum, vld1_u8( p + i_pitch ) );
+        sum = vaddw_u8( sum, vld1_u8( p + i_pitch + 1 ) );
+
+        const int16x8_t center = vreinterpretq_s16_u16( vmovl_u8( vld1_u8( p ) ) );
+        int16x8_t pix = vsubq_s16( vshlq_n_s16( center, 3 ),
+                                   vreinterpretq_s16_u16( sum ) );
+        pix = vmaxq_s16( vminq_s16( pix, max ), min );
+
+        int32x4_t lo = vmulq_n_s32( vmovl_s16( vget_low_s16( pix ) ), i_sigma );
+        int32x4_t hi = vmulq_n_s32( vmovl_s16( vget_high_s16( pix ) ), i_sigma );
+        int16x8_t res = vcombine_s16( vmovn_s32( vshrq_n_s32( lo, 20 ) ),
+                                      vmovn_s32( vshrq_n_s32( hi, 20 ) ) );
+        vst1_u8( p_out + i, vqmovun_s16( vaddq_s16( res, center ) ) );
+    }
+
+    sharpen_LineC( p_out + i, p_src + i, i_pitch, i_width - i, i_sigma );
+}
+#endif
+
+static inline sharpen_line_t sharpen_GetLine( void )
+{
+#ifdef CAN_COMPILE_AVX2
+    if( vlc_CPU_AVX2() )
+        return sharpen_LineAVX2;
+#endif
+#ifdef CAN_COMPILE_SSE2
+    if( vlc_CPU_SSE2() )
+        return sharpen_LineSSE2;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return sharpen_LineNEON;
+#else
+    return sharpen_LineC;
+#endif
+}
+
+#endif
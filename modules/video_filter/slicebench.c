@@ -0,0 +1,325 @@
+/*****************************************************************************
+ * slicebench.c : slice threaded video filters benchmark plugin for vlc
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_modules.h>
+#include <vlc_cpu.h>
+
+#include <vlc_filter.h>
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int Create( vlc_object_t * );
+static void Destroy( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+
+#define LOOPS_TEXT N_("Number of pictures to filter")
+#define LOOPS_LONGTEXT N_("The number of pictures filtered for each number " \
+                          "of threads")
+
+#define FILTERS_TEXT N_("Video filters")
+#define FILTERS_LONGTEXT N_("The video filters to benchmark on I420 " \
+                            "pictures, separated by colons")
+
+#define CONVERSIONS_TEXT N_("Chroma conversions")
+#define CONVERSIONS_LONGTEXT N_("The chroma conversions to benchmark, as " \
+                                "input-output pairs of chromas separated " \
+                                "by colons")
+
+#define CFG_PREFIX "slicebench-"
+
+vlc_module_begin ()
+    set_description( N_("Slice threading benchmark filter") )
+    set_shortname( N_("Slicebench" ))
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter2", 0 )
+
+    set_section( N_("Benchmarking"), NULL )
+    add_integer( CFG_PREFIX "loops", 50, LOOPS_TEXT,
+                 LOOPS_LONGTEXT, false )
+    add_string( CFG_PREFIX "filters",
+                "adjust{hue=20}:gradfun:hqdn3d:deinterlace{mode=yadif}",
+                FILTERS_TEXT, FILTERS_LONGTEXT, false )
+    add_string( CFG_PREFIX "conversions", "I420-RV32:I420-RV16:I422-YUY2",
+                CONVERSIONS_TEXT, CONVERSIONS_LONGTEXT, false )
+
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "loops", "filters", "conversions", NULL
+};
+
+/* Picture sizes the filters are benchmarked at */
+static const struct
+{
+    unsigned i_width, i_height;
+} p_sizes[] = {
+    { 1920, 1080 },
+    { 3840, 2160 },
+};
+
+/*****************************************************************************
+ * filter_sys_t: filter method descriptor
+ *****************************************************************************/
+struct filter_sys_t
+{
+    bool b_done;
+    int i_loops;
+    char *psz_filters;
+    char *psz_conversions;
+};
+
+/*****************************************************************************
+ * Create: allocates video thread output method
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys;
+
+    /* Allocate structure */
+    p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
+    if( p_filter->p_sys == NULL )
+        return VLC_ENOMEM;
+
+    p_sys = p_filter->p_sys;
+    p_sys->b_done = false;
+
+    p_filter->pf_video_filter = Filter;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    p_sys->i_loops = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "loops" );
+    if( p_sys->i_loops < 1 )
+        p_sys->i_loops = 1;
+    p_sys->psz_filters = var_CreateGetString( p_filter,
+                                              CFG_PREFIX "filters" );
+    p_sys->psz_conversions = var_CreateGetString( p_filter,
+                                                  CFG_PREFIX "conversions" );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy video thread output method
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->psz_filters );
+    free( p_sys->psz_conversions );
+    free( p_sys );
+}
+
+static picture_t *slicebench_NewPicture( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+/* Fills a picture with a noisy gradient, so that the filters have work */
+static picture_t *slicebench_NewSource( vlc_fourcc_t i_chroma,
+                                        unsigned i_width, unsigned i_height )
+{
+    video_format_t fmt;
+
+    video_format_Setup( &fmt, i_chroma, i_width, i_height, i_width, i_height,
+                        1, 1 );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+        return NULL;
+
+    uint32_t i_seed = 0x1234567;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                i_seed = i_seed * 1103515245 + 12345;
+                p->p_pixels[y * p->i_pitch + x] =
+                    (x + y) / 8 + ((i_seed >> 16) & 7);
+            }
+    }
+    p_pic->b_progressive = false;
+    p_pic->i_nb_fields = 2;
+    return p_pic;
+}
+
+/* Runs one filter with 1 to the number of CPUs slice threads */
+static void slicebench_Run( filter_t *p_filter, const char *psz_name,
+                            config_chain_t *p_cfg,
+                            vlc_fourcc_t i_chroma_in,
+                            vlc_fourcc_t i_chroma_out,
+                            unsigned i_width, unsigned i_height )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    float f_base = 0.f;
+
+    picture_t *p_src = slicebench_NewSource( i_chroma_in, i_width, i_height );
+    if( p_src == NULL )
+        return;
+
+    unsigned i_max = vlc_GetCPUCount();
+    if( i_max > FILTER_SLICES_MAX )
+        i_max = FILTER_SLICES_MAX;
+
+    for( unsigned i_threads = 1; i_threads <= i_max; i_threads++ )
+    {
+        filter_t *p_bench = vlc_object_create( p_filter, sizeof(filter_t) );
+        if( p_bench == NULL )
+            break;
+
+        var_Create( p_bench, "filter-threads", VLC_VAR_INTEGER );
+        var_SetInteger( p_bench, "filter-threads", i_threads );
+
+        es_format_Init( &p_bench->fmt_in, VIDEO_ES, i_chroma_in );
+        video_format_Copy( &p_bench->fmt_in.video, &p_src->format );
+        es_format_Copy( &p_bench->fmt_out, &p_bench->fmt_in );
+        p_bench->fmt_out.i_codec =
+        p_bench->fmt_out.video.i_chroma = i_chroma_out;
+        p_bench->p_cfg = p_cfg;
+        p_bench->owner.video.buffer_new = slicebench_NewPicture;
+
+        p_bench->p_module = module_need( p_bench, "video filter2", psz_name,
+                                         psz_name != NULL );
+        if( p_bench->p_module == NULL )
+        {
+            msg_Err( p_filter, "cannot create %s %4.4s to %4.4s",
+                     psz_name ? psz_name : "converter",
+                     (const char *)&i_chroma_in, (const char *)&i_chroma_out );
+            es_format_Clean( &p_bench->fmt_in );
+            es_format_Clean( &p_bench->fmt_out );
+            vlc_object_release( p_bench );
+            break;
+        }
+
+        /* The first pictures fill the history of the temporal filters */
+        mtime_t time = 0;
+        for( int i_iter = -2; i_iter < p_sys->i_loops; i_iter++ )
+        {
+            if( i_iter == 0 )
+                time = mdate();
+
+            p_src->date = VLC_TS_0 + (i_iter + 2) * CLOCK_FREQ / 25;
+            picture_t *p_out = p_bench->pf_video_filter( p_bench,
+                                                         picture_Hold( p_src ) );
+            while( p_out != NULL )
+            {
+                picture_t *p_next = p_out->p_next;
+                picture_Release( p_out );
+                p_out = p_next;
+            }
+        }
+        time = mdate() - time;
+
+        module_unneed( p_bench, p_bench->p_module );
+        es_format_Clean( &p_bench->fmt_in );
+        es_format_Clean( &p_bench->fmt_out );
+        vlc_object_release( p_bench );
+
+        float f_fps = (float) p_sys->i_loops / time * CLOCK_FREQ;
+        if( i_threads == 1 )
+            f_base = f_fps;
+
+        msg_Info( p_filter, "%s %4.4s->%4.4s %ux%u: %u thread(s) "
+                  "%.1f pictures/second, x%.2f",
+                  psz_name ? psz_name : "converter",
+                  (const char *)&i_chroma_in, (const char *)&i_chroma_out,
+                  i_width, i_height, i_threads, f_fps, f_fps / f_base );
+    }
+
+    picture_Release( p_src );
+}
+
+/*****************************************************************************
+ * Render: runs the benchmark on the first picture
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
+
+    for( size_t i = 0; i < ARRAY_SIZE(p_sizes); i++ )
+    {
+        const unsigned w = p_sizes[i].i_width, h = p_sizes[i].i_height;
+
+        const char *psz = p_sys->psz_filters;
+        char *psz_buf = NULL;
+        while( psz != NULL && *psz != '\0' )
+        {
+            char *psz_name;
+            config_chain_t *p_cfg;
+            char *psz_next = config_ChainCreate( &psz_name, &p_cfg, psz );
+
+            free( psz_buf );
+            psz = psz_buf = psz_next;
+            if( psz_name == NULL )
+                continue;
+
+            slicebench_Run( p_filter, psz_name, p_cfg,
+                            VLC_CODEC_I420, VLC_CODEC_I420, w, h );
+            config_ChainDestroy( p_cfg );
+            free( psz_name );
+        }
+        free( psz_buf );
+
+        for( psz = p_sys->psz_conversions; psz != NULL && *psz != '\0'; )
+        {
+            char psz_in[5], psz_out[5];
+
+            if( sscanf( psz, "%4[^-:]-%4[^:]", psz_in, psz_out ) == 2 )
+                slicebench_Run( p_filter, NULL, NULL,
+                                vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                               psz_in ),
+                                vlc_fourcc_GetCodecFromString( VIDEO_ES,
+                                                               psz_out ),
+                                w, h );
+            psz = strchr( psz, ':' );
+            if( psz != NULL )
+                psz++;
+        }
+    }
+
+    p_sys->b_done = true;
+    return p_pic;
+}
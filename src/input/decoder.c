@@ -34,6 +34,7 @@
 #include <vlc_common.h>
 
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include <vlc_vout.h>
 #include <vlc_aout.h>
 #include <vlc_sout.h>
@@ -83,13 +84,15 @@ struct decoder_owner_sys_t
     vlc_meta_t     *p_description;
 
     /* fifo */
-    block_fifo_t *p_fifo;
+    block_ring_t *p_fifo;
+    unsigned      i_fifo_pace;
+    bool          b_fifo_overflow;
+    uint64_t      i_fifo_dropped; /* drops accounted in the input stats */
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
     vlc_cond_t  wait_acknowledge;
-    vlc_cond_t  wait_fifo; /* TODO: merge with wait_acknowledge */
 
     /* -- These variables need locking on write(only) -- */
     audio_output_t *p_aout;
@@ -112,7 +115,7 @@ struct decoder_owner_sys_t
 
     /* Flushing */
     bool b_flushing;
-    bool b_draining;
+    atomic_bool b_draining;
     bool b_drained;
     bool b_idle;
 
@@ -135,6 +138,9 @@ struct decoder_owner_sys_t
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION ((int)(0.200*CLOCK_FREQ))
 
+/* Maximum number of blocks waiting to be decoded */
+#define DECODER_FIFO_SLOTS 4096
+
 static void DecoderUpdateFormatLocked( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
@@ -842,8 +848,10 @@ static void DecoderGetCc( decoder_t *p_dec, decoder_t *p_dec_cc )
         if( !p_owner->cc.pp_decoder[i] )
             continue;
 
-        block_FifoPut( p_owner->cc.pp_decoder[i]->p_owner->p_fifo,
-            (i_cc_decoder > 1) ? block_Duplicate(p_cc) : p_cc);
+        block_t *p_dup = (i_cc_decoder > 1) ? block_Duplicate(p_cc) : p_cc;
+        if( p_dup != NULL )
+            block_RingPut( p_owner->cc.pp_decoder[i]->p_owner->p_fifo,
+                           p_dup, false );
 
         i_cc_decoder--;
         b_processed = true;
@@ -1404,6 +1412,7 @@ static void *DecoderThread( void *p_data )
 {
     decoder_t *p_dec = (decoder_t *)p_data;
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    bool b_drain = false;
 
     /* The decoder's main loop */
     vlc_mutex_lock( &p_owner->lock );
@@ -1411,31 +1420,36 @@ static void *DecoderThread( void *p_data )
     {
         block_t *p_block;
 
-        vlc_fifo_Lock( p_owner->p_fifo );
         vlc_cond_signal( &p_owner->wait_acknowledge );
         vlc_mutex_unlock( &p_owner->lock );
-        vlc_fifo_CleanupPush( p_owner->p_fifo );
-
-        vlc_cond_signal( &p_owner->wait_fifo );
 
-        while( vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        while( (p_block = block_RingGet( p_owner->p_fifo )) == NULL )
         {
-            if( p_owner->b_draining )
+            if( b_drain || atomic_exchange( &p_owner->b_draining, false ) )
             {   /* We have emptied the FIFO and there is a pending request to
-                 * drain. Pass p_block = NULL to decoder just once. */
-                p_owner->b_draining = false;
+                 * drain. A block may have been queued just before the
+                 * request though: decode what is left first, and only then
+                 * pass p_block = NULL to decoder just once. */
+                p_block = block_RingGet( p_owner->p_fifo );
+                b_drain = p_block != NULL;
                 break;
             }
 
+            vlc_mutex_lock( &p_owner->lock );
             p_owner->b_idle = true;
-            vlc_fifo_Wait( p_owner->p_fifo );
+            vlc_cond_signal( &p_owner->wait_acknowledge );
+            vlc_mutex_unlock( &p_owner->lock );
+
+            block_RingWait( p_owner->p_fifo );
             /* Make sure there is no cancellation point other than this one^^.
              * If you need one, be sure to push cleanup of p_block. */
+            vlc_mutex_lock( &p_owner->lock );
             p_owner->b_idle = false;
+            vlc_mutex_unlock( &p_owner->lock );
         }
 
-        p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
-        vlc_cleanup_run();
+        if( p_block != NULL && (p_block->i_flags & BLOCK_FLAG_CORE_FLUSH) )
+            b_drain = false; /* flush supersedes drain */
 
         int canc = vlc_savecancel();
         DecoderProcess( p_dec, p_block );
@@ -1524,14 +1538,34 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->b_has_data = false;
 
     p_owner->b_flushing = false;
-    p_owner->b_draining = false;
+    atomic_init( &p_owner->b_draining, false );
     p_owner->b_drained = false;
     p_owner->b_idle = false;
 
     es_format_Init( &p_owner->fmt, UNKNOWN_ES, 0 );
 
     /* decoder fifo */
-    p_owner->p_fifo = block_FifoNew();
+    int64_t i_fifo_size = var_InheritInteger( p_dec, "dec-fifo-size" );
+    int64_t i_fifo_duration = var_InheritInteger( p_dec, "dec-fifo-duration" );
+    char *psz_overflow = var_InheritString( p_dec, "dec-fifo-overflow" );
+    int i_overflow = BLOCK_RING_DROP_OLDEST;
+
+    if( psz_overflow != NULL )
+    {
+        if( !strcmp( psz_overflow, "drop-nonref" ) )
+            i_overflow = BLOCK_RING_DROP_NONREF;
+        else if( !strcmp( psz_overflow, "block" ) )
+            i_overflow = BLOCK_RING_BLOCK;
+        free( psz_overflow );
+    }
+
+    p_owner->p_fifo = block_RingNew( DECODER_FIFO_SLOTS,
+                                     __MAX(i_fifo_size, 0) * 1024,
+                                     __MAX(i_fifo_duration, 0) * 1000,
+                                     i_overflow );
+    p_owner->i_fifo_pace = var_InheritInteger( p_dec, "dec-fifo-pace" );
+    p_owner->b_fifo_overflow = false;
+    p_owner->i_fifo_dropped = 0;
     if( unlikely(p_owner->p_fifo == NULL) )
     {
         free( p_owner );
@@ -1542,7 +1576,6 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     vlc_mutex_init( &p_owner->lock );
     vlc_cond_init( &p_owner->wait_request );
     vlc_cond_init( &p_owner->wait_acknowledge );
-    vlc_cond_init( &p_owner->wait_fifo );
 
     /* Set buffers allocation callbacks for the decoders */
     p_dec->pf_aout_format_update = aout_update_format;
@@ -1636,10 +1669,16 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     msg_Dbg( p_dec, "killing decoder fourcc `%4.4s', %u PES in FIFO",
              (char*)&p_dec->fmt_in.i_codec,
-             (unsigned)block_FifoCount( p_owner->p_fifo ) );
+             (unsigned)block_RingCount( p_owner->p_fifo ) );
+
+    block_ring_stats_t stats;
+
+    block_RingGetStats( p_owner->p_fifo, &stats );
+    msg_Dbg( p_dec, "%"PRIu64" PES queued, %"PRIu64" dropped, "
+             "%"PRIu64" waits", stats.i_put, stats.i_dropped, stats.i_waits );
 
     /* Free all packets still in the decoder fifo. */
-    block_FifoRelease( p_owner->p_fifo );
+    block_RingRelease( p_owner->p_fifo );
 
     /* Cleanup */
     if( p_owner->p_aout )
@@ -1701,7 +1740,6 @@ static void DeleteDecoder( decoder_t * p_dec )
         vlc_object_release( p_owner->p_packetizer );
     }
 
-    vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
     vlc_cond_destroy( &p_owner->wait_request );
     vlc_mutex_destroy( &p_owner->lock );
@@ -1852,31 +1890,41 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
+     * Locking is not necessary as b_waiting is only read, not written by
+     * the decoder thread. */
+    const bool b_can_wait = !p_owner->b_waiting;
 
-    vlc_fifo_Lock( p_owner->p_fifo );
-    if( !b_do_pace )
+    if( b_do_pace && b_can_wait )
+        block_RingPace( p_owner->p_fifo, p_owner->i_fifo_pace );
+
+    if( block_RingPut( p_owner->p_fifo, p_block, b_can_wait ) )
     {
-        /* FIXME: ideally we would check the time amount of data
-         * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
-        {
+        if( !p_owner->b_fifo_overflow )
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
-                      "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
-        }
+                      "consumed quickly enough), dropping data!" );
+        p_owner->b_fifo_overflow = true;
     }
     else
-    if( !p_owner->b_waiting )
-    {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
-         * Locking is not necessary as b_waiting is only read, not written by
-         * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
-            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
-    }
+        p_owner->b_fifo_overflow = false;
+
+    /* Account the blocks dropped by the producer or, with the drop oldest
+     * policy, by the decoder thread */
+    input_thread_t *p_input = p_owner->p_input;
+    block_ring_stats_t stats;
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    block_RingGetStats( p_owner->p_fifo, &stats );
+    if( stats.i_dropped > p_owner->i_fifo_dropped )
+    {
+        if( p_input != NULL )
+        {
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            stats_Update( p_input->p->counters.p_dropped_packets,
+                          stats.i_dropped - p_owner->i_fifo_dropped, NULL );
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
+        p_owner->i_fifo_dropped = stats.i_dropped;
+    }
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -1885,7 +1933,7 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
 
     assert( !p_owner->b_waiting );
 
-    if( block_FifoCount( p_dec->p_owner->p_fifo ) > 0 )
+    if( block_RingCount( p_dec->p_owner->p_fifo ) > 0 )
         return false;
 
     bool b_empty;
@@ -1914,10 +1962,8 @@ void input_DecoderDrain( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    vlc_fifo_Lock( p_owner->p_fifo );
-    p_owner->b_draining = true;
-    vlc_fifo_Signal( p_owner->p_fifo );
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    atomic_store( &p_owner->b_draining, true );
+    block_RingWake( p_owner->p_fifo );
 }
 
 static void DecoderFlush( decoder_t *p_dec )
@@ -1926,21 +1972,17 @@ static void DecoderFlush( decoder_t *p_dec )
 
     vlc_assert_locked( &p_owner->lock );
 
-    vlc_fifo_Lock( p_owner->p_fifo );
-    /* Empty the fifo */
-    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
-    p_owner->b_draining = false; /* flush supersedes drain */
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    atomic_store( &p_owner->b_draining, false ); /* flush supersedes drain */
 
     /* Monitor for flush end */
     p_owner->b_flushing = true;
     vlc_cond_signal( &p_owner->wait_request );
 
-    /* Send a special block */
+    /* Empty the fifo, then send a special block */
     block_t *p_null = DecoderBlockFlushNew();
+    block_RingFlush( p_owner->p_fifo, p_null );
     if( !p_null )
         return;
-    input_DecoderDecode( p_dec, p_null, false );
 
     /* */
     while( p_owner->b_flushing )
@@ -2119,14 +2161,11 @@ void input_DecoderWait( decoder_t *p_dec )
     vlc_mutex_lock( &p_owner->lock );
     while( !p_owner->b_has_data )
     {
-        vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && block_RingCount( p_owner->p_fifo ) == 0 )
         {
             msg_Warn( p_dec, "can't wait without data to decode" );
-            vlc_fifo_Unlock( p_owner->p_fifo );
             break;
         }
-        vlc_fifo_Unlock( p_owner->p_fifo );
         vlc_cond_wait( &p_owner->wait_acknowledge, &p_owner->lock );
     }
     vlc_mutex_unlock( &p_owner->lock );
@@ -2189,7 +2228,7 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
-    return block_FifoSize( p_owner->p_fifo );
+    return block_RingSize( p_owner->p_fifo );
 }
 
 void input_DecoderGetObjects( decoder_t *p_dec,
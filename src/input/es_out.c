@@ -2600,6 +2600,10 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
         EsOutFrameNext( out );
         return VLC_SUCCESS;
 
+    case ES_OUT_SET_TIMESHIFT_OFFSET:
+        /* Nothing is buffered at this level */
+        return VLC_EGENERIC;
+
     case ES_OUT_SET_TIMES:
     {
         double f_position = (double)va_arg( args, double );
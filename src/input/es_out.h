@@ -82,6 +82,9 @@ enum es_out_query_private_e
 
     /* Set End Of Stream */
     ES_OUT_SET_EOS,                                 /* res=cannot fail */
+
+    /* Move the playback position inside the timeshift buffer */
+    ES_OUT_SET_TIMESHIFT_OFFSET,                    /* arg1=mtime_t i_offset    res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -143,6 +146,10 @@ static inline void es_out_SetTimes( es_out_t *p_out, double f_position, mtime_t
     int i_ret = es_out_Control( p_out, ES_OUT_SET_TIMES, f_position, i_time, i_length );
     assert( !i_ret );
 }
+static inline int es_out_SetTimeshiftOffset( es_out_t *p_out, mtime_t i_offset )
+{
+    return es_out_Control( p_out, ES_OUT_SET_TIMESHIFT_OFFSET, i_offset );
+}
 static inline void es_out_SetJitter( es_out_t *p_out,
                                      mtime_t i_pts_delay, mtime_t i_pts_jitter, int i_cr_average )
 {
@@ -35,7 +35,11 @@
 #  include <direct.h>
 #endif
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -83,7 +87,7 @@ typedef struct attribute_packed
 {
     es_out_id_t *p_es;
     block_t *p_block;
-    int     i_offset;  /* We do not use file > INT_MAX */
+    int     i_offset;  /* We do not use file > INT_MAX, -1 if the data is lost */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -150,6 +154,33 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Header stored in front of each block payload */
+typedef struct
+{
+    mtime_t  i_pts;
+    mtime_t  i_dts;
+    mtime_t  i_length;
+    uint32_t i_flags;
+    unsigned i_nb_samples;
+    size_t   i_buffer;
+} ts_block_header_t;
+
+/* Records are aligned so that headers can be read in place */
+#define TS_RECORD_ALIGN(x) (((x) + 15) & ~(size_t)15)
+
+/* Payloads at least that large are mapped instead of copied */
+#define TS_MMAP_BLOCK_MIN (64 * 1024)
+
+/* Maximal distance between two seek points */
+#define TS_INDEX_INTERVAL (CLOCK_FREQ)
+
+typedef struct
+{
+    mtime_t i_date;     /* Date of the indexed command */
+    mtime_t i_time;     /* Stream time when the command was pushed */
+    int     i_cmd;      /* Index of the command in its storage */
+} ts_index_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -157,16 +188,22 @@ struct ts_storage_t
 
     /* */
     char    *psz_file;  /* Filename */
+    int     fd;         /* File descriptor, -1 once the data is dropped */
     size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
+    size_t  i_file_size;/* Current size in bytes */
+    bool    b_mappable; /* Disk space is reserved, the file may be mapped */
+    uint8_t *p_map;     /* Shared mapping of the i_file_max first bytes */
 
     /* */
     int      i_cmd_r;
     int      i_cmd_w;
     int      i_cmd_max;
     ts_cmd_t *p_cmd;
+
+    /* Seek points, sorted by date */
+    int        i_index;
+    int        i_index_max;
+    ts_index_t *p_index;
 };
 
 typedef struct
@@ -175,6 +212,7 @@ typedef struct
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_total_size_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -194,12 +232,23 @@ typedef struct
     /* */
     mtime_t        i_buffering_delay;
 
-    /* */
+    /* Storages are chained from the oldest (already played and kept for
+     * rewinding) to the one being written */
+    ts_storage_t   *p_storage_first;
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_storage_size;
 
     mtime_t        i_cmd_delay;
 
+    /* Seek state */
+    mtime_t        i_cmd_date;      /* Date of the last popped command */
+    mtime_t        i_cmd_time;      /* Stream time of the last popped command */
+    mtime_t        i_push_time;     /* Stream time of the last pushed command */
+    mtime_t        i_barrier_date;  /* Date of the last command that cannot be replayed */
+    mtime_t        i_skip_date;     /* Commands older than this one are skipped */
+    unsigned       i_seek;          /* Incremented on each seek */
+
 } ts_thread_t;
 
 struct es_out_id_t
@@ -214,6 +263,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_total_size_max;  /* Maximal size of all temporary files */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -250,19 +300,27 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, mtime_t i_offset );
 
 static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
 static void         TsStorageDelete( ts_storage_t * );
+static void         TsStorageDrop( ts_storage_t * );
+static void         TsStorageMap( ts_storage_t * );
+static void         TsStorageUnmap( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, mtime_t i_time );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static int          TsStorageFind( ts_storage_t *, mtime_t i_date );
+static int          TsStorageFindTime( ts_storage_t *, mtime_t i_time );
 
 static void CmdClean( ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
+static bool CmdIsReplayable( const ts_cmd_t * );
+static bool CmdIsTimes( const ts_cmd_t * );
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
 static void CmdInitSend   ( ts_cmd_t *, es_out_id_t *, block_t * );
@@ -282,7 +340,7 @@ static int  CmdExecuteControl( es_out_t *, ts_cmd_t * );
 
 /* File helpers */
 static char *GetTmpPath( char *psz_path );
-static FILE *GetTmpFile( char **ppsz_file, const char *psz_path );
+static int   GetTmpFile( char **ppsz_file, const char *psz_path );
 
 /*****************************************************************************
  * input_EsOutTimeshiftNew:
@@ -330,11 +388,17 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     else
         p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
 
+    /* Keep room for at least the segment being read and the one being written */
+    const int64_t i_total_size_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    p_sys->i_total_size_max = __MAX( i_total_size_max * 1024 * 1024,
+                                     2 * p_sys->i_tmp_size_max );
+
     char *psz_tmp_path = var_CreateGetNonEmptyString( p_input, "input-timeshift-path" );
     p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
 
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
-             (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
+    msg_Dbg( p_input, "using timeshift granularity of %d MiB, up to %"PRId64" MiB, in path '%s'",
+             (int)p_sys->i_tmp_size_max/(1024*1024),
+             p_sys->i_total_size_max/(1024*1024), p_sys->psz_tmp_path );
 
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
@@ -563,6 +627,15 @@ static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
     msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
     return VLC_EGENERIC;
 }
+static int ControlLockedSetTimeshiftOffset( es_out_t *p_out, mtime_t i_offset )
+{
+    es_out_sys_t *p_sys = p_out->p_sys;
+
+    if( !p_sys->b_delayed )
+        return VLC_EGENERIC;
+
+    return TsSeek( p_sys->p_ts, i_offset );
+}
 static int ControlLockedSetFrameNext( es_out_t *p_out )
 {
     es_out_sys_t *p_sys = p_out->p_sys;
@@ -672,6 +745,12 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     {
         return ControlLockedSetFrameNext( p_out );
     }
+    case ES_OUT_SET_TIMESHIFT_OFFSET:
+    {
+        const mtime_t i_offset = (mtime_t)va_arg( args, mtime_t );
+
+        return ControlLockedSetTimeshiftOffset( p_out, i_offset );
+    }
     case ES_OUT_GET_PCR_SYSTEM:
     {
         if( p_sys->b_delayed )
@@ -741,6 +820,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_total_size_max = p_sys->i_total_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -754,8 +834,16 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->p_storage_first = NULL;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_storage_size = 0;
+    p_ts->i_cmd_date = -1;
+    p_ts->i_cmd_time = -1;
+    p_ts->i_push_time = -1;
+    p_ts->i_barrier_date = -1;
+    p_ts->i_skip_date = -1;
+    p_ts->i_seek = 0;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -798,18 +886,64 @@ static void TsStop( ts_thread_t *p_ts )
         CmdClean( &cmd );
     }
     assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    while( p_ts->p_storage_first )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_first->p_next;
+
+        TsStorageDelete( p_ts->p_storage_first );
+        p_ts->p_storage_first = p_next;
+    }
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
 }
+static void TsReclaimLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    while( p_ts->i_storage_size + p_ts->i_tmp_size_max > p_ts->i_total_size_max &&
+           p_ts->p_storage_first != p_ts->p_storage_w )
+    {
+        ts_storage_t *p_old = p_ts->p_storage_first;
+
+        if( p_old == p_ts->p_storage_r )
+        {
+            if( p_old->fd == -1 )
+                break;
+
+            /* Nothing left to rewind: drop what has not been played yet and
+             * jump to the next storage. The commands are kept as they may
+             * not all be skipped (ES creation/deletion...) */
+            const ts_storage_t *p_next = p_old->p_next;
+            if( !TsStorageIsEmpty( p_old ) && p_next->i_cmd_w > 0 )
+            {
+                const mtime_t i_next_date = p_next->p_cmd[0].i_date;
+
+                msg_Warn( p_ts->p_input, "es out timeshift: buffer full, dropping %"PRId64" ms",
+                          (i_next_date - p_old->p_cmd[p_old->i_cmd_r].i_date) / 1000 );
+                p_ts->i_cmd_delay -= i_next_date - p_old->p_cmd[p_old->i_cmd_r].i_date;
+                p_ts->i_skip_date = __MAX( p_ts->i_skip_date, i_next_date );
+            }
+            p_ts->i_storage_size -= p_old->i_file_max;
+            TsStorageDrop( p_old );
+            continue;
+        }
+
+        /* Forget the oldest played storage */
+        p_ts->p_storage_first = p_old->p_next;
+        if( p_old->fd != -1 )
+            p_ts->i_storage_size -= p_old->i_file_max;
+        TsStorageDelete( p_old );
+    }
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
 
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
+        TsReclaimLocked( p_ts );
+
         ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
 
         if( !p_storage )
@@ -819,21 +953,28 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
             /* TODO warn the user (but only once) */
             return;
         }
+        p_ts->i_storage_size += p_storage->i_file_max;
 
         if( !p_ts->p_storage_w )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+            p_ts->p_storage_first = p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
         {
             TsStoragePack( p_ts->p_storage_w );
+            if( p_ts->p_storage_w != p_ts->p_storage_r )
+                TsStorageUnmap( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
         }
     }
 
+    /* The stream time is the clock of the seek requests */
+    if( CmdIsTimes( p_cmd ) )
+        p_ts->i_push_time = p_cmd->u.control.u.times.i_time;
+
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->i_push_time );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -843,19 +984,28 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_assert_locked( &p_ts->lock );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+    if( TsStorageIsEmpty( p_storage ) )
         return VLC_EGENERIC;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+    /* Do not read the data of commands that will be skipped */
+    if( p_storage->p_cmd[p_storage->i_cmd_r].i_date < p_ts->i_skip_date )
+        b_flush = true;
 
-    while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
-    {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
+    TsStoragePopCmd( p_storage, p_cmd, b_flush );
+
+    p_ts->i_cmd_date = p_cmd->i_date;
+    if( CmdIsTimes( p_cmd ) )
+        p_ts->i_cmd_time = p_cmd->u.control.u.times.i_time;
+    if( !CmdIsReplayable( p_cmd ) )
+        p_ts->i_barrier_date = p_cmd->i_date;
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
+    /* Played storages are kept (unmapped) for rewinding */
+    while( TsStorageIsEmpty( p_ts->p_storage_r ) && p_ts->p_storage_r->p_next )
+    {
+        TsStorageUnmap( p_ts->p_storage_r );
+        p_ts->p_storage_r = p_ts->p_storage_r->p_next;
+        TsStorageMap( p_ts->p_storage_r );
     }
 
     return VLC_SUCCESS;
@@ -932,6 +1082,100 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
     return i_ret;
 }
 
+static int TsSeek( ts_thread_t *p_ts, mtime_t i_offset )
+{
+    vlc_mutex_lock( &p_ts->lock );
+
+    /* The offset is on the stream time, as the seek points are */
+    if( p_ts->i_cmd_date < 0 || p_ts->i_cmd_time < 0 )
+    {
+        vlc_mutex_unlock( &p_ts->lock );
+        return VLC_EGENERIC;
+    }
+
+    /* Find the last seek point before the target. Seek points before a
+     * command that cannot be replayed (ES creation/deletion...) are not
+     * usable. A target outside of what is kept is left to the demuxer */
+    const mtime_t i_target = p_ts->i_cmd_time + i_offset;
+    ts_storage_t *p_seek = NULL;
+    int i_seek = -1;
+    ts_storage_t *p_first = NULL;
+    int i_first = -1;
+
+    for( ts_storage_t *p_storage = p_ts->p_storage_first; p_storage; p_storage = p_storage->p_next )
+    {
+        if( p_storage->i_index <= 0 )
+            continue;
+
+        if( !p_first )
+        {
+            const int i = TsStorageFind( p_storage, p_ts->i_barrier_date ) + 1;
+            if( i < p_storage->i_index )
+            {
+                p_first = p_storage;
+                i_first = i;
+            }
+        }
+
+        const int i = TsStorageFindTime( p_storage, i_target );
+        if( i >= 0 && p_storage->p_index[i].i_date > p_ts->i_barrier_date )
+        {
+            p_seek = p_storage;
+            i_seek = i;
+        }
+    }
+    if( !p_seek || !p_first ||
+        i_target < p_first->p_index[i_first].i_time ||
+        i_target > p_ts->i_push_time )
+    {
+        vlc_mutex_unlock( &p_ts->lock );
+        return VLC_EGENERIC;
+    }
+
+    const ts_index_t *p_index = &p_seek->p_index[i_seek];
+
+    if( p_index->i_date <= p_ts->i_cmd_date )
+    {
+        /* Rewind: replay the storages from the seek point */
+        for( ts_storage_t *p_storage = p_seek; ; p_storage = p_storage->p_next )
+        {
+            p_storage->i_cmd_r = p_storage == p_seek ? p_index->i_cmd : 0;
+            if( p_storage == p_ts->p_storage_r )
+                break;
+        }
+        if( p_ts->p_storage_r != p_seek && p_ts->p_storage_r != p_ts->p_storage_w )
+            TsStorageUnmap( p_ts->p_storage_r );
+        p_ts->p_storage_r = p_seek;
+        TsStorageMap( p_seek );
+        p_ts->i_skip_date = -1;
+    }
+    else
+    {
+        /* Fast forward: skip all commands up to the seek point */
+        p_ts->i_skip_date = p_index->i_date;
+    }
+
+    msg_Dbg( p_ts->p_input, "es out timeshift: seeking by %"PRId64" ms",
+             (p_index->i_time - p_ts->i_cmd_time) / 1000 );
+
+    /* Keep the current pace from the new position */
+    p_ts->i_cmd_delay += p_ts->i_rate_delay;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_cmd_delay -= p_index->i_date - p_ts->i_cmd_date;
+    p_ts->i_cmd_date = p_index->i_date;
+    p_ts->i_cmd_time = p_index->i_time;
+    p_ts->i_seek++;
+
+    /* Reset the decoders and clock sync */
+    es_out_SetTime( p_ts->p_out, -1 );
+
+    vlc_cond_signal( &p_ts->wait );
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return VLC_SUCCESS;
+}
+
 static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
@@ -942,6 +1186,8 @@ static void *TsRun( void *p_data )
         ts_cmd_t cmd;
         mtime_t  i_deadline;
         bool b_buffering;
+        bool b_skip;
+        unsigned i_seek;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -954,13 +1200,23 @@ static void *TsRun( void *p_data )
 
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
             {
+                /* Skipped commands are dropped unless they cannot be replayed,
+                 * in which case they are executed without delay */
+                b_skip = cmd.i_date < p_ts->i_skip_date;
+                if( !b_skip || !CmdIsReplayable( &cmd ) )
+                {
+                    vlc_restorecancel( canc );
+                    break;
+                }
+                CmdClean( &cmd );
                 vlc_restorecancel( canc );
-                break;
+                continue;
             }
             vlc_restorecancel( canc );
 
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
+        i_seek = p_ts->i_seek;
 
         if( b_buffering && i_buffering_date < 0 )
         {
@@ -1010,6 +1266,8 @@ static void *TsRun( void *p_data )
             vlc_restorecancel( canc );
         }
         i_deadline = cmd.i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
+        if( b_skip )
+            i_deadline = VLC_TS_0;
 
         vlc_cleanup_run();
 
@@ -1021,6 +1279,17 @@ static void *TsRun( void *p_data )
 
         vlc_cleanup_pop();
 
+        /* Drop a command popped before a seek, it will be replayed if needed */
+        vlc_mutex_lock( &p_ts->lock );
+        const bool b_stale = i_seek != p_ts->i_seek;
+        vlc_mutex_unlock( &p_ts->lock );
+
+        if( b_stale && CmdIsReplayable( &cmd ) )
+        {
+            CmdClean( &cmd );
+            continue;
+        }
+
         /* Execute the command  */
         const int canc = vlc_savecancel();
         switch( cmd.i_type )
@@ -1065,9 +1334,16 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     /* */
     p_storage->i_file_max = i_tmp_size_max;
     p_storage->i_file_size = 0;
-    p_storage->p_filew = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
-    if( p_storage->psz_file )
-        p_storage->p_filer = vlc_fopen( p_storage->psz_file, "rb" );
+    p_storage->p_map = NULL;
+    p_storage->fd = GetTmpFile( &p_storage->psz_file, psz_tmp_path );
+
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_FALLOCATE)
+    /* Writing to a mapping of a sparse file would fault once the disk is
+     * full, so only map the file when its space could be reserved */
+    if( p_storage->fd != -1 )
+        p_storage->b_mappable = !posix_fallocate( p_storage->fd, 0, p_storage->i_file_max );
+#endif
+    TsStorageMap( p_storage );
 
     /* */
     p_storage->i_cmd_w = 0;
@@ -1076,7 +1352,12 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_cmd = malloc( p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
 
-    if( !p_storage->p_cmd || !p_storage->p_filew || !p_storage->p_filer )
+    /* */
+    p_storage->i_index = 0;
+    p_storage->i_index_max = 0;
+    p_storage->p_index = NULL;
+
+    if( !p_storage->p_cmd || p_storage->fd == -1 )
     {
         TsStorageDelete( p_storage );
         return NULL;
@@ -1094,23 +1375,112 @@ static void TsStorageDelete( ts_storage_t *p_storage )
         CmdClean( &cmd );
     }
     free( p_storage->p_cmd );
+    free( p_storage->p_index );
 
-    if( p_storage->p_filer )
-        fclose( p_storage->p_filer );
-    if( p_storage->p_filew )
-        fclose( p_storage->p_filew );
+    TsStorageDrop( p_storage );
 
+    free( p_storage );
+}
+static void TsStorageDrop( ts_storage_t *p_storage )
+{
+    /* Release the file, the commands are kept but their data is lost */
+    TsStorageUnmap( p_storage );
+    if( p_storage->fd != -1 )
+    {
+        close( p_storage->fd );
+        p_storage->fd = -1;
+    }
     if( p_storage->psz_file )
     {
         vlc_unlink( p_storage->psz_file );
         free( p_storage->psz_file );
+        p_storage->psz_file = NULL;
     }
 
-    free( p_storage );
+    for( int i = p_storage->i_cmd_r; i < p_storage->i_cmd_w; i++ )
+    {
+        if( p_storage->p_cmd[i].i_type == C_SEND )
+            p_storage->p_cmd[i].u.send.i_offset = -1;
+    }
+    p_storage->i_index = 0;
+}
+static void TsStorageMap( ts_storage_t *p_storage )
+{
+#ifdef HAVE_MMAP
+    if( p_storage->p_map || !p_storage->b_mappable || p_storage->fd == -1 )
+        return;
+
+    void *p_map = mmap( NULL, p_storage->i_file_max, PROT_READ|PROT_WRITE,
+                        MAP_SHARED, p_storage->fd, 0 );
+    if( p_map != MAP_FAILED )
+        p_storage->p_map = p_map;
+#else
+    VLC_UNUSED(p_storage);
+#endif
+}
+static void TsStorageUnmap( ts_storage_t *p_storage )
+{
+#ifdef HAVE_MMAP
+    /* Blocks handed to the decoders have their own mappings */
+    if( p_storage->p_map )
+        munmap( p_storage->p_map, p_storage->i_file_max );
+#endif
+    p_storage->p_map = NULL;
+}
+static int TsStorageWrite( ts_storage_t *p_storage, const void *p_data, size_t i_offset, size_t i_size )
+{
+    if( p_storage->p_map && i_offset + i_size <= p_storage->i_file_max )
+    {
+        memcpy( &p_storage->p_map[i_offset], p_data, i_size );
+        return VLC_SUCCESS;
+    }
+
+    /* No mapping, or oversized block */
+    if( lseek( p_storage->fd, i_offset, SEEK_SET ) != (off_t)i_offset )
+        return VLC_EGENERIC;
+    while( i_size > 0 )
+    {
+        const ssize_t i_ret = write( p_storage->fd, p_data, i_size );
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p_data = (const uint8_t *)p_data + i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
+}
+static int TsStorageRead( ts_storage_t *p_storage, void *p_data, size_t i_offset, size_t i_size )
+{
+    if( p_storage->p_map && i_offset + i_size <= p_storage->i_file_max )
+    {
+        memcpy( p_data, &p_storage->p_map[i_offset], i_size );
+        return VLC_SUCCESS;
+    }
+
+    if( lseek( p_storage->fd, i_offset, SEEK_SET ) != (off_t)i_offset )
+        return VLC_EGENERIC;
+    while( i_size > 0 )
+    {
+        const ssize_t i_ret = read( p_storage->fd, p_data, i_size );
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p_data = (uint8_t *)p_data + i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
 }
 static void TsStoragePack( ts_storage_t *p_storage )
 {
     /* Try to release a bit of memory */
+    if( p_storage->i_index > 0 && p_storage->i_index < p_storage->i_index_max )
+    {
+        ts_index_t *p_new = realloc( p_storage->p_index, p_storage->i_index * sizeof(*p_storage->p_index) );
+        if( p_new )
+        {
+            p_storage->p_index = p_new;
+            p_storage->i_index_max = p_storage->i_index;
+        }
+    }
+
     if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
         return;
 
@@ -1124,7 +1494,7 @@ static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = TS_RECORD_ALIGN( sizeof(ts_block_header_t) + p_cmd->u.send.p_block->i_buffer );
 
         if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
             return true;
@@ -1135,7 +1505,79 @@ static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
     return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+static void TsStorageIndex( ts_storage_t *p_storage, mtime_t i_date,
+                            mtime_t i_time, bool b_key )
+{
+    /* Without a stream time yet, there is nothing to seek to */
+    if( i_time < 0 )
+        return;
+
+    /* Seek points are placed on key frames when the demuxer flags them,
+     * and at a regular interval otherwise */
+    if( p_storage->i_index > 0 )
+    {
+        const ts_index_t *p_last = &p_storage->p_index[p_storage->i_index-1];
+
+        /* Keep the seek points sorted by stream time too */
+        if( i_time < p_last->i_time )
+            return;
+
+        const mtime_t i_delta = i_time - p_last->i_time;
+        if( i_delta < (b_key ? TS_INDEX_INTERVAL / 10 : TS_INDEX_INTERVAL) )
+            return;
+    }
+
+    if( p_storage->i_index >= p_storage->i_index_max )
+    {
+        const int i_max = __MAX( 2 * p_storage->i_index_max, 64 );
+        ts_index_t *p_new = realloc( p_storage->p_index, i_max * sizeof(*p_storage->p_index) );
+        if( !p_new )
+            return;
+        p_storage->p_index = p_new;
+        p_storage->i_index_max = i_max;
+    }
+
+    ts_index_t *p_index = &p_storage->p_index[p_storage->i_index++];
+    p_index->i_date = i_date;
+    p_index->i_time = i_time;
+    p_index->i_cmd = p_storage->i_cmd_w;
+}
+static int TsStorageFind( ts_storage_t *p_storage, mtime_t i_date )
+{
+    /* Return the last seek point not after i_date, or -1 */
+    int i_low = 0;
+    int i_high = p_storage->i_index;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = i_low + (i_high - i_low) / 2;
+
+        if( p_storage->p_index[i_mid].i_date <= i_date )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low - 1;
+}
+static int TsStorageFindTime( ts_storage_t *p_storage, mtime_t i_time )
+{
+    /* Return the last seek point not after the stream time i_time, or -1 */
+    int i_low = 0;
+    int i_high = p_storage->i_index;
+
+    while( i_low < i_high )
+    {
+        const int i_mid = i_low + (i_high - i_low) / 2;
+
+        if( p_storage->p_index[i_mid].i_time <= i_time )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low - 1;
+}
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd,
+                              mtime_t i_time )
 {
     ts_cmd_t cmd = *p_cmd;
 
@@ -1144,63 +1586,92 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
+        const ts_block_header_t hdr = {
+            .i_pts = p_block->i_pts,
+            .i_dts = p_block->i_dts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+            .i_buffer = p_block->i_buffer,
+        };
+        const size_t i_offset = p_storage->i_file_size;
 
         cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
+        cmd.u.send.i_offset = -1;
 
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
-        {
-            block_Release( p_block );
-            return;
-        }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
+        if( !TsStorageWrite( p_storage, &hdr, i_offset, sizeof(hdr) ) &&
+            !TsStorageWrite( p_storage, p_block->p_buffer,
+                             i_offset + sizeof(hdr), p_block->i_buffer ) )
         {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
+            cmd.u.send.i_offset = i_offset;
+            p_storage->i_file_size = TS_RECORD_ALIGN( i_offset + sizeof(hdr) + p_block->i_buffer );
+
+            TsStorageIndex( p_storage, cmd.i_date, i_time,
+                            p_block->i_flags & BLOCK_FLAG_TYPE_I );
         }
-        p_storage->i_file_size += p_block->i_buffer;
         block_Release( p_block );
-
-        if( b_flush )
-            fflush( p_storage->p_filew );
     }
     p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
 }
-static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
+static block_t *TsStorageReadBlock( ts_storage_t *p_storage, int i_offset )
 {
-    assert( !TsStorageIsEmpty( p_storage ) );
+    ts_block_header_t hdr;
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
-    if( p_cmd->i_type == C_SEND )
-    {
-        block_t block;
+    if( i_offset < 0 || TsStorageRead( p_storage, &hdr, i_offset, sizeof(hdr) ) )
+        return NULL;
+
+    const size_t i_data = i_offset + sizeof(hdr);
+    block_t *p_block = NULL;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+#ifdef HAVE_MMAP
+    /* Hand large payloads over without copying them. The block owns its
+     * private mapping, so it outlives the storage */
+    if( hdr.i_buffer >= TS_MMAP_BLOCK_MIN )
+    {
+        const size_t i_page = sysconf( _SC_PAGESIZE );
+        const size_t i_start = i_data & ~(i_page - 1);
+        const size_t i_length = i_data - i_start + hdr.i_buffer;
+
+        p_block = block_mmap_Alloc( mmap( NULL, i_length, PROT_READ|PROT_WRITE,
+                                          MAP_PRIVATE, p_storage->fd, i_start ),
+                                    i_length );
+        if( p_block )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
-            {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
-            }
-            p_cmd->u.send.p_block = p_block;
+            p_block->p_buffer += i_data - i_start;
+            p_block->i_buffer = hdr.i_buffer;
         }
-        else
+    }
+#endif
+    if( !p_block )
+    {
+        p_block = block_Alloc( hdr.i_buffer );
+        if( !p_block )
+            return NULL;
+        if( TsStorageRead( p_storage, p_block->p_buffer, i_data, hdr.i_buffer ) )
         {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            block_Release( p_block );
+            return NULL;
         }
     }
+
+    p_block->i_dts      = hdr.i_dts;
+    p_block->i_pts      = hdr.i_pts;
+    p_block->i_flags    = hdr.i_flags;
+    p_block->i_length   = hdr.i_length;
+    p_block->i_nb_samples = hdr.i_nb_samples;
+    return p_block;
+}
+static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
+{
+    assert( !TsStorageIsEmpty( p_storage ) );
+
+    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
+    if( p_cmd->i_type == C_SEND )
+    {
+        p_cmd->u.send.p_block = NULL;
+        if( !b_flush )
+            p_cmd->u.send.p_block = TsStorageReadBlock( p_storage, p_cmd->u.send.i_offset );
+    }
 }
 
 /*****************************************************************************
@@ -1227,6 +1698,38 @@ static void CmdClean( ts_cmd_t *p_cmd )
     }
 }
 
+static bool CmdIsTimes( const ts_cmd_t *p_cmd )
+{
+    return p_cmd->i_type == C_CONTROL &&
+           p_cmd->u.control.i_query == ES_OUT_SET_TIMES;
+}
+
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    /* Commands that do not own anything and do not change the set of ES can
+     * be executed again after a rewind or dropped by a fast forward */
+    switch( p_cmd->i_type )
+    {
+    case C_SEND:
+        return true;
+    case C_CONTROL:
+        switch( p_cmd->u.control.i_query )
+        {
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        case ES_OUT_SET_TIMES:
+        case ES_OUT_SET_JITTER:
+            return true;
+        default:
+            return false;
+        }
+    default:
+        return false;
+    }
+}
+
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
     p_cmd->i_type = C_ADD;
@@ -1586,29 +2089,19 @@ static char *GetTmpPath( char *psz_path )
     return psz_path;
 }
 
-static FILE *GetTmpFile( char **ppsz_file, const char *psz_path )
+static int GetTmpFile( char **ppsz_file, const char *psz_path )
 {
     char *psz_name;
     int fd;
-    FILE *f;
 
     /* */
     *ppsz_file = NULL;
     if( asprintf( &psz_name, "%s"DIR_SEP"vlc-timeshift.XXXXXX", psz_path ) < 0 )
-        return NULL;
+        return -1;
 
     /* */
     fd = vlc_mkstemp( psz_name );
     *ppsz_file = psz_name;
 
-    if( fd < 0 )
-        return NULL;
-
-    /* */
-    f = fdopen( fd, "w+b" );
-    if( !f )
-        close( fd );
-
-    return f;
+    return fd;
 }
-
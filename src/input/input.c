@@ -369,6 +369,7 @@ static input_thread_t *Create( vlc_object_t *p_parent, input_item_t *p_item,
     p_input->p->input.b_can_rate_control = true;
     p_input->p->input.b_rescale_ts = true;
     p_input->p->input.b_eof = false;
+    p_input->p->input.i_dropped = 0;
 
     vlc_mutex_lock( &p_item->lock );
 
@@ -660,6 +661,22 @@ static void MainLoopStatistics( input_thread_t *p_input )
 
     es_out_SetTimes( p_input->p->p_es_out, f_position, i_time, i_length );
 
+    /* account the packets lost by access_demux modules */
+    uint64_t i_dropped;
+    if( !demux_Control( p_input->p->input.p_demux,
+                        DEMUX_GET_DROPPED, &i_dropped )
+     && i_dropped > p_input->p->input.i_dropped )
+    {
+        if( libvlc_stats( p_input ) )
+        {
+            vlc_mutex_lock( &p_input->p->counters.counters_lock );
+            stats_Update( p_input->p->counters.p_dropped_packets,
+                          i_dropped - p_input->p->input.i_dropped, NULL );
+            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+        }
+        p_input->p->input.i_dropped = i_dropped;
+    }
+
     /* update current bookmark */
     vlc_mutex_lock( &p_input->p->p_item->lock );
     p_input->p->bookmark.i_time_offset = i_time;
@@ -798,11 +815,18 @@ static void InitStatistics( input_thread_t * p_input )
     {
         INIT_COUNTER( read_bytes, COUNTER );
         INIT_COUNTER( read_packets, COUNTER );
+        INIT_COUNTER( dropped_packets, COUNTER );
         INIT_COUNTER( demux_read, COUNTER );
         INIT_COUNTER( input_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, COUNTER );
         INIT_COUNTER( demux_discontinuity, COUNTER );
+        INIT_COUNTER( cache_hits, COUNTER );
+        INIT_COUNTER( cache_misses, COUNTER );
+        INIT_COUNTER( readahead_hits, COUNTER );
+        INIT_COUNTER( readahead_stalls, COUNTER );
+        INIT_COUNTER( readahead_stall_time, COUNTER );
+        INIT_COUNTER( readahead_misses, COUNTER );
         INIT_COUNTER( played_abuffers, COUNTER );
         INIT_COUNTER( lost_abuffers, COUNTER );
         INIT_COUNTER( displayed_pictures, COUNTER );
@@ -1271,11 +1295,18 @@ error:
                                p_input->p->counters.p_##c = NULL; } while(0)
         EXIT_COUNTER( read_bytes );
         EXIT_COUNTER( read_packets );
+        EXIT_COUNTER( dropped_packets );
         EXIT_COUNTER( demux_read );
         EXIT_COUNTER( input_bitrate );
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
+        EXIT_COUNTER( cache_hits );
+        EXIT_COUNTER( cache_misses );
+        EXIT_COUNTER( readahead_hits );
+        EXIT_COUNTER( readahead_stalls );
+        EXIT_COUNTER( readahead_stall_time );
+        EXIT_COUNTER( readahead_misses );
         EXIT_COUNTER( played_abuffers );
         EXIT_COUNTER( lost_abuffers );
         EXIT_COUNTER( displayed_pictures );
@@ -1342,11 +1373,18 @@ static void End( input_thread_t * p_input )
             stats_ComputeInputStats( p_input, p_input->p->p_item->p_stats );
             CL_CO( read_bytes );
             CL_CO( read_packets );
+            CL_CO( dropped_packets );
             CL_CO( demux_read );
             CL_CO( input_bitrate );
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
+            CL_CO( cache_hits );
+            CL_CO( cache_misses );
+            CL_CO( readahead_hits );
+            CL_CO( readahead_stalls );
+            CL_CO( readahead_stall_time );
+            CL_CO( readahead_misses );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
             CL_CO( displayed_pictures );
@@ -1654,6 +1692,15 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* Seek inside the timeshift buffer when it covers the request,
+             * the demuxer seeks otherwise */
+            if( !es_out_SetTimeshiftOffset( p_input->p->p_es_out,
+                                    i_time - var_GetInteger( p_input, "time" ) ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( p_input->p->p_es_out, -1 );
 
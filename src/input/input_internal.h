@@ -66,6 +66,7 @@ typedef struct
     int64_t i_pts_delay;
 
     bool       b_eof;   /* eof of demuxer */
+    uint64_t   i_dropped; /* packets dropped by the demuxer so far */
 
 } input_source_t;
 
@@ -140,11 +141,18 @@ struct input_thread_private_t
     struct {
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
+        counter_t *p_dropped_packets;
         counter_t *p_input_bitrate;
         counter_t *p_demux_read;
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
         counter_t *p_demux_discontinuity;
+        counter_t *p_cache_hits;
+        counter_t *p_cache_misses;
+        counter_t *p_readahead_hits;
+        counter_t *p_readahead_stalls;
+        counter_t *p_readahead_stall_time;
+        counter_t *p_readahead_misses;
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
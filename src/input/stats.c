@@ -89,12 +89,22 @@ void stats_ComputeInputStats(input_thread_t *input, input_stats_t *st)
     /* Input */
     st->i_read_packets = stats_GetTotal(input->p->counters.p_read_packets);
     st->i_read_bytes = stats_GetTotal(input->p->counters.p_read_bytes);
+    st->i_dropped_packets =
+        stats_GetTotal(input->p->counters.p_dropped_packets);
     st->f_input_bitrate = stats_GetRate(input->p->counters.p_input_bitrate);
     st->i_demux_read_bytes = stats_GetTotal(input->p->counters.p_demux_read);
     st->f_demux_bitrate = stats_GetRate(input->p->counters.p_demux_bitrate);
     st->i_demux_corrupted = stats_GetTotal(input->p->counters.p_demux_corrupted);
     st->i_demux_discontinuity = stats_GetTotal(input->p->counters.p_demux_discontinuity);
 
+    /* Stream cache */
+    st->i_cache_hits = stats_GetTotal(input->p->counters.p_cache_hits);
+    st->i_cache_misses = stats_GetTotal(input->p->counters.p_cache_misses);
+    st->i_readahead_hits = stats_GetTotal(input->p->counters.p_readahead_hits);
+    st->i_readahead_stalls = stats_GetTotal(input->p->counters.p_readahead_stalls);
+    st->i_readahead_stall_time = stats_GetTotal(input->p->counters.p_readahead_stall_time);
+    st->i_readahead_misses = stats_GetTotal(input->p->counters.p_readahead_misses);
+
     /* Decoders */
     st->i_decoded_video = stats_GetTotal(input->p->counters.p_decoded_video);
     st->i_decoded_audio = stats_GetTotal(input->p->counters.p_decoded_audio);
@@ -123,10 +133,14 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
 {
     vlc_mutex_lock( &p_stats->lock );
     p_stats->i_read_packets = p_stats->i_read_bytes =
+    p_stats->i_dropped_packets =
     p_stats->f_input_bitrate = p_stats->f_average_input_bitrate =
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
+    p_stats->i_cache_hits = p_stats->i_cache_misses =
+    p_stats->i_readahead_hits = p_stats->i_readahead_stalls =
+    p_stats->i_readahead_stall_time = p_stats->i_readahead_misses =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
@@ -31,6 +31,7 @@
 #include <vlc_common.h>
 #include <vlc_strings.h>
 #include <vlc_memory.h>
+#include <vlc_interrupt.h>
 
 #include <libvlc.h>
 
@@ -61,12 +62,16 @@
 /* How many tracks we have, currently only used for stream mode */
 #ifdef OPTIMIZE_MEMORY
 #   define STREAM_CACHE_TRACK 1
+#   define STREAM_CACHE_TRACK_MAX 1
     /* Max size of our cache 128Ko per track */
 #   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
+#   define STREAM_CACHE_TRACK_SIZE_MIN (1024*128)
 #else
 #   define STREAM_CACHE_TRACK 3
+#   define STREAM_CACHE_TRACK_MAX 8
     /* Max size of our cache 4Mo per track */
 #   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
+#   define STREAM_CACHE_TRACK_SIZE_MIN (1024*256)
 #endif
 
 /* How many data we try to prebuffer
@@ -95,6 +100,18 @@
 #define STREAM_READ_ATONCE 1024
 #define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
 
+/* Tracks adapt to the seek pattern:
+ *  - a hard seek evicting a track used less than STREAM_CACHE_THRASH_DELAY
+ *    ago adds a track (up to STREAM_CACHE_TRACK_MAX),
+ *  - a track reused by a hard seek is sized after the average length read
+ *    between seeks, so that small random reads (indexes) use small tracks.
+ *  The tracks never use more than STREAM_CACHE_SIZE in total. */
+#define STREAM_CACHE_THRASH_DELAY (CLOCK_FREQ/2)
+
+/* Read-ahead (for pf_read accesses selected with --stream-readahead):
+ * a thread reads the access ahead of the tracks into a ring buffer */
+#define STREAM_READAHEAD_ATONCE (64*1024)
+
 typedef struct
 {
     int64_t i_date;
@@ -103,6 +120,7 @@ typedef struct
     uint64_t i_end;
 
     uint8_t *p_buffer;
+    unsigned i_size;     /* Size of p_buffer */
 
 } stream_track_t;
 
@@ -139,6 +157,8 @@ struct stream_sys_t
         block_t *p_first;
         block_t **pp_last;
 
+        bool     b_fastseek;     /* Blocks can be handed out (stream_Block) */
+
     } block;
 
     /* Method 2: for pf_read */
@@ -146,17 +166,54 @@ struct stream_sys_t
     {
         unsigned i_offset;   /* Buffer offset in the current track */
         int      i_tk;       /* Current track */
-        stream_track_t tk[STREAM_CACHE_TRACK];
-
-        /* Global buffer */
-        uint8_t *p_buffer;
+        int      i_tk_count; /* Number of tracks in use */
+        stream_track_t tk[STREAM_CACHE_TRACK_MAX];
 
         /* */
         unsigned i_used; /* Used since last read */
         unsigned i_read_size;
 
+        /* Seek pattern */
+        uint64_t i_run;      /* Read since the last track switch */
+        uint64_t i_run_avg;  /* Average of i_run */
+
     } stream;
 
+    /* Read-ahead for method 2 */
+    struct
+    {
+        bool          b_enabled;
+        vlc_thread_t  thread;
+        vlc_interrupt_t *p_interrupt;
+
+        /* Held while the access is used, by the thread to read it too.
+         * Controls wait for one read at most, as the thread does not start
+         * another one while some are pending (i_hold) */
+        vlc_mutex_t   access_lock;
+
+        /* Capabilities, read once at start */
+        bool          b_can_seek;
+        bool          b_can_fastseek;
+
+        vlc_mutex_t   lock;        /* Protects all following fields */
+        vlc_cond_t    wait_data;   /* Signaled by the thread */
+        vlc_cond_t    wait_space;  /* Signaled by the reader */
+
+        uint8_t      *p_buffer;
+        size_t        i_size;
+        uint64_t      i_start;     /* Access position of the first byte */
+        size_t        i_fill;      /* Bytes buffered from i_start */
+        unsigned      i_gen;       /* Incremented when the buffer is reset */
+        bool          b_eof;
+        bool          b_seek;      /* Access seek requested at i_start */
+        int           i_seek_ret;
+        uint64_t      i_access_size; /* Access size after the last read */
+        unsigned      i_hold;      /* Controls waiting for the access */
+        bool          b_paused;    /* Pause state requested */
+        bool          b_access_paused; /* Pause state of the access */
+        bool          b_exit;
+    } prefetch;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -168,6 +225,7 @@ struct stream_sys_t
         uint64_t i_read_count;
         uint64_t i_bytes;
         uint64_t i_read_time;
+        uint64_t i_dropped; /* Packets dropped by the current access */
     } stat;
 
     /* Streams list */
@@ -177,11 +235,23 @@ struct stream_sys_t
     access_t       *p_list_access;
 };
 
+/* Adds to a stream cache counter of the input statistics */
+#define AStreamStat( s, counter, val ) do { \
+    input_thread_t *p_input = (s)->p_input; \
+    if( p_input != NULL && libvlc_stats( s ) ) \
+    { \
+        vlc_mutex_lock( &p_input->p->counters.counters_lock ); \
+        stats_Update( p_input->p->counters.p_##counter, (val), NULL ); \
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock ); \
+    } \
+} while(0)
+
 /* Method 1: */
 static int  AStreamReadBlock( stream_t *s, void *p_read, unsigned int i_read );
 static int  AStreamPeekBlock( stream_t *s, const uint8_t **p_peek, unsigned int i_read );
 static int  AStreamSeekBlock( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferBlock( stream_t *s );
+static block_t *AStreamBlockBlock( stream_t *s, unsigned int i_read );
 static block_t *AReadBlock( stream_t *s, bool *pb_eof );
 
 /* Method 2 */
@@ -191,6 +261,16 @@ static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
+/* Read-ahead */
+static void APrefetchStart( stream_t *s );
+static void APrefetchStop( stream_t *s );
+static void APrefetchReset( stream_t *s, uint64_t i_pos );
+static int  APrefetchRead( stream_t *s, void *p_read, unsigned int i_read );
+static int  APrefetchSeek( stream_t *s, uint64_t i_pos );
+static void APrefetchHold( stream_t *s );
+static void APrefetchUnhold( stream_t *s );
+static void APrefetchPause( stream_t *s, bool b_paused );
+
 /* ReadDir */
 static input_item_t *AStreamReadDir( stream_t *s );
 
@@ -314,11 +394,14 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         p_sys->method = STREAM_METHOD_READDIR;
 
     p_sys->i_pos = p_access->info.i_pos;
+    p_sys->stream.i_tk_count = 0;
+    p_sys->prefetch.b_enabled = false;
 
     /* Stats */
     p_sys->stat.i_bytes = 0;
     p_sys->stat.i_read_time = 0;
     p_sys->stat.i_read_count = 0;
+    p_sys->stat.i_dropped = 0;
 
     TAB_INIT( p_sys->i_list, p_sys->list );
     p_sys->i_list_index = 0;
@@ -388,6 +471,9 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         p_sys->block.i_size = 0;
         p_sys->block.p_first = NULL;
         p_sys->block.pp_last = &p_sys->block.p_first;
+        if( access_Control( p_access, ACCESS_CAN_FASTSEEK,
+                            &p_sys->block.b_fastseek ) )
+            p_sys->block.b_fastseek = false;
 
         /* Do the prebuffering */
         AStreamPrebufferBlock( s );
@@ -410,24 +496,30 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         /* Allocate/Setup our tracks */
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
-        p_sys->stream.p_buffer = malloc( STREAM_CACHE_SIZE );
-        if( p_sys->stream.p_buffer == NULL )
-            goto error;
+        p_sys->stream.i_tk_count = 0;
         p_sys->stream.i_used   = 0;
         p_sys->stream.i_read_size = STREAM_READ_ATONCE;
 #if STREAM_READ_ATONCE < 256
 #   error "Invalid STREAM_READ_ATONCE value"
 #endif
+        p_sys->stream.i_run = 0;
+        p_sys->stream.i_run_avg = STREAM_CACHE_TRACK_SIZE;
 
         for( i = 0; i < STREAM_CACHE_TRACK; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
             p_sys->stream.tk[i].i_end   = p_sys->i_pos;
-            p_sys->stream.tk[i].p_buffer=
-                &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
+            p_sys->stream.tk[i].i_size  = STREAM_CACHE_TRACK_SIZE;
+            p_sys->stream.tk[i].p_buffer = malloc( STREAM_CACHE_TRACK_SIZE );
+            if( p_sys->stream.tk[i].p_buffer == NULL )
+                goto error;
+            p_sys->stream.i_tk_count++;
         }
 
+        /* Read ahead of the tracks if requested for this access */
+        APrefetchStart( s );
+
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
 
@@ -454,7 +546,9 @@ error:
     }
     else if( p_sys->method == STREAM_METHOD_STREAM )
     {
-        free( p_sys->stream.p_buffer );
+        APrefetchStop( s );
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
+            free( p_sys->stream.tk[i].p_buffer );
     }
     while( p_sys->i_list > 0 )
         free( p_sys->list[--(p_sys->i_list)] );
@@ -475,7 +569,14 @@ static void AStreamDestroy( stream_t *s )
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else if( p_sys->method == STREAM_METHOD_STREAM )
-        free( p_sys->stream.p_buffer );
+    {
+        APrefetchStop( s );
+
+        msg_Dbg( s, "cache: %d tracks", p_sys->stream.i_tk_count );
+
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
+            free( p_sys->stream.tk[i].p_buffer );
+    }
 
     free( p_sys->p_peek );
 
@@ -501,7 +602,14 @@ static void AStreamControlReset( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    p_sys->i_pos = p_sys->p_access->info.i_pos;
+    if( p_sys->prefetch.b_enabled )
+    {
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->i_pos = p_sys->prefetch.i_start;
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+    }
+    else
+        p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->method == STREAM_METHOD_BLOCK )
     {
@@ -528,8 +636,9 @@ static void AStreamControlReset( stream_t *s )
         p_sys->stream.i_offset = 0;
         p_sys->stream.i_tk     = 0;
         p_sys->stream.i_used   = 0;
+        p_sys->stream.i_run    = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             p_sys->stream.tk[i].i_date  = 0;
             p_sys->stream.tk[i].i_start = p_sys->i_pos;
@@ -548,7 +657,15 @@ static void AStreamControlUpdate( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
-    p_sys->i_pos = p_sys->p_access->info.i_pos;
+    if( p_sys->prefetch.b_enabled )
+    {
+        /* The access is ahead of what was handed to the tracks */
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->i_pos = p_sys->prefetch.i_start;
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+    }
+    else
+        p_sys->i_pos = p_sys->p_access->info.i_pos;
 
     if( p_sys->i_list )
     {
@@ -602,11 +719,38 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_GET_META:
         case STREAM_GET_CONTENT_TYPE:
         case STREAM_GET_SIGNAL:
+        case STREAM_GET_PRIVATE_ID_STATE:
+        {
+            if( !p_sys->prefetch.b_enabled )
+                return access_vaControl( p_access, i_query, args );
+
+            APrefetchHold( s );
+            int ret = access_vaControl( p_access, i_query, args );
+            APrefetchUnhold( s );
+            return ret;
+        }
+
         case STREAM_SET_PAUSE_STATE:
+        {
+            if( !p_sys->prefetch.b_enabled )
+                return access_vaControl( p_access, i_query, args );
+
+            /* Applied by the thread once its current read is over */
+            APrefetchPause( s, (bool)va_arg( args, int ) );
+            return VLC_SUCCESS;
+        }
+
         case STREAM_SET_PRIVATE_ID_STATE:
         case STREAM_SET_PRIVATE_ID_CA:
-        case STREAM_GET_PRIVATE_ID_STATE:
-            return access_vaControl( p_access, i_query, args );
+        {
+            if( !p_sys->prefetch.b_enabled )
+                return access_vaControl( p_access, i_query, args );
+
+            APrefetchHold( s );
+            int ret = access_vaControl( p_access, i_query, args );
+            APrefetchUnhold( s );
+            return ret;
+        }
 
         case STREAM_GET_SIZE:
         {
@@ -619,6 +763,13 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
                     *pi_64 += s->p_sys->list[i]->i_size;
                 break;
             }
+            if( p_sys->prefetch.b_enabled )
+            {   /* Asked often by demuxers: do not wait for the access */
+                vlc_mutex_lock( &p_sys->prefetch.lock );
+                *pi_64 = p_sys->prefetch.i_access_size;
+                vlc_mutex_unlock( &p_sys->prefetch.lock );
+                break;
+            }
             *pi_64 = access_GetSize( p_access );
             break;
         }
@@ -649,7 +800,21 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
         case STREAM_SET_TITLE:
         case STREAM_SET_SEEKPOINT:
         {
+            if( !p_sys->prefetch.b_enabled )
+            {
+                int ret = access_vaControl( p_access, i_query, args );
+                if( ret == VLC_SUCCESS )
+                    AStreamControlReset( s );
+                return ret;
+            }
+
+            /* Drop the data read ahead before the access moved */
+            APrefetchHold( s );
             int ret = access_vaControl( p_access, i_query, args );
+            if( ret == VLC_SUCCESS )
+                APrefetchReset( s, p_access->info.i_pos );
+            APrefetchUnhold( s );
+
             if( ret == VLC_SUCCESS )
                 AStreamControlReset( s );
             return ret;
@@ -992,6 +1157,70 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
     return VLC_EGENERIC;
 }
 
+/* Hands out the next i_read bytes without copying them, if they are within
+ * the current block. The cache is emptied up to the new position, so that
+ * the returned payload cannot be read again from the cache if the caller
+ * modifies it: backward seeks will go through the access. */
+static block_t *AStreamBlockBlock( stream_t *s, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *b = p_sys->block.p_current;
+
+    if( b == NULL || b->i_buffer - p_sys->block.i_offset < i_read )
+        return NULL;
+
+    /* Release the data before the current block */
+    while( p_sys->block.p_first != b )
+    {
+        block_t *p_old = p_sys->block.p_first;
+
+        p_sys->block.i_start += p_old->i_buffer;
+        p_sys->block.i_size  -= p_old->i_buffer;
+        p_sys->block.p_first  = p_old->p_next;
+
+        block_Release( p_old );
+    }
+
+    const size_t i_used = p_sys->block.i_offset + i_read;
+    block_t *p_bk;
+
+    if( i_used == b->i_buffer )
+    {
+        /* Give the whole block away */
+        p_sys->block.p_first = p_sys->block.p_current = b->p_next;
+        if( b->p_next == NULL )
+            p_sys->block.pp_last = &p_sys->block.p_first;
+        b->p_next = NULL;
+        p_bk = b;
+    }
+    else
+    {
+        p_bk = block_Share( b );
+        if( p_bk == NULL )
+            return NULL;
+        p_bk->p_next = NULL;
+
+        b->p_buffer += i_used;
+        b->i_buffer -= i_used;
+    }
+
+    p_bk->p_buffer += p_sys->block.i_offset;
+    p_bk->i_buffer  = i_read;
+    p_bk->i_flags   = 0;
+    p_bk->i_pts     =
+    p_bk->i_dts     = VLC_TS_INVALID;
+    p_bk->i_length  = 0;
+
+    p_sys->block.i_start += i_used;
+    p_sys->block.i_size  -= i_used;
+    p_sys->block.i_offset = 0;
+    p_sys->i_pos += i_read;
+
+    if( p_sys->block.p_current == NULL )
+        AStreamRefillBlock( s );
+    return p_bk;
+}
+
 static int AStreamRefillBlock( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1062,6 +1291,106 @@ static int AStreamRefillBlock( stream_t *s )
 static int AStreamRefillStream( stream_t *s );
 static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_read );
 
+static int AStreamReadAccess( stream_t *s, void *p_read, unsigned int i_read )
+{
+    if( s->p_sys->prefetch.b_enabled )
+        return APrefetchRead( s, p_read, i_read );
+    return AReadStream( s, p_read, i_read );
+}
+
+static int AStreamSeekAccess( stream_t *s, uint64_t i_pos )
+{
+    if( s->p_sys->prefetch.b_enabled )
+        return APrefetchSeek( s, i_pos );
+    return ASeek( s, i_pos );
+}
+
+/* Size available for a track without exceeding the cache size */
+static unsigned AStreamTrackRoom( stream_t *s, const stream_track_t *tk )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned i_used = 0;
+
+    for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
+    {
+        if( &p_sys->stream.tk[i] != tk )
+            i_used += p_sys->stream.tk[i].i_size;
+    }
+    return i_used < STREAM_CACHE_SIZE ? STREAM_CACHE_SIZE - i_used : 0;
+}
+
+/* Grow a track, keeping its content */
+static void AStreamTrackGrow( stream_t *s, stream_track_t *tk, unsigned i_size )
+{
+    i_size = __MIN( i_size, STREAM_CACHE_TRACK_SIZE );
+    i_size = __MIN( i_size, AStreamTrackRoom( s, tk ) );
+    if( i_size <= tk->i_size )
+        return;
+
+    uint8_t *p_buffer = malloc( i_size );
+    if( !p_buffer )
+        return;
+
+    for( uint64_t i_pos = tk->i_start; i_pos < tk->i_end; )
+    {
+        const unsigned i_off = i_pos % tk->i_size;
+        const unsigned i_new = i_pos % i_size;
+        unsigned i_copy = __MIN( tk->i_end - i_pos, tk->i_size - i_off );
+        i_copy = __MIN( i_copy, i_size - i_new );
+
+        memcpy( &p_buffer[i_new], &tk->p_buffer[i_off], i_copy );
+        i_pos += i_copy;
+    }
+    free( tk->p_buffer );
+    tk->p_buffer = p_buffer;
+    tk->i_size = i_size;
+}
+
+/* Size an empty track after the average length read between seeks */
+static void AStreamTrackAdapt( stream_t *s, stream_track_t *tk )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned i_size = STREAM_CACHE_TRACK_SIZE_MIN;
+
+    assert( tk->i_start == tk->i_end );
+
+    while( i_size < STREAM_CACHE_TRACK_SIZE && i_size < 2 * p_sys->stream.i_run_avg )
+        i_size *= 2;
+    i_size = __MIN( i_size, AStreamTrackRoom( s, tk ) );
+    if( i_size < STREAM_CACHE_TRACK_SIZE_MIN || i_size == tk->i_size )
+        return;
+
+    uint8_t *p_buffer = realloc( tk->p_buffer, i_size );
+    if( !p_buffer )
+        return;
+    tk->p_buffer = p_buffer;
+    tk->i_size = i_size;
+}
+
+/* Add an empty track if the cache size allows it, returns its index or -1 */
+static int AStreamTrackAdd( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( p_sys->stream.i_tk_count >= STREAM_CACHE_TRACK_MAX )
+        return -1;
+
+    stream_track_t *tk = &p_sys->stream.tk[p_sys->stream.i_tk_count];
+    const unsigned i_size = AStreamTrackRoom( s, NULL );
+    if( i_size < STREAM_CACHE_TRACK_SIZE_MIN )
+        return -1;
+
+    tk->i_size = __MIN( i_size, STREAM_CACHE_TRACK_SIZE_MIN );
+    tk->p_buffer = malloc( tk->i_size );
+    if( !tk->p_buffer )
+        return -1;
+    tk->i_date = 0;
+    tk->i_start = tk->i_end = 0;
+
+    msg_Dbg( s, "adding cache track %d", p_sys->stream.i_tk_count );
+    return p_sys->stream.i_tk_count++;
+}
+
 static int AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1095,9 +1424,13 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
              tk->i_start, p_sys->stream.i_offset, tk->i_end );
 #endif
 
+    /* A small track may have to grow for large peeks */
+    if( i_read > tk->i_size / 2 )
+        AStreamTrackGrow( s, tk, 2 * i_read );
+
     /* Avoid problem, but that should *never* happen */
-    if( i_read > STREAM_CACHE_TRACK_SIZE / 2 )
-        i_read = STREAM_CACHE_TRACK_SIZE / 2;
+    if( i_read > tk->i_size / 2 )
+        i_read = tk->i_size / 2;
 
     while( tk->i_end < tk->i_start + p_sys->stream.i_offset + i_read )
     {
@@ -1116,8 +1449,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     /* Now, direct pointer or a copy ? */
-    i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
-    if( i_off + i_read <= STREAM_CACHE_TRACK_SIZE )
+    i_off = (tk->i_start + p_sys->stream.i_offset) % tk->i_size;
+    if( i_off + i_read <= tk->i_size )
     {
         *pp_peek = &tk->p_buffer[i_off];
         return i_read;
@@ -1135,9 +1468,9 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     memcpy( p_sys->p_peek, &tk->p_buffer[i_off],
-            STREAM_CACHE_TRACK_SIZE - i_off );
-    memcpy( &p_sys->p_peek[STREAM_CACHE_TRACK_SIZE - i_off],
-            &tk->p_buffer[0], i_read - (STREAM_CACHE_TRACK_SIZE - i_off) );
+            tk->i_size - i_off );
+    memcpy( &p_sys->p_peek[tk->i_size - i_off],
+            &tk->p_buffer[0], i_read - (tk->i_size - i_off) );
 
     *pp_peek = p_sys->p_peek;
     return i_read;
@@ -1163,16 +1496,24 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
 #endif
 
     bool   b_aseek;
-    access_Control( p_access, ACCESS_CAN_SEEK, &b_aseek );
+    bool   b_afastseek;
+    if( p_sys->prefetch.b_enabled )
+    {
+        b_aseek = p_sys->prefetch.b_can_seek;
+        b_afastseek = p_sys->prefetch.b_can_fastseek;
+    }
+    else
+    {
+        access_Control( p_access, ACCESS_CAN_SEEK, &b_aseek );
+        access_Control( p_access, ACCESS_CAN_FASTSEEK, &b_afastseek );
+    }
+
     if( !b_aseek && i_pos < p_current->i_start )
     {
         msg_Warn( s, "AStreamSeekStream: can't seek" );
         return VLC_EGENERIC;
     }
 
-    bool   b_afastseek;
-    access_Control( p_access, ACCESS_CAN_FASTSEEK, &b_afastseek );
-
     /* FIXME compute seek cost (instead of static 'stupid' value) */
     uint64_t i_skip_threshold;
     if( b_aseek )
@@ -1196,7 +1537,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Try to maximize already read data */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1213,7 +1554,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Use the oldest unused */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1223,11 +1564,29 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
                 i_tk_idx = i;
             }
         }
+
+        /* The reads jump between more places than we have tracks */
+        if( tk->i_date > mdate() - STREAM_CACHE_THRASH_DELAY )
+        {
+            const int i_new = AStreamTrackAdd( s );
+            if( i_new >= 0 )
+            {
+                tk = &p_sys->stream.tk[i_new];
+                i_tk_idx = i_new;
+            }
+        }
     }
-    assert( i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK );
+    assert( i_tk_idx >= 0 && i_tk_idx < p_sys->stream.i_tk_count );
 
     if( tk != p_current )
+    {
         i_skip_threshold = 0;
+
+        /* Learn how much is read between two seeks */
+        p_sys->stream.i_run_avg = ( 3 * p_sys->stream.i_run_avg +
+                                    p_sys->stream.i_run ) / 4;
+        p_sys->stream.i_run = 0;
+    }
     if( tk->i_start <= i_pos && i_pos <= tk->i_end + i_skip_threshold )
     {
 #ifdef STREAM_DEBUG
@@ -1236,6 +1595,8 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
                  i_tk_idx, tk->i_start, tk->i_end,
                  tk != p_current ? "seek" : i_pos > tk->i_end ? "skip" : "noseek" );
 #endif
+        AStreamStat( s, cache_hits, 1 );
+
         if( tk != p_current )
         {
             assert( b_aseek );
@@ -1243,7 +1604,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
             /* Seek at the end of the buffer
              * TODO it is stupid to seek now, it would be better to delay it
              */
-            if( ASeek( s, tk->i_end ) )
+            if( AStreamSeekAccess( s, tk->i_end ) )
                 return VLC_EGENERIC;
         }
         else if( i_pos > tk->i_end )
@@ -1263,12 +1624,15 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
 #ifdef STREAM_DEBUG
         msg_Err( s, "AStreamSeekStream: hard seek" );
 #endif
+        AStreamStat( s, cache_misses, 1 );
+
         /* Nothing good, seek and choose oldest segment */
-        if( ASeek( s, i_pos ) )
+        if( AStreamSeekAccess( s, i_pos ) )
             return VLC_EGENERIC;
 
         tk->i_start = i_pos;
         tk->i_end   = i_pos;
+        AStreamTrackAdapt( s, tk );
     }
     p_sys->stream.i_offset = i_pos - tk->i_start;
     p_sys->stream.i_tk = i_tk_idx;
@@ -1310,10 +1674,10 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
     while( i_data < i_read )
     {
-        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
+        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % tk->i_size;
         unsigned int i_current =
             __MIN( tk->i_end - tk->i_start - p_sys->stream.i_offset,
-                   STREAM_CACHE_TRACK_SIZE - i_off );
+                   tk->i_size - i_off );
         int i_copy = __MIN( i_current, i_read - i_data );
 
         if( i_copy <= 0 ) break; /* EOF */
@@ -1333,6 +1697,7 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
         /* */
         p_sys->stream.i_used += i_copy;
+        p_sys->stream.i_run += i_copy;
 
         if( tk->i_end + i_data <= tk->i_start + p_sys->stream.i_offset + i_read )
         {
@@ -1362,7 +1727,7 @@ static int AStreamRefillStream( stream_t *s )
 
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN( p_sys->stream.i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN( p_sys->stream.i_used, tk->i_size -
                (tk->i_end - tk->i_start - p_sys->stream.i_offset) );
     bool b_read = false;
     int64_t i_start, i_stop;
@@ -1377,14 +1742,14 @@ static int AStreamRefillStream( stream_t *s )
     i_start = mdate();
     while( i_toread > 0 )
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % tk->i_size;
         int i_read;
 
         if( vlc_killed() )
             return VLC_EGENERIC;
 
-        i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
-        i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
+        i_read = __MIN( i_toread, (int)tk->i_size - i_off );
+        i_read = AStreamReadAccess( s, &tk->p_buffer[i_off], i_read );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
         if( i_read <  0 )
@@ -1402,10 +1767,10 @@ static int AStreamRefillStream( stream_t *s )
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if( tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end )
+        /* Windows of the track size */
+        if( tk->i_start + tk->i_size < tk->i_end )
         {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            unsigned i_invalid = tk->i_end - tk->i_start - tk->i_size;
 
             tk->i_start += i_invalid;
             p_sys->stream.i_offset -= i_invalid;
@@ -1460,9 +1825,9 @@ static void AStreamPrebufferStream( stream_t *s )
         }
 
         /* */
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
+        i_read = tk->i_size - i_buffered;
         i_read = __MIN( (int)p_sys->stream.i_read_size, i_read );
-        i_read = AReadStream( s, &tk->p_buffer[i_buffered], i_read );
+        i_read = AStreamReadAccess( s, &tk->p_buffer[i_buffered], i_read );
         if( i_read <  0 )
             continue;
         else if( i_read == 0 )
@@ -1481,6 +1846,360 @@ static void AStreamPrebufferStream( stream_t *s )
     }
 }
 
+/****************************************************************************
+ * Read-ahead:
+ ****************************************************************************/
+static void *APrefetchThread( void *data )
+{
+    stream_t *s = data;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_interrupt_set( p_sys->prefetch.p_interrupt );
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    while( !p_sys->prefetch.b_exit )
+    {
+        const unsigned i_gen = p_sys->prefetch.i_gen;
+
+        if( p_sys->prefetch.b_seek )
+        {
+            const uint64_t i_pos = p_sys->prefetch.i_start;
+            vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+            vlc_mutex_lock( &p_sys->prefetch.access_lock );
+            const int i_ret = ASeek( s, i_pos );
+            const uint64_t i_access_size = access_GetSize( p_sys->p_access );
+            vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+
+            vlc_mutex_lock( &p_sys->prefetch.lock );
+            p_sys->prefetch.i_access_size = i_access_size;
+            if( i_gen == p_sys->prefetch.i_gen )
+            {
+                p_sys->prefetch.b_seek = false;
+                p_sys->prefetch.i_seek_ret = i_ret;
+                p_sys->prefetch.b_eof = i_ret != VLC_SUCCESS;
+                vlc_cond_signal( &p_sys->prefetch.wait_data );
+            }
+            continue;
+        }
+
+        if( p_sys->prefetch.b_paused != p_sys->prefetch.b_access_paused )
+        {
+            const bool b_paused = p_sys->prefetch.b_paused;
+            vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+            vlc_mutex_lock( &p_sys->prefetch.access_lock );
+            if( access_Control( p_sys->p_access, ACCESS_SET_PAUSE_STATE,
+                                b_paused ) )
+                msg_Warn( s, "cannot %s the access",
+                          b_paused ? "pause" : "resume" );
+            vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+
+            vlc_mutex_lock( &p_sys->prefetch.lock );
+            p_sys->prefetch.b_access_paused = b_paused;
+            continue;
+        }
+
+        if( p_sys->prefetch.b_eof || p_sys->prefetch.b_paused ||
+            p_sys->prefetch.i_hold > 0 ||
+            p_sys->prefetch.i_fill >= p_sys->prefetch.i_size )
+        {
+            vlc_cond_wait( &p_sys->prefetch.wait_space, &p_sys->prefetch.lock );
+            continue;
+        }
+
+        /* Read into the contiguous free space after the buffered data. The
+         * reader never touches it, so the lock can be released */
+        const size_t i_size = p_sys->prefetch.i_size;
+        const size_t i_off = (p_sys->prefetch.i_start + p_sys->prefetch.i_fill) % i_size;
+        size_t i_read = __MIN( i_size - p_sys->prefetch.i_fill, i_size - i_off );
+        i_read = __MIN( i_read, STREAM_READAHEAD_ATONCE );
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+        /* The access may update its state (size, content type...) while
+         * reading, so it is read with the access lock held too */
+        vlc_mutex_lock( &p_sys->prefetch.access_lock );
+        const int i_ret = AReadStream( s, &p_sys->prefetch.p_buffer[i_off], i_read );
+        const uint64_t i_access_size = access_GetSize( p_sys->p_access );
+        vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+
+        vlc_mutex_lock( &p_sys->prefetch.lock );
+        p_sys->prefetch.i_access_size = i_access_size;
+        if( i_gen != p_sys->prefetch.i_gen )
+            continue; /* Reset while reading, drop the data */
+
+        if( i_ret > 0 )
+        {
+            p_sys->prefetch.i_fill += i_ret;
+            vlc_cond_signal( &p_sys->prefetch.wait_data );
+        }
+        else if( i_ret == 0 )
+        {
+            p_sys->prefetch.b_eof = true;
+            vlc_cond_signal( &p_sys->prefetch.wait_data );
+        }
+        else
+        {
+            /* Do not spin on a failing access */
+            vlc_cond_timedwait( &p_sys->prefetch.wait_space, &p_sys->prefetch.lock,
+                                mdate() + CLOCK_FREQ / 100 );
+        }
+    }
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    return NULL;
+}
+
+static bool APrefetchIsSelected( stream_t *s )
+{
+    char *psz_list = var_InheritString( s, "stream-readahead" );
+    bool b_selected = false;
+
+    if( psz_list == NULL )
+        return false;
+
+    char *psz_state;
+    for( const char *psz = strtok_r( psz_list, ",", &psz_state );
+         psz != NULL && !b_selected;
+         psz = strtok_r( NULL, ",", &psz_state ) )
+    {
+        b_selected = !strcasecmp( psz, s->psz_access );
+    }
+    free( psz_list );
+    return b_selected;
+}
+
+static void APrefetchStart( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    bool b_seek;
+
+    /* Live streams and input lists are not read ahead */
+    if( p_sys->i_list > 0 || !APrefetchIsSelected( s ) ||
+        access_Control( p_sys->p_access, ACCESS_CAN_SEEK, &b_seek ) || !b_seek )
+        return;
+
+    const int64_t i_size = var_InheritInteger( s, "stream-readahead-size" ) * 1024;
+    if( i_size < STREAM_READAHEAD_ATONCE )
+        return;
+
+    p_sys->prefetch.p_buffer = malloc( i_size );
+    p_sys->prefetch.p_interrupt = vlc_interrupt_create();
+    if( !p_sys->prefetch.p_buffer || !p_sys->prefetch.p_interrupt )
+        goto error;
+
+    if( access_Control( p_sys->p_access, ACCESS_CAN_FASTSEEK,
+                        &p_sys->prefetch.b_can_fastseek ) )
+        p_sys->prefetch.b_can_fastseek = false;
+    p_sys->prefetch.b_can_seek = b_seek;
+
+    vlc_mutex_init( &p_sys->prefetch.access_lock );
+    vlc_mutex_init( &p_sys->prefetch.lock );
+    vlc_cond_init( &p_sys->prefetch.wait_data );
+    vlc_cond_init( &p_sys->prefetch.wait_space );
+    p_sys->prefetch.i_size = i_size;
+    p_sys->prefetch.i_start = p_sys->i_pos;
+    p_sys->prefetch.i_fill = 0;
+    p_sys->prefetch.i_gen = 0;
+    p_sys->prefetch.b_eof = false;
+    p_sys->prefetch.b_seek = false;
+    p_sys->prefetch.i_seek_ret = VLC_SUCCESS;
+    p_sys->prefetch.i_access_size = access_GetSize( p_sys->p_access );
+    p_sys->prefetch.i_hold = 0;
+    p_sys->prefetch.b_paused = false;
+    p_sys->prefetch.b_access_paused = false;
+    p_sys->prefetch.b_exit = false;
+
+    if( vlc_clone( &p_sys->prefetch.thread, APrefetchThread, s,
+                   VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_cond_destroy( &p_sys->prefetch.wait_space );
+        vlc_cond_destroy( &p_sys->prefetch.wait_data );
+        vlc_mutex_destroy( &p_sys->prefetch.lock );
+        vlc_mutex_destroy( &p_sys->prefetch.access_lock );
+        goto error;
+    }
+
+    msg_Dbg( s, "reading ahead up to %"PRId64" KiB", i_size / 1024 );
+    p_sys->prefetch.b_enabled = true;
+    return;
+
+error:
+    msg_Warn( s, "cannot read ahead" );
+    if( p_sys->prefetch.p_interrupt )
+        vlc_interrupt_destroy( p_sys->prefetch.p_interrupt );
+    free( p_sys->prefetch.p_buffer );
+}
+
+static void APrefetchStop( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    if( !p_sys->prefetch.b_enabled )
+        return;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_exit = true;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    /* Abort a blocking read */
+    vlc_interrupt_kill( p_sys->prefetch.p_interrupt );
+    vlc_join( p_sys->prefetch.thread, NULL );
+
+    vlc_interrupt_destroy( p_sys->prefetch.p_interrupt );
+    vlc_cond_destroy( &p_sys->prefetch.wait_space );
+    vlc_cond_destroy( &p_sys->prefetch.wait_data );
+    vlc_mutex_destroy( &p_sys->prefetch.lock );
+    vlc_mutex_destroy( &p_sys->prefetch.access_lock );
+    free( p_sys->prefetch.p_buffer );
+    p_sys->prefetch.b_enabled = false;
+}
+
+/* Holds the thread off the access and waits for the read in progress, for the
+ * controls */
+static void APrefetchHold( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_hold++;
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    vlc_mutex_lock( &p_sys->prefetch.access_lock );
+}
+
+static void APrefetchUnhold( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const uint64_t i_access_size = access_GetSize( p_sys->p_access );
+
+    vlc_mutex_unlock( &p_sys->prefetch.access_lock );
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_access_size = i_access_size;
+    p_sys->prefetch.i_hold--;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+static void APrefetchPause( stream_t *s, bool b_paused )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.b_paused = b_paused;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+/* Must be called with the access held, see APrefetchHold() */
+static void APrefetchReset( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    p_sys->prefetch.i_start = i_pos;
+    p_sys->prefetch.i_fill = 0;
+    p_sys->prefetch.i_gen++;
+    p_sys->prefetch.b_eof = false;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+}
+
+static int APrefetchRead( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    uint8_t *p_data = p_read;
+    mtime_t i_stall = 0;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+    while( p_sys->prefetch.i_fill == 0 && !p_sys->prefetch.b_eof )
+    {
+        if( vlc_killed() )
+        {
+            vlc_mutex_unlock( &p_sys->prefetch.lock );
+            return -1;
+        }
+        if( i_stall == 0 )
+            i_stall = mdate();
+        vlc_cond_timedwait( &p_sys->prefetch.wait_data, &p_sys->prefetch.lock,
+                            mdate() + CLOCK_FREQ / 10 );
+    }
+    if( i_stall != 0 )
+        i_stall = mdate() - i_stall;
+
+    const size_t i_size = p_sys->prefetch.i_size;
+    const size_t i_copy = __MIN( i_read, p_sys->prefetch.i_fill );
+
+    for( size_t i_done = 0; i_done < i_copy; )
+    {
+        const size_t i_off = p_sys->prefetch.i_start % i_size;
+        const size_t i_chunk = __MIN( i_copy - i_done, i_size - i_off );
+
+        memcpy( &p_data[i_done], &p_sys->prefetch.p_buffer[i_off], i_chunk );
+        p_sys->prefetch.i_start += i_chunk;
+        p_sys->prefetch.i_fill -= i_chunk;
+        i_done += i_chunk;
+    }
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    if( i_stall != 0 )
+    {
+        AStreamStat( s, readahead_stalls, 1 );
+        AStreamStat( s, readahead_stall_time, i_stall );
+    }
+    else
+        AStreamStat( s, readahead_hits, 1 );
+    return i_copy;
+}
+
+static int APrefetchSeek( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int i_ret;
+
+    vlc_mutex_lock( &p_sys->prefetch.lock );
+
+    /* Already read ahead: drop the skipped data */
+    if( !p_sys->prefetch.b_seek && i_pos >= p_sys->prefetch.i_start &&
+        i_pos <= p_sys->prefetch.i_start + p_sys->prefetch.i_fill )
+    {
+        p_sys->prefetch.i_fill -= i_pos - p_sys->prefetch.i_start;
+        p_sys->prefetch.i_start = i_pos;
+        vlc_cond_signal( &p_sys->prefetch.wait_space );
+        vlc_mutex_unlock( &p_sys->prefetch.lock );
+        return VLC_SUCCESS;
+    }
+
+    /* Let the thread seek the access and wait for the result */
+    p_sys->prefetch.i_start = i_pos;
+    p_sys->prefetch.i_fill = 0;
+    p_sys->prefetch.i_gen++;
+    p_sys->prefetch.b_eof = false;
+    p_sys->prefetch.b_seek = true;
+    vlc_cond_signal( &p_sys->prefetch.wait_space );
+
+    const mtime_t i_start = mdate();
+    while( p_sys->prefetch.b_seek )
+    {
+        if( vlc_killed() )
+        {
+            vlc_mutex_unlock( &p_sys->prefetch.lock );
+            return VLC_EGENERIC;
+        }
+        vlc_cond_timedwait( &p_sys->prefetch.wait_data, &p_sys->prefetch.lock,
+                            mdate() + CLOCK_FREQ / 10 );
+    }
+    i_ret = p_sys->prefetch.i_seek_ret;
+    vlc_mutex_unlock( &p_sys->prefetch.lock );
+
+    AStreamStat( s, readahead_misses, 1 );
+    AStreamStat( s, readahead_stall_time, mdate() - i_start );
+    return i_ret;
+}
+
 /****************************************************************************
  * stream_ReadLine:
  ****************************************************************************/
@@ -1740,11 +2459,42 @@ static int AReadStream( stream_t *s, void *p_read, unsigned int i_read )
     return i_read;
 }
 
+static void AReadBlockStats( stream_t *s, access_t *p_access,
+                             block_t *p_block )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    input_thread_t *p_input = s->p_input;
+    uint64_t i_dropped = p_access->info.i_dropped - p_sys->stat.i_dropped;
+
+    p_sys->stat.i_dropped = p_access->info.i_dropped;
+
+    if( !p_input || !libvlc_stats( p_access ) )
+        return;
+
+    /* The access may return a chain of packets */
+    uint64_t total;
+    size_t i_size;
+    int i_count;
+
+    block_ChainProperties( p_block, &i_count, &i_size, NULL );
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    if( i_count > 0 )
+    {
+        stats_Update( p_input->p->counters.p_read_bytes, i_size, &total );
+        stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
+        stats_Update( p_input->p->counters.p_read_packets, i_count, NULL );
+    }
+    if( i_dropped > 0 )
+        stats_Update( p_input->p->counters.p_dropped_packets, i_dropped,
+                      NULL );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
 static block_t *AReadBlock( stream_t *s, bool *pb_eof )
 {
     stream_sys_t *p_sys = s->p_sys;
     access_t *p_access = p_sys->p_access;
-    input_thread_t *p_input = s->p_input;
     block_t *p_block;
     bool b_eof;
 
@@ -1752,18 +2502,7 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
     {
         p_block = p_access->pf_block( p_access );
         if( pb_eof ) *pb_eof = p_access->info.b_eof;
-        if( p_input && p_block && libvlc_stats (p_access) )
-        {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate,
-                          total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
+        AReadBlockStats( s, p_access, p_block );
         return p_block;
     }
 
@@ -1787,24 +2526,12 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
             access_Delete( p_sys->p_list_access );
 
         p_sys->p_list_access = p_list_access;
+        p_sys->stat.i_dropped = 0;
 
         /* We have to read some data */
         return AReadBlock( s, pb_eof );
     }
-    if( p_block )
-    {
-        if( p_input )
-        {
-            uint64_t total;
-
-            vlc_mutex_lock( &p_input->p->counters.counters_lock );
-            stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
-            stats_Update( p_input->p->counters.p_input_bitrate, total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1 , NULL);
-            vlc_mutex_unlock( &p_input->p->counters.counters_lock );
-        }
-    }
+    AReadBlockStats( s, p_sys->p_list_access, p_block );
     return p_block;
 }
 
@@ -1936,6 +2663,14 @@ block_t *stream_Block( stream_t *s, int i_size )
 {
     if( i_size <= 0 ) return NULL;
 
+    /* Pass the access blocks (e.g. file mappings) through if possible */
+    if( s->pf_read == AStreamReadBlock && s->p_sys->block.b_fastseek )
+    {
+        block_t *p_bk = AStreamBlockBlock( s, i_size );
+        if( p_bk )
+            return p_bk;
+    }
+
     /* emulate block read */
     block_t *p_bk = block_Alloc( i_size );
     if( p_bk )
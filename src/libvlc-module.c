@@ -380,6 +380,19 @@ static const char *const ppsz_pos_descriptions[] =
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_PIPELINE_TEXT N_("Video filter pipeline depth")
+#define VIDEO_FILTER_PIPELINE_LONGTEXT N_( \
+    "Runs each video filter on its own thread, with up to this number of " \
+    "pictures waiting for each filter. This uses more CPU cores for long " \
+    "filter chains, but filter changes only apply from the next picture. " \
+    "0 runs the filters on the video output thread.")
+
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Maximum number of threads processing slices of a picture in the video " \
+    "filters and converters that support it. 0 uses one per CPU core, " \
+    "1 processes the whole picture on the thread calling the filter.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -676,6 +689,12 @@ static const char *const ppsz_prefres[] = {
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift disk budget (MiB)")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum total size of the timeshift temporary files. " \
+    "Already played data is kept within this budget so that playback " \
+    "can be rewound; when it is exhausted, the oldest data is dropped." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -823,6 +842,12 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_THREADS_TEXT N_( "HTTP server threads" )
+#define HTTP_THREADS_LONGTEXT N_( \
+    "Number of threads serving the clients of each HTTP, HTTPS and RTSP " \
+    "server. Zero uses one thread per CPU. This is only supported on " \
+    "Linux; other systems always use a single thread." )
+
 #define HTTP_CERT_TEXT N_("HTTP/TLS server certificate")
 #define CERT_LONGTEXT N_( \
    "This X.509 certicate file (PEM format) is used for server-side TLS. " \
@@ -895,6 +920,33 @@ static const char *const ppsz_prefres[] = {
     "This allows you to select a list of encoders that VLC will use in " \
     "priority.")
 
+#define DEC_FIFO_SIZE_TEXT N_("Decoder buffer size (kB)")
+#define DEC_FIFO_SIZE_LONGTEXT N_( \
+    "Amount of data waiting to be decoded, in kilobytes, above which the " \
+    "decoder buffer overflow policy applies. Zero means no limit." )
+
+#define DEC_FIFO_DURATION_TEXT N_("Decoder buffer duration (ms)")
+#define DEC_FIFO_DURATION_LONGTEXT N_( \
+    "Duration of the data waiting to be decoded, in milliseconds, above " \
+    "which the decoder buffer overflow policy applies. Zero means no limit." )
+
+#define DEC_FIFO_OVERFLOW_TEXT N_("Decoder buffer overflow policy")
+#define DEC_FIFO_OVERFLOW_LONGTEXT N_( \
+    "What to do when data is not decoded quickly enough: discard the " \
+    "oldest data, drop the new non-reference frames, or slow the input " \
+    "down." )
+
+#define DEC_FIFO_PACE_TEXT N_("Decoder pacing depth")
+#define DEC_FIFO_PACE_LONGTEXT N_( \
+    "Number of blocks waiting to be decoded above which the input is " \
+    "slowed down, when it is not a live source." )
+
+static const char *const ppsz_dec_fifo_overflow[] = {
+    "drop-oldest", "drop-nonref", "block" };
+static const char *const ppsz_dec_fifo_overflow_text[] = {
+    N_("Drop oldest data"), N_("Drop non-reference frames"),
+    N_("Slow the input down") };
+
 /*****************************************************************************
  * Sout
  ****************************************************************************/
@@ -986,6 +1038,16 @@ static const char *const ppsz_prefres[] = {
 #define STREAM_FILTER_LONGTEXT N_( \
     "Stream filters are used to modify the stream that is being read. " )
 
+#define STREAM_READAHEAD_TEXT N_("Read-ahead access modules")
+#define STREAM_READAHEAD_LONGTEXT N_( \
+    "Comma-separated list of access modules that are read from a separate " \
+    "thread, ahead of the demuxer. Only seekable accesses are concerned." )
+
+#define STREAM_READAHEAD_SIZE_TEXT N_("Read-ahead size (kB)")
+#define STREAM_READAHEAD_SIZE_LONGTEXT N_( \
+    "Amount of data read ahead of the demuxer, in kibibytes. " \
+    "0 disables reading ahead." )
+
 #define DEMUX_TEXT N_("Demux module")
 #define DEMUX_LONGTEXT N_( \
     "Demultiplexers are used to separate the \"elementary\" streams " \
@@ -1591,6 +1653,12 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list_cat( "video-filter", SUBCAT_VIDEO_VFILTER, NULL,
                 VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT, false )
+    add_integer( "video-filter-pipeline", 0, VIDEO_FILTER_PIPELINE_TEXT,
+                 VIDEO_FILTER_PIPELINE_LONGTEXT, true )
+        change_integer_range( 0, 16 )
+    add_integer( "filter-threads", 0, FILTER_THREADS_TEXT,
+                 FILTER_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
     add_module_list( "video-splitter", "video splitter", NULL,
                      VIDEO_SPLITTER_TEXT, VIDEO_SPLITTER_LONGTEXT, false )
     add_obsolete_string( "vout-filter" ) /* since 2.0.0 */
@@ -1726,6 +1794,9 @@ vlc_module_begin ()
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-threads", 0, HTTP_THREADS_TEXT, HTTP_THREADS_LONGTEXT,
+                 true )
+        change_integer_range( 0, 256 )
     add_loadfile( "http-cert", NULL, HTTP_CERT_TEXT, CERT_LONGTEXT, true )
     add_obsolete_string( "sout-http-cert" ) /* since 2.0.0 */
     add_loadfile( "http-key", NULL, HTTP_KEY_TEXT, KEY_LONGTEXT, true )
@@ -1839,6 +1910,8 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 4096, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -1849,6 +1922,17 @@ vlc_module_begin ()
                 CODEC_LONGTEXT, true )
     add_string( "encoder",  NULL, ENCODER_TEXT,
                 ENCODER_LONGTEXT, true )
+    add_integer( "dec-fifo-size", 400 * 1024, DEC_FIFO_SIZE_TEXT,
+                 DEC_FIFO_SIZE_LONGTEXT, true )
+    add_integer( "dec-fifo-duration", 0, DEC_FIFO_DURATION_TEXT,
+                 DEC_FIFO_DURATION_LONGTEXT, true )
+    add_string( "dec-fifo-overflow", ppsz_dec_fifo_overflow[0],
+                DEC_FIFO_OVERFLOW_TEXT, DEC_FIFO_OVERFLOW_LONGTEXT, true )
+        change_string_list( ppsz_dec_fifo_overflow,
+                            ppsz_dec_fifo_overflow_text )
+    add_integer( "dec-fifo-pace", 10, DEC_FIFO_PACE_TEXT,
+                 DEC_FIFO_PACE_LONGTEXT, true )
+        change_integer_range( 1, 4096 )
 
     set_subcategory( SUBCAT_INPUT_ACCESS )
     add_category_hint( N_("Input"), INPUT_CAT_LONGTEXT , false )
@@ -1863,6 +1947,10 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
     add_module_list( "stream-filter", "stream_filter", NULL,
                      STREAM_FILTER_TEXT, STREAM_FILTER_LONGTEXT, false )
+    add_string( "stream-readahead", "file,smb,nfs,http,https",
+                STREAM_READAHEAD_TEXT, STREAM_READAHEAD_LONGTEXT, true )
+    add_integer( "stream-readahead-size", 4096, STREAM_READAHEAD_SIZE_TEXT,
+                 STREAM_READAHEAD_SIZE_LONGTEXT, true )
 
 
 /* Stream output options */
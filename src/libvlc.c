@@ -102,8 +102,10 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->playlist = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
+    priv->slice_pool = NULL;
 
     vlc_ExitInit( &priv->exit );
+    vlc_block_Init();
 
     return p_libvlc;
 }
@@ -528,6 +530,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     vlc_DeinitActions( p_libvlc, priv->actions );
 
+    if( priv->slice_pool != NULL )
+        filter_SlicePoolDelete( priv->slice_pool );
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
@@ -555,6 +560,7 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
 
     assert( atomic_load(&(vlc_internals(p_libvlc)->refs)) == 1 );
     vlc_object_release( p_libvlc );
+    vlc_block_Deinit();
 }
 
 /*****************************************************************************
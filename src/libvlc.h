@@ -70,6 +70,12 @@ void vlc_assert_locked (vlc_mutex_t *);
 # define vlc_assert_locked( m ) (void)m
 #endif
 
+/*
+ * Block allocator
+ */
+void vlc_block_Init(void);
+void vlc_block_Deinit(void);
+
 /*
  * Logging
  */
@@ -154,6 +160,7 @@ typedef struct libvlc_priv_t
     struct playlist_t *playlist; ///< Playlist for interfaces
     struct playlist_preparser_t *parser; ///< Input item meta data handler
     struct vlc_actions *actions; ///< Hotkeys handler
+    struct filter_slice_pool *slice_pool; ///< Video filter slice threads
 
     /* Objects tree */
     vlc_mutex_t        structure_lock;
@@ -167,6 +174,8 @@ static inline libvlc_priv_t *libvlc_priv (libvlc_int_t *libvlc)
     return (libvlc_priv_t *)libvlc;
 }
 
+void filter_SlicePoolDelete (struct filter_slice_pool *);
+
 void intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                      const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
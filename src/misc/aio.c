@@ -0,0 +1,521 @@
+/*****************************************************************************
+ * aio.c: asynchronous file writing
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/uio.h>
+# include <linux/io_uring.h>
+# include <vlc_atomic.h>
+#endif
+
+#if defined (HAVE_LINUX_IO_URING_H) && defined (__NR_io_uring_setup)
+/**
+ * @section io_uring writer
+ *
+ * Small writes (typically a few TS packets) are gathered into a few large
+ * buffers. Each full buffer is written with one asynchronous request at an
+ * explicit file offset, so that the calling thread never waits for the disk
+ * unless all buffers are in flight. The buffers and the file are registered
+ * with the kernel once, to save the per-request mapping costs.
+ *
+ * The kernel interface is used directly, so as not to depend on liburing.
+ */
+
+/** Number of write buffers (and maximum number of requests in flight) */
+#define AIO_BUFFERS     4
+/** Size of each write buffer */
+#define AIO_BUFFER_SIZE (256 * 1024)
+/** Maximum time data is kept in a partially filled buffer */
+#define AIO_DELAY       CLOCK_FREQ
+
+struct vlc_aio_writer
+{
+    int ring_fd;
+    int fd;
+    bool fixed; /**< Buffers and file are registered */
+
+    /* Submission queue */
+    void *sq_ptr;
+    size_t sq_size;
+    atomic_uint *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned to_submit;
+
+    /* Completion queue */
+    void *cq_ptr;
+    size_t cq_size;
+    atomic_uint *cq_head;
+    atomic_uint *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    uint64_t offset; /**< File offset of the next byte */
+    unsigned current; /**< Buffer being filled */
+    size_t fill; /**< Bytes in the current buffer */
+    mtime_t date; /**< Date of the first byte of the current buffer */
+    unsigned pending; /**< Requests in flight */
+    int error; /**< First error (errno value), or 0 */
+
+    bool busy[AIO_BUFFERS];
+    struct iovec iov[AIO_BUFFERS];
+    uint8_t *base;
+};
+
+static int aio_enter (vlc_aio_writer_t *w, unsigned submit, unsigned wait)
+{
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+    for (;;)
+    {
+        int val = syscall (__NR_io_uring_enter, w->ring_fd, submit, wait,
+                           flags, NULL, 0);
+        if (val >= 0)
+        {
+            assert ((unsigned)val <= submit);
+            w->to_submit -= val;
+            return 0;
+        }
+        if (errno != EINTR)
+            return -1;
+    }
+}
+
+/** Processes completed requests */
+static void aio_reap (vlc_aio_writer_t *w)
+{
+    unsigned head = atomic_load_explicit (w->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit (w->cq_tail, memory_order_acquire);
+
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = &w->cqes[head & w->cq_mask];
+        unsigned i = cqe->user_data;
+
+        assert (i < AIO_BUFFERS && w->busy[i]);
+        if (cqe->res < 0)
+        {
+            if (w->error == 0)
+                w->error = -cqe->res;
+        }
+        else if ((size_t)cqe->res != w->iov[i].iov_len && w->error == 0)
+            w->error = ENOSPC; /* short write to a regular file */
+
+        w->busy[i] = false;
+        w->pending--;
+        head++;
+    }
+    atomic_store_explicit (w->cq_head, head, memory_order_release);
+}
+
+/** Waits for at least one request to complete */
+static int aio_wait (vlc_aio_writer_t *w)
+{
+    assert (w->pending > 0);
+
+    if (aio_enter (w, w->to_submit, 1))
+    {
+        if (w->error == 0)
+            w->error = errno;
+        return -1;
+    }
+    aio_reap (w);
+    return 0;
+}
+
+/** Queues the write of the current buffer (without submitting it) */
+static void aio_queue (vlc_aio_writer_t *w)
+{
+    unsigned i = w->current;
+
+    if (w->fill == 0)
+        return;
+
+    unsigned tail = atomic_load_explicit (w->sq_tail, memory_order_relaxed);
+    unsigned idx = tail & w->sq_mask;
+    struct io_uring_sqe *sqe = &w->sqes[idx];
+
+    /* There are as many entries as buffers: one is necessarily free */
+    memset (sqe, 0, sizeof (*sqe));
+    if (w->fixed)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 0;
+        sqe->buf_index = i;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = w->fd;
+    }
+    sqe->addr = (uintptr_t)w->iov[i].iov_base;
+    sqe->len = w->fill;
+    sqe->off = w->offset;
+    sqe->user_data = i;
+    w->sq_array[idx] = idx;
+    atomic_store_explicit (w->sq_tail, tail + 1, memory_order_release);
+
+    w->iov[i].iov_len = w->fill;
+    w->busy[i] = true;
+    w->pending++;
+    w->to_submit++;
+    w->offset += w->fill;
+    w->fill = 0;
+}
+
+/** Selects a free buffer to fill, waiting if needed */
+static int aio_next (vlc_aio_writer_t *w)
+{
+    for (;;)
+    {
+        for (unsigned i = 0; i < AIO_BUFFERS; i++)
+            if (!w->busy[i])
+            {
+                w->current = i;
+                return 0;
+            }
+        if (aio_wait (w))
+            return -1;
+    }
+}
+
+static void aio_unmap (vlc_aio_writer_t *w)
+{
+    if (w->sqes != NULL)
+        munmap (w->sqes, w->sqes_size);
+    if (w->cq_ptr != NULL && w->cq_ptr != w->sq_ptr)
+        munmap (w->cq_ptr, w->cq_size);
+    if (w->sq_ptr != NULL)
+        munmap (w->sq_ptr, w->sq_size);
+}
+
+/** Checks that the kernel supports an operation */
+static bool aio_probe (int ring_fd, unsigned op)
+{
+    const unsigned count = 256;
+    struct io_uring_probe *probe =
+        calloc (1, sizeof (*probe) + count * sizeof (probe->ops[0]));
+    if (unlikely(probe == NULL))
+        return false;
+
+    /* The probe itself only exists since Linux 5.6 */
+    bool ok = syscall (__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE,
+                       probe, count) == 0
+           && op < probe->ops_len
+           && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    free (probe);
+    return ok;
+}
+
+/**
+ * Creates an asynchronous writer for a regular file.
+ *
+ * @param fd file descriptor (must remain open until vlc_aio_WriterDelete())
+ * @param offset file offset of the first write
+ * @return a writer, or NULL if asynchronous I/O is not available; the caller
+ * should then use plain write() calls.
+ */
+vlc_aio_writer_t *vlc_aio_WriterNew (int fd, uint64_t offset)
+{
+    vlc_aio_writer_t *w = calloc (1, sizeof (*w));
+    if (unlikely(w == NULL))
+        return NULL;
+
+    struct io_uring_params p;
+    memset (&p, 0, sizeof (p));
+    w->ring_fd = syscall (__NR_io_uring_setup, AIO_BUFFERS, &p);
+    if (w->ring_fd == -1)
+    {
+        free (w);
+        return NULL;
+    }
+
+    w->sq_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    w->cq_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        w->sq_size = w->cq_size = __MAX(w->sq_size, w->cq_size);
+
+    w->sq_ptr = mmap (NULL, w->sq_size, PROT_READ|PROT_WRITE,
+                      MAP_SHARED|MAP_POPULATE, w->ring_fd, IORING_OFF_SQ_RING);
+    if (w->sq_ptr == MAP_FAILED)
+    {
+        w->sq_ptr = NULL;
+        goto error;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        w->cq_ptr = w->sq_ptr;
+    else
+    {
+        w->cq_ptr = mmap (NULL, w->cq_size, PROT_READ|PROT_WRITE,
+                          MAP_SHARED|MAP_POPULATE, w->ring_fd,
+                          IORING_OFF_CQ_RING);
+        if (w->cq_ptr == MAP_FAILED)
+        {
+            w->cq_ptr = NULL;
+            goto error;
+        }
+    }
+    w->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+    w->sqes = mmap (NULL, w->sqes_size, PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_POPULATE, w->ring_fd, IORING_OFF_SQES);
+    if (w->sqes == MAP_FAILED)
+    {
+        w->sqes = NULL;
+        goto error;
+    }
+
+    uint8_t *sq = w->sq_ptr, *cq = w->cq_ptr;
+    w->sq_tail = (atomic_uint *)(sq + p.sq_off.tail);
+    w->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    w->sq_array = (unsigned *)(sq + p.sq_off.array);
+    w->cq_head = (atomic_uint *)(cq + p.cq_off.head);
+    w->cq_tail = (atomic_uint *)(cq + p.cq_off.tail);
+    w->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    w->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    w->base = vlc_memalign (4096, AIO_BUFFERS * AIO_BUFFER_SIZE);
+    if (unlikely(w->base == NULL))
+        goto error;
+    for (unsigned i = 0; i < AIO_BUFFERS; i++)
+    {
+        w->iov[i].iov_base = w->base + i * AIO_BUFFER_SIZE;
+        w->iov[i].iov_len = AIO_BUFFER_SIZE;
+    }
+
+    /* Registration pins the buffers, which can exceed RLIMIT_MEMLOCK.
+     * Unregistered buffers work too, only slightly slower. */
+    w->fd = fd;
+    w->fixed =
+        syscall (__NR_io_uring_register, w->ring_fd, IORING_REGISTER_BUFFERS,
+                 w->iov, AIO_BUFFERS) == 0;
+    if (w->fixed
+     && syscall (__NR_io_uring_register, w->ring_fd, IORING_REGISTER_FILES,
+                 &w->fd, 1) != 0)
+    {
+        syscall (__NR_io_uring_register, w->ring_fd,
+                 IORING_UNREGISTER_BUFFERS, NULL, 0);
+        w->fixed = false;
+    }
+
+    /* Unregistered buffers are written with IORING_OP_WRITE, which came with
+     * Linux 5.6. Before that, the ring can be set up but every such write
+     * fails with EINVAL. */
+    if (!w->fixed && !aio_probe (w->ring_fd, IORING_OP_WRITE))
+        goto error;
+
+    w->offset = offset;
+    return w;
+
+error:
+    aio_unmap (w);
+    close (w->ring_fd);
+    vlc_free (w->base);
+    free (w);
+    return NULL;
+}
+
+/**
+ * Writes all pending data and waits for completion.
+ *
+ * @return 0 on success, -1 if any write failed since the last call (errno is
+ * set).
+ */
+int vlc_aio_Sync (vlc_aio_writer_t *w)
+{
+    aio_queue (w);
+    if (w->to_submit > 0 && aio_enter (w, w->to_submit, 0) && w->error == 0)
+        w->error = errno;
+
+    while (w->pending > 0)
+        if (aio_wait (w))
+            break;
+
+    if (w->error != 0)
+    {
+        errno = w->error;
+        w->error = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Destroys an asynchronous writer, after writing all pending data.
+ * The file descriptor is not closed.
+ */
+void vlc_aio_WriterDelete (vlc_aio_writer_t *w)
+{
+    vlc_aio_Sync (w);
+    while (w->pending > 0 && aio_wait (w) == 0);
+
+    aio_unmap (w);
+    close (w->ring_fd); /* also unregisters the buffers and the file */
+    vlc_free (w->base);
+    free (w);
+}
+
+/**
+ * Writes a chain of blocks at the current offset, and releases it.
+ *
+ * The data may still be in flight when this function returns. Errors are
+ * reported by the next call.
+ *
+ * @return the number of bytes, or -1 on error (errno is set).
+ */
+ssize_t vlc_aio_Write (vlc_aio_writer_t *w, block_t *block)
+{
+    size_t total = 0;
+
+    if (w->error != 0)
+    {
+        errno = w->error;
+        w->error = 0;
+        block_ChainRelease (block);
+        return -1;
+    }
+
+    while (block != NULL)
+    {
+        const uint8_t *buf = block->p_buffer;
+        size_t len = block->i_buffer;
+
+        while (len > 0)
+        {
+            if (w->fill == 0)
+                w->date = mdate ();
+
+            size_t copy = __MIN(len, AIO_BUFFER_SIZE - w->fill);
+
+            memcpy ((uint8_t *)w->iov[w->current].iov_base + w->fill, buf,
+                    copy);
+            w->fill += copy;
+            buf += copy;
+            len -= copy;
+            total += copy;
+
+            if (w->fill == AIO_BUFFER_SIZE)
+            {
+                aio_queue (w);
+                if (aio_next (w))
+                    goto error;
+            }
+        }
+
+        block_t *next = block->p_next;
+        block_Release (block);
+        block = next;
+    }
+
+    /* Do not keep a slow stream in memory for too long */
+    if (w->fill > 0 && mdate () - w->date >= AIO_DELAY)
+    {
+        aio_queue (w);
+        if (aio_next (w))
+            goto error;
+    }
+
+    /* Submit all buffers filled by this call at once */
+    if (w->to_submit > 0 && aio_enter (w, w->to_submit, 0))
+        goto error;
+    aio_reap (w);
+    return total;
+
+error:
+    block_ChainRelease (block);
+    errno = w->error ? w->error : errno;
+    w->error = 0;
+    return -1;
+}
+
+/**
+ * Changes the offset of the next write.
+ * Pending writes are completed first.
+ */
+int vlc_aio_Seek (vlc_aio_writer_t *w, uint64_t offset)
+{
+    int val = vlc_aio_Sync (w);
+
+    w->offset = offset;
+    return val;
+}
+
+/**
+ * Returns the offset of the next write.
+ */
+uint64_t vlc_aio_Tell (const vlc_aio_writer_t *w)
+{
+    return w->offset + w->fill;
+}
+
+#else /* !io_uring */
+vlc_aio_writer_t *vlc_aio_WriterNew (int fd, uint64_t offset)
+{
+    (void) fd; (void) offset;
+    return NULL;
+}
+
+void vlc_aio_WriterDelete (vlc_aio_writer_t *w)
+{
+    (void) w;
+    vlc_assert_unreachable ();
+}
+
+ssize_t vlc_aio_Write (vlc_aio_writer_t *w, block_t *block)
+{
+    (void) w; (void) block;
+    vlc_assert_unreachable ();
+}
+
+int vlc_aio_Sync (vlc_aio_writer_t *w)
+{
+    (void) w;
+    vlc_assert_unreachable ();
+}
+
+int vlc_aio_Seek (vlc_aio_writer_t *w, uint64_t offset)
+{
+    (void) w; (void) offset;
+    vlc_assert_unreachable ();
+}
+
+uint64_t vlc_aio_Tell (const vlc_aio_writer_t *w)
+{
+    (void) w;
+    vlc_assert_unreachable ();
+}
+#endif
@@ -33,10 +33,15 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -97,12 +102,427 @@ void block_Init( block_t *restrict b, void *buf, size_t size )
 #endif
 }
 
+/** Initial memory alignment of data block.
+ * @note This must be a multiple of sizeof(void*) and a power of two.
+ * libavcodec AVX optimizations require at least 32-bytes. */
+#define BLOCK_ALIGN        32
+
+/** Initial reserved header and footer size. */
+#define BLOCK_PADDING      32
+
+/* Maximum size of reserved footer before shrinking with realloc(). */
+#define BLOCK_WASTE_SIZE   2048
+
+/**
+ * Storage of a block allocated with block_Alloc().
+ * The payload follows the structure in memory. It is shared by the block
+ * itself and all the blocks created from it with block_Share().
+ */
+typedef struct
+{
+    block_t     self;
+    atomic_uint refs; /**< Number of blocks referencing the payload */
+    unsigned    cls; /**< Size class (BLOCK_CLASSES if none) */
+} block_sys_t;
+
+/** Block sharing the payload of another block (see block_Share()). */
+typedef struct
+{
+    block_t      self;
+    block_sys_t *storage;
+} block_shared_t;
+
+/**
+ * @section Block storage allocator.
+ *
+ * Storage for small and medium blocks is recycled through a set of size
+ * classes. Each thread keeps a cache of free storage per class, so that most
+ * allocations and releases involve neither the heap nor any lock. Caches
+ * exchange storage in batches with a global depot when they run empty or
+ * full, which serves producer/consumer pairs of threads (e.g. an access
+ * thread allocating packets and a decoder thread releasing them).
+ */
+
+/** Block allocator size classes */
+static const struct
+{
+    size_t   size; /**< Largest payload size of the class */
+    unsigned depth; /**< Maximum number of free storage cached per thread */
+} block_classes[] =
+{
+    {   256, 256 }, /* TS packets (188 or 204 bytes) */
+    {  1536, 128 }, /* Ethernet MTU, 7 TS packets */
+    {  4096,  64 }, /* Audio frames and small PES */
+    { 16384,  32 }, /* PES */
+    { 65536,  16 }, /* Largest UDP datagram, large PES */
+};
+#define BLOCK_CLASSES ARRAY_SIZE(block_classes)
+
+/** Pseudo size class of the storage of blocks from block_mmap_Alloc() */
+#define BLOCK_CLASS_MMAP (BLOCK_CLASSES + 1)
+
+/** Ratio of storage kept in the depot to the thread cache depth per class */
+#define BLOCK_DEPOT_RATIO  4
+
+/** Number of allocations between two updates of the global statistics */
+#define BLOCK_STATS_PERIOD 256
+
+typedef struct
+{
+    block_sys_t  *free[BLOCK_CLASSES]; /**< Free storage (linked by p_next) */
+    unsigned      count[BLOCK_CLASSES];
+    block_stats_t stats; /**< Statistics not yet accounted globally */
+} block_cache_t;
+
+static vlc_mutex_t block_depot_lock = VLC_STATIC_MUTEX;
+static block_sys_t *block_depot[BLOCK_CLASSES];
+static unsigned block_depot_count[BLOCK_CLASSES];
+static block_stats_t block_stats;
+static vlc_threadvar_t block_cache_key;
+static atomic_bool block_cache_ready = ATOMIC_VAR_INIT(false);
+static bool block_cache_failed = false;
+static unsigned block_users = 0;
+
+static unsigned BlockClass (size_t size)
+{
+    unsigned cls = 0;
+
+    while (cls < BLOCK_CLASSES && size > block_classes[cls].size)
+        cls++;
+    return cls;
+}
+
+/** Accounts thread statistics globally. Depot lock must be held. */
+static void BlockCachePublish (block_cache_t *cache)
+{
+    block_stats.i_alloc += cache->stats.i_alloc;
+    block_stats.i_heap += cache->stats.i_heap;
+    block_stats.i_refill += cache->stats.i_refill;
+    block_stats.i_flush += cache->stats.i_flush;
+    memset (&cache->stats, 0, sizeof (cache->stats));
+}
+
+/** Frees a list of storage linked by p_next. */
+static void BlockStorageFreeList (block_sys_t *sys)
+{
+    while (sys != NULL)
+    {
+        block_sys_t *next = (block_sys_t *)sys->self.p_next;
+
+        free (sys);
+        sys = next;
+    }
+}
+
+/** Moves up to half a cache worth of storage from the depot to the cache. */
+static void BlockCacheRefill (block_cache_t *cache, unsigned cls)
+{
+    unsigned n = block_classes[cls].depth / 2;
+
+    vlc_mutex_lock (&block_depot_lock);
+    if (block_depot[cls] != NULL)
+        cache->stats.i_refill++;
+    while (n > 0 && block_depot[cls] != NULL)
+    {
+        block_sys_t *sys = block_depot[cls];
+
+        block_depot[cls] = (block_sys_t *)sys->self.p_next;
+        block_depot_count[cls]--;
+        sys->self.p_next = (block_t *)cache->free[cls];
+        cache->free[cls] = sys;
+        cache->count[cls]++;
+        n--;
+    }
+    BlockCachePublish (cache);
+    vlc_mutex_unlock (&block_depot_lock);
+}
+
+/**
+ * Moves up to @p n storage from the cache to the depot. Storage in excess of
+ * the depot capacity is freed.
+ */
+static void BlockCacheFlush (block_cache_t *cache, unsigned cls, unsigned n)
+{
+    const unsigned max = BLOCK_DEPOT_RATIO * block_classes[cls].depth;
+    block_sys_t *excess = NULL;
+
+    vlc_mutex_lock (&block_depot_lock);
+    cache->stats.i_flush++;
+    while (n > 0 && cache->free[cls] != NULL)
+    {
+        block_sys_t *sys = cache->free[cls];
+
+        cache->free[cls] = (block_sys_t *)sys->self.p_next;
+        cache->count[cls]--;
+        if (block_depot_count[cls] < max)
+        {
+            sys->self.p_next = (block_t *)block_depot[cls];
+            block_depot[cls] = sys;
+            block_depot_count[cls]++;
+        }
+        else
+        {
+            sys->self.p_next = (block_t *)excess;
+            excess = sys;
+        }
+        n--;
+    }
+    BlockCachePublish (cache);
+    vlc_mutex_unlock (&block_depot_lock);
+
+    BlockStorageFreeList (excess);
+}
+
+/** Returns the storage cached by an exiting thread to the depot. */
+static void BlockCacheDestroy (void *data)
+{
+    block_cache_t *cache = data;
+
+    for (unsigned cls = 0; cls < BLOCK_CLASSES; cls++)
+        BlockCacheFlush (cache, cls, cache->count[cls]);
+    free (cache);
+}
+
+/**
+ * Returns the storage cache of the calling thread, creating it if needed.
+ * @return the cache, or NULL if thread-local storage is not available
+ */
+static block_cache_t *BlockCacheGet (void)
+{
+    if (unlikely(!atomic_load_explicit (&block_cache_ready,
+                                        memory_order_acquire)))
+    {
+        vlc_mutex_lock (&block_depot_lock);
+        if (!atomic_load_explicit (&block_cache_ready, memory_order_relaxed)
+         && !block_cache_failed)
+        {
+            if (vlc_threadvar_create (&block_cache_key, BlockCacheDestroy))
+                block_cache_failed = true;
+            else
+                atomic_store_explicit (&block_cache_ready, true,
+                                       memory_order_release);
+        }
+        vlc_mutex_unlock (&block_depot_lock);
+
+        if (block_cache_failed)
+            return NULL;
+    }
+
+    block_cache_t *cache = vlc_threadvar_get (block_cache_key);
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc (1, sizeof (*cache));
+        if (unlikely(cache == NULL))
+            return NULL;
+        if (vlc_threadvar_set (block_cache_key, cache))
+        {
+            free (cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+/**
+ * Registers a user of the block allocator (i.e. a LibVLC instance).
+ */
+void vlc_block_Init (void)
+{
+    vlc_mutex_lock (&block_depot_lock);
+    block_users++;
+    vlc_mutex_unlock (&block_depot_lock);
+}
+
+/**
+ * Unregisters a user of the block allocator. When the last one goes away,
+ * the storage cached by the calling thread and by the depot is freed, and
+ * the thread cache key is deleted. The other threads have exited by then, so
+ * their caches were already returned to the depot.
+ */
+void vlc_block_Deinit (void)
+{
+    vlc_mutex_lock (&block_depot_lock);
+    assert (block_users > 0);
+    if (--block_users > 0)
+    {
+        vlc_mutex_unlock (&block_depot_lock);
+        return;
+    }
+
+    if (atomic_load_explicit (&block_cache_ready, memory_order_relaxed))
+    {
+        block_cache_t *cache = vlc_threadvar_get (block_cache_key);
+
+        if (cache != NULL)
+        {
+            vlc_threadvar_set (block_cache_key, NULL);
+            for (unsigned cls = 0; cls < BLOCK_CLASSES; cls++)
+                BlockStorageFreeList (cache->free[cls]);
+            free (cache);
+        }
+        vlc_threadvar_delete (&block_cache_key);
+        atomic_store_explicit (&block_cache_ready, false,
+                               memory_order_relaxed);
+    }
+    block_cache_failed = false;
+
+    for (unsigned cls = 0; cls < BLOCK_CLASSES; cls++)
+    {
+        BlockStorageFreeList (block_depot[cls]);
+        block_depot[cls] = NULL;
+        block_depot_count[cls] = 0;
+    }
+    vlc_mutex_unlock (&block_depot_lock);
+}
+
+/**
+ * Allocates storage for a block of (at least) the given payload size.
+ * @param alloc total allocation size for the payload size
+ */
+static block_sys_t *BlockStorageAlloc (size_t size, size_t alloc)
+{
+    unsigned cls = BlockClass (size);
+    block_cache_t *cache = NULL;
+    block_sys_t *sys;
+
+    if (cls < BLOCK_CLASSES)
+    {
+        cache = BlockCacheGet ();
+        if (likely(cache != NULL))
+        {
+            if (cache->free[cls] == NULL)
+                BlockCacheRefill (cache, cls);
+
+            sys = cache->free[cls];
+            if (likely(sys != NULL))
+            {
+                cache->free[cls] = (block_sys_t *)sys->self.p_next;
+                cache->count[cls]--;
+                if (++cache->stats.i_alloc >= BLOCK_STATS_PERIOD)
+                {
+                    vlc_mutex_lock (&block_depot_lock);
+                    BlockCachePublish (cache);
+                    vlc_mutex_unlock (&block_depot_lock);
+                }
+                return sys;
+            }
+        }
+        /* Allocate the whole class size so the storage can be recycled */
+        alloc += block_classes[cls].size - size;
+    }
+
+    sys = malloc (alloc);
+    if (unlikely(sys == NULL))
+        return NULL;
+    sys->cls = cls;
+
+    if (cache != NULL)
+    {
+        cache->stats.i_alloc++;
+        cache->stats.i_heap++;
+    }
+    else
+    {
+        vlc_mutex_lock (&block_depot_lock);
+        block_stats.i_alloc++;
+        block_stats.i_heap++;
+        vlc_mutex_unlock (&block_depot_lock);
+    }
+    return sys;
+}
+
+static void BlockStorageFree (block_sys_t *sys)
+{
+    unsigned cls = sys->cls;
+
+#ifdef HAVE_MMAP
+    if (cls == BLOCK_CLASS_MMAP)
+        munmap (sys->self.p_start, sys->self.i_size);
+#endif
+
+    if (cls < BLOCK_CLASSES)
+    {
+        block_cache_t *cache = BlockCacheGet ();
+        if (likely(cache != NULL))
+        {
+            if (cache->count[cls] >= block_classes[cls].depth)
+                BlockCacheFlush (cache, cls, block_classes[cls].depth / 2);
+            sys->self.p_next = (block_t *)cache->free[cls];
+            cache->free[cls] = sys;
+            cache->count[cls]++;
+            return;
+        }
+    }
+    free (sys);
+}
+
+/**
+ * Gets the block allocator statistics.
+ * Each thread accounts its activity periodically, so the counters may lag
+ * slightly behind.
+ */
+void block_GetStats (block_stats_t *stats)
+{
+    vlc_mutex_lock (&block_depot_lock);
+    *stats = block_stats;
+    stats->i_cached = 0;
+    for (unsigned cls = 0; cls < BLOCK_CLASSES; cls++)
+        stats->i_cached += block_depot_count[cls];
+    vlc_mutex_unlock (&block_depot_lock);
+}
+
+static void BlockStorageRelease (block_sys_t *sys)
+{
+    unsigned refs = atomic_fetch_sub (&sys->refs, 1);
+    assert (refs > 0);
+    if (refs == 1)
+        BlockStorageFree (sys);
+}
+
 static void block_generic_Release (block_t *block)
 {
     /* That is always true for blocks allocated with block_Alloc(). */
-    assert (block->p_start == (unsigned char *)(block + 1));
+    assert (block->p_start == (unsigned char *)((block_sys_t *)block + 1));
+    block_Invalidate (block);
+    BlockStorageRelease ((block_sys_t *)block);
+}
+
+static void block_shared_Release (block_t *block)
+{
+    block_sys_t *sys = ((block_shared_t *)block)->storage;
+
     block_Invalidate (block);
     free (block);
+    BlockStorageRelease (sys);
+}
+
+/**
+ * Returns the reference-counted storage of a block, or NULL if the block
+ * was not allocated by block_Alloc() nor block_mmap_Alloc() (nor shared from
+ * such a block).
+ */
+#ifdef HAVE_MMAP
+static void block_mmap_Release (block_t *);
+#endif
+
+static block_sys_t *BlockGetStorage (const block_t *block)
+{
+    if (block->pf_release == block_generic_Release)
+        return (block_sys_t *)block;
+#ifdef HAVE_MMAP
+    if (block->pf_release == block_mmap_Release)
+        return (block_sys_t *)block;
+#endif
+    if (block->pf_release == block_shared_Release)
+        return ((const block_shared_t *)block)->storage;
+    return NULL;
+}
+
+static bool BlockIsShared (const block_t *block)
+{
+    block_sys_t *sys = BlockGetStorage (block);
+
+    return sys != NULL && atomic_load (&sys->refs) > 1;
 }
 
 static void BlockMetaCopy( block_t *restrict out, const block_t *in )
@@ -115,30 +535,21 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
     out->i_length  = in->i_length;
 }
 
-/** Initial memory alignment of data block.
- * @note This must be a multiple of sizeof(void*) and a power of two.
- * libavcodec AVX optimizations require at least 32-bytes. */
-#define BLOCK_ALIGN        32
-
-/** Initial reserved header and footer size. */
-#define BLOCK_PADDING      32
-
-/* Maximum size of reserved footer before shrinking with realloc(). */
-#define BLOCK_WASTE_SIZE   2048
-
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    const size_t alloc = sizeof (block_sys_t) + BLOCK_ALIGN
+                       + (2 * BLOCK_PADDING) + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
-    if (unlikely(b == NULL))
+    block_sys_t *sys = BlockStorageAlloc (size, alloc);
+    if (unlikely(sys == NULL))
         return NULL;
 
-    block_Init (b, b + 1, alloc - sizeof (*b));
+    block_t *b = &sys->self;
+    atomic_init (&sys->refs, 1);
+    block_Init (b, sys + 1, alloc - sizeof (*sys));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
@@ -170,7 +581,7 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
          p_block->i_buffer = 0; /* discard current payload */
     if( p_block->i_buffer == 0 )
     {
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !BlockIsShared( p_block ) )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -205,11 +616,14 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     uint8_t *p_start = p_block->p_start;
     uint8_t *p_end = p_start + p_block->i_size;
 
-    /* Second, reallocate the buffer if we lack space. This is done now to
-     * minimize the payload size for memory copy. */
+    /* Second, reallocate the buffer if we lack space, or if the payload is
+     * to be expanded over a buffer shared with other blocks. This is done now
+     * to minimize the payload size for memory copy. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || ((i_prebody > 0 || p_block->i_buffer < i_body)
+      && BlockIsShared( p_block )) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
@@ -261,6 +675,70 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
 }
 
 
+/**
+ * Creates a block sharing the payload of another block.
+ *
+ * Unlike block_Duplicate(), the payload is not copied if the block was
+ * allocated with block_Alloc() or block_mmap_Alloc(): the new block only
+ * holds a reference to it.
+ * The new block has the same payload and properties as the original, but its
+ * own header, so that either can be trimmed, chained or released
+ * independently. Blocks of other types are copied.
+ *
+ * The payload of a shared block must not be modified in place. Use
+ * block_Unshare() first. block_Realloc() takes care of that automatically.
+ *
+ * @return a new block, or NULL on memory error
+ */
+block_t *block_Share (block_t *block)
+{
+    block_sys_t *sys = BlockGetStorage (block);
+    if (sys == NULL)
+        return block_Duplicate (block);
+
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+        return NULL;
+
+    block_t *b = &shared->self;
+    block_Init (b, block->p_start, block->i_size);
+    b->p_buffer = block->p_buffer;
+    b->i_buffer = block->i_buffer;
+    b->pf_release = block_shared_Release;
+    block_CopyProperties (b, block);
+
+    unsigned refs = atomic_fetch_add (&sys->refs, 1);
+    assert (refs > 0);
+    (void) refs;
+    shared->storage = sys;
+    return b;
+}
+
+/**
+ * Ensures that the payload of a block can be written to.
+ *
+ * If the payload is shared with other blocks (see block_Share()), it is
+ * copied into a new block, and the original block is released. Otherwise,
+ * the block is returned unchanged.
+ *
+ * @return a block with a private payload, or NULL on memory error (the
+ * original block is released in that case)
+ */
+block_t *block_Unshare (block_t *block)
+{
+    if (!BlockIsShared (block))
+        return block;
+
+    block_t *dup = block_Alloc (block->i_buffer);
+    if (likely(dup != NULL))
+    {
+        BlockMetaCopy (dup, block);
+        memcpy (dup->p_buffer, block->p_buffer, block->i_buffer);
+    }
+    block_Release (block);
+    return dup;
+}
+
 static void block_heap_Release (block_t *block)
 {
     block_Invalidate (block);
@@ -295,13 +773,10 @@ block_t *block_heap_Alloc (void *addr, size_t length)
 }
 
 #ifdef HAVE_MMAP
-# include <sys/mman.h>
-
 static void block_mmap_Release (block_t *block)
 {
     block_Invalidate (block);
-    munmap (block->p_start, block->i_size);
-    free (block);
+    BlockStorageRelease ((block_sys_t *)block);
 }
 
 /**
@@ -319,13 +794,18 @@ block_t *block_mmap_Alloc (void *addr, size_t length)
     if (addr == MAP_FAILED)
         return NULL;
 
-    block_t *block = malloc (sizeof (*block));
-    if (block == NULL)
+    /* The mapping is reference-counted like block_Alloc() storage, so that
+     * parts of it can be handed out with block_Share(). */
+    block_sys_t *sys = malloc (sizeof (*sys));
+    if (sys == NULL)
     {
         munmap (addr, length);
         return NULL;
     }
 
+    block_t *block = &sys->self;
+    atomic_init (&sys->refs, 1);
+    sys->cls = BLOCK_CLASS_MMAP;
     block_Init (block, addr, length);
     block->pf_release = block_mmap_Release;
     return block;
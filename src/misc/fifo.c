@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "libvlc.h"
 
 /**
@@ -359,3 +360,440 @@ size_t block_FifoCount (block_fifo_t *fifo)
     vlc_mutex_unlock (&fifo->lock);
     return depth;
 }
+
+/**
+ * @section Single producer, single consumer block rings
+ *
+ * Unlike FIFOs, block rings take no lock to queue or dequeue blocks: only
+ * one thread may queue blocks (the producer), and only one other thread may
+ * dequeue them (the consumer). The lock is only taken by a thread going to
+ * sleep, and by the other thread if and only if it must wake it up.
+ */
+
+/**
+ * Internal state for block rings
+ */
+struct block_ring_t
+{
+    /* Written by the producer */
+    atomic_size_t       tail;    /**< Index of the next block to queue */
+    atomic_size_t       flush;   /**< Blocks queued before are discarded */
+    atomic_uintptr_t    marker;  /**< Block to return after a flush */
+    atomic_llong        last_ts; /**< Date of the last queued block */
+
+    /* Written by the consumer */
+    atomic_size_t       head;    /**< Index of the next block to dequeue */
+    atomic_llong        first_ts; /**< Date of the last dequeued block */
+    bool                b_discontinuity;
+
+    atomic_size_t       bytes;
+
+    /* Sleeping */
+    vlc_mutex_t         lock;
+    vlc_cond_t          wait_data;
+    vlc_cond_t          wait_room;
+    atomic_bool         consumer_waiting;
+    atomic_bool         producer_waiting;
+    bool                b_wake;
+
+    /* Limits */
+    size_t              max_bytes;
+    mtime_t             max_duration;
+    int                 overflow;
+
+    /* Statistics */
+    atomic_ullong       put;
+    atomic_ullong       dropped;
+    atomic_ullong       waits;
+
+    size_t              mask;
+    block_t            *slots[];
+};
+
+static mtime_t block_RingDate(const block_t *block)
+{
+    return (block->i_dts > VLC_TS_INVALID) ? block->i_dts : block->i_pts;
+}
+
+static size_t block_RingCountBlocks(block_ring_t *ring)
+{
+    return atomic_load(&ring->tail) - atomic_load(&ring->head);
+}
+
+static mtime_t block_RingDuration(block_ring_t *ring)
+{
+    mtime_t first = atomic_load(&ring->first_ts);
+    mtime_t last = atomic_load(&ring->last_ts);
+
+    if (first <= VLC_TS_INVALID || last < first)
+        return 0; /* unknown, or timestamps discontinuity */
+    return last - first;
+}
+
+static bool block_RingOverLimits(block_ring_t *ring)
+{
+    if (ring->max_bytes != 0 && atomic_load(&ring->bytes) > ring->max_bytes)
+        return true;
+    if (ring->max_duration != 0
+     && block_RingDuration(ring) > ring->max_duration)
+        return true;
+    return false;
+}
+
+static void block_RingWaitCleanup(void *data)
+{
+    block_ring_t *ring = data;
+
+    atomic_store(&ring->consumer_waiting, false);
+    vlc_mutex_unlock(&ring->lock);
+}
+
+static void block_RingNotify(block_ring_t *ring, atomic_bool *waiting,
+                             vlc_cond_t *cond)
+{
+    if (!atomic_load(waiting))
+        return;
+
+    vlc_mutex_lock(&ring->lock);
+    vlc_cond_signal(cond);
+    vlc_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Waits until the ring has fewer than the given number of blocks and,
+ * if limits is true, until it is within its limits.
+ */
+static void block_RingWaitRoom(block_ring_t *ring, size_t depth, bool limits)
+{
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock(&ring->lock);
+    atomic_store(&ring->producer_waiting, true);
+    for (bool waited = false;; waited = true)
+    {
+        size_t count = block_RingCountBlocks(ring);
+
+        if (count < depth
+         && (!limits || count == 0 || !block_RingOverLimits(ring)))
+            break;
+        if (!waited)
+            atomic_fetch_add_explicit(&ring->waits, 1, memory_order_relaxed);
+        vlc_cond_wait(&ring->wait_room, &ring->lock);
+    }
+    atomic_store(&ring->producer_waiting, false);
+    vlc_mutex_unlock(&ring->lock);
+    vlc_restorecancel(canc);
+}
+
+static block_t *block_RingPop(block_ring_t *ring, size_t *restrict phead)
+{
+    size_t head = *phead;
+    block_t *block = ring->slots[head & ring->mask];
+    mtime_t ts = block_RingDate(block);
+
+    atomic_fetch_sub(&ring->bytes, block->i_buffer);
+    if (ts > VLC_TS_INVALID)
+        atomic_store(&ring->first_ts, ts);
+    *phead = ++head;
+    atomic_store(&ring->head, head);
+
+    block_RingNotify(ring, &ring->producer_waiting, &ring->wait_room);
+    return block;
+}
+
+/**
+ * Creates a single producer, single consumer ring of blocks.
+ *
+ * @param slots maximum number of queued blocks (must be a power of two)
+ * @param max_bytes size of the queued data above which the overflow policy
+ *                  applies (zero for no limit)
+ * @param max_duration duration of the queued data above which the overflow
+ *                     policy applies (zero for no limit)
+ * @param overflow overflow policy (BLOCK_RING_DROP_OLDEST,
+ *                 BLOCK_RING_DROP_NONREF or BLOCK_RING_BLOCK)
+ * @return the ring or NULL on memory error
+ */
+block_ring_t *block_RingNew(size_t slots, size_t max_bytes,
+                            mtime_t max_duration, int overflow)
+{
+    assert(slots > 0 && (slots & (slots - 1)) == 0);
+
+    block_ring_t *ring = malloc(sizeof (*ring) + slots * sizeof (block_t *));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->flush, 0);
+    atomic_init(&ring->marker, 0);
+    atomic_init(&ring->last_ts, VLC_TS_INVALID);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->first_ts, VLC_TS_INVALID);
+    ring->b_discontinuity = false;
+    atomic_init(&ring->bytes, 0);
+
+    vlc_mutex_init(&ring->lock);
+    vlc_cond_init(&ring->wait_data);
+    vlc_cond_init(&ring->wait_room);
+    atomic_init(&ring->consumer_waiting, false);
+    atomic_init(&ring->producer_waiting, false);
+    ring->b_wake = false;
+
+    ring->max_bytes = max_bytes;
+    ring->max_duration = max_duration;
+    ring->overflow = overflow;
+
+    atomic_init(&ring->put, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->waits, 0);
+
+    ring->mask = slots - 1;
+    return ring;
+}
+
+/**
+ * Destroys a ring created by block_RingNew().
+ * Any queued blocks are also destroyed.
+ *
+ * @warning Neither the producer nor the consumer may use the ring anymore.
+ */
+void block_RingRelease(block_ring_t *ring)
+{
+    size_t head = atomic_load(&ring->head);
+    size_t tail = atomic_load(&ring->tail);
+    block_t *marker = (block_t *)atomic_load(&ring->marker);
+
+    while (head != tail)
+        block_Release(ring->slots[head++ & ring->mask]);
+    if (marker != NULL)
+        block_Release(marker);
+
+    vlc_cond_destroy(&ring->wait_room);
+    vlc_cond_destroy(&ring->wait_data);
+    vlc_mutex_destroy(&ring->lock);
+    free(ring);
+}
+
+/**
+ * Queues a block into a ring. This function can only be called by the
+ * producer thread.
+ *
+ * If the ring is over its limits, the overflow policy applies:
+ * - BLOCK_RING_DROP_OLDEST: the consumer discards the oldest blocks,
+ * - BLOCK_RING_DROP_NONREF: the block is dropped if it is a B frame,
+ * - BLOCK_RING_BLOCK: the function waits for the consumer, if allowed to.
+ * If all slots are in use, the function waits for the consumer whatever the
+ * policy, if allowed to. Otherwise the block is dropped.
+ *
+ * @param block block to queue (it is released if it is dropped)
+ * @param can_wait whether the function may wait for the consumer
+ *
+ * @note This function is not a cancellation point.
+ *
+ * @return VLC_SUCCESS if the block was queued, VLC_EGENERIC if it was dropped
+ */
+int block_RingPut(block_ring_t *ring, block_t *block, bool can_wait)
+{
+    const bool b_wait = can_wait && ring->overflow == BLOCK_RING_BLOCK;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (block_RingOverLimits(ring))
+    {
+        if (ring->overflow == BLOCK_RING_DROP_NONREF
+         && (block->i_flags & BLOCK_FLAG_TYPE_B))
+            goto drop;
+        if (b_wait)
+            block_RingWaitRoom(ring, ring->mask + 1, true);
+    }
+
+    if (tail - atomic_load(&ring->head) > ring->mask)
+    {   /* No free slots: only the consumer can make room */
+        if (!can_wait)
+            goto drop;
+        block_RingWaitRoom(ring, ring->mask + 1, false);
+    }
+
+    mtime_t ts = block_RingDate(block);
+    if (ts > VLC_TS_INVALID)
+        atomic_store(&ring->last_ts, ts);
+    atomic_fetch_add(&ring->bytes, block->i_buffer);
+
+    ring->slots[tail & ring->mask] = block;
+    atomic_store(&ring->tail, tail + 1);
+    atomic_fetch_add_explicit(&ring->put, 1, memory_order_relaxed);
+
+    block_RingNotify(ring, &ring->consumer_waiting, &ring->wait_data);
+    return VLC_SUCCESS;
+
+drop:
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    block_Release(block);
+    return VLC_EGENERIC;
+}
+
+/**
+ * Waits until fewer than the given number of blocks are queued in a ring.
+ * This function can only be called by the producer thread.
+ *
+ * @note This function is not a cancellation point.
+ */
+void block_RingPace(block_ring_t *ring, size_t depth)
+{
+    if (block_RingCountBlocks(ring) >= depth)
+        block_RingWaitRoom(ring, depth, false);
+}
+
+/**
+ * Discards all the blocks queued in a ring. This function can only be
+ * called by the producer thread. The blocks are released by the consumer.
+ *
+ * @param marker block returned by block_RingGet() once the queued blocks
+ *               are discarded and before any block queued afterwards,
+ *               or NULL. If a previous marker was not returned yet, it is
+ *               replaced (and released).
+ */
+void block_RingFlush(block_ring_t *ring, block_t *marker)
+{
+    atomic_store(&ring->flush,
+                 atomic_load_explicit(&ring->tail, memory_order_relaxed));
+
+    if (marker != NULL)
+    {
+        block_t *old = (block_t *)atomic_exchange(&ring->marker,
+                                                  (uintptr_t)marker);
+        if (old != NULL)
+            block_Release(old);
+    }
+
+    block_RingNotify(ring, &ring->consumer_waiting, &ring->wait_data);
+}
+
+/**
+ * Dequeues the first block from a ring, if any. This function can only be
+ * called by the consumer thread.
+ *
+ * If the ring uses the BLOCK_RING_DROP_OLDEST policy and is over its limits,
+ * the oldest blocks are released and the next returned block is flagged
+ * with BLOCK_FLAG_DISCONTINUITY.
+ *
+ * @note This function is not a cancellation point.
+ *
+ * @return the first block in the ring or NULL if the ring is empty
+ */
+block_t *block_RingGet(block_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        size_t flush = atomic_load(&ring->flush);
+
+        if ((ptrdiff_t)(flush - head) > 0)
+        {   /* Discard the blocks queued before a flush */
+            block_Release(block_RingPop(ring, &head));
+            continue;
+        }
+
+        if (atomic_load_explicit(&ring->marker, memory_order_relaxed) != 0)
+        {
+            block_t *marker = (block_t *)atomic_exchange(&ring->marker, 0);
+
+            if (marker != NULL)
+            {   /* The marker may belong to a more recent flush */
+                flush = atomic_load(&ring->flush);
+                while ((ptrdiff_t)(flush - head) > 0)
+                    block_Release(block_RingPop(ring, &head));
+
+                atomic_store(&ring->first_ts, VLC_TS_INVALID);
+                ring->b_discontinuity = false;
+                return marker;
+            }
+        }
+
+        if (head == atomic_load(&ring->tail))
+            return NULL;
+
+        bool b_over = ring->overflow == BLOCK_RING_DROP_OLDEST
+                   && block_RingOverLimits(ring);
+        block_t *block = block_RingPop(ring, &head);
+
+        if (b_over && head != atomic_load(&ring->tail))
+        {   /* Drop the oldest blocks until the ring is within its limits */
+            atomic_fetch_add_explicit(&ring->dropped, 1,
+                                      memory_order_relaxed);
+            block_Release(block);
+            ring->b_discontinuity = true;
+            continue;
+        }
+
+        if (ring->b_discontinuity)
+        {
+            block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
+            ring->b_discontinuity = false;
+        }
+        return block;
+    }
+}
+
+/**
+ * Waits until a block is queued into a ring, or block_RingWake() is called.
+ * This function can only be called by the consumer thread.
+ * It may also return spuriously.
+ *
+ * @note This function is a cancellation point.
+ */
+void block_RingWait(block_ring_t *ring)
+{
+    vlc_mutex_lock(&ring->lock);
+    atomic_store(&ring->consumer_waiting, true);
+    vlc_cleanup_push(block_RingWaitCleanup, ring);
+
+    while (!ring->b_wake
+        && atomic_load(&ring->head) == atomic_load(&ring->tail)
+        && atomic_load(&ring->marker) == 0)
+        vlc_cond_wait(&ring->wait_data, &ring->lock);
+    ring->b_wake = false;
+
+    vlc_cleanup_run();
+}
+
+/**
+ * Wakes the consumer thread of a ring up, if it is waiting in
+ * block_RingWait(). This function can be called from any thread.
+ */
+void block_RingWake(block_ring_t *ring)
+{
+    vlc_mutex_lock(&ring->lock);
+    ring->b_wake = true;
+    vlc_cond_signal(&ring->wait_data);
+    vlc_mutex_unlock(&ring->lock);
+}
+
+/**
+ * Checks how many blocks are queued in a ring (including blocks about to be
+ * discarded after a flush). This function can be called from any thread.
+ */
+size_t block_RingCount(block_ring_t *ring)
+{
+    return block_RingCountBlocks(ring);
+}
+
+/**
+ * Checks how many bytes are queued in a ring. This function can be called
+ * from any thread.
+ */
+size_t block_RingSize(block_ring_t *ring)
+{
+    return atomic_load(&ring->bytes);
+}
+
+/**
+ * Gets the statistics of a ring. This function can be called from any
+ * thread.
+ */
+void block_RingGetStats(block_ring_t *ring, block_ring_stats_t *stats)
+{
+    stats->i_put = atomic_load_explicit(&ring->put, memory_order_relaxed);
+    stats->i_dropped = atomic_load_explicit(&ring->dropped,
+                                            memory_order_relaxed);
+    stats->i_waits = atomic_load_explicit(&ring->waits, memory_order_relaxed);
+}
@@ -25,6 +25,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <libvlc.h>
 #include <vlc_filter.h>
@@ -111,6 +113,218 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/* */
+#define SLICE_MIN_LINES 16
+
+struct filter_slice_job
+{
+    struct filter_slice_job *next;
+    filter_slice_t func;
+    void *opaque;
+    int lines;
+    unsigned align;
+    unsigned overlap;
+    unsigned count;   /* slices */
+    unsigned started; /* slices taken by a thread */
+    unsigned done;    /* slices completed */
+};
+
+struct filter_slice_pool
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /* a job is queued, or the pool is stopping */
+    vlc_cond_t  done; /* a job is completed */
+    struct filter_slice_job *jobs; /* jobs with slices not started yet */
+    bool stopping;
+    unsigned count;
+    vlc_thread_t threads[];
+};
+
+static int SliceStart( const struct filter_slice_job *job, unsigned i )
+{
+    if( i >= job->count )
+        return job->lines;
+    return (int64_t)job->lines * i / job->count / job->align * job->align;
+}
+
+static void SliceRun( const struct filter_slice_job *job, unsigned i )
+{
+    const int start = SliceStart( job, i );
+    const int end = SliceStart( job, i + 1 );
+
+    if( start < end )
+        job->func( job->opaque, i, __MAX(start - (int)job->overlap, 0),
+                   start, end );
+}
+
+/* Takes the next slice of a job, the pool lock must be held */
+static unsigned SliceTake( struct filter_slice_pool *pool,
+                           struct filter_slice_job *job )
+{
+    const unsigned i = job->started++;
+
+    if( job->started == job->count )
+    {
+        struct filter_slice_job **pp = &pool->jobs;
+        while( *pp != job )
+            pp = &(*pp)->next;
+        *pp = job->next;
+    }
+    return i;
+}
+
+static void *SliceThread( void *data )
+{
+    struct filter_slice_pool *pool = data;
+
+    vlc_mutex_lock( &pool->lock );
+    for( ;; )
+    {
+        while( !pool->stopping && pool->jobs == NULL )
+            vlc_cond_wait( &pool->wait, &pool->lock );
+        if( pool->stopping )
+            break;
+
+        struct filter_slice_job *job = pool->jobs;
+        const unsigned i = SliceTake( pool, job );
+
+        vlc_mutex_unlock( &pool->lock );
+        SliceRun( job, i );
+        vlc_mutex_lock( &pool->lock );
+
+        /* The job belongs to a caller waiting for it, do not touch it after
+         * its last slice is done */
+        if( ++job->done == job->count )
+            vlc_cond_broadcast( &pool->done );
+    }
+    vlc_mutex_unlock( &pool->lock );
+    return NULL;
+}
+
+void filter_SlicePoolDelete( struct filter_slice_pool *pool )
+{
+    vlc_mutex_lock( &pool->lock );
+    assert( pool->jobs == NULL );
+    pool->stopping = true;
+    vlc_cond_broadcast( &pool->wait );
+    vlc_mutex_unlock( &pool->lock );
+
+    for( unsigned i = 0; i < pool->count; i++ )
+        vlc_join( pool->threads[i], NULL );
+
+    vlc_cond_destroy( &pool->done );
+    vlc_cond_destroy( &pool->wait );
+    vlc_mutex_destroy( &pool->lock );
+    free( pool );
+}
+
+static struct filter_slice_pool *SlicePoolNew( void )
+{
+    /* The calling thread processes slices too */
+    unsigned count = __MIN( vlc_GetCPUCount(), FILTER_SLICES_MAX ) - 1;
+    if( count == 0 )
+        return NULL;
+
+    struct filter_slice_pool *pool =
+        malloc( sizeof(*pool) + count * sizeof(pool->threads[0]) );
+    if( unlikely(pool == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &pool->lock );
+    vlc_cond_init( &pool->wait );
+    vlc_cond_init( &pool->done );
+    pool->jobs = NULL;
+    pool->stopping = false;
+    pool->count = 0;
+
+    while( pool->count < count )
+    {
+        if( vlc_clone( &pool->threads[pool->count], SliceThread, pool,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        pool->count++;
+    }
+
+    if( pool->count == 0 )
+    {
+        filter_SlicePoolDelete( pool );
+        return NULL;
+    }
+    return pool;
+}
+
+static struct filter_slice_pool *SlicePoolGet( libvlc_int_t *libvlc )
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+    libvlc_priv_t *priv = libvlc_priv( libvlc );
+
+    vlc_mutex_lock( &lock );
+    if( priv->slice_pool == NULL )
+        priv->slice_pool = SlicePoolNew();
+    struct filter_slice_pool *pool = priv->slice_pool;
+    vlc_mutex_unlock( &lock );
+    return pool;
+}
+
+void filter_Slice( filter_t *p_filter, filter_slice_t func, void *opaque,
+                   int lines, unsigned align, unsigned overlap )
+{
+    struct filter_slice_pool *pool = NULL;
+    unsigned count = var_InheritInteger( p_filter, "filter-threads" );
+
+    if( count == 0 )
+        count = vlc_GetCPUCount();
+    count = __MIN( count, FILTER_SLICES_MAX );
+    if( align == 0 )
+        align = 1;
+    if( lines <= 0 )
+        return;
+    /* Small planes are not worth the synchronization */
+    count = __MIN( count, (unsigned)lines / __MAX(align, SLICE_MIN_LINES) );
+
+    if( count > 1 )
+        pool = SlicePoolGet( p_filter->p_libvlc );
+    if( pool == NULL )
+    {
+        func( opaque, 0, 0, 0, lines );
+        return;
+    }
+
+    struct filter_slice_job job = {
+        .next = NULL,
+        .func = func,
+        .opaque = opaque,
+        .lines = lines,
+        .align = align,
+        .overlap = overlap,
+        .count = count,
+        .started = 0,
+        .done = 0,
+    };
+
+    vlc_mutex_lock( &pool->lock );
+    struct filter_slice_job **pp = &pool->jobs;
+    while( *pp != NULL )
+        pp = &(*pp)->next;
+    *pp = &job;
+    vlc_cond_broadcast( &pool->wait );
+
+    /* Process slices too rather than waiting idle, so that the job completes
+     * even if all the threads are busy with the jobs of other filters */
+    while( job.started < job.count )
+    {
+        const unsigned i = SliceTake( pool, &job );
+
+        vlc_mutex_unlock( &pool->lock );
+        SliceRun( &job, i );
+        vlc_mutex_lock( &pool->lock );
+        job.done++;
+    }
+    while( job.done < job.count )
+        vlc_cond_wait( &pool->done, &pool->lock );
+    vlc_mutex_unlock( &pool->lock );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
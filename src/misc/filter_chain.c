@@ -39,6 +39,17 @@ typedef struct chained_filter_t
     struct chained_filter_t *prev, *next;
     vlc_mouse_t *mouse;
     picture_t *pending;
+
+    /* Pipeline stage */
+    vlc_thread_t thread;
+    vlc_mutex_t lock; /**< Serializes the filter callbacks */
+    picture_t *queue, **queue_last; /**< Pictures waiting for the filter */
+    unsigned queued;
+
+    /* Statistics, protected by the chain lock */
+    uint64_t pictures;
+    mtime_t time, time_max;
+    unsigned queued_max;
 } chained_filter_t;
 
 /* Only use this with filter objects from _this_ C module */
@@ -59,6 +70,18 @@ struct filter_chain_t
     es_format_t fmt_out; /**< Chain current output format */
     unsigned length; /**< Number of filters */
     bool b_allow_fmt_out_change; /**< Can the output format be changed? */
+
+    /* Pipeline */
+    vlc_mutex_t lock; /**< Pipeline state and statistics */
+    vlc_cond_t wait;
+    unsigned depth; /**< Pictures waiting for each filter, 0 if synchronous */
+    bool running;
+    bool stopping;
+    unsigned inflight; /**< Pictures waiting for or in a filter */
+    picture_t *out, **out_last; /**< Pictures out of the last filter */
+    void (*ready)( void * );
+    void *ready_opaque;
+
     char psz_capability[1]; /**< Module capability for all chained filters */
 };
 
@@ -66,6 +89,7 @@ struct filter_chain_t
  * Local prototypes
  */
 static void FilterDeletePictures( picture_t * );
+static void FilterChainStop( filter_chain_t * );
 
 static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     const char *cap, bool fmt_out_change, const filter_owner_t *owner )
@@ -86,6 +110,16 @@ static filter_chain_t *filter_chain_NewInner( const filter_owner_t *callbacks,
     es_format_Init( &chain->fmt_out, UNKNOWN_ES, 0 );
     chain->length = 0;
     chain->b_allow_fmt_out_change = fmt_out_change;
+    vlc_mutex_init( &chain->lock );
+    vlc_cond_init( &chain->wait );
+    chain->depth = 0;
+    chain->running = false;
+    chain->stopping = false;
+    chain->inflight = 0;
+    chain->out = NULL;
+    chain->out_last = &chain->out;
+    chain->ready = NULL;
+    chain->ready_opaque = NULL;
     strcpy( chain->psz_capability, cap );
 
     return chain;
@@ -152,6 +186,8 @@ void filter_chain_Delete( filter_chain_t *p_chain )
 
     es_format_Clean( &p_chain->fmt_in );
     es_format_Clean( &p_chain->fmt_out );
+    vlc_cond_destroy( &p_chain->wait );
+    vlc_mutex_destroy( &p_chain->lock );
 
     free( p_chain );
 }
@@ -187,6 +223,9 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
     if( unlikely(chained == NULL) )
         return NULL;
 
+    /* The threads are restarted with the new filter on the next picture */
+    FilterChainStop( chain );
+
     filter_t *filter = &chained->filter;
 
     if( fmt_in == NULL )
@@ -236,6 +275,14 @@ filter_t *filter_chain_AppendFilter( filter_chain_t *chain, const char *name,
         vlc_mouse_Init( mouse );
     chained->mouse = mouse;
     chained->pending = NULL;
+    vlc_mutex_init( &chained->lock );
+    chained->queue = NULL;
+    chained->queue_last = &chained->queue;
+    chained->queued = 0;
+    chained->pictures = 0;
+    chained->time = 0;
+    chained->time_max = 0;
+    chained->queued_max = 0;
 
     msg_Dbg( parent, "Filter '%s' (%p) appended to chain",
              (name != NULL) ? name : module_get_name(filter->p_module, false),
@@ -259,6 +306,8 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     vlc_object_t *obj = chain->callbacks.sys;
     chained_filter_t *chained = (chained_filter_t *)filter;
 
+    FilterChainStop( chain );
+
     /* Remove it from the chain */
     if( chained->prev != NULL )
         chained->prev->next = chained->next;
@@ -282,7 +331,13 @@ void filter_chain_DeleteFilter( filter_chain_t *chain, filter_t *filter )
     module_unneed( filter, filter->p_module );
 
     msg_Dbg( obj, "Filter %p removed from chain", filter );
+    if( chained->pictures > 0 )
+        msg_Dbg( obj, "Filter %p: %"PRIu64" pictures, %"PRId64" us average, "
+                 "%"PRId64" us max, %u pictures queued max", filter,
+                 chained->pictures, chained->time / (mtime_t)chained->pictures,
+                 chained->time_max, chained->queued_max );
     FilterDeletePictures( chained->pending );
+    vlc_mutex_destroy( &chained->lock );
 
     free( chained->mouse );
     es_format_Clean( &filter->fmt_out );
@@ -366,12 +421,27 @@ const es_format_t *filter_chain_GetFmtOut( filter_chain_t *p_chain )
     return &p_chain->fmt_out;
 }
 
+static void FilterChainAddTime( chained_filter_t *f, mtime_t duration )
+{
+    f->pictures++;
+    f->time += duration;
+    if( duration > f->time_max )
+        f->time_max = duration;
+}
+
 static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic )
 {
     for( ; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
+        filter_chain_t *p_chain = p_filter->owner.sys;
+        mtime_t start = mdate();
+
         p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+
+        vlc_mutex_lock( &p_chain->lock );
+        FilterChainAddTime( f, mdate() - start );
+        vlc_mutex_unlock( &p_chain->lock );
         if( !p_pic )
             break;
         if( f->pending )
@@ -385,8 +455,238 @@ static picture_t *FilterChainVideoFilter( chained_filter_t *f, picture_t *p_pic
     return p_pic;
 }
 
+/**
+ * Pipelined filtering
+ *
+ * Each filter runs on its own thread and takes its input pictures from a
+ * queue, filled by the previous filter or by filter_chain_VideoFilter().
+ * A filter only starts on a picture when the queue of the next filter has
+ * room for its output, so that at most depth pictures wait before each filter.
+ * Each filter gets its pictures in order, so time-dependent filters, such as
+ * deinterlacers, work as in a synchronous chain.
+ * The last filter never waits: its output is queued until taken by
+ * filter_chain_VideoFilter(), so that the pipeline always drains and the
+ * owner can wait for room in the first queue without deadlocking.
+ */
+static void FilterChainQueue( chained_filter_t *f, picture_t *pic )
+{
+    *f->queue_last = pic;
+    f->queue_last = &pic->p_next;
+    f->queued++;
+    if( f->queued > f->queued_max )
+        f->queued_max = f->queued;
+}
+
+static picture_t *FilterChainDequeue( picture_t **pp_queue,
+                                      picture_t ***ppp_last )
+{
+    picture_t *pic = *pp_queue;
+    if( pic != NULL )
+    {
+        *pp_queue = pic->p_next;
+        if( *pp_queue == NULL )
+            *ppp_last = pp_queue;
+        pic->p_next = NULL;
+    }
+    return pic;
+}
+
+static void *FilterChainThread( void *data )
+{
+    chained_filter_t *f = data;
+    chained_filter_t *next = f->next;
+    filter_t *p_filter = &f->filter;
+    filter_chain_t *p_chain = p_filter->owner.sys;
+
+    vlc_mutex_lock( &p_chain->lock );
+    for( ;; )
+    {
+        while( !p_chain->stopping
+            && ( f->queue == NULL
+              || ( next != NULL && next->queued >= p_chain->depth ) ) )
+            vlc_cond_wait( &p_chain->wait, &p_chain->lock );
+        if( p_chain->stopping )
+            break;
+
+        picture_t *p_pic = FilterChainDequeue( &f->queue, &f->queue_last );
+        f->queued--;
+        vlc_cond_broadcast( &p_chain->wait );
+        vlc_mutex_unlock( &p_chain->lock );
+
+        vlc_mutex_lock( &f->lock );
+        mtime_t start = mdate();
+        p_pic = p_filter->pf_video_filter( p_filter, p_pic );
+        mtime_t duration = mdate() - start;
+        vlc_mutex_unlock( &f->lock );
+
+        vlc_mutex_lock( &p_chain->lock );
+        FilterChainAddTime( f, duration );
+
+        bool b_ready = false;
+        while( p_pic != NULL )
+        {
+            picture_t *p_next = p_pic->p_next;
+            p_pic->p_next = NULL;
+
+            if( next != NULL )
+            {
+                /* Several output pictures may not fit at once */
+                while( !p_chain->stopping && next->queued >= p_chain->depth )
+                    vlc_cond_wait( &p_chain->wait, &p_chain->lock );
+                if( p_chain->stopping )
+                {
+                    picture_Release( p_pic );
+                    FilterDeletePictures( p_next );
+                    break;
+                }
+                FilterChainQueue( next, p_pic );
+                p_chain->inflight++;
+            }
+            else
+            {
+                *p_chain->out_last = p_pic;
+                p_chain->out_last = &p_pic->p_next;
+                b_ready = true;
+            }
+            vlc_cond_broadcast( &p_chain->wait );
+            p_pic = p_next;
+        }
+        p_chain->inflight--;
+        vlc_cond_broadcast( &p_chain->wait );
+
+        if( b_ready && p_chain->ready != NULL )
+        {
+            vlc_mutex_unlock( &p_chain->lock );
+            p_chain->ready( p_chain->ready_opaque );
+            vlc_mutex_lock( &p_chain->lock );
+        }
+    }
+    vlc_mutex_unlock( &p_chain->lock );
+    return NULL;
+}
+
+static bool FilterChainStart( filter_chain_t *p_chain )
+{
+    assert( !p_chain->running && p_chain->inflight == 0 );
+
+    for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+    {
+        /* Pictures left by a previous synchronous run */
+        FilterDeletePictures( f->pending );
+        f->pending = NULL;
+
+        if( vlc_clone( &f->thread, FilterChainThread, f,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            vlc_mutex_lock( &p_chain->lock );
+            p_chain->stopping = true;
+            vlc_cond_broadcast( &p_chain->wait );
+            vlc_mutex_unlock( &p_chain->lock );
+
+            for( chained_filter_t *g = p_chain->first; g != f; g = g->next )
+                vlc_join( g->thread, NULL );
+            p_chain->stopping = false;
+            return false;
+        }
+    }
+    p_chain->running = true;
+    return true;
+}
+
+/* Stops the threads and drops the pictures within the chain */
+static void FilterChainStop( filter_chain_t *p_chain )
+{
+    if( !p_chain->running )
+        return;
+
+    vlc_mutex_lock( &p_chain->lock );
+    p_chain->stopping = true;
+    vlc_cond_broadcast( &p_chain->wait );
+    vlc_mutex_unlock( &p_chain->lock );
+
+    for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+        vlc_join( f->thread, NULL );
+
+    for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
+    {
+        FilterDeletePictures( f->queue );
+        f->queue = NULL;
+        f->queue_last = &f->queue;
+        f->queued = 0;
+    }
+    FilterDeletePictures( p_chain->out );
+    p_chain->out = NULL;
+    p_chain->out_last = &p_chain->out;
+    p_chain->inflight = 0;
+    p_chain->stopping = false;
+    p_chain->running = false;
+}
+
+static picture_t *FilterChainPipeline( filter_chain_t *p_chain,
+                                       picture_t *p_pic )
+{
+    chained_filter_t *first = p_chain->first;
+
+    vlc_mutex_lock( &p_chain->lock );
+    if( p_pic != NULL )
+    {
+        assert( p_pic->p_next == NULL );
+        /* Rather than wait, exceed the depth by one if a picture is ready */
+        while( first->queued > p_chain->depth
+           || ( first->queued == p_chain->depth && p_chain->out == NULL ) )
+            vlc_cond_wait( &p_chain->wait, &p_chain->lock );
+
+        FilterChainQueue( first, p_pic );
+        p_chain->inflight++;
+        vlc_cond_broadcast( &p_chain->wait );
+    }
+    p_pic = FilterChainDequeue( &p_chain->out, &p_chain->out_last );
+    vlc_mutex_unlock( &p_chain->lock );
+    return p_pic;
+}
+
+void filter_chain_SetPipeline( filter_chain_t *p_chain, unsigned depth,
+                               void (*ready)( void * ), void *opaque )
+{
+    FilterChainStop( p_chain );
+    p_chain->depth = depth;
+    p_chain->ready = ready;
+    p_chain->ready_opaque = opaque;
+}
+
+int filter_chain_GetStats( filter_chain_t *p_chain, unsigned index,
+                           filter_chain_stats_t *p_stats )
+{
+    chained_filter_t *f = p_chain->first;
+
+    while( f != NULL && index-- > 0 )
+        f = f->next;
+    if( f == NULL )
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_chain->lock );
+    p_stats->queued = f->queued;
+    p_stats->queued_max = f->queued_max;
+    p_stats->pictures = f->pictures;
+    p_stats->time = f->pictures ? f->time / (mtime_t)f->pictures : 0;
+    p_stats->time_max = f->time_max;
+    vlc_mutex_unlock( &p_chain->lock );
+    return VLC_SUCCESS;
+}
+
 picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
 {
+    if( p_chain->depth > 0 && p_chain->first != NULL )
+    {
+        if( p_chain->running || FilterChainStart( p_chain ) )
+            return FilterChainPipeline( p_chain, p_pic );
+
+        vlc_object_t *obj = p_chain->callbacks.sys;
+        msg_Err( obj, "cannot start the filter threads, "
+                 "filtering synchronously" );
+        p_chain->depth = 0;
+    }
+
     if( p_pic )
     {
         p_pic = FilterChainVideoFilter( p_chain->first, p_pic );
@@ -408,8 +708,23 @@ picture_t *filter_chain_VideoFilter( filter_chain_t *p_chain, picture_t *p_pic )
     return NULL;
 }
 
+picture_t *filter_chain_VideoDrain( filter_chain_t *p_chain )
+{
+    if( !p_chain->running )
+        return filter_chain_VideoFilter( p_chain, NULL );
+
+    vlc_mutex_lock( &p_chain->lock );
+    while( p_chain->inflight > 0 && p_chain->out == NULL )
+        vlc_cond_wait( &p_chain->wait, &p_chain->lock );
+    picture_t *p_pic = FilterChainDequeue( &p_chain->out, &p_chain->out_last );
+    vlc_mutex_unlock( &p_chain->lock );
+    return p_pic;
+}
+
 void filter_chain_VideoFlush( filter_chain_t *p_chain )
 {
+    FilterChainStop( p_chain );
+
     for( chained_filter_t *f = p_chain->first; f != NULL; f = f->next )
     {
         filter_t *p_filter = &f->filter;
@@ -476,7 +791,11 @@ int filter_chain_MouseFilter( filter_chain_t *p_chain, vlc_mouse_t *p_dst, const
             vlc_mouse_t filtered;
 
             *p_mouse = current;
-            if( p_filter->pf_video_mouse( p_filter, &filtered, &old, &current ) )
+            vlc_mutex_lock( &f->lock );
+            int ret = p_filter->pf_video_mouse( p_filter, &filtered, &old,
+                                                &current );
+            vlc_mutex_unlock( &f->lock );
+            if( ret )
                 return VLC_EGENERIC;
             current = filtered;
         }
@@ -498,7 +817,10 @@ int filter_chain_MouseEvent( filter_chain_t *p_chain,
         {
             vlc_mouse_t old = *f->mouse;
             *f->mouse = *p_mouse;
-            if( p_filter->pf_sub_mouse( p_filter, &old, p_mouse, p_fmt ) )
+            vlc_mutex_lock( &f->lock );
+            int ret = p_filter->pf_sub_mouse( p_filter, &old, p_mouse, p_fmt );
+            vlc_mutex_unlock( &f->lock );
+            if( ret )
                 return VLC_EGENERIC;
         }
     }
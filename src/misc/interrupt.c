@@ -218,6 +218,27 @@ static void vlc_interrupt_cleanup(void *opaque)
     vlc_interrupt_finish(opaque);
 }
 
+void vlc_interrupt_register(void (*cb)(void *), void *opaque)
+{
+    vlc_interrupt_t *ctx = vlc_threadvar_get(vlc_interrupt_var);
+    if (ctx == NULL)
+        return;
+
+    vlc_mutex_lock(&ctx->lock);
+    assert(ctx->callback == NULL);
+    ctx->callback = cb;
+    ctx->data = opaque;
+    if (ctx->interrupted)
+        cb(opaque);
+    vlc_mutex_unlock(&ctx->lock);
+}
+
+int vlc_interrupt_unregister(void)
+{
+    vlc_interrupt_t *ctx = vlc_threadvar_get(vlc_interrupt_var);
+    return (ctx != NULL) ? vlc_interrupt_finish(ctx) : 0;
+}
+
 void vlc_interrupt_kill(vlc_interrupt_t *ctx)
 {
     assert(ctx != NULL);
@@ -40,8 +40,10 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_fs.h>
 #include "../libvlc.h"
 
+#include <limits.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -49,6 +51,12 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -63,10 +71,48 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* Maximum number of stream segments sent to a client at once */
+#define HTTPD_CL_SEGMENTS 64
+
+/* Maximum number of complete groups of pictures kept by a stream */
+#define HTTPD_STREAM_GOPS 16
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum number of events handled by a worker per iteration */
+# define HTTPD_WORKER_EVENTS 64
+#endif
+
 static void httpd_ClientClean(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+static int httpd_AppendData(httpd_stream_t *stream, block_t *p_block);
+
+/* each host serves its clients from a pool of worker threads */
+typedef struct
+{
+    httpd_host_t *host;
+    vlc_thread_t  thread;
+    vlc_mutex_t   lock;
+
+    int            i_client;
+    httpd_client_t **client;
+    mtime_t        i_deadline; /* next check of the activity timeouts */
+
+    /* clients parked until their stream has data, and clients whose state
+     * machine the thread has to run, woken up through wakefd */
+    vlc_mutex_t    wake_lock;
+    int            wakefd[2];
+    int            i_waiting;
+    httpd_client_t **waiting;
+    int            i_ready;
+    httpd_client_t **ready;
+
+#ifdef HAVE_SYS_EPOLL_H
+    int           epfd;
+#endif
+} httpd_worker_t;
+
+static void httpd_WorkerQueue(httpd_worker_t *, httpd_client_t *);
+static void httpd_WorkerWakeUrl(httpd_worker_t *, const httpd_url_t *);
 
-/* each host run in his own thread */
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -79,10 +125,14 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
+    /* worker threads, the first one accepts connections */
+    httpd_worker_t *workers;
+    unsigned     i_workers;
+    unsigned     i_next_worker;
+
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
      * All url will have their cb trigger, but only the first one can answer
@@ -90,9 +140,6 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
-
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -142,10 +189,16 @@ enum
 struct httpd_client_t
 {
     httpd_url_t *url;
+    httpd_worker_t *worker;
 
     int     i_ref;
 
     int     fd;
+    short   i_events; /* events the worker waits for */
+    bool    b_ready;   /* queued for the worker state machine */
+    /* url whose stream data the client is parked on, or NULL
+     * (both protected by the worker wake lock) */
+    const httpd_url_t *wait_url;
 
     bool    b_stream_mode;
     uint8_t i_state;
@@ -165,6 +218,9 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* stream data to send, sharing the stream segments */
+    block_t *p_chain;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -592,6 +648,12 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+typedef struct
+{
+    int64_t  i_pos;   /* absolute position of the data */
+    block_t *p_block; /* data, shared with the clients sending it */
+} httpd_segment_t;
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -611,17 +673,49 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* GOP cache: positions of the last keyframes still in the ring, the
+     * oldest first. New clients start at the last one, and the data of
+     * the i_gops complete GOPs before it is kept for slow clients. */
+    int64_t     pi_keyframes[HTTPD_STREAM_GOPS + 1];
+    unsigned    i_keyframes;
+    unsigned    i_gops;
+    int         i_backlog;          /* policy for slow clients */
+    httpd_stream_stats_t stats;
+
+    /* ring of segments */
+    int         i_buffer_size;      /* size of the data kept */
+    int64_t     i_buffer_max;       /* maximum size, to keep the GOPs */
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    int64_t     i_buffer_first_pos; /* position of the oldest data kept */
+    httpd_segment_t *p_segments;
+    size_t      i_segments_max;     /* ring capacity */
+    size_t      i_segment_first;    /* index of the oldest segment */
+    size_t      i_segments;         /* number of segments in the ring */
 
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
+
+    /* workers of the host with clients waiting for data */
+    bool        *pb_wake;
 };
 
+/* Parks a client until the stream has new data.
+ * The stream lock must be held. */
+static void httpd_StreamWait(httpd_stream_t *stream, httpd_client_t *cl)
+{
+    httpd_worker_t *worker = cl->worker;
+
+    stream->pb_wake[worker - stream->url->host->workers] = true;
+
+    vlc_mutex_lock(&worker->wake_lock);
+    if (cl->wait_url == NULL)
+        TAB_APPEND(worker->i_waiting, worker->waiting, cl);
+    cl->wait_url = stream->url;
+    vlc_mutex_unlock(&worker->wake_lock);
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -632,46 +726,108 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
-        if (answer->i_body_offset >= stream->i_buffer_pos)
+        vlc_mutex_lock(&stream->lock);
+        if (answer->i_body_offset >= stream->i_buffer_pos) {
+            httpd_StreamWait(stream, cl);
+            vlc_mutex_unlock(&stream->lock);
             return VLC_EGENERIC;    /* wait, no data available */
+        }
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass) {
                 /* still waiting for the next keyframe */
+                httpd_StreamWait(stream, cl);
+                vlc_mutex_unlock(&stream->lock);
                 return VLC_EGENERIC;
+            }
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
+        /* this client isn't fast enough: its data is gone or, unless it
+         * can go at its own pace, it lags more than the buffer size */
+        if (answer->i_body_offset < stream->i_buffer_first_pos
+         || (stream->i_backlog != HTTPD_BACKLOG_THROTTLE
+          && answer->i_body_offset
+                < stream->i_buffer_pos - stream->i_buffer_size)) {
+            int64_t i_offset;
+
+            switch (stream->i_backlog) {
+                case HTTPD_BACKLOG_DISCONNECT:
+                    stream->stats.i_disconnects++;
+                    vlc_mutex_unlock(&stream->lock);
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    return VLC_EGENERIC;
+
+                case HTTPD_BACKLOG_THROTTLE:
+                    /* resume on the oldest keyframe */
+                    i_offset = stream->i_keyframes > 0
+                             ? stream->pi_keyframes[0]
+                             : stream->i_buffer_first_pos;
+                    break;
+
+                default:
+                    /* skip to the last keyframe */
+                    i_offset = stream->i_keyframes > 0
+                             ? stream->pi_keyframes[stream->i_keyframes - 1]
+                             : stream->i_buffer_last_pos;
+                    break;
+            }
+            /* within a GOP longer than the buffer, there may be no
+             * keyframe ahead of the client: it goes on then */
+            if (i_offset > answer->i_body_offset) {
+                stream->stats.i_skips++;
+                stream->stats.i_skipped += i_offset - answer->i_body_offset;
+                answer->i_body_offset = i_offset;
+            }
+        }
+
+        /* Find the segment with the data (the last ones are the most
+         * likely to be needed) */
+        size_t i_seg = stream->i_segments;
+        const httpd_segment_t *seg;
+        do {
+            assert(i_seg > 0);
+            i_seg--;
+            seg = &stream->p_segments[(stream->i_segment_first + i_seg)
+                                      % stream->i_segments_max];
+        } while (seg->i_pos > answer->i_body_offset);
+
+        /* Share the segments with the client, without copying the data */
+        block_t **pp_last = &cl->p_chain;
+        assert(cl->p_chain == NULL);
+
+        for (unsigned i = 0; i < HTTPD_CL_SEGMENTS
+                          && i_seg < stream->i_segments; i++, i_seg++) {
+            seg = &stream->p_segments[(stream->i_segment_first + i_seg)
+                                      % stream->i_segments_max];
+
+            block_t *p_block = block_Share(seg->p_block);
+            if (unlikely(p_block == NULL))
+                break;
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
+            size_t i_skip = answer->i_body_offset - seg->i_pos;
+            p_block->p_buffer += i_skip;
+            p_block->i_buffer -= i_skip;
+            answer->i_body_offset += p_block->i_buffer;
 
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
+            *pp_last = p_block;
+            pp_last = &p_block->p_next;
+        }
+        if (cl->p_chain == NULL)
+            httpd_StreamWait(stream, cl);
+        vlc_mutex_unlock(&stream->lock);
 
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        if (cl->p_chain == NULL)
+            return VLC_EGENERIC;
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
         return VLC_SUCCESS;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
@@ -706,10 +862,16 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                 memcpy(answer->p_body, stream->p_header, stream->i_header);
             }
             answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
+            cl->i_keyframe_wait_to_pass = -1;
+            if (stream->i_keyframes > 0) {
+                /* start at once on the last keyframe, the data since then
+                 * is sent at the network speed */
+                answer->i_body_offset =
+                    stream->pi_keyframes[stream->i_keyframes - 1];
+                stream->stats.i_instant++;
+            } else if (stream->b_has_keyframes)
                 cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
-            else
-                cl->i_keyframe_wait_to_pass = -1;
+            stream->stats.i_clients++;
             vlc_mutex_unlock(&stream->lock);
         } else {
             httpd_MsgAdd(answer, "Content-Length", "0");
@@ -758,6 +920,13 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
         return NULL;
     }
 
+    stream->pb_wake = calloc(host->i_workers, sizeof (*stream->pb_wake));
+    if (unlikely(stream->pb_wake == NULL)) {
+        httpd_UrlDelete(stream->url);
+        free(stream);
+        return NULL;
+    }
+
     vlc_mutex_init(&stream->lock);
     if (psz_mime == NULL || psz_mime[0] == '\0')
         psz_mime = vlc_mime_Ext2Mime(psz_url);
@@ -766,13 +935,22 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
     stream->i_header = 0;
     stream->p_header = NULL;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
+    stream->i_buffer_max = 8 * stream->i_buffer_size;
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
+    stream->i_buffer_first_pos = 1;
+    stream->p_segments = NULL;
+    stream->i_segments_max = 0;
+    stream->i_segment_first = 0;
+    stream->i_segments = 0;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
+    stream->i_keyframes = 0;
+    stream->i_gops = 1;
+    stream->i_backlog = HTTPD_BACKLOG_DROP;
+    memset(&stream->stats, 0, sizeof(stream->stats));
     stream->i_http_headers = 0;
     stream->p_http_headers = NULL;
 
@@ -802,29 +980,102 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+int httpd_StreamSetBacklog(httpd_stream_t *stream, unsigned i_gops,
+                           int i_policy)
+{
+    vlc_mutex_lock(&stream->lock);
+    stream->i_gops = __MIN(i_gops, HTTPD_STREAM_GOPS);
+    stream->i_backlog = i_policy;
+    while (stream->i_keyframes > stream->i_gops + 1) {
+        stream->i_keyframes--;
+        memmove(stream->pi_keyframes, stream->pi_keyframes + 1,
+                stream->i_keyframes * sizeof (*stream->pi_keyframes));
+    }
+    vlc_mutex_unlock(&stream->lock);
+    return VLC_SUCCESS;
+}
+
+void httpd_StreamGetStats(httpd_stream_t *stream, httpd_stream_stats_t *stats)
+{
+    vlc_mutex_lock(&stream->lock);
+    *stats = stream->stats;
+    vlc_mutex_unlock(&stream->lock);
+}
+
+static int httpd_AppendData(httpd_stream_t *stream, block_t *p_block)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
+    /* Drop the oldest segments, but those of the cached GOPs while the
+     * maximum size is not reached */
+    while (stream->i_segments > 0) {
+        int64_t i_size = stream->i_buffer_pos + (int64_t)p_block->i_buffer
+                       - stream->i_buffer_first_pos;
+        httpd_segment_t *seg = &stream->p_segments[stream->i_segment_first];
+
+        if (i_size <= stream->i_buffer_size
+         || (stream->i_keyframes > 0 && seg->i_pos >= stream->pi_keyframes[0]
+          && i_size <= stream->i_buffer_max))
+            break;
 
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
+        block_Release(seg->p_block);
+        stream->i_segment_first = (stream->i_segment_first + 1)
+                                % stream->i_segments_max;
+        stream->i_segments--;
+        stream->i_buffer_first_pos = stream->i_segments > 0
+            ? stream->p_segments[stream->i_segment_first].i_pos
+            : stream->i_buffer_pos;
+    }
 
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+    /* Forget the keyframes which are gone */
+    unsigned i_gone = 0;
+    while (i_gone < stream->i_keyframes
+        && stream->pi_keyframes[i_gone] < stream->i_buffer_first_pos)
+        i_gone++;
+    if (i_gone > 0) {
+        stream->i_keyframes -= i_gone;
+        memmove(stream->pi_keyframes, stream->pi_keyframes + i_gone,
+                stream->i_keyframes * sizeof (*stream->pi_keyframes));
     }
 
-    stream->i_buffer_pos += i_data;
+    if (stream->i_segments == stream->i_segments_max) {
+        /* Grow the ring, and unwrap it */
+        size_t i_max = stream->i_segments_max ? 2 * stream->i_segments_max
+                                              : 64;
+        httpd_segment_t *p_segments = malloc(i_max * sizeof (*p_segments));
+        if (unlikely(p_segments == NULL))
+            return VLC_ENOMEM;
+
+        for (size_t i = 0; i < stream->i_segments; i++)
+            p_segments[i] = stream->p_segments[(stream->i_segment_first + i)
+                                               % stream->i_segments_max];
+        free(stream->p_segments);
+        stream->p_segments = p_segments;
+        stream->i_segments_max = i_max;
+        stream->i_segment_first = 0;
+    }
+
+    if (stream->i_segments == 0)
+        stream->i_buffer_first_pos = stream->i_buffer_pos;
+
+    httpd_segment_t *seg = &stream->p_segments[(stream->i_segment_first
+                            + stream->i_segments) % stream->i_segments_max];
+    seg->i_pos = stream->i_buffer_pos;
+    seg->p_block = p_block;
+    stream->i_segments++;
+
+    stream->i_buffer_pos += p_block->i_buffer;
+    return VLC_SUCCESS;
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
+    /* Keep a reference to the data rather than a copy where possible */
+    block_t *p_shared = block_Share((block_t *)p_block);
+    if (unlikely(p_shared == NULL))
+        return VLC_ENOMEM;
+
     vlc_mutex_lock(&stream->lock);
 
     /* save this pointer (to be used by new connection) */
@@ -833,12 +1084,36 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
     if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
         stream->b_has_keyframes = true;
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
+
+        if (stream->i_keyframes == stream->i_gops + 1) {
+            stream->i_keyframes--;
+            memmove(stream->pi_keyframes, stream->pi_keyframes + 1,
+                    stream->i_keyframes * sizeof (*stream->pi_keyframes));
+        }
+        stream->pi_keyframes[stream->i_keyframes++] = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    int ret = httpd_AppendData(stream, p_shared);
+
+    /* wake up the workers of the clients waiting for data */
+    httpd_host_t *host = stream->url->host;
+    httpd_worker_t *wake[host->i_workers];
+    unsigned i_wake = 0;
+
+    for (unsigned i = 0; i < host->i_workers && ret == VLC_SUCCESS; i++)
+        if (stream->pb_wake[i]) {
+            stream->pb_wake[i] = false;
+            wake[i_wake++] = &host->workers[i];
+        }
 
     vlc_mutex_unlock(&stream->lock);
-    return VLC_SUCCESS;
+
+    for (unsigned i = 0; i < i_wake; i++)
+        httpd_WorkerWakeUrl(wake[i], stream->url);
+
+    if (ret != VLC_SUCCESS)
+        block_Release(p_shared);
+    return ret;
 }
 
 void httpd_StreamDelete(httpd_stream_t *stream)
@@ -849,17 +1124,22 @@ void httpd_StreamDelete(httpd_stream_t *stream)
         free(stream->p_http_headers[i].value);
     }
     free(stream->p_http_headers);
+    free(stream->pb_wake);
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    for (size_t i = 0; i < stream->i_segments; i++)
+        block_Release(stream->p_segments[(stream->i_segment_first + i)
+                                         % stream->i_segments_max].p_block);
+    free(stream->p_segments);
     free(stream);
 }
 
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread(void *);
+static int httpd_WorkerInit(httpd_host_t *, httpd_worker_t *);
+static void httpd_WorkerClean(httpd_worker_t *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t *);
 
@@ -970,16 +1250,29 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
-        msg_Err(p_this, "cannot spawn http host thread");
+    /* create the worker threads */
+    unsigned i_workers = 1;
+#ifdef HAVE_SYS_EPOLL_H
+    i_workers = var_InheritInteger(p_this, "http-threads");
+    if (i_workers == 0)
+        i_workers = vlc_GetCPUCount();
+#endif
+    host->workers = malloc(i_workers * sizeof (*host->workers));
+    host->i_workers = 0;
+    host->i_next_worker = 0;
+    if (!host->workers)
         goto error;
+
+    while (host->i_workers < i_workers) {
+        if (httpd_WorkerInit(host, &host->workers[host->i_workers])) {
+            msg_Err(p_this, "cannot spawn http host thread");
+            goto error;
+        }
+        host->i_workers++;
     }
+    msg_Dbg(host, "serving with %u thread(s)", host->i_workers);
 
     /* now add it to httpd */
     TAB_APPEND(httpd.i_host, httpd.host, host);
@@ -993,6 +1286,11 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+        for (unsigned i = 0; i < host->i_workers; i++)
+            vlc_cancel(host->workers[i].thread);
+        for (unsigned i = 0; i < host->i_workers; i++)
+            httpd_WorkerClean(&host->workers[i]);
+        free(host->workers);
         net_ListenClose(host->fds);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
@@ -1024,24 +1322,17 @@ void httpd_HostDelete(httpd_host_t *host)
     }
     TAB_REMOVE(httpd.i_host, httpd.host, host);
 
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_workers; i++)
+        vlc_cancel(host->workers[i].thread);
+    for (unsigned i = 0; i < host->i_workers; i++)
+        httpd_WorkerClean(&host->workers[i]);
+    free(host->workers);
 
     msg_Dbg(host, "HTTP host removed");
 
     for (int i = 0; i < host->i_url; i++)
         msg_Err(host, "url still registered: %s", host->url[i]->psz_url);
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *cl = host->client[i];
-        msg_Warn(host, "client still connected");
-        httpd_ClientClean(cl);
-        TAB_REMOVE(host->i_client, host->client, cl);
-        free(cl);
-        i--;
-        /* TODO */
-    }
-
     vlc_tls_Delete(host->p_tls);
     net_ListenClose(host->fds);
     vlc_cond_destroy(&host->wait);
@@ -1079,7 +1370,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     TAB_APPEND(host->i_url, host->url, url);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1104,27 +1395,35 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     TAB_REMOVE(host->i_url, host->url, url);
+    vlc_mutex_unlock(&host->lock);
 
-    vlc_mutex_destroy(&url->lock);
-    free(url->psz_url);
-    free(url->psz_user);
-    free(url->psz_password);
+    for (unsigned i = 0; i < host->i_workers; i++) {
+        httpd_worker_t *worker = &host->workers[i];
 
-    for (int i = 0; i < host->i_client; i++) {
-        httpd_client_t *client = host->client[i];
+        vlc_mutex_lock(&worker->lock);
+        for (int j = 0; j < worker->i_client; j++) {
+            httpd_client_t *client = worker->client[j];
 
-        if (client->url != url)
-            continue;
+            if (client->url != url)
+                continue;
 
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        httpd_ClientClean(client);
-        TAB_REMOVE(host->i_client, host->client, client);
-        free(client);
-        i--;
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            /* the worker thread removes the client */
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            vlc_mutex_lock(&worker->wake_lock);
+            httpd_WorkerQueue(worker, client);
+            vlc_mutex_unlock(&worker->wake_lock);
+        }
+        vlc_mutex_unlock(&worker->lock);
     }
+
+    vlc_mutex_destroy(&url->lock);
+    free(url->psz_url);
+    free(url->psz_user);
+    free(url->psz_password);
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1206,6 +1505,7 @@ static void httpd_ClientInit(httpd_client_t *cl, mtime_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->p_chain = NULL;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1235,6 +1535,8 @@ static void httpd_ClientClean(httpd_client_t *cl)
 
     free(cl->p_buffer);
     cl->p_buffer = NULL;
+    block_ChainRelease(cl->p_chain);
+    cl->p_chain = NULL;
 }
 
 static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
@@ -1245,7 +1547,11 @@ static httpd_client_t *httpd_ClientNew(int fd, vlc_tls_t *p_tls, mtime_t now)
 
     cl->i_ref   = 0;
     cl->fd      = fd;
+    cl->i_events = 0;
+    cl->b_ready = false;
+    cl->wait_url = NULL;
     cl->url     = NULL;
+    cl->worker  = NULL;
     cl->p_tls = p_tls;
 
     httpd_ClientInit(cl, now);
@@ -1587,81 +1893,134 @@ static void httpd_ClientRecv(httpd_client_t *cl)
         cl->i_activity_timeout = 0;
 }
 
-static void httpd_ClientSend(httpd_client_t *cl)
+/* Sends stream data directly from the shared stream segments */
+static ssize_t httpd_ClientSendChain(httpd_client_t *cl)
 {
-    int i_len;
+    ssize_t val;
+
+#ifndef _WIN32
+    if (cl->p_tls == NULL) {
+        struct iovec iov[HTTPD_CL_SEGMENTS];
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 0 };
 
-    if (cl->i_buffer < 0) {
-        /* We need to create the header */
-        int i_size = 0;
-        char *p;
-        const char *psz_status = httpd_ReasonFromCode(cl->answer.i_status);
-
-        i_size = strlen("HTTP/1.") + 10 + 10 + strlen(psz_status) + 5;
-        for (size_t i = 0; i < cl->answer.i_headers; i++)
-            i_size += strlen(cl->answer.p_headers[i].name) + 2 +
-                      strlen(cl->answer.p_headers[i].value) + 2;
-
-        if (cl->i_buffer_size < i_size) {
-            cl->i_buffer_size = i_size;
-            free(cl->p_buffer);
-            cl->p_buffer = xmalloc(i_size);
+        for (block_t *b = cl->p_chain;
+             b != NULL && msg.msg_iovlen < ARRAY_SIZE(iov); b = b->p_next) {
+            iov[msg.msg_iovlen].iov_base = b->p_buffer;
+            iov[msg.msg_iovlen].iov_len = b->i_buffer;
+            msg.msg_iovlen++;
         }
-        p = (char *)cl->p_buffer;
 
-        p += sprintf(p, "%s.%u %d %s\r\n",
-                      cl->answer.i_proto ==  HTTPD_PROTO_HTTP ? "HTTP/1" : "RTSP/1",
-                      cl->answer.i_version,
-                      cl->answer.i_status, psz_status);
-        for (size_t i = 0; i < cl->answer.i_headers; i++)
-            p += sprintf(p, "%s: %s\r\n", cl->answer.p_headers[i].name,
-                          cl->answer.p_headers[i].value);
-        p += sprintf(p, "\r\n");
+        do
+            val = sendmsg(cl->fd, &msg, MSG_NOSIGNAL);
+        while (val == -1 && errno == EINTR);
+    } else
+#endif
+        val = httpd_NetSend(cl, cl->p_chain->p_buffer,
+                            cl->p_chain->i_buffer);
 
-        cl->i_buffer = 0;
-        cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
+    /* release what has been sent */
+    for (size_t i_sent = (val > 0) ? val : 0; i_sent > 0;) {
+        block_t *b = cl->p_chain;
+
+        if (i_sent < b->i_buffer) {
+            b->p_buffer += i_sent;
+            b->i_buffer -= i_sent;
+            break;
+        }
+        i_sent -= b->i_buffer;
+        cl->p_chain = b->p_next;
+        block_Release(b);
     }
+    return val;
+}
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
-    if (i_len >= 0) {
-        cl->i_buffer += i_len;
+static void httpd_ClientSend(httpd_client_t *cl)
+{
+    ssize_t i_len;
 
-        if (cl->i_buffer >= cl->i_buffer_size) {
-            if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
-                /* catch more body data */
-                int     i_msg = cl->query.i_type;
-                int64_t i_offset = cl->answer.i_body_offset;
+    if (cl->p_chain != NULL) {
+        i_len = httpd_ClientSendChain(cl);
+        if (i_len < 0)
+            goto error;
+        if (cl->p_chain != NULL)
+            return;
+    } else {
+        if (cl->i_buffer < 0) {
+            /* We need to create the header */
+            int i_size = 0;
+            char *p;
+            const char *psz_status = httpd_ReasonFromCode(cl->answer.i_status);
 
-                httpd_MsgClean(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+            i_size = strlen("HTTP/1.") + 10 + 10 + strlen(psz_status) + 5;
+            for (size_t i = 0; i < cl->answer.i_headers; i++)
+                i_size += strlen(cl->answer.p_headers[i].name) + 2 +
+                          strlen(cl->answer.p_headers[i].value) + 2;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query);
+            if (cl->i_buffer_size < i_size) {
+                cl->i_buffer_size = i_size;
+                free(cl->p_buffer);
+                cl->p_buffer = xmalloc(i_size);
             }
+            p = (char *)cl->p_buffer;
+
+            p += sprintf(p, "%s.%u %d %s\r\n",
+                          cl->answer.i_proto ==  HTTPD_PROTO_HTTP ? "HTTP/1" : "RTSP/1",
+                          cl->answer.i_version,
+                          cl->answer.i_status, psz_status);
+            for (size_t i = 0; i < cl->answer.i_headers; i++)
+                p += sprintf(p, "%s: %s\r\n", cl->answer.p_headers[i].name,
+                              cl->answer.p_headers[i].value);
+            p += sprintf(p, "\r\n");
+
+            cl->i_buffer = 0;
+            cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
+        }
 
-            if (cl->answer.i_body > 0) {
-                /* send the body data */
-                free(cl->p_buffer);
-                cl->p_buffer = cl->answer.p_body;
-                cl->i_buffer_size = cl->answer.i_body;
-                cl->i_buffer = 0;
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
+        if (i_len < 0)
+            goto error;
 
-                cl->answer.i_body = 0;
-                cl->answer.p_body = NULL;
-            } else /* send finished */
-                cl->i_state = HTTPD_CLIENT_SEND_DONE;
-        }
-    } else {
+        cl->i_buffer += i_len;
+        if (cl->i_buffer < cl->i_buffer_size)
+            return;
+    }
+
+    if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+        /* catch more body data */
+        int     i_msg = cl->query.i_type;
+        int64_t i_offset = cl->answer.i_body_offset;
+
+        httpd_MsgClean(&cl->answer);
+        cl->answer.i_body_offset = i_offset;
+
+        cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                                  &cl->answer, &cl->query);
+    }
+
+    if (cl->answer.i_body > 0) {
+        /* send the body data */
+        free(cl->p_buffer);
+        cl->p_buffer = cl->answer.p_body;
+        cl->i_buffer_size = cl->answer.i_body;
+        cl->i_buffer = 0;
+
+        cl->answer.i_body = 0;
+        cl->answer.p_body = NULL;
+    } else if (cl->p_chain == NULL /* send finished */
+            && cl->i_state != HTTPD_CLIENT_DEAD)
+        cl->i_state = HTTPD_CLIENT_SEND_DONE;
+    return;
+
+error:
 #if defined(_WIN32)
-        if ((i_len < 0 && WSAGetLastError() != WSAEWOULDBLOCK) || (i_len == 0))
+    if (WSAGetLastError() != WSAEWOULDBLOCK)
 #else
-        if ((i_len < 0 && errno != EAGAIN) || (i_len == 0))
+    if (errno != EAGAIN)
 #endif
-        {
-            /* error */
-            cl->i_state = HTTPD_CLIENT_DEAD;
-        }
+    {
+        /* error */
+        cl->i_state = HTTPD_CLIENT_DEAD;
     }
 }
 
@@ -1716,277 +2075,517 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Runs the state machine of a client, returns the events to wait for */
+static short httpd_ClientPrepare(httpd_host_t *host, httpd_client_t *cl)
 {
-    struct pollfd ufd[host->nfd + host->i_client];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
+    int64_t i_offset;
+    short events = 0;
 
-    /* add all socket that should be read/write and close dead connection */
-    while (host->i_url <= 0) {
-        mutex_cleanup_push(&host->lock);
-        vlc_cond_wait(&host->wait, &host->lock);
-        vlc_cleanup_pop();
-    }
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+        case HTTPD_CLIENT_TLS_HS_IN:
+            events = POLLIN;
+            break;
 
-    mtime_t now = mdate();
-    bool b_low_delay = false;
+        case HTTPD_CLIENT_SENDING:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            events = POLLOUT;
+            break;
 
-    int canc = vlc_savecancel();
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        int64_t i_offset;
-        httpd_client_t *cl = host->client[i_client];
-        if (cl->i_ref < 0 || (cl->i_ref == 0 &&
-                    (cl->i_state == HTTPD_CLIENT_DEAD ||
-                      (cl->i_activity_timeout > 0 &&
-                        cl->i_activity_date+cl->i_activity_timeout < now)))) {
-            httpd_ClientClean(cl);
-            TAB_REMOVE(host->i_client, host->client, cl);
-            free(cl);
-            i_client--;
-            continue;
-        }
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        pufd->fd = cl->fd;
-        pufd->events = pufd->revents = 0;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
-
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
 
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                default: {
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                    /* Search the url and trigger callbacks */
+                    vlc_mutex_lock(&host->lock);
+                    for (int i = 0; i < host->i_url; i++) {
+                        httpd_url_t *url = host->url[i];
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
-
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                    default: {
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        for (int i = 0; i < host->i_url; i++) {
-                            httpd_url_t *url = host->url[i];
-
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                        }
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
+                    vlc_mutex_unlock(&host->lock);
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
                     }
+
+                    cl->i_state = HTTPD_CLIENT_SENDING;
                 }
-                break;
             }
+            break;
+        }
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
-                    const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if (psz_connection) {
-                        b_connection = (strcasecmp(psz_connection, "Close") == 0);
-                        b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
-                    }
-
-                    if (psz_query)
-                        b_query = (strcasecmp(psz_query, "Close") == 0);
-
-                    if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
-                                ((cl->query.i_version == 0 && b_keepalive) ||
-                                  (cl->query.i_version == 1 && !b_connection))) ||
-                            ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
-                              !b_query && !b_connection)) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        cl->p_buffer = xmalloc(cl->i_buffer_size);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                const char *psz_connection = httpd_MsgGet(&cl->answer, "Connection");
+                const char *psz_query = httpd_MsgGet(&cl->query, "Connection");
+                bool b_connection = false;
+                bool b_keepalive = false;
+                bool b_query = false;
+
+                cl->url = NULL;
+                if (psz_connection) {
+                    b_connection = (strcasecmp(psz_connection, "Close") == 0);
+                    b_keepalive = (strcasecmp(psz_connection, "Keep-Alive") == 0);
+                }
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                if (psz_query)
+                    b_query = (strcasecmp(psz_query, "Close") == 0);
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-                break;
+                if (((cl->query.i_proto == HTTPD_PROTO_HTTP) &&
+                            ((cl->query.i_version == 0 && b_keepalive) ||
+                              (cl->query.i_version == 1 && !b_connection))) ||
+                        ((cl->query.i_proto == HTTPD_PROTO_RTSP) &&
+                          !b_query && !b_connection)) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
 
-            case HTTPD_CLIENT_WAITING:
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    cl->p_buffer = xmalloc(cl->i_buffer_size);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
                 i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+                httpd_MsgClean(&cl->answer);
 
-                httpd_MsgInit(&cl->answer);
                 cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+                cl->i_state = HTTPD_CLIENT_WAITING;
+            }
+            break;
+
+        case HTTPD_CLIENT_WAITING:
+            i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
+
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
+
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
+            }
+    }
+    return events;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static uint32_t httpd_EpollEvents(short events)
+{
+    return ((events & POLLIN) ? EPOLLIN : 0)
+         | ((events & POLLOUT) ? EPOLLOUT : 0);
+}
+#endif
+
+/* Queues a client for the state machine of its worker thread, and wakes the
+ * thread up. The wake lock must be held. */
+static void httpd_WorkerQueue(httpd_worker_t *worker, httpd_client_t *cl)
+{
+    if (cl->b_ready)
+        return;
+    cl->b_ready = true;
+    TAB_APPEND(worker->i_ready, worker->ready, cl);
+
+    if (worker->i_ready == 1) {
+        uint64_t val = 1;
+
+        if (write(worker->wakefd[1], &val, sizeof (val)) < 0)
+            msg_Err(worker->host, "cannot wake worker: %s",
+                    vlc_strerror_c(errno));
+    }
+}
+
+/* Wakes up the clients of a worker waiting for the data of an url */
+static void httpd_WorkerWakeUrl(httpd_worker_t *worker, const httpd_url_t *url)
+{
+    vlc_mutex_lock(&worker->wake_lock);
+    for (int i = 0; i < worker->i_waiting;) {
+        httpd_client_t *cl = worker->waiting[i];
+
+        if (cl->wait_url != url) {
+            i++;
+            continue;
         }
+        cl->wait_url = NULL;
+        TAB_REMOVE(worker->i_waiting, worker->waiting, cl);
+        httpd_WorkerQueue(worker, cl);
+    }
+    vlc_mutex_unlock(&worker->wake_lock);
+}
 
-        if (pufd->events != 0)
-            nfd++;
-        else
-            b_low_delay = true;
+/* Empties the wake up descriptor */
+static void httpd_WorkerDrain(httpd_worker_t *worker)
+{
+    uint64_t val[8];
+
+    if (read(worker->wakefd[0], val, sizeof (val)) < 0)
+        msg_Err(worker->host, "cannot drain worker: %s",
+                vlc_strerror_c(errno));
+}
+
+/* Removes a client from its worker. The worker lock must be held. */
+static void httpd_WorkerRemove(httpd_worker_t *worker, httpd_client_t *cl)
+{
+    vlc_mutex_lock(&worker->wake_lock);
+    if (cl->wait_url != NULL)
+        TAB_REMOVE(worker->i_waiting, worker->waiting, cl);
+    if (cl->b_ready)
+        TAB_REMOVE(worker->i_ready, worker->ready, cl);
+    vlc_mutex_unlock(&worker->wake_lock);
+
+    httpd_ClientClean(cl);
+    TAB_REMOVE(worker->i_client, worker->client, cl);
+    free(cl);
+}
+
+/* Runs the state machine of a client until it waits for its socket, or for
+ * the data of its stream */
+static void httpd_WorkerRun(httpd_worker_t *worker, httpd_client_t *cl)
+{
+    short events;
+
+    do {
+        if (cl->i_ref < 0 ||
+            (cl->i_ref == 0 && cl->i_state == HTTPD_CLIENT_DEAD)) {
+            httpd_WorkerRemove(worker, cl);
+            return;
+        }
+        events = httpd_ClientPrepare(worker->host, cl);
+    } while (events == 0 && cl->i_state != HTTPD_CLIENT_WAITING);
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (events != cl->i_events) {
+        struct epoll_event ev = {
+            .events = httpd_EpollEvents(events),
+            .data.ptr = cl,
+        };
+        epoll_ctl(worker->epfd, EPOLL_CTL_MOD, cl->fd, &ev);
     }
+#endif
+    cl->i_events = events;
+}
+
+/* Runs the state machine of the ready clients and removes the clients which
+ * timed out. Returns the time to wait for events in milliseconds. */
+static int httpd_WorkerPrepare(httpd_worker_t *worker, mtime_t now)
+{
+    vlc_mutex_lock(&worker->wake_lock);
+    int i_ready = worker->i_ready;
+    httpd_client_t **ready = worker->ready;
+
+    worker->i_ready = 0;
+    worker->ready = NULL;
+    for (int i = 0; i < i_ready; i++)
+        ready[i]->b_ready = false;
+    vlc_mutex_unlock(&worker->wake_lock);
+
+    for (int i = 0; i < i_ready; i++)
+        httpd_WorkerRun(worker, ready[i]);
+    free(ready);
+
+    if (now >= worker->i_deadline) {
+        mtime_t deadline = INT64_MAX;
+
+        for (int i_client = 0; i_client < worker->i_client; i_client++) {
+            httpd_client_t *cl = worker->client[i_client];
+
+            if (cl->i_activity_timeout <= 0)
+                continue;
+
+            mtime_t date = cl->i_activity_date + cl->i_activity_timeout;
+            if (cl->i_ref == 0 && date < now) {
+                httpd_WorkerRemove(worker, cl);
+                i_client--;
+                continue;
+            }
+            if (date < deadline)
+                deadline = date;
+        }
+        /* check the timeouts at most once per second */
+        worker->i_deadline = __MAX(deadline, now + CLOCK_FREQ);
+    }
+
+    if (worker->i_deadline == INT64_MAX)
+        return -1;
+    return __MIN((worker->i_deadline - now + 999) / 1000, INT_MAX);
+}
+
+static void httpd_ClientEvent(httpd_worker_t *worker, httpd_client_t *cl,
+                              mtime_t now)
+{
+    cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
+        case HTTPD_CLIENT_WAITING:
+            /* the connection broke while waiting for stream data */
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            break;
+    }
+
+    /* the thread runs its ready clients before waiting again */
+    vlc_mutex_lock(&worker->wake_lock);
+    if (!cl->b_ready) {
+        cl->b_ready = true;
+        TAB_APPEND(worker->i_ready, worker->ready, cl);
+    }
+    vlc_mutex_unlock(&worker->wake_lock);
+}
+
+/* Accepts a new connection and hands it over to the next worker */
+static void httpd_HostAccept(httpd_host_t *host, int fd, mtime_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *p_tls;
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+
+        p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
+    }
+    else
+        p_tls = NULL;
+
+    httpd_client_t *cl = httpd_ClientNew(fd, p_tls, now);
+    if (cl == NULL) {
+        if (p_tls != NULL)
+            vlc_tls_SessionDelete(p_tls);
+        net_Close(fd);
+        return;
+    }
+
+    httpd_worker_t *worker = &host->workers[host->i_next_worker];
+    host->i_next_worker = (host->i_next_worker + 1) % host->i_workers;
+
+    vlc_mutex_lock(&worker->lock);
+    cl->worker = worker;
+    cl->i_events = (cl->i_state == HTTPD_CLIENT_TLS_HS_OUT) ? POLLOUT
+                                                            : POLLIN;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = {
+        .events = httpd_EpollEvents(cl->i_events),
+        .data.ptr = cl,
+    };
+
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+        vlc_mutex_unlock(&worker->lock);
+        httpd_ClientClean(cl);
+        free(cl);
+        return;
+    }
+#endif
+    TAB_APPEND(worker->i_client, worker->client, cl);
+
+    /* let the worker thread poll the client and check its timeout */
+    if (cl->i_activity_timeout > 0)
+        worker->i_deadline = __MIN(worker->i_deadline,
+                                   now + cl->i_activity_timeout);
+    vlc_mutex_lock(&worker->wake_lock);
+    httpd_WorkerQueue(worker, cl);
+    vlc_mutex_unlock(&worker->wake_lock);
+    vlc_mutex_unlock(&worker->lock);
+}
+
+static void httpdLoop(httpd_worker_t *worker)
+{
+    httpd_host_t *host = worker->host;
+
+    vlc_mutex_lock(&host->lock);
+    mutex_cleanup_push(&host->lock);
+    while (host->i_url <= 0)
+        vlc_cond_wait(&host->wait, &host->lock);
+    vlc_cleanup_pop();
     vlc_mutex_unlock(&host->lock);
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&worker->lock);
+    int timeout = httpd_WorkerPrepare(worker, mdate());
+
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev[HTTPD_WORKER_EVENTS];
+
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 
-    /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-    int ret = poll(ufd, nfd, b_low_delay ? 20 : -1);
+    /* clients waiting for stream data are woken up through wakefd */
+    int ret = epoll_wait(worker->epfd, ev, ARRAY_SIZE(ev), timeout);
+#else
+    /* the first worker accepts the new connections */
+    const bool b_listen = worker == host->workers;
+    struct pollfd ufd[1 + host->nfd + worker->i_client];
+    unsigned nfd = 1;
+
+    ufd[0].fd = worker->wakefd[0];
+    ufd[0].events = POLLIN;
+    ufd[0].revents = 0;
+
+    if (b_listen)
+        for (unsigned i = 0; i < host->nfd; i++, nfd++) {
+            ufd[nfd].fd = host->fds[i];
+            ufd[nfd].events = POLLIN;
+            ufd[nfd].revents = 0;
+        }
+
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
+
+        if (cl->i_events == 0)
+            continue;
+        ufd[nfd].fd = cl->fd;
+        ufd[nfd].events = cl->i_events;
+        ufd[nfd].revents = 0;
+        nfd++;
+    }
+    vlc_mutex_unlock(&worker->lock);
+    vlc_restorecancel(canc);
+
+    /* clients waiting for stream data are woken up through wakefd */
+    int ret = poll(ufd, nfd, timeout);
+#endif
 
     canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
     switch(ret) {
         case -1:
             if (errno != EINTR) {
@@ -2000,76 +2599,149 @@ static void httpdLoop(httpd_host_t *host)
     }
 
     /* Handle client sockets */
-    now = mdate();
-    nfd = host->nfd;
+    mtime_t now = mdate();
+    bool b_accept = false;
 
-    for (int i_client = 0; i_client < host->i_client; i_client++) {
-        httpd_client_t *cl = host->client[i_client];
-        const struct pollfd *pufd = &ufd[nfd];
+    vlc_mutex_lock(&worker->lock);
+#ifdef HAVE_SYS_EPOLL_H
+    for (int i = 0; i < ret; i++) {
+        void *ptr = ev[i].data.ptr;
 
-        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        if (ptr == NULL)
+            b_accept = true; /* listening socket */
+        else if (ptr == worker)
+            httpd_WorkerDrain(worker);
+        else
+            httpd_ClientEvent(worker, ptr, now);
+    }
+#else
+    if (ufd[0].revents != 0)
+        httpd_WorkerDrain(worker);
+
+    nfd = 1 + (b_listen ? host->nfd : 0);
+
+    for (int i_client = 0; i_client < worker->i_client; i_client++) {
+        httpd_client_t *cl = worker->client[i_client];
+        const struct pollfd *pufd = &ufd[nfd];
 
-        if (cl->fd != pufd->fd)
+        if (cl->i_events == 0)
             continue; // we were not waiting for this client
+        assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
+        assert(cl->fd == pufd->fd);
         ++nfd;
         if (pufd->revents == 0)
             continue; // no event received
 
-        cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT: httpd_ClientTlsHandshake(cl); break;
-        }
+        httpd_ClientEvent(worker, cl, now);
     }
 
+    if (b_listen)
+        for (nfd = 1; nfd <= host->nfd; nfd++)
+            if (ufd[nfd].revents != 0)
+                b_accept = true;
+#endif
+    vlc_mutex_unlock(&worker->lock);
+
     /* Handle server sockets (accept new connections) */
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        httpd_client_t *cl;
-        int fd = ufd[nfd].fd;
+    if (b_accept)
+        for (unsigned i = 0; i < host->nfd; i++)
+            httpd_HostAccept(host, host->fds[i], now);
 
-        assert (fd == host->fds[nfd]);
+    vlc_restorecancel(canc);
+}
 
-        if (ufd[nfd].revents == 0)
-            continue;
+static void* httpd_WorkerThread(void *data)
+{
+    httpd_worker_t *worker = data;
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
-            continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+    for (;;)
+        httpdLoop(worker);
+    return NULL;
+}
 
-        vlc_tls_t *p_tls;
+static int httpd_WorkerInit(httpd_host_t *host, httpd_worker_t *worker)
+{
+    worker->host = host;
+    worker->i_client = 0;
+    worker->client = NULL;
+    worker->i_deadline = INT64_MAX;
+    worker->i_waiting = 0;
+    worker->waiting = NULL;
+    worker->i_ready = 0;
+    worker->ready = NULL;
+
+#if defined (HAVE_SYS_EVENTFD_H) && defined (EFD_CLOEXEC)
+    worker->wakefd[0] = eventfd(0, EFD_CLOEXEC);
+    if (worker->wakefd[0] != -1)
+        worker->wakefd[1] = worker->wakefd[0];
+    else
+#endif
+    if (vlc_pipe(worker->wakefd))
+        return VLC_EGENERIC;
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
+#ifdef HAVE_SYS_EPOLL_H
+    worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd == -1)
+        goto error;
 
-            p_tls = vlc_tls_SessionCreate(host->p_tls, fd, NULL, alpn);
-        }
-        else
-            p_tls = NULL;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = worker };
 
-        cl = httpd_ClientNew(fd, p_tls, now);
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->wakefd[0], &ev))
+        goto error;
 
-        TAB_APPEND(host->i_client, host->client, cl);
+    /* the first worker accepts the new connections */
+    for (unsigned i = 0; i < host->nfd && worker == host->workers; i++) {
+        ev.data.ptr = NULL;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
     }
+#endif
 
-    vlc_restorecancel(canc);
+    vlc_mutex_init(&worker->lock);
+    vlc_mutex_init(&worker->wake_lock);
+    if (vlc_clone(&worker->thread, httpd_WorkerThread, worker,
+                  VLC_THREAD_PRIORITY_LOW)) {
+        vlc_mutex_destroy(&worker->wake_lock);
+        vlc_mutex_destroy(&worker->lock);
+        goto error;
+    }
+    return VLC_SUCCESS;
+
+error:
+#ifdef HAVE_SYS_EPOLL_H
+    if (worker->epfd != -1)
+        close(worker->epfd);
+#endif
+    if (worker->wakefd[1] != worker->wakefd[0])
+        close(worker->wakefd[1]);
+    close(worker->wakefd[0]);
+    return VLC_EGENERIC;
 }
 
-static void* httpd_HostThread(void *data)
+/* Joins a (cancelled) worker thread and closes its connections */
+static void httpd_WorkerClean(httpd_worker_t *worker)
 {
-    httpd_host_t *host = data;
+    vlc_join(worker->thread, NULL);
 
-    vlc_mutex_lock(&host->lock);
-    while (host->i_ref > 0)
-        httpdLoop(host);
-    vlc_mutex_unlock(&host->lock);
-    return NULL;
+    for (int i = 0; i < worker->i_client; i++) {
+        httpd_client_t *cl = worker->client[i];
+        msg_Warn(worker->host, "client still connected");
+        httpd_ClientClean(cl);
+        free(cl);
+        /* TODO */
+    }
+    free(worker->client);
+    free(worker->waiting);
+    free(worker->ready);
+
+#ifdef HAVE_SYS_EPOLL_H
+    close(worker->epfd);
+#endif
+    if (worker->wakefd[1] != worker->wakefd[0])
+        close(worker->wakefd[1]);
+    close(worker->wakefd[0]);
+    vlc_mutex_destroy(&worker->wake_lock);
+    vlc_mutex_destroy(&worker->lock);
 }
 
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream, httpd_header * p_headers, size_t i_headers)
@@ -37,6 +37,7 @@
 #include <assert.h>
 
 #include <vlc_network.h>
+#include <vlc_block.h>
 
 #ifdef _WIN32
 #   undef EAFNOSUPPORT
@@ -95,6 +96,10 @@ static int net_SetupDgramSocket (vlc_object_t *p_obj, int fd,
 #ifdef SO_REUSEPORT
     setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &(int){ 1 }, sizeof (int));
 #endif
+#ifdef SO_RXQ_OVFL
+    /* Report datagrams dropped by the kernel (see net_RecvBlocks()) */
+    setsockopt (fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 }, sizeof (int));
+#endif
 
 #if defined (_WIN32)
 
@@ -742,3 +747,108 @@ int net_SetCSCov (int fd, int sendcov, int recvcov)
 
     return VLC_EGENERIC;
 }
+
+#ifdef SO_RXQ_OVFL
+static void net_GetDrops (struct msghdr *msg, uint32_t *drops)
+{
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR (msg);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR (msg, cmsg))
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+            memcpy (drops, CMSG_DATA (cmsg), sizeof (*drops));
+}
+# define DROPS_CMSG_SPACE CMSG_SPACE (sizeof (uint32_t))
+#else
+# define net_GetDrops(msg, drops) ((void)(msg), (void)(drops))
+# define DROPS_CMSG_SPACE 1
+#endif
+
+/**
+ * net_RecvBlocks:
+ * Receives several datagrams into blocks at once.
+ * Waits for one datagram, then receives as many pending datagrams as possible,
+ * with a single system call if the platform supports it.
+ * This function is a cancellation point.
+ *
+ * @param fd datagram socket
+ * @param blocks blocks to receive datagrams into: on input, i_buffer is the
+ * capacity of each block; on output, it is the length of the received
+ * datagram (truncated datagrams are flagged as corrupted)
+ * @param count number of blocks (at least one)
+ * @param drops [IN/OUT] number of datagrams dropped by the kernel on the
+ * socket since it was opened (updated only if the kernel reports it)
+ * @return the number of datagrams received in the first blocks, or -1 on
+ * error (see errno)
+ */
+int net_RecvBlocks (int fd, block_t *const *blocks, unsigned count,
+                    uint32_t *drops)
+{
+    assert (count > 0);
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msgs[count];
+    struct iovec iovs[count];
+    union
+    {
+        struct cmsghdr hdr;
+        char buf[DROPS_CMSG_SPACE];
+    } ctrls[count];
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        iovs[i].iov_base = blocks[i]->p_buffer;
+        iovs[i].iov_len = blocks[i]->i_buffer;
+        msgs[i].msg_hdr = (struct msghdr) {
+            .msg_iov = &iovs[i],
+            .msg_iovlen = 1,
+            .msg_control = ctrls[i].buf,
+            .msg_controllen = sizeof (ctrls[i].buf),
+        };
+    }
+
+    int n = recvmmsg (fd, msgs, count, MSG_WAITFORONE, NULL);
+
+    for (int i = 0; i < n; i++)
+    {
+        blocks[i]->i_buffer = msgs[i].msg_len;
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            blocks[i]->i_flags |= BLOCK_FLAG_CORRUPTED;
+        net_GetDrops (&msgs[i].msg_hdr, drops);
+    }
+    return n;
+#elif !defined (_WIN32)
+    struct iovec iov = {
+        .iov_base = blocks[0]->p_buffer,
+        .iov_len = blocks[0]->i_buffer,
+    };
+    union
+    {
+        struct cmsghdr hdr;
+        char buf[DROPS_CMSG_SPACE];
+    } ctrl;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctrl.buf,
+        .msg_controllen = sizeof (ctrl.buf),
+    };
+
+    ssize_t len = recvmsg (fd, &msg, 0);
+    if (len == -1)
+        return -1;
+
+    blocks[0]->i_buffer = len;
+    if (msg.msg_flags & MSG_TRUNC)
+        blocks[0]->i_flags |= BLOCK_FLAG_CORRUPTED;
+    net_GetDrops (&msg, drops);
+    (void) count;
+    return 1;
+#else
+    ssize_t len = recv (fd, blocks[0]->p_buffer, blocks[0]->i_buffer, 0);
+    if (len == -1)
+        return -1;
+
+    blocks[0]->i_buffer = len;
+    (void) count; (void) drops;
+    return 1;
+#endif
+}
@@ -53,7 +53,14 @@ static void test_block_File (void)
     assert (block != NULL);
     assert (block->i_buffer == strlen (text));
     assert (!memcmp (block->p_buffer, text, block->i_buffer));
+
+    /* File mappings are shared, not copied */
+    block_t *shared = block_Share (block);
+    assert (shared != NULL);
+    assert (shared->p_buffer == block->p_buffer);
     block_Release (block);
+    assert (!memcmp (shared->p_buffer, text, shared->i_buffer));
+    block_Release (shared);
 
     remove ("testfile.txt");
 }
@@ -84,10 +91,65 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_Share (void)
+{
+    block_t *block = block_Alloc (sizeof (text));
+    assert (block != NULL);
+    memcpy (block->p_buffer, text, sizeof (text));
+    block->i_pts = 42;
+
+    block_t *shared = block_Share (block);
+    assert (shared != NULL);
+    assert (shared != block);
+    assert (shared->p_buffer == block->p_buffer);
+    assert (shared->i_buffer == block->i_buffer);
+    assert (shared->i_pts == 42);
+
+    /* Trimming a shared block does not affect the other one */
+    shared->p_buffer += 5;
+    shared->i_buffer -= 5;
+    assert (block->i_buffer == sizeof (text));
+
+    /* Expanding a shared block must not touch the shared payload */
+    shared = block_Realloc (shared, 5, shared->i_buffer + 100);
+    assert (shared != NULL);
+    assert (shared->p_buffer != block->p_buffer);
+    assert (!memcmp (shared->p_buffer + 5, text + 5, sizeof (text) - 5));
+    memset (shared->p_buffer, 'X', shared->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (shared);
+
+    /* Copy-on-write */
+    shared = block_Share (block);
+    assert (shared != NULL);
+    block_t *copy = block_Unshare (shared);
+    assert (copy != NULL);
+    assert (copy->p_buffer != block->p_buffer);
+    assert (!memcmp (copy->p_buffer, text, sizeof (text)));
+    memset (copy->p_buffer, 'X', copy->i_buffer);
+    assert (!memcmp (block->p_buffer, text, sizeof (text)));
+    block_Release (copy);
+
+    /* The payload is private again: no copy needed */
+    assert (block_Unshare (block) == block);
+
+    /* The payload outlives the original block */
+    shared = block_Share (block);
+    assert (shared != NULL);
+    block_Release (block);
+    assert (!memcmp (shared->p_buffer, text, sizeof (text)));
+    block = block_Share (shared);
+    assert (block != NULL);
+    block_Release (shared);
+    assert (block_Unshare (block) == block);
+    block_Release (block);
+}
+
 int main (void)
 {
     test_block_File ();
     test_block ();
+    test_block_Share ();
     return 0;
 }
 
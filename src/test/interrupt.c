@@ -33,6 +33,13 @@
 
 static vlc_sem_t sem;
 
+static void test_callback(void *data)
+{
+    unsigned *count = data;
+
+    (*count)++;
+}
+
 static void test_context_simple(vlc_interrupt_t *ctx)
 {
     vlc_interrupt_t *octx;
@@ -64,10 +71,31 @@ static void test_context_simple(vlc_interrupt_t *ctx)
     assert(vlc_sem_wait_i11e(&sem) == EINTR);
     assert(vlc_sem_wait_i11e(&sem) == 0);
 
+    unsigned count = 0;
+    vlc_interrupt_register(test_callback, &count);
+    assert(vlc_interrupt_unregister() == 0);
+    assert(count == 0);
+
+    vlc_interrupt_register(test_callback, &count);
+    vlc_interrupt_raise(ctx);
+    assert(count == 1);
+    assert(vlc_interrupt_unregister() == EINTR);
+
+    /* a pending interruption invokes the callback at once */
+    vlc_interrupt_raise(ctx);
+    vlc_interrupt_register(test_callback, &count);
+    assert(count == 2);
+    assert(vlc_interrupt_unregister() == EINTR);
+    assert(vlc_interrupt_unregister() == 0);
+
     octx = vlc_interrupt_set(NULL);
     assert(octx == ctx);
     octx = vlc_interrupt_set(NULL);
     assert(octx == NULL);
+
+    /* without a context, nothing is registered */
+    vlc_interrupt_register(test_callback, &count);
+    assert(vlc_interrupt_unregister() == 0);
 }
 
 static void *test_thread_simple(void *data)
@@ -629,6 +629,11 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
 {
     vout_thread_t *vout = filter->owner.sys;
 
+    /* A pipelined chain allocates from its own threads, without the lock,
+     * and holds more pictures than the private pool has. */
+    if (vout->p->filter.pipeline > 0)
+        return picture_NewFromFormat(&filter->fmt_out.video);
+
     vlc_assert_locked(&vout->p->filter.lock);
     if (filter_chain_GetLength(vout->p->filter.chain_interactive) == 0)
         return VoutVideoFilterInteractiveNewPicture(filter);
@@ -636,6 +641,14 @@ static picture_t *VoutVideoFilterStaticNewPicture(filter_t *filter)
     return picture_NewFromFormat(&filter->fmt_out.video);
 }
 
+/* Called by the pipelined static chain, from any thread */
+static void VoutVideoFilterReady(void *data)
+{
+    vout_thread_t *vout = data;
+
+    vout_control_Wake(&vout->p->control);
+}
+
 static void ThreadFilterFlush(vout_thread_t *vout, bool is_locked)
 {
     if (vout->p->displayed.current)
@@ -681,7 +694,10 @@ static void ThreadChangeFilters(vout_thread_t *vout,
             vout_filter_t *e = xmalloc(sizeof(*e));
             e->name = name;
             e->cfg  = cfg;
-            if (!strcmp(e->name, "deinterlace") ||
+            /* A pipelined static chain runs every filter once per picture,
+             * instead of once per display */
+            if (vout->p->filter.pipeline > 0 ||
+                !strcmp(e->name, "deinterlace") ||
                 !strcmp(e->name, "postproc")) {
                 vlc_array_append(&array_static, e);
             } else {
@@ -759,12 +775,14 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
     vlc_mutex_lock(&vout->p->filter.lock);
 
     picture_t *picture = filter_chain_VideoFilter(vout->p->filter.chain_static, NULL);
-    assert(!reuse || !picture);
+    assert(!reuse || !picture || vout->p->filter.pipeline > 0);
 
     while (!picture) {
         picture_t *decoded;
+        bool is_reused = false;
         if (reuse && vout->p->displayed.decoded) {
             decoded = picture_Hold(vout->p->displayed.decoded);
+            is_reused = true;
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (decoded) {
@@ -797,6 +815,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         vout->p->displayed.is_interlaced = !decoded->b_progressive;
 
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
+        /* A pipelined chain would get the same picture again, or not return
+         * the picture to step to in time */
+        if (!picture && (is_reused || frame_by_frame))
+            picture = filter_chain_VideoDrain(vout->p->filter.chain_static);
     }
 
     vlc_mutex_unlock(&vout->p->filter.lock);
@@ -1301,6 +1323,11 @@ static int ThreadStart(vout_thread_t *vout, const vout_display_state_t *state)
     };
     vout->p->filter.chain_static =
         filter_chain_NewVideo( vout, true, &owner );
+    vout->p->filter.pipeline = var_InheritInteger(vout, "video-filter-pipeline");
+    if (vout->p->filter.chain_static != NULL && vout->p->filter.pipeline > 0)
+        filter_chain_SetPipeline(vout->p->filter.chain_static,
+                                 vout->p->filter.pipeline,
+                                 VoutVideoFilterReady, vout);
 
     owner.video.buffer_new = VoutVideoFilterInteractiveNewPicture;
     vout->p->filter.chain_interactive =
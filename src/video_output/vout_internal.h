@@ -118,6 +118,7 @@ struct vout_thread_sys_t
         vlc_mutex_t     lock;
         char            *configuration;
         video_format_t  format;
+        unsigned        pipeline; /* static chain depth, 0 if synchronous */
         struct filter_chain_t *chain_static;
         struct filter_chain_t *chain_interactive;
     } filter;
@@ -0,0 +1,259 @@
+/*****************************************************************************
+ * livehttp.c: HTTP live streaming output test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Segments a few seconds of silent MPEG audio written by the test, once in
+ * MPEG-TS with a playlist delta update, once in fragmented MP4 with partial
+ * segments and a DASH manifest, then checks the playlists and the
+ * manifest against the segments written. */
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+
+/* MPEG-1 Layer II, 192 kbit/s, 48 kHz, stereo: 576 bytes per 24 ms frame */
+#define MPGA_FRAME   576
+#define MPGA_FRAMES  834 /* 20 s */
+#define DURATION     20.016
+
+static char dir[] = "/tmp/vlc-livehttp-XXXXXX";
+
+/* Writes silent frames: all bit allocations are zero */
+static void WriteStream (const char *path)
+{
+    uint8_t frame[MPGA_FRAME] = { 0xff, 0xfd, 0xa4, 0x00 };
+
+    FILE *out = fopen (path, "wb");
+    assert (out != NULL);
+    for (unsigned i = 0; i < MPGA_FRAMES; i++)
+        fwrite (frame, 1, sizeof (frame), out);
+    assert (!ferror (out));
+    fclose (out);
+}
+
+static void Segment (const char *input, const char *sout)
+{
+    const char *args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+    };
+    char chain[1024];
+
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, input);
+    assert (media != NULL);
+    libvlc_media_add_option (media, ":demux=mpga");
+    snprintf (chain, sizeof (chain), ":sout=%s", sout);
+    libvlc_media_add_option (media, chain);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+    libvlc_media_release (media);
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        msleep (CLOCK_FREQ / 100);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+    assert (state == libvlc_Ended);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
+
+/* Returns the content of a file of the output directory */
+static char *Load (const char *name)
+{
+    char path[256];
+    struct stat st;
+
+    snprintf (path, sizeof (path), "%s/%s", dir, name);
+    FILE *stream = fopen (path, "rb");
+    assert (stream != NULL);
+    assert (fstat (fileno (stream), &st) == 0);
+
+    char *buf = malloc (st.st_size + 1);
+    assert (buf != NULL);
+    assert (fread (buf, 1, st.st_size, stream) == (size_t)st.st_size);
+    buf[st.st_size] = '\0';
+    fclose (stream);
+    return buf;
+}
+
+static unsigned Count (const char *str, const char *pattern)
+{
+    unsigned count = 0;
+
+    while ((str = strstr (str, pattern)) != NULL)
+    {
+        count++;
+        str += strlen (pattern);
+    }
+    return count;
+}
+
+/* Checks the segments of a playlist: they exist and are not empty, and
+ * returns their number and their total duration */
+static unsigned CheckSegments (const char *playlist, double *duration)
+{
+    unsigned count = 0;
+
+    *duration = 0.;
+    for (const char *p = strstr (playlist, "#EXTINF:"); p != NULL;
+         p = strstr (p, "#EXTINF:"))
+    {
+        char name[64], path[256];
+        struct stat st;
+
+        *duration += atof (p + 8);
+        p = strchr (p, '\n') + 1;
+        assert (sscanf (p, "%63[^\n]", name) == 1);
+        snprintf (path, sizeof (path), "%s/%s", dir, name);
+        assert (stat (path, &st) == 0 && st.st_size > 0);
+        count++;
+    }
+    return count;
+}
+
+static void TestTS (const char *input)
+{
+    char sout[512];
+    double duration, delta_duration;
+
+    snprintf (sout, sizeof (sout), "#std{access=livehttp{seglen=1,"
+              "splitanywhere,index=%s/index.m3u8,index-url=seg-#.ts,"
+              "delta=%s/delta.m3u8},mux=ts,dst=%s/seg-#.ts}", dir, dir, dir);
+    Segment (input, sout);
+
+    char *index = Load ("index.m3u8");
+    log ("%s", index);
+    assert (!strncmp (index, "#EXTM3U\n", 8));
+    assert (strstr (index, "#EXT-X-VERSION:9\n") != NULL);
+    assert (strstr (index, "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=6\n") != NULL);
+    assert (strstr (index, "#EXT-X-PLAYLIST-TYPE:VOD\n") != NULL);
+    assert (strstr (index, "#EXT-X-SKIP") == NULL);
+    assert (strstr (index, "#EXT-X-ENDLIST\n") != NULL);
+
+    unsigned count = CheckSegments (index, &duration);
+    assert (count >= 10);
+    assert (duration > DURATION - 1. && duration < DURATION + 1.);
+    free (index);
+
+    /* The delta update skips all but the last six seconds */
+    char *delta = Load ("delta.m3u8");
+    const char *skip = strstr (delta, "#EXT-X-SKIP:SKIPPED-SEGMENTS=");
+    assert (skip != NULL);
+    unsigned skipped = atoi (skip + 29);
+    assert (skipped > 0);
+    assert (CheckSegments (delta, &delta_duration) == count - skipped);
+    assert (delta_duration >= 6. && delta_duration < 6. + 2.);
+    free (delta);
+}
+
+static void TestMP4 (const char *input)
+{
+    char sout[512];
+    double duration;
+
+    snprintf (sout, sizeof (sout), "#std{access=livehttp{seglen=2,"
+              "splitanywhere,partial,index=%s/index.m3u8,"
+              "index-url=frag-#.m4s,mpd=%s/index.mpd},"
+              "mux=mp4frag{fragment=500},dst=%s/frag-#.m4s}", dir, dir, dir);
+    Segment (input, sout);
+
+    char *index = Load ("index.m3u8");
+    log ("%s", index);
+    assert (strstr (index, "#EXT-X-VERSION:6\n") != NULL);
+    assert (strstr (index, "#EXT-X-MAP:URI=\"frag-init.m4s\"\n") != NULL);
+    assert (strstr (index, "#EXT-X-PART-INF:PART-TARGET=") != NULL);
+    assert (strstr (index, "#EXT-X-ENDLIST\n") != NULL);
+    /* Parts are only listed for the last three target durations, plus
+     * the segment they start in */
+    assert (Count (index, "#EXT-X-PART:") > 0);
+    assert (Count (index, "#EXT-X-PART:") <= (3 + 1) * 2 * 2);
+
+    unsigned count = CheckSegments (index, &duration);
+    assert (count >= 5);
+    assert (duration > DURATION - 1. && duration < DURATION + 1.);
+    free (index);
+
+    /* The codecs come from the sample entry of the track */
+    char *mpd = Load ("index.mpd");
+    log ("%s", mpd);
+    assert (strstr (mpd, "type=\"static\"") != NULL);
+    assert (strstr (mpd, "mimeType=\"audio/mp4\"") != NULL);
+    assert (strstr (mpd, "codecs=\"mp4a.6B\"") != NULL);
+    assert (strstr (mpd, "availabilityTimeOffset") == NULL);
+    assert (Count (mpd, "<S ") == count);
+    free (mpd);
+
+    free (Load ("frag-init.m4s"));
+}
+
+/* Removes the files written to the output directory */
+static void Clean (void)
+{
+    DIR *d = opendir (dir);
+    assert (d != NULL);
+
+    struct dirent *ent;
+    while ((ent = readdir (d)) != NULL)
+    {
+        char path[256];
+
+        if (ent->d_name[0] == '.')
+            continue;
+        snprintf (path, sizeof (path), "%s/%s", dir, ent->d_name);
+        unlink (path);
+    }
+    closedir (d);
+}
+
+int main (void)
+{
+    test_init ();
+
+    if (mkdtemp (dir) == NULL)
+    {
+        perror ("mkdtemp");
+        return 1;
+    }
+
+    char input[sizeof (dir) + 4];
+    snprintf (input, sizeof (input), "%s.mp2", dir);
+    WriteStream (input);
+
+    TestTS (input);
+    Clean ();
+    TestMP4 (input);
+    Clean ();
+
+    unlink (input);
+    rmdir (dir);
+    return 0;
+}
@@ -0,0 +1,388 @@
+/*****************************************************************************
+ * adaptative.c: HLS and DASH segment downloads test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_demux_adaptative directory playlist [kbps]
+ *
+ * Serves a canned HLS or DASH ladder from a directory with a minimal
+ * HTTP/1.1 server, optionally throttled, and plays it to the end. Then checks
+ * that every request succeeded and that the segments were downloaded over
+ * kept alive connections, i.e. far fewer connections than segments. */
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vlc_common.h>
+
+#define MAX_CLIENTS 32
+
+typedef struct
+{
+    unsigned connections;  /* TCP connections accepted */
+    unsigned requests;     /* HTTP requests served */
+    unsigned segments;     /* requests for anything but a playlist */
+    unsigned segment_connections; /* connections used for segments */
+    unsigned failures;     /* requests not found or invalid */
+    uint64_t bytes;        /* body bytes sent */
+} serve_result_t;
+
+typedef struct
+{
+    int    fd;
+    bool   segments;
+    size_t len;
+    char   buf[4096];
+} client_t;
+
+static const char *ContentType (const char *path)
+{
+    const char *ext = strrchr (path, '.');
+
+    if (ext == NULL)
+        return "application/octet-stream";
+    if (!strcmp (ext, ".m3u8"))
+        return "application/vnd.apple.mpegurl";
+    if (!strcmp (ext, ".mpd"))
+        return "application/dash+xml";
+    if (!strcmp (ext, ".ts"))
+        return "video/mp2t";
+    if (!strcmp (ext, ".mp4") || !strcmp (ext, ".m4s"))
+        return "video/mp4";
+    return "application/octet-stream";
+}
+
+/* Sends at most kbps kbit/s, 0 for unlimited */
+static bool SendAll (int fd, const void *buf, size_t len, unsigned kbps)
+{
+    while (len > 0)
+    {
+        size_t size = len;
+        if (kbps && size > 4096)
+            size = 4096;
+
+        ssize_t val = send (fd, buf, size, MSG_NOSIGNAL);
+        if (val < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (kbps)
+            msleep (CLOCK_FREQ * val * 8 / (kbps * 1000));
+        buf = (const char *)buf + val;
+        len -= val;
+    }
+    return true;
+}
+
+static bool IsPlaylist (const char *path)
+{
+    const char *type = ContentType (path);
+    return !strcmp (type, "application/vnd.apple.mpegurl")
+        || !strcmp (type, "application/dash+xml");
+}
+
+/* Serves one request, returns false if the connection must be closed */
+static bool Serve (client_t *cl, const char *dir, unsigned kbps,
+                   serve_result_t *res)
+{
+    const char *req = cl->buf;
+    char path[256], hdr[512];
+    unsigned long long first = 0, last = 0;
+    bool range = false;
+
+    res->requests++;
+
+    if (sscanf (req, "GET %255s HTTP/1.1", path) != 1
+     || strstr (path, "..") != NULL)
+    {
+        res->failures++;
+        return false;
+    }
+
+    const char *r = strstr (req, "\r\nRange: bytes=");
+    if (r != NULL)
+    {
+        int n = sscanf (r, "\r\nRange: bytes=%llu-%llu", &first, &last);
+        range = n >= 1;
+        if (n < 2)
+            last = ULLONG_MAX;
+    }
+    const bool keep = strstr (req, "\r\nConnection: close") == NULL;
+
+    char *file;
+    if (asprintf (&file, "%s%s", dir, path) == -1)
+        abort ();
+
+    int fd = open (file, O_RDONLY);
+    free (file);
+
+    struct stat st;
+    if (fd == -1 || fstat (fd, &st) || (range && first >= (uint64_t)st.st_size))
+    {
+        if (fd != -1)
+            close (fd);
+        fprintf (stderr, "%s: not found\n", path);
+        res->failures++;
+        snprintf (hdr, sizeof (hdr), "HTTP/1.1 404 Not Found\r\n"
+                  "Content-Length: 0\r\n\r\n");
+        return SendAll (cl->fd, hdr, strlen (hdr), 0) && keep;
+    }
+
+    if (!IsPlaylist (path))
+    {
+        res->segments++;
+        if (!cl->segments)
+            res->segment_connections++;
+        cl->segments = true;
+    }
+
+    if (!range || last >= (uint64_t)st.st_size)
+        last = st.st_size - 1;
+    const size_t length = last - first + 1;
+
+    snprintf (hdr, sizeof (hdr), "HTTP/1.1 %s\r\n"
+              "Content-Length: %zu\r\n"
+              "Content-Type: %s\r\n"
+              "%s\r\n", range ? "206 Partial Content" : "200 OK", length,
+              ContentType (path), keep ? "" : "Connection: close\r\n");
+
+    char *data = malloc (length);
+    bool ok = data != NULL
+           && pread (fd, data, length, first) == (ssize_t)length;
+    close (fd);
+    if (!ok)
+    {
+        free (data);
+        res->failures++;
+        return false;
+    }
+
+    ok = SendAll (cl->fd, hdr, strlen (hdr), 0)
+      && SendAll (cl->fd, data, length, kbps);
+    free (data);
+    res->bytes += length;
+    return ok && keep;
+}
+
+/* Runs the server until the stop pipe is closed */
+static void RunServer (int listenfd, const char *dir, unsigned kbps,
+                       int stop, int out)
+{
+    client_t clients[MAX_CLIENTS];
+    struct pollfd ufd[MAX_CLIENTS + 2];
+    serve_result_t res = { 0, 0, 0, 0, 0, 0 };
+
+    for (unsigned i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    for (;;)
+    {
+        unsigned n = 0;
+
+        ufd[n].fd = stop;
+        ufd[n++].events = POLLIN;
+        ufd[n].fd = listenfd;
+        ufd[n++].events = POLLIN;
+        for (unsigned i = 0; i < MAX_CLIENTS; i++)
+        {
+            ufd[n].fd = clients[i].fd;
+            ufd[n++].events = POLLIN;
+        }
+
+        if (poll (ufd, n, -1) < 0)
+            continue;
+        if (ufd[0].revents)
+            break;
+
+        if (ufd[1].revents)
+        {
+            int fd = accept (listenfd, NULL, NULL);
+            for (unsigned i = 0; fd != -1 && i < MAX_CLIENTS; i++)
+                if (clients[i].fd == -1)
+                {
+                    clients[i].fd = fd;
+                    clients[i].segments = false;
+                    clients[i].len = 0;
+                    fd = -1;
+                    res.connections++;
+                }
+            if (fd != -1)
+                close (fd);
+        }
+
+        for (unsigned i = 0; i < MAX_CLIENTS; i++)
+        {
+            client_t *cl = &clients[i];
+
+            if (cl->fd == -1 || !ufd[2 + i].revents)
+                continue;
+
+            ssize_t val = recv (cl->fd, cl->buf + cl->len,
+                                sizeof (cl->buf) - 1 - cl->len, 0);
+            if (val <= 0)
+            {
+                close (cl->fd);
+                cl->fd = -1;
+                continue;
+            }
+            cl->len += val;
+            cl->buf[cl->len] = '\0';
+
+            /* requests are served one at a time */
+            char *end;
+            while ((end = strstr (cl->buf, "\r\n\r\n")) != NULL)
+            {
+                end += 4;
+                if (!Serve (cl, dir, kbps, &res))
+                {
+                    close (cl->fd);
+                    cl->fd = -1;
+                    break;
+                }
+                cl->len -= end - cl->buf;
+                memmove (cl->buf, end, cl->len + 1);
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < MAX_CLIENTS; i++)
+        if (clients[i].fd != -1)
+            close (clients[i].fd);
+
+    if (write (out, &res, sizeof (res)) != sizeof (res))
+        abort ();
+}
+
+static int Play (const char *url)
+{
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_location (vlc, url);
+    assert (media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+    libvlc_media_release (media);
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        msleep (CLOCK_FREQ / 100);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+    return state == libvlc_Ended ? 0 : 1;
+}
+
+int main (int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf (stderr, "Usage: %s directory playlist [kbps]\n", argv[0]);
+        return 77;
+    }
+
+    unsigned kbps = (argc > 3) ? strtoul (argv[3], NULL, 0) : 0;
+
+    test_init ();
+    alarm (0); /* plays the whole ladder in real time */
+
+    int listenfd = socket (AF_INET, SOCK_STREAM, 0);
+    assert (listenfd != -1);
+
+    /* Any free port */
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = 0,
+        .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof (addr);
+    if (bind (listenfd, (const struct sockaddr *)&addr, sizeof (addr))
+     || listen (listenfd, 16)
+     || getsockname (listenfd, (struct sockaddr *)&addr, &addrlen))
+    {
+        perror ("bind");
+        return 1;
+    }
+
+    int stop[2], out[2];
+    if (pipe (stop) || pipe (out))
+        abort ();
+
+    pid_t pid = fork ();
+    assert (pid != -1);
+    if (pid == 0)
+    {
+        close (stop[1]);
+        close (out[0]);
+        RunServer (listenfd, argv[1], kbps, stop[0], out[1]);
+        _exit (0);
+    }
+    close (listenfd);
+    close (stop[0]);
+    close (out[1]);
+
+    char url[256];
+    snprintf (url, sizeof (url), "http://127.0.0.1:%u/%s",
+              ntohs (addr.sin_port), argv[2]);
+    int ret = Play (url);
+
+    close (stop[1]);
+    serve_result_t res;
+    if (read (out[0], &res, sizeof (res)) != sizeof (res))
+        abort ();
+    close (out[0]);
+    waitpid (pid, NULL, 0);
+
+    printf ("%s: %u requests over %u connections, %u failed, %"PRIu64
+            " bytes\n", url, res.requests, res.connections, res.failures,
+            res.bytes);
+    printf (" %u segments over %u connections\n", res.segments,
+            res.segment_connections);
+
+    if (res.failures > 0)
+        ret = 1;
+    /* the segments of each stream should share one connection */
+    if (res.segments > 8 && res.segment_connections * 2 > res.segments)
+    {
+        fprintf (stderr, "connections are not kept alive\n");
+        ret = 1;
+    }
+    return ret;
+}
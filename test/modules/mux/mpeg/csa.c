@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * csa.c: CSA batch (de)scrambling test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that csa_EncryptBatch() and csa_DecryptBatch() give the same
+ * packets as csa_Encrypt() and csa_Decrypt(), with packets with or without
+ * adaptation field, then compares their speed. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "csa.h"
+
+#define PACKETS 2048
+
+static void RandomPackets (uint8_t *buf, unsigned count, bool scrambled)
+{
+    for (unsigned i = 0; i < count * 188; i++)
+        buf[i] = rand ();
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint8_t *pkt = &buf[i * 188];
+
+        pkt[0] = 0x47;
+        pkt[3] &= scrambled ? 0xff : 0x3f;
+        /* adaptation fields of any length, including invalid ones */
+        if (rand () % 3 == 0)
+        {
+            pkt[3] |= 0x20;
+            pkt[4] = rand () % ((rand () % 4) ? 40 : 190);
+        }
+        else
+            pkt[3] &= ~0x20;
+    }
+}
+
+static void Check (csa_t *csa, unsigned count, int size)
+{
+    uint8_t *ref = malloc (count * 188), *buf = malloc (count * 188);
+    uint8_t *pkts[count];
+
+    assert (ref != NULL && buf != NULL);
+    for (unsigned i = 0; i < count; i++)
+        pkts[i] = &buf[i * 188];
+
+    RandomPackets (ref, count, false);
+    memcpy (buf, ref, count * 188);
+    for (unsigned i = 0; i < count; i++)
+        csa_Encrypt (csa, &ref[i * 188], size);
+    csa_EncryptBatch (csa, pkts, count, size);
+    assert (!memcmp (ref, buf, count * 188));
+
+    /* odd, even and clear packets */
+    RandomPackets (ref, count, true);
+    memcpy (buf, ref, count * 188);
+    for (unsigned i = 0; i < count; i++)
+        csa_Decrypt (csa, &ref[i * 188], size);
+    csa_DecryptBatch (csa, pkts, count, size);
+    assert (!memcmp (ref, buf, count * 188));
+
+    free (buf);
+    free (ref);
+}
+
+static double Bench (csa_t *csa, unsigned batch)
+{
+    uint8_t *buf = malloc (PACKETS * 188);
+    uint8_t *pkts[PACKETS];
+
+    assert (buf != NULL);
+    RandomPackets (buf, PACKETS, false);
+    for (unsigned i = 0; i < PACKETS; i++)
+        pkts[i] = &buf[i * 188];
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < PACKETS; i += batch)
+    {
+        unsigned count = __MIN (batch, PACKETS - i);
+
+        for (unsigned j = 0; j < count; j++)
+            pkts[i + j][3] |= 0x80;
+        if (batch == 1)
+            csa_Decrypt (csa, pkts[i], 188);
+        else
+            csa_DecryptBatch (csa, &pkts[i], count, 188);
+    }
+    mtime_t duration = mdate () - start;
+
+    free (buf);
+    return (double)(PACKETS * 188 * 8) / duration; /* Mbit/s */
+}
+
+int main (void)
+{
+    /* around the scalar threshold and the widths of the bitslice words */
+    static const unsigned counts[] = { 1, 2, 3, 4, 5, 8, 31, 63, 64, 65, 100,
+                                       127, 128, 129, 255, 256, 257, 513 };
+    static const unsigned batches[] = { 1, 8, 32, 64, 128, 256 };
+    char odd[] = "0x0123456789abcdef", even[] = "fedcba9876543210";
+    csa_t *csa = csa_New ();
+
+    assert (csa != NULL);
+    srand (0);
+    csa_SetCW (NULL, csa, odd, true);
+    csa_SetCW (NULL, csa, even, false);
+
+    for (unsigned i = 0; i < ARRAY_SIZE(counts); i++)
+    {
+        csa_UseKey (NULL, csa, i & 1);
+        Check (csa, counts[i], 188);
+        Check (csa, counts[i], 12 + rand () % (188 - 12));
+    }
+
+    double scalar = Bench (csa, 1);
+    printf ("descrambling %u packets:\n", PACKETS);
+    printf (" per packet:        %7.1f Mbit/s\n", scalar);
+    for (unsigned i = 1; i < ARRAY_SIZE(batches); i++)
+    {
+        double rate = Bench (csa, batches[i]);
+        printf (" batches of %3u:    %7.1f Mbit/s (x%.1f)\n", batches[i],
+                rate, rate / scalar);
+    }
+
+    csa_Delete (csa);
+    return 0;
+}
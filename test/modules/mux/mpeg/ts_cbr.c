@@ -0,0 +1,436 @@
+/*****************************************************************************
+ * ts_cbr.c: constant bitrate TS muxer analyser
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_modules_mux_mpeg_ts_cbr [input [muxrate]]
+ *
+ * Remuxes a short sample with --sout-ts-muxrate into a temporary file, then
+ * reads the file back and checks, from the position of each packet:
+ *  - that every PCR is within 500 ns of its ideal value,
+ *  - the PCR and PAT intervals,
+ *  - that no transport buffer (ISO/IEC 13818-1 T-STD) overflows,
+ *  - that every PES is received before its DTS.
+ *
+ * Without arguments, the sample is a few seconds of silent MPEG audio
+ * written by the test. */
+
+#include "../../../libvlc/test.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include <vlc_common.h>
+
+#define PCR_INTERVAL 30  /* ms, as given to the muxer */
+#define PSI_INTERVAL 100 /* ms, the muxer default */
+#define TB_SIZE      512 /* bytes */
+
+/* MPEG-1 Layer II, 192 kbit/s, 48 kHz, stereo: 576 bytes per 24 ms frame */
+#define MPGA_FRAME   576
+#define MPGA_FRAMES  250
+#define MPGA_RATE    1000000 /* muxrate, bits/s */
+
+/* Writes silent frames: all bit allocations are zero */
+static void WriteStream (const char *path)
+{
+    uint8_t frame[MPGA_FRAME] = { 0xff, 0xfd, 0xa4, 0x00 };
+
+    FILE *out = fopen (path, "wb");
+    assert (out != NULL);
+    for (unsigned i = 0; i < MPGA_FRAMES; i++)
+        fwrite (frame, 1, sizeof (frame), out);
+    assert (!ferror (out));
+    fclose (out);
+}
+
+static void Mux (const char *input, const char *demux, const char *output,
+                 unsigned rate)
+{
+    char chain[512];
+
+    snprintf (chain, sizeof (chain), ":sout=#std{access=file,"
+              "mux=ts{muxrate=%u,pcr=%u},dst='%s'}", rate, PCR_INTERVAL,
+              output);
+
+    const char *args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+    };
+
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+
+    libvlc_media_t *media = libvlc_media_new_path (vlc, input);
+    assert (media != NULL);
+    libvlc_media_add_option (media, chain);
+    if (demux != NULL)
+    {
+        snprintf (chain, sizeof (chain), ":demux=%s", demux);
+        libvlc_media_add_option (media, chain);
+    }
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+    libvlc_media_release (media);
+
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        msleep (CLOCK_FREQ / 100);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+    assert (state == libvlc_Ended);
+
+    libvlc_media_player_stop (mp);
+    libvlc_media_player_release (mp);
+    libvlc_release (vlc);
+}
+
+typedef struct
+{
+    uint8_t  type;   /* stream_type, 0 if not in the PMT */
+    int64_t  leak;   /* Rx, bits/s, 0 if not checked */
+    int64_t  fill;   /* bits times the mux rate, as in the muxer */
+    bool     pes;    /* a PES is being received */
+    int64_t  dts;    /* 27 MHz */
+    uint64_t pes_count;
+    uint64_t late;
+} es_t;
+
+/* Same leak rates as the muxer. H.264 ones depend on the level, known
+ * from the SPS (see VideoLeakRate()). The HEVC level may come from the
+ * packetizer only, so that HEVC is not checked. */
+static int64_t LeakRate (uint8_t stream_type)
+{
+    switch (stream_type)
+    {
+        case 0x01: case 0x02: /* MPEG-2 MP@ML until the sequence extension */
+            return 18000000;
+        case 0x10: case 0xd1:
+            return 18000000;
+        case 0x03: case 0x04: case 0x0f: case 0x11: case 0x81: case 0x83:
+            return 2000000;
+        default: /* H.264 and HEVC, private data: audio or subtitles */
+            return 0;
+    }
+}
+
+/* Returns the leak rate given by the level of a video stream, if its
+ * payload announces it, 0 otherwise */
+static int64_t VideoLeakRate (uint8_t stream_type, const uint8_t *p,
+                              const uint8_t *end)
+{
+    static const struct { uint8_t level; unsigned max; } h264[] = {
+        {  9,    128 }, { 10,     64 }, { 11,    192 }, { 12,    384 },
+        { 13,    768 }, { 20,   2000 }, { 21,   4000 }, { 22,   4000 },
+        { 30,  10000 }, { 31,  14000 }, { 32,  20000 }, { 40,  20000 },
+        { 41,  50000 }, { 42,  50000 }, { 50, 135000 }, { 51, 240000 },
+        { 52, 240000 }, { 60, 240000 }, { 61, 480000 }, { 62, 800000 },
+    };
+
+    for (; p + 7 <= end; p++)
+    {
+        if (p[0] != 0 || p[1] != 0 || p[2] != 1)
+            continue;
+
+        if (stream_type == 0x1b && (p[3] & 0x1f) == 7) /* SPS */
+        {
+            unsigned factor = 1200;
+            if (p[4] == 100)
+                factor = 1500;
+            else if (p[4] == 110)
+                factor = 3600;
+            else if (p[4] == 122 || p[4] == 244 || p[4] == 44)
+                factor = 4800;
+
+            for (size_t i = 0; i < sizeof (h264) / sizeof (h264[0]); i++)
+                if (h264[i].level == p[6])
+                    return (int64_t)h264[i].max * factor;
+            return 0;
+        }
+
+        if ((stream_type == 0x01 || stream_type == 0x02) && p[3] == 0xb5
+         && (p[4] >> 4) == 1) /* sequence extension */
+        {
+            switch (p[5] >> 4)
+            {
+                case 10: return 4800000;
+                case 6:  return 72000000;
+                case 4:  return 96000000;
+                default: return 18000000;
+            }
+        }
+    }
+    return 0;
+}
+
+static const uint8_t *Payload (const uint8_t *p)
+{
+    if (!(p[3] & 0x10))
+        return NULL;
+    if (p[3] & 0x20)
+        return (p[4] < 184) ? p + 5 + p[4] : NULL;
+    return p + 4;
+}
+
+static int64_t GetTS (const uint8_t *p)
+{
+    return ((int64_t)(p[0] & 0x0e) << 29) | (p[1] << 22)
+         | ((p[2] & 0xfe) << 14) | (p[3] << 7) | (p[4] >> 1);
+}
+
+static int Analyse (const char *path, unsigned rate)
+{
+    FILE *stream = fopen (path, "rb");
+    if (stream == NULL)
+    {
+        perror (path);
+        return 1;
+    }
+
+    static es_t es[8192];
+    int pmt_pid = -1, pcr_pid = -1;
+    uint64_t n = 0, nulls = 0, pcr_count = 0, errors = 0;
+    int64_t first_pcr = -1, last_pcr = -1, last_pat = -1;
+    uint64_t first_n = 0;
+    int64_t max_error = 0, max_pcr_gap = 0, max_pat_gap = 0;
+    int64_t max_fill = 0;
+    const int64_t slot = INT64_C(188 * 8 * 27000000);
+    uint8_t p[188];
+
+    memset (es, 0, sizeof (es));
+
+    for (; fread (p, 188, 1, stream) == 1; n++)
+    {
+        /* Ideal arrival time of the packet, from the first PCR */
+        int64_t now = -1;
+        if (first_pcr >= 0)
+            now = first_pcr + (int64_t)((n - first_n) * (uint64_t)slot / rate);
+
+        if (p[0] != 0x47)
+        {
+            fprintf (stderr, "packet %"PRIu64": lost sync\n", n);
+            errors++;
+            break;
+        }
+
+        const unsigned pid = ((p[1] & 0x1f) << 8) | p[2];
+        const bool start = p[1] & 0x40;
+        const uint8_t *payload = Payload (p);
+        es_t *e = &es[pid];
+
+        if (pid == 0x1fff)
+            nulls++;
+
+        /* PCR */
+        if (pid == (unsigned)pcr_pid && (p[3] & 0x20) && p[4] >= 7
+         && (p[5] & 0x10))
+        {
+            int64_t base = ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9)
+                         | (p[9] << 1) | (p[10] >> 7);
+            int64_t pcr = base * 300 + (((p[10] & 1) << 8) | p[11]);
+
+            if (first_pcr < 0)
+            {
+                first_pcr = now = pcr;
+                first_n = n;
+            }
+            int64_t error = llabs (pcr - now);
+            if (error > max_error)
+                max_error = error;
+            if (error > 13) /* 500 ns */
+            {
+                fprintf (stderr, "packet %"PRIu64": PCR off by %"PRId64
+                         " ns\n", n, error * 1000 / 27);
+                errors++;
+            }
+            if (last_pcr >= 0 && pcr - last_pcr > max_pcr_gap)
+                max_pcr_gap = pcr - last_pcr;
+            last_pcr = pcr;
+            pcr_count++;
+        }
+
+        /* PSI: assumes sections fit in one packet, as the muxer does */
+        if (payload != NULL && start && (pid == 0 || (int)pid == pmt_pid))
+        {
+            const uint8_t *s = payload + 1 + payload[0];
+            if (s + 8 <= p + 188)
+            {
+                unsigned len = ((s[1] & 0x0f) << 8) | s[2];
+                const uint8_t *end = s + 3 + len - 4;
+
+                if (end > p + 188)
+                    end = p + 188;
+                if (pid == 0 && s[0] == 0x00)
+                {
+                    for (const uint8_t *q = s + 8; q + 4 <= end; q += 4)
+                        if ((q[0] << 8 | q[1]) != 0)
+                            pmt_pid = ((q[2] & 0x1f) << 8) | q[3];
+                    if (now >= 0 && last_pat >= 0 && now - last_pat > max_pat_gap)
+                        max_pat_gap = now - last_pat;
+                    last_pat = now;
+                }
+                else if (s[0] == 0x02 && s + 12 <= end)
+                {
+                    pcr_pid = ((s[8] & 0x1f) << 8) | s[9];
+                    const uint8_t *q = s + 12 + (((s[10] & 0x0f) << 8) | s[11]);
+                    for (; q + 5 <= end; q += 5 + (((q[3] & 0x0f) << 8) | q[4]))
+                    {
+                        es_t *pe = &es[((q[1] & 0x1f) << 8) | q[2]];
+                        if (pe->type != q[0])
+                        {
+                            pe->type = q[0];
+                            pe->leak = LeakRate (q[0]);
+                        }
+                    }
+                }
+            }
+        }
+
+        /* The level of the video sets its leak rate */
+        if (payload != NULL && (e->type == 0x01 || e->type == 0x02
+                             || e->type == 0x1b))
+        {
+            int64_t leak = VideoLeakRate (e->type, payload, p + 188);
+            if (leak > 0)
+                e->leak = leak;
+        }
+
+        /* Transport buffer */
+        if (e->leak > 0)
+        {
+            e->fill += INT64_C(188 * 8) * rate;
+            if (e->fill > max_fill)
+                max_fill = e->fill;
+            if (e->fill > INT64_C(TB_SIZE * 8) * rate)
+            {
+                fprintf (stderr, "packet %"PRIu64": TB of PID %u overflows "
+                         "(%"PRId64" bytes)\n", n, pid, e->fill / (8 * rate));
+                errors++;
+            }
+        }
+        for (unsigned i = 0; i < 8192; i++)
+            if (es[i].leak > 0)
+            {
+                es[i].fill -= es[i].leak * 188 * 8;
+                if (es[i].fill < 0)
+                    es[i].fill = 0;
+            }
+
+        /* PES: the previous one is complete when the next one starts */
+        if (e->leak > 0 && payload != NULL && now >= 0)
+        {
+            if (start)
+            {
+                e->pes = false;
+                /* DTS if any, PTS otherwise */
+                const uint8_t *ts = payload + ((payload[7] & 0x40) ? 14 : 9);
+
+                if (ts + 5 <= p + 188 && payload[0] == 0 && payload[1] == 0
+                 && payload[2] == 1 && (payload[7] & 0x80))
+                {
+                    e->dts = GetTS (ts) * 300;
+                    e->pes = true;
+                    e->pes_count++;
+                }
+            }
+            if (e->pes && now > e->dts)
+            {
+                e->late++;
+                e->pes = false;
+            }
+        }
+    }
+    fclose (stream);
+
+    printf ("%s: %"PRIu64" packets, %"PRIu64" null, %"PRIu64" PCR\n",
+            path, n, nulls, pcr_count);
+    printf (" PCR accuracy: %"PRId64" ns, max interval %"PRId64" ms\n",
+            max_error * 1000 / 27, max_pcr_gap / 27000);
+    printf (" max PAT interval %"PRId64" ms, max TB level %"PRId64" bytes\n",
+            max_pat_gap / 27000, max_fill / (8 * (int64_t)rate));
+
+    if (pcr_count < 2 || max_pcr_gap > 40 * 27000)
+    {
+        fprintf (stderr, "PCR interval too long\n");
+        errors++;
+    }
+    if (max_pat_gap > (PSI_INTERVAL + 5) * 27000)
+    {
+        fprintf (stderr, "PAT interval too long\n");
+        errors++;
+    }
+    for (unsigned i = 0; i < 8192; i++)
+        if (es[i].leak > 0)
+        {
+            printf (" PID %u: %"PRIu64" PES, %"PRIu64" late\n", i,
+                    es[i].pes_count, es[i].late);
+            errors += es[i].late;
+        }
+
+    return errors ? 1 : 0;
+}
+
+static int TempFile (char *path)
+{
+    int fd = mkstemp (path);
+    if (fd == -1)
+    {
+        perror ("mkstemp");
+        return -1;
+    }
+    close (fd);
+    return 0;
+}
+
+int main (int argc, char *argv[])
+{
+    char path[] = "/tmp/vlc-ts-cbr-XXXXXX";
+    int ret;
+
+    test_init ();
+    if (TempFile (path))
+        return 1;
+
+    if (argc > 1)
+    {
+        unsigned rate = (argc > 2) ? strtoul (argv[2], NULL, 0) : 10000000;
+
+        alarm (0); /* long samples take more than the default 10 seconds */
+        Mux (argv[1], NULL, path, rate);
+        ret = Analyse (path, rate);
+    }
+    else
+    {
+        char input[] = "/tmp/vlc-ts-cbr-mpga-XXXXXX";
+
+        if (TempFile (input))
+        {
+            unlink (path);
+            return 1;
+        }
+        WriteStream (input);
+        Mux (input, "mpga", path, MPGA_RATE);
+        unlink (input);
+        ret = Analyse (path, MPGA_RATE);
+    }
+    unlink (path);
+    return ret;
+}
@@ -0,0 +1,265 @@
+/*****************************************************************************
+ * startcode.c: start code scanners test and benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that every start code scanner finds the same start codes as a naive
+ * search, at any alignment and length, that block_FindStartcodeFromOffset()
+ * gives the same results with and without scanner whatever the blocks, and
+ * that nal_decode() still removes the right emulation prevention bytes.
+ * Then compares the speed of the scanners. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_block_helper.h>
+
+#include "startcode_helper.h"
+#include "../demux/mpeg/mpeg_parser_helpers.h"
+
+#define SIZE   4096
+#define BENCH  (4 << 20)
+
+typedef const uint8_t *(*scanner_t)( const uint8_t *, const uint8_t *,
+                                     uint8_t );
+
+static const struct
+{
+    const char *name;
+    scanner_t   find;
+} scanners[] = {
+    { "C", startcode_FindC },
+#ifdef CAN_COMPILE_SSE2
+    { "SSE2", startcode_FindSSE2 },
+#endif
+#ifdef CAN_COMPILE_AVX2
+    { "AVX2", startcode_FindAVX2 },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { "NEON", startcode_FindNEON },
+#endif
+};
+
+static bool Available (unsigned i)
+{
+#ifdef CAN_COMPILE_SSE2
+    if (!strcmp (scanners[i].name, "SSE2"))
+        return vlc_CPU_SSE2 ();
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (!strcmp (scanners[i].name, "AVX2"))
+        return vlc_CPU_AVX2 ();
+#endif
+    return true;
+}
+
+/* Mostly zeros, ones and threes, so that start codes and near misses abound */
+static void RandomBuffer (uint8_t *buf, size_t size, unsigned density)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        unsigned r = rand () % density;
+        buf[i] = (r < 4) ? 0 : (r < 5) ? 1 : (r < 6) ? 3 : rand ();
+    }
+}
+
+static const uint8_t *FindNaive (const uint8_t *p, const uint8_t *end,
+                                 uint8_t third)
+{
+    for (; end - p >= 3; p++)
+        if (p[0] == 0 && p[1] == 0 && p[2] == third)
+            return p;
+    return NULL;
+}
+
+static void CheckScanners (void)
+{
+    uint8_t *buf = malloc (SIZE);
+    assert (buf != NULL);
+
+    for (unsigned density = 6; density <= 1024; density *= 4)
+    {
+        RandomBuffer (buf, SIZE, density);
+
+        for (unsigned n = 0; n < 2000; n++)
+        {
+            size_t start = rand () % SIZE;
+            size_t end = start + rand () % (((n & 1) ? 80 : SIZE) + 1);
+            if (end > SIZE)
+                end = SIZE;
+            const uint8_t third = (n & 2) ? 0x03 : 0x01;
+            const uint8_t *ref = FindNaive (buf + start, buf + end, third);
+
+            for (unsigned i = 0; i < ARRAY_SIZE(scanners); i++)
+                if (Available (i))
+                    assert (scanners[i].find (buf + start, buf + end,
+                                              third) == ref);
+        }
+    }
+    free (buf);
+}
+
+/* Splits a buffer in blocks of random sizes, including very short ones */
+static void PushBlocks (block_bytestream_t *bs, const uint8_t *buf,
+                        size_t size)
+{
+    while (size > 0)
+    {
+        size_t len = 1 + rand () % ((rand () & 1) ? 4 : 300);
+        if (len > size)
+            len = size;
+
+        block_t *block = block_Alloc (len);
+        assert (block != NULL);
+        memcpy (block->p_buffer, buf, len);
+        block_BytestreamPush (bs, block);
+        buf += len;
+        size -= len;
+    }
+}
+
+static void CheckBytestream (void)
+{
+    static const uint8_t startcode[3] = { 0x00, 0x00, 0x01 };
+    uint8_t *buf = malloc (SIZE);
+    assert (buf != NULL);
+
+    for (unsigned n = 0; n < 200; n++)
+    {
+        size_t size = rand () % SIZE;
+        block_bytestream_t ref, bs;
+
+        RandomBuffer (buf, size, (n & 1) ? 8 : 200);
+        block_BytestreamInit (&ref);
+        block_BytestreamInit (&bs);
+        PushBlocks (&ref, buf, size);
+        PushBlocks (&bs, buf, size);
+
+        size_t ref_offset = rand () % 4, offset = ref_offset;
+        for (;;)
+        {
+            int ref_ret = block_FindStartcodeFromOffset (&ref, &ref_offset,
+                                                         startcode, 3, NULL);
+            int ret = block_FindStartcodeFromOffset (&bs, &offset,
+                                                     startcode, 3,
+                                                     startcode_FindAnnexB);
+            assert (ret == ref_ret);
+            assert (offset == ref_offset);
+            if (ret != VLC_SUCCESS)
+                break;
+            assert (!memcmp (&buf[offset], startcode, 3));
+            ref_offset = ++offset;
+        }
+
+        block_BytestreamRelease (&ref);
+        block_BytestreamRelease (&bs);
+    }
+    free (buf);
+}
+
+static size_t DecodeNaive (const uint8_t *src, uint8_t *dst, size_t size)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (i + 3 < size && src[i] == 0 && src[i+1] == 0 && src[i+2] == 3)
+        {
+            dst[j++] = 0;
+            dst[j++] = 0;
+            i += 2;
+            continue;
+        }
+        dst[j++] = src[i];
+    }
+    return j;
+}
+
+static void CheckNalDecode (void)
+{
+    uint8_t *buf = malloc (SIZE), *ref = malloc (SIZE), *dst = malloc (SIZE);
+    assert (buf != NULL && ref != NULL && dst != NULL);
+
+    for (unsigned n = 0; n < 2000; n++)
+    {
+        size_t size = rand () % ((n & 1) ? 16 : SIZE);
+
+        RandomBuffer (buf, size, (n & 2) ? 8 : 200);
+        size_t ref_size = DecodeNaive (buf, ref, size);
+        assert (nal_decode (buf, dst, size) == ref_size);
+        assert (!memcmp (dst, ref, ref_size));
+    }
+    free (dst);
+    free (ref);
+    free (buf);
+}
+
+static void Bench (void)
+{
+    uint8_t *buf = malloc (BENCH);
+    assert (buf != NULL);
+
+    /* a start code every 64 kB or so, as in a high bitrate stream */
+    for (size_t i = 0; i < BENCH; i++)
+        buf[i] = rand () | 0x80;
+    for (size_t i = 0; i + 3 <= BENCH; i += 60000 + rand () % 10000)
+        memcpy (&buf[i], "\x00\x00\x01", 3);
+
+    printf ("scanning %u MiB:\n", BENCH >> 20);
+    for (unsigned i = 0; i < ARRAY_SIZE(scanners); i++)
+    {
+        if (!Available (i))
+            continue;
+
+        unsigned count = 0;
+        mtime_t start = mdate ();
+        for (unsigned n = 0; n < 16; n++)
+        {
+            const uint8_t *p = buf, *end = buf + BENCH;
+            while ((p = scanners[i].find (p, end, 0x01)) != NULL)
+            {
+                count++;
+                p += 3;
+            }
+        }
+        mtime_t duration = mdate () - start;
+
+        printf (" %-5s %8.1f MB/s (%u start codes)\n", scanners[i].name,
+                (double)(16 * BENCH) / (duration ? duration : 1), count / 16);
+    }
+    free (buf);
+}
+
+int main (void)
+{
+    srand (0);
+
+    CheckScanners ();
+    CheckBytestream ();
+    CheckNalDecode ();
+    Bench ();
+    return 0;
+}
@@ -0,0 +1,698 @@
+/*****************************************************************************
+ * kernels.c: video filters SIMD kernels test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that the SIMD kernels of the motionblur, sharpen, gaussianblur and
+ * hqdn3d video filters, and the line kernels of the blend module, give
+ * exactly the output of the C ones, on generated lines and pictures of many
+ * widths. Then compares the time they take to filter a 1080p luma plane. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+
+#include "motionblur.h"
+#include "sharpen.h"
+#include "gaussianblur.h"
+#include "hqdn3d.h"
+#include "blend.h"
+
+#define MAX_WIDTH 1024
+#define PITCH     (MAX_WIDTH + 64)
+#define LINES     40
+
+#define BENCH_WIDTH  1920
+#define BENCH_HEIGHT 1080
+#define BENCH_FRAMES 20
+
+static const struct
+{
+    const char            *name;
+    motionblur_line_t      motionblur;
+    sharpen_line_t         sharpen;
+    gaussianblur_kernels_t gaussianblur;
+} kernels[] = {
+    { "C", motionblur_LineC, sharpen_LineC,
+      { gaussianblur_HorizontalC, gaussianblur_AccumulateC,
+        gaussianblur_DivideC } },
+#ifdef CAN_COMPILE_SSE2
+    { "SSE2", motionblur_LineSSE2, sharpen_LineSSE2,
+      { gaussianblur_HorizontalSSE2, gaussianblur_AccumulateSSE2,
+        gaussianblur_DivideSSE2 } },
+#endif
+#ifdef CAN_COMPILE_AVX2
+    { "AVX2", motionblur_LineAVX2, sharpen_LineAVX2,
+      { gaussianblur_HorizontalAVX2, gaussianblur_AccumulateAVX2,
+        gaussianblur_DivideAVX2 } },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { "NEON", motionblur_LineNEON, sharpen_LineNEON,
+      { gaussianblur_HorizontalNEON, gaussianblur_AccumulateNEON,
+        gaussianblur_DivideC } },
+#endif
+};
+
+static const struct
+{
+    const char     *name;
+    blend_kernels_t blend;
+} blend_kernels[] = {
+    { "C", { blend_MergeC, blend_MergeHalfC, blend_MergeUVC,
+             blend_MergeRGB32C, blend_RGBAToYUVAC } },
+#ifdef CAN_COMPILE_SSE2
+    { "SSE2", { blend_MergeSSE2, blend_MergeHalfSSE2, blend_MergeUVSSE2,
+                blend_MergeRGB32SSE2, blend_RGBAToYUVASSE2 } },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { "NEON", { blend_MergeNEON, blend_MergeHalfNEON, blend_MergeUVNEON,
+                blend_MergeRGB32NEON, blend_RGBAToYUVANEON } },
+#endif
+};
+
+static bool BlendAvailable (unsigned i)
+{
+#ifdef CAN_COMPILE_SSE2
+    if (!strcmp (blend_kernels[i].name, "SSE2"))
+        return vlc_CPU_SSE2 ();
+#endif
+    return true;
+}
+
+static bool Available (unsigned i)
+{
+#ifdef CAN_COMPILE_SSE2
+    if (!strcmp (kernels[i].name, "SSE2"))
+        return vlc_CPU_SSE2 ();
+#endif
+#ifdef CAN_COMPILE_AVX2
+    if (!strcmp (kernels[i].name, "AVX2"))
+        return vlc_CPU_AVX2 ();
+#endif
+    return true;
+}
+
+/* Noise, noisy gradients, extremes only, or flat areas with a few spikes */
+static void Fill (uint8_t *buf, size_t size, unsigned pattern)
+{
+    for (size_t i = 0; i < size; i++)
+        switch (pattern % 4)
+        {
+            case 0:
+                buf[i] = rand ();
+                break;
+            case 1:
+                buf[i] = (i % PITCH) / 8 + (i / PITCH) + rand () % 8;
+                break;
+            case 2:
+                buf[i] = (rand () & 1) ? 255 : 0;
+                break;
+            default:
+                buf[i] = (rand () % 64) ? 128 : rand ();
+                break;
+        }
+}
+
+static unsigned RandomWidth (unsigned n)
+{
+    /* all the short widths, to go through every tail */
+    return (n < 80) ? 1 + n : 1 + (unsigned)rand () % MAX_WIDTH;
+}
+
+static void CheckMotionblur (void)
+{
+    uint8_t *old = malloc (PITCH), *new = malloc (PITCH);
+    uint8_t *ref = malloc (PITCH), *out = malloc (PITCH);
+    assert (old != NULL && new != NULL && ref != NULL && out != NULL);
+
+    for (unsigned n = 0; n < 400; n++)
+    {
+        const int width = RandomWidth (n);
+        const int oldfactor = rand () % 129;
+
+        Fill (old, PITCH, n);
+        Fill (new, PITCH, n + 1);
+        motionblur_LineC (ref, old, new, width, oldfactor, 128 - oldfactor);
+
+        for (unsigned i = 1; i < ARRAY_SIZE(kernels); i++)
+        {
+            if (!Available (i))
+                continue;
+            memset (out, 0xAA, PITCH);
+            kernels[i].motionblur (out, old, new, width, oldfactor,
+                                   128 - oldfactor);
+            assert (!memcmp (out, ref, width));
+            assert (out[width] == 0xAA);
+        }
+    }
+    free (out);
+    free (ref);
+    free (new);
+    free (old);
+}
+
+static void CheckSharpen (void)
+{
+    uint8_t *src = malloc (3 * PITCH);
+    uint8_t *ref = malloc (PITCH), *out = malloc (PITCH);
+    assert (src != NULL && ref != NULL && out != NULL);
+
+    for (unsigned n = 0; n < 400; n++)
+    {
+        const int width = RandomWidth (n);
+        const int sigmas[] = { 0, 0.05 * (1 << 20), 1 << 20, 2 << 20,
+                               rand () % ((2 << 20) + 1) };
+        const int sigma = sigmas[n % ARRAY_SIZE(sigmas)];
+
+        Fill (src, 3 * PITCH, n);
+        sharpen_LineC (ref, &src[PITCH + 1], PITCH, width, sigma);
+
+        for (unsigned i = 1; i < ARRAY_SIZE(kernels); i++)
+        {
+            if (!Available (i))
+                continue;
+            memset (out, 0xAA, PITCH);
+            kernels[i].sharpen (out, &src[PITCH + 1], PITCH, width, sigma);
+            assert (!memcmp (out, ref, width));
+            assert (out[width] == 0xAA);
+        }
+    }
+    free (out);
+    free (ref);
+    free (src);
+}
+
+/* Same distribution as the gaussianblur filter */
+static int32_t *Distribution (double sigma, int *dim)
+{
+    *dim = (int)(3. * sigma);
+
+    int32_t *distribution = malloc ((2 * *dim + 1) * sizeof (*distribution));
+    assert (distribution != NULL);
+    for (int x = -*dim; x <= *dim; x++)
+        distribution[*dim + x] = (int32_t)(sqrt (exp (-(x*x) / (sigma*sigma))
+                                           / (2. * M_PI * sigma * sigma))
+                                           * (float)(1 << 8));
+    return distribution;
+}
+
+static void CheckGaussianblur (void)
+{
+    static const double sigmas[] = { 0.002, 0.2, 0.5, 1., 2., 4., 10. };
+    uint8_t *in = malloc (2 * PITCH), *ref = malloc (PITCH), *out = malloc (PITCH);
+    int32_t *acc = malloc (PITCH * sizeof (int32_t));
+    int32_t *accref = malloc (PITCH * sizeof (int32_t));
+    int32_t *row = malloc (PITCH * sizeof (int32_t));
+    int32_t *scale = malloc (2 * PITCH * sizeof (int32_t));
+    assert (in != NULL && ref != NULL && out != NULL && acc != NULL
+         && accref != NULL && row != NULL && scale != NULL);
+
+    for (unsigned n = 0; n < 700; n++)
+    {
+        const int width = RandomWidth (n);
+        int dim;
+        int32_t *distribution = Distribution (sigmas[n % ARRAY_SIZE(sigmas)],
+                                              &dim);
+        gaussianblur_taps_t taps;
+        assert (gaussianblur_InitTaps (&taps, distribution, dim,
+                                       n & 1) == VLC_SUCCESS);
+
+        /* horizontal pass */
+        Fill (in, 2 * PITCH, n);
+        gaussianblur_HorizontalC (accref, in, width, &taps);
+        for (unsigned i = 1; i < ARRAY_SIZE(kernels); i++)
+        {
+            if (!Available (i))
+                continue;
+            acc[width] = 0x55555555;
+            kernels[i].gaussianblur.pf_horizontal (acc, in, width, &taps);
+            assert (!memcmp (acc, accref, width * sizeof (*acc)));
+            assert (acc[width] == 0x55555555);
+        }
+
+        /* vertical pass, on the horizontal sums */
+        const int32_t weight = rand () % (1 << 14);
+        for (int i = 0; i < width; i++)
+        {
+            row[i] = rand () % (1 << 16);
+            accref[i] = rand () % (1 << 24);
+        }
+        memcpy (acc, accref, width * sizeof (*acc));
+        gaussianblur_AccumulateC (accref, row, weight, width);
+        for (unsigned i = 1; i < ARRAY_SIZE(kernels); i++)
+        {
+            if (!Available (i))
+                continue;
+            int32_t *tmp = malloc (PITCH * sizeof (int32_t));
+            assert (tmp != NULL);
+            memcpy (tmp, acc, width * sizeof (*tmp));
+            tmp[width] = 0x55555555;
+            kernels[i].gaussianblur.pf_accumulate (tmp, row, weight, width);
+            assert (!memcmp (tmp, accref, width * sizeof (*tmp)));
+            assert (tmp[width] == 0x55555555);
+            free (tmp);
+        }
+
+        /* normalization, with quotients around the pixel values */
+        const int shift = n & 1;
+        for (int i = 0; i < 2 * width; i++)
+            scale[i] = 1 + rand () % ((n & 2) ? 256 : (1 << 22));
+        for (int i = 0; i < width; i++)
+            acc[i] = (rand () % 300) * scale[i << shift]
+                   + rand () % scale[i << shift];
+        gaussianblur_DivideC (ref, acc, scale, shift, width);
+        for (unsigned i = 1; i < ARRAY_SIZE(kernels); i++)
+        {
+            if (!Available (i))
+                continue;
+            memset (out, 0xAA, PITCH);
+            kernels[i].gaussianblur.pf_divide (out, acc, scale, shift, width);
+            assert (!memcmp (out, ref, width));
+            assert (out[width] == 0xAA);
+        }
+
+        gaussianblur_CleanTaps (&taps);
+        free (distribution);
+    }
+    free (scale);
+    free (row);
+    free (accref);
+    free (acc);
+    free (out);
+    free (ref);
+    free (in);
+}
+
+typedef struct
+{
+    int coefs[3][512*16];
+    unsigned int *line;
+    unsigned int *tile;
+    unsigned short *frame;
+} hqdn3d_state_t;
+
+static void Hqdn3dInit (hqdn3d_state_t *state, unsigned char *src,
+                        int width, int lines, const double strength[3],
+                        bool simd)
+{
+    for (unsigned i = 0; i < 3; i++)
+        PrecalcCoefs (state->coefs[i], strength[i]);
+    state->line = malloc (width * sizeof (*state->line));
+    state->tile = simd ? malloc (TILE_LINES * width * sizeof (*state->tile))
+                       : NULL;
+    state->frame = deNoiseInit (src, width, lines, PITCH);
+    assert (state->line != NULL && state->frame != NULL);
+    assert (!simd || state->tile != NULL);
+}
+
+static void Hqdn3dClean (hqdn3d_state_t *state)
+{
+    free (state->frame);
+    free (state->tile);
+    free (state->line);
+}
+
+static void Hqdn3dRun (hqdn3d_state_t *state, unsigned char *src,
+                       unsigned char *dst, int width, int first, int start,
+                       int end)
+{
+    deNoise (src, dst, state->line, state->tile, state->frame, width,
+             PITCH, PITCH, state->coefs[0], state->coefs[1], state->coefs[2],
+             first, start, end);
+}
+
+static void CheckHqdn3d (void)
+{
+#ifdef CAN_COMPILE_AVX2
+    if (!vlc_CPU_AVX2 ())
+        return;
+
+    /* spatial and temporal, spatial only, temporal only, very strong */
+    static const double strengths[][3] = {
+        { 4., 3., 6. }, { 4., 3., 0. }, { 0., 0., 6. }, { 254., 100., 254. },
+    };
+    unsigned char *src = malloc (LINES * PITCH);
+    unsigned char *ref = malloc (LINES * PITCH), *out = malloc (LINES * PITCH);
+    assert (src != NULL && ref != NULL && out != NULL);
+
+    for (unsigned n = 0; n < 120; n++)
+    {
+        const int width = RandomWidth (n % 40 + (n >= 40) * 80);
+        const double *strength = strengths[n % ARRAY_SIZE(strengths)];
+        hqdn3d_state_t c, simd;
+
+        Fill (src, LINES * PITCH, n);
+        Hqdn3dInit (&c, src, width, LINES, strength, false);
+        Hqdn3dInit (&simd, src, width, LINES, strength, true);
+
+        /* a few frames, to go through the temporal low pass, the last one
+         * filtered as a slice primed over the lines before it */
+        for (unsigned frame = 0; frame < 4; frame++)
+        {
+            const int first = (frame == 3) ? 5 : 0;
+            const int start = (frame == 3) ? 13 : 0;
+
+            memset (ref, 0xAA, LINES * PITCH);
+            memset (out, 0xAA, LINES * PITCH);
+            Hqdn3dRun (&c, src, ref, width, first, start, LINES);
+            Hqdn3dRun (&simd, src, out, width, first, start, LINES);
+            assert (!memcmp (out, ref, LINES * PITCH));
+            assert (!memcmp (simd.frame, c.frame,
+                             width * LINES * sizeof (*c.frame)));
+            Fill (src, LINES * PITCH, n + frame);
+        }
+        Hqdn3dClean (&simd);
+        Hqdn3dClean (&c);
+    }
+    free (out);
+    free (ref);
+    free (src);
+#endif
+}
+
+/* Subtitles like alpha: long transparent runs, opaque glyphs with
+ * antialiased edges, and a few random values */
+static void FillAlpha (uint8_t *buf, size_t size, size_t step,
+                       unsigned pattern)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        uint8_t a;
+        switch (pattern % 3)
+        {
+            case 0:
+                a = rand ();
+                break;
+            case 1:
+                a = (rand () % 16) ? 0 : 255;
+                break;
+            default:
+                a = ((i / step) % 37 < 20) ? 0
+                  : ((i / step) % 37 < 23) ? rand () : 255;
+                break;
+        }
+        buf[i * step] = a;
+    }
+}
+
+static void CheckBlend (void)
+{
+    uint8_t *src = malloc (4 * PITCH), *a = malloc (2 * PITCH);
+    uint8_t *y = malloc (PITCH), *u = malloc (PITCH), *v = malloc (PITCH);
+    uint8_t *ref = malloc (4 * PITCH), *out = malloc (4 * PITCH);
+    uint8_t *yuva[4];
+    for (unsigned p = 0; p < 4; p++)
+        yuva[p] = malloc (PITCH);
+    assert (src != NULL && a != NULL && y != NULL && u != NULL && v != NULL
+         && ref != NULL && out != NULL && yuva[0] != NULL && yuva[1] != NULL
+         && yuva[2] != NULL && yuva[3] != NULL);
+
+    for (unsigned n = 0; n < 600; n++)
+    {
+        const unsigned width = RandomWidth (n % 300);
+        const unsigned half = (width + 1) / 2;
+        const int alphas[] = { 255, 0, 128, rand () % 256 };
+        const int alpha = alphas[n % ARRAY_SIZE(alphas)];
+        const bool swap_rb = n & 1;
+
+        Fill (src, 4 * PITCH, n);
+        Fill (u, PITCH, n + 1);
+        Fill (v, PITCH, n + 2);
+        Fill (y, PITCH, n + 3);
+        FillAlpha (a, 2 * PITCH, 1, n / 4);
+
+        for (unsigned i = 1; i < ARRAY_SIZE(blend_kernels); i++)
+        {
+            const blend_kernels_t *k = &blend_kernels[i].blend;
+            if (!BlendAvailable (i))
+                continue;
+
+            /* luma */
+            memcpy (ref, y, PITCH);
+            memcpy (out, y, PITCH);
+            blend_MergeC (ref, src, a, alpha, width);
+            k->pf_merge (out, src, a, alpha, width);
+            assert (!memcmp (out, ref, PITCH));
+
+            /* planar chroma, from the even pixels */
+            memcpy (ref, y, PITCH);
+            memcpy (out, y, PITCH);
+            blend_MergeHalfC (ref, src, a, alpha, half);
+            k->pf_merge_half (out, src, a, alpha, half);
+            assert (!memcmp (out, ref, PITCH));
+
+            /* interleaved chroma */
+            memcpy (ref, src, 2 * PITCH);
+            memcpy (out, src, 2 * PITCH);
+            blend_MergeUVC (ref, u, v, a, alpha, half);
+            k->pf_merge_uv (out, u, v, a, alpha, half);
+            assert (!memcmp (out, ref, 2 * PITCH));
+
+            /* packed RGB, with the alpha of the source in its 4th bytes */
+            uint8_t *rgba = &src[2 * PITCH];
+            FillAlpha (&rgba[3], width, 4, n / 4);
+            Fill (ref, 4 * width, n + 4);
+            memcpy (out, ref, 4 * width);
+            blend_MergeRGB32C (ref, rgba, alpha, width, swap_rb);
+            k->pf_merge_rgb32 (out, rgba, alpha, width, swap_rb);
+            assert (!memcmp (out, ref, 4 * width));
+        }
+
+        /* RGBA to YUVA conversion */
+        const uint8_t *rgba = &src[n % 4];
+        blend_RGBAToYUVAC (y, u, v, a, rgba, width);
+        for (unsigned i = 1; i < ARRAY_SIZE(blend_kernels); i++)
+        {
+            if (!BlendAvailable (i))
+                continue;
+            for (unsigned p = 0; p < 4; p++)
+                memset (yuva[p], 0xAA, PITCH);
+            blend_kernels[i].blend.pf_rgba_to_yuva (yuva[0], yuva[1], yuva[2],
+                                                    yuva[3], rgba, width);
+            assert (!memcmp (yuva[0], y, width));
+            assert (!memcmp (yuva[1], u, width));
+            assert (!memcmp (yuva[2], v, width));
+            assert (!memcmp (yuva[3], a, width));
+            for (unsigned p = 0; p < 4; p++)
+                assert (yuva[p][width] == 0xAA);
+        }
+    }
+    for (unsigned p = 0; p < 4; p++)
+        free (yuva[p]);
+    free (out);
+    free (ref);
+    free (v);
+    free (u);
+    free (y);
+    free (a);
+    free (src);
+}
+
+static void PrintCost (const char *filter, const char *name, mtime_t duration)
+{
+    printf (" %-13s %-5s %7.3f ms/frame\n", filter, name,
+            (double)duration / BENCH_FRAMES / 1000.);
+}
+
+static void Bench (void)
+{
+    const size_t size = BENCH_HEIGHT * BENCH_WIDTH;
+    uint8_t *src = malloc (size), *old = malloc (size), *dst = malloc (size);
+    int32_t *buf = malloc (size * sizeof (int32_t));
+    int32_t *scale = malloc (size * sizeof (int32_t));
+    int32_t *acc = malloc (BENCH_WIDTH * sizeof (int32_t));
+    assert (src != NULL && old != NULL && dst != NULL && buf != NULL
+         && scale != NULL && acc != NULL);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        src[i] = (i % BENCH_WIDTH) / 8 + (i / BENCH_WIDTH) / 8 + rand () % 8;
+        old[i] = src[i] ^ (rand () & 3);
+        scale[i] = 65000 + rand () % 1000;
+    }
+
+    int dim;
+    int32_t *distribution = Distribution (2., &dim);
+    gaussianblur_taps_t taps;
+    assert (gaussianblur_InitTaps (&taps, distribution, dim, 0) == VLC_SUCCESS);
+
+    printf ("filtering %ux%u luma planes:\n", BENCH_WIDTH, BENCH_HEIGHT);
+    for (unsigned i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        if (!Available (i))
+            continue;
+
+        mtime_t start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            for (unsigned y = 0; y < BENCH_HEIGHT; y++)
+                kernels[i].motionblur (&dst[y * BENCH_WIDTH],
+                                       &old[y * BENCH_WIDTH],
+                                       &src[y * BENCH_WIDTH],
+                                       BENCH_WIDTH, 96, 32);
+        PrintCost ("motionblur", kernels[i].name, mdate () - start);
+
+        start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            for (unsigned y = 1; y < BENCH_HEIGHT - 1; y++)
+                kernels[i].sharpen (&dst[y * BENCH_WIDTH + 1],
+                                    &src[y * BENCH_WIDTH + 1], BENCH_WIDTH,
+                                    BENCH_WIDTH - 2, 0.05 * (1 << 20));
+        PrintCost ("sharpen", kernels[i].name, mdate () - start);
+
+        /* the interior of the plane, as the edges are done in C anyway */
+        const gaussianblur_kernels_t *k = &kernels[i].gaussianblur;
+        const int width = BENCH_WIDTH - 2 * dim;
+        start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+        {
+            for (unsigned y = 0; y < BENCH_HEIGHT; y++)
+                k->pf_horizontal (&buf[y * BENCH_WIDTH + dim],
+                                  &src[y * BENCH_WIDTH], width, &taps);
+            for (int y = dim; y < BENCH_HEIGHT - dim; y++)
+            {
+                memset (acc, 0, BENCH_WIDTH * sizeof (*acc));
+                for (int t = -dim; t <= dim; t++)
+                    k->pf_accumulate (acc, &buf[(y + t) * BENCH_WIDTH],
+                                      distribution[t + dim], BENCH_WIDTH);
+                k->pf_divide (&dst[y * BENCH_WIDTH], acc,
+                              &scale[y * BENCH_WIDTH], 0, BENCH_WIDTH);
+            }
+        }
+        PrintCost ("gaussianblur", kernels[i].name, mdate () - start);
+    }
+
+    for (unsigned simd = 0; simd < 2; simd++)
+    {
+#ifdef CAN_COMPILE_AVX2
+        if (simd && !vlc_CPU_AVX2 ())
+            break;
+#else
+        if (simd)
+            break;
+#endif
+        static const double strength[3] = { 4., 3., 6. };
+        hqdn3d_state_t state;
+        unsigned int *line = malloc (BENCH_WIDTH * sizeof (*line));
+        unsigned int *tile = malloc (TILE_LINES * BENCH_WIDTH * sizeof (*tile));
+        assert (line != NULL && tile != NULL);
+
+        for (unsigned c = 0; c < 3; c++)
+            PrecalcCoefs (state.coefs[c], strength[c]);
+        state.frame = deNoiseInit (old, BENCH_WIDTH, BENCH_HEIGHT, BENCH_WIDTH);
+        assert (state.frame != NULL);
+
+        mtime_t start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            deNoise ((n & 1) ? old : src, dst, line, simd ? tile : NULL,
+                     state.frame, BENCH_WIDTH, BENCH_WIDTH, BENCH_WIDTH,
+                     state.coefs[0], state.coefs[1], state.coefs[2],
+                     0, 0, BENCH_HEIGHT);
+        PrintCost ("hqdn3d", simd ? "AVX2" : "C", mdate () - start);
+
+        free (state.frame);
+        free (tile);
+        free (line);
+    }
+
+    /* a subtitle band over the bottom fourth of the picture, mostly
+     * transparent as text is */
+    const unsigned sub_lines = BENCH_HEIGHT / 4;
+    uint8_t *rgba = malloc (4 * BENCH_WIDTH * sub_lines);
+    uint8_t *alpha = malloc (BENCH_WIDTH * sub_lines);
+    assert (rgba != NULL && alpha != NULL);
+    for (size_t i = 0; i < 4 * BENCH_WIDTH * sub_lines; i++)
+        rgba[i] = rand ();
+    FillAlpha (alpha, BENCH_WIDTH * sub_lines, 1, 2);
+    FillAlpha (&rgba[3], BENCH_WIDTH * sub_lines, 4, 2);
+
+    printf ("blending a %ux%u subtitle band:\n", BENCH_WIDTH, sub_lines);
+    for (unsigned i = 0; i < ARRAY_SIZE(blend_kernels); i++)
+    {
+        const blend_kernels_t *k = &blend_kernels[i].blend;
+        if (!BlendAvailable (i))
+            continue;
+
+        mtime_t start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            for (unsigned y = 0; y < sub_lines; y++)
+            {
+                k->pf_merge (&dst[y * BENCH_WIDTH], &src[y * BENCH_WIDTH],
+                             &alpha[y * BENCH_WIDTH], 255, BENCH_WIDTH);
+                if (y & 1)
+                    continue;
+                k->pf_merge_half (&dst[size / 2 + y * BENCH_WIDTH / 2],
+                                  &old[y * BENCH_WIDTH],
+                                  &alpha[y * BENCH_WIDTH], 255,
+                                  BENCH_WIDTH / 2);
+                k->pf_merge_half (&dst[3 * size / 4 + y * BENCH_WIDTH / 2],
+                                  &src[y * BENCH_WIDTH],
+                                  &alpha[y * BENCH_WIDTH], 255,
+                                  BENCH_WIDTH / 2);
+            }
+        PrintCost ("YUVA>I420", blend_kernels[i].name, mdate () - start);
+
+        start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            for (unsigned y = 0; y < sub_lines; y++)
+                k->pf_merge_rgb32 ((uint8_t *)&buf[y * BENCH_WIDTH],
+                                   &rgba[4 * y * BENCH_WIDTH], 255,
+                                   BENCH_WIDTH, false);
+        PrintCost ("RGBA>RV32", blend_kernels[i].name, mdate () - start);
+
+        start = mdate ();
+        for (unsigned n = 0; n < BENCH_FRAMES; n++)
+            for (unsigned y = 0; y < sub_lines; y++)
+                k->pf_rgba_to_yuva (&dst[0], &dst[BENCH_WIDTH],
+                                    &dst[2 * BENCH_WIDTH],
+                                    &dst[3 * BENCH_WIDTH],
+                                    &rgba[4 * y * BENCH_WIDTH], BENCH_WIDTH);
+        PrintCost ("RGBA>YUVA", blend_kernels[i].name, mdate () - start);
+    }
+    free (alpha);
+    free (rgba);
+
+    gaussianblur_CleanTaps (&taps);
+    free (distribution);
+    free (acc);
+    free (scale);
+    free (buf);
+    free (dst);
+    free (old);
+    free (src);
+}
+
+int main (void)
+{
+    srand (0);
+
+    CheckMotionblur ();
+    CheckSharpen ();
+    CheckGaussianblur ();
+    CheckHqdn3d ();
+    CheckBlend ();
+    Bench ();
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ * demux_ts.c: MPEG-TS demuxer test and throughput benchmark
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_src_input_demux_ts [file.ts [passes [packet size]]]
+ *
+ * Without arguments, writes a synthetic transport stream and checks that
+ * all of it is read, and that the PES payloads reach the ES output whole,
+ * whether the file is mapped in memory or not. This covers the packet
+ * batches and the resynchronisation within a batch.
+ *
+ * With a file, demuxes it as fast as possible into a dummy stream output, so
+ * that every elementary stream is selected but nothing gets decoded, then
+ * reports the number of TS packets parsed per second. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include <vlc_common.h>
+
+#define PES_COUNT   500
+#define PES_PAYLOAD 1000 /* bytes */
+#define PES_HEADER  14   /* with a PTS */
+#define PMT_PID     0x100
+#define ES_PID      0x101
+
+static const char *const args[] = {
+    "--ignore-config", "-I", "dummy", "--no-media-library",
+    "--demux=ts", "--sout=#dummy",
+};
+
+static double CpuTime (void)
+{
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* Plays the file once and returns the wall clock time it took */
+static mtime_t RunPass (libvlc_instance_t *vlc, const char *path,
+                        libvlc_media_stats_t *stats)
+{
+    libvlc_media_t *media = libvlc_media_new_path (vlc, path);
+    assert (media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media (media);
+    assert (mp != NULL);
+
+    const mtime_t start = mdate ();
+    libvlc_media_player_play (mp);
+
+    libvlc_state_t state;
+    do
+    {
+        msleep (CLOCK_FREQ / 1000);
+        state = libvlc_media_player_get_state (mp);
+    }
+    while (state != libvlc_Ended && state != libvlc_Error);
+
+    const mtime_t duration = mdate () - start;
+    assert (state == libvlc_Ended);
+
+    /* The statistics are final once the input is stopped */
+    libvlc_media_player_stop (mp);
+    if (stats != NULL)
+        assert (libvlc_media_get_stats (media, stats));
+    libvlc_media_player_release (mp);
+    libvlc_media_release (media);
+    return duration;
+}
+
+/*
+ * Synthetic stream: one program with an MPEG audio PID, carrying PES packets
+ * of PES_PAYLOAD bytes and a PCR every PES. The payloads are not valid audio,
+ * which does not matter as nothing is decoded.
+ */
+static uint32_t Crc32 (const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (len--)
+    {
+        crc ^= (uint32_t)*p++ << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+static void WritePSI (FILE *out, unsigned pid, uint8_t *cc,
+                      const uint8_t *section, size_t len)
+{
+    uint8_t pkt[188];
+
+    memset (pkt, 0xff, sizeof (pkt));
+    pkt[0] = 0x47;
+    pkt[1] = 0x40 | (pid >> 8);
+    pkt[2] = pid;
+    pkt[3] = 0x10 | (*cc)++ % 16;
+    pkt[4] = 0; /* pointer field */
+    memcpy (&pkt[5], section, len);
+    SetDWBE (&pkt[5 + len], Crc32 (section, len));
+    fwrite (pkt, 1, sizeof (pkt), out);
+}
+
+static void WriteTables (FILE *out, uint8_t *cc_pat, uint8_t *cc_pmt)
+{
+    static const uint8_t pat[] = {
+        0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff,
+    };
+    static const uint8_t pmt[] = {
+        0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+        0x03, 0xe0 | (ES_PID >> 8), ES_PID & 0xff, 0xf0, 0x00,
+    };
+
+    WritePSI (out, 0, cc_pat, pat, sizeof (pat));
+    WritePSI (out, PMT_PID, cc_pmt, pmt, sizeof (pmt));
+}
+
+static void WritePES (FILE *out, uint8_t *cc, uint64_t pcr)
+{
+    const uint64_t pts = pcr + 90000 / 5;
+    uint8_t pes[PES_HEADER + PES_PAYLOAD];
+
+    pes[0] = 0x00; pes[1] = 0x00; pes[2] = 0x01; pes[3] = 0xc0;
+    SetWBE (&pes[4], sizeof (pes) - 6);
+    pes[6] = 0x80;
+    pes[7] = 0x80; /* PTS only */
+    pes[8] = 5;
+    pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+    pes[10] = pts >> 22;
+    pes[11] = 0x01 | ((pts >> 14) & 0xfe);
+    pes[12] = pts >> 7;
+    pes[13] = 0x01 | (pts << 1);
+    memset (&pes[PES_HEADER], 0x55, PES_PAYLOAD);
+
+    for (size_t done = 0; done < sizeof (pes);)
+    {
+        uint8_t pkt[188];
+        size_t adaptation = 0;
+
+        pkt[0] = 0x47;
+        pkt[1] = (done == 0 ? 0x40 : 0x00) | (ES_PID >> 8);
+        pkt[2] = ES_PID & 0xff;
+
+        if (done == 0)
+        {   /* PCR in the adaptation field of the first packet */
+            pkt[4] = 7;
+            pkt[5] = 0x10;
+            pkt[6] = pcr >> 25;
+            pkt[7] = pcr >> 17;
+            pkt[8] = pcr >> 9;
+            pkt[9] = pcr >> 1;
+            pkt[10] = ((pcr & 1) << 7) | 0x7e;
+            pkt[11] = 0;
+            adaptation = 8;
+        }
+
+        size_t len = __MIN(sizeof (pes) - done, 184 - adaptation);
+        if (adaptation + len < 184)
+        {   /* Stuff the last packet */
+            size_t stuffing = 184 - adaptation - len;
+
+            if (adaptation == 0)
+            {
+                pkt[4] = stuffing - 1;
+                if (stuffing > 1)
+                    pkt[5] = 0x00;
+                memset (&pkt[6], 0xff, stuffing > 2 ? stuffing - 2 : 0);
+            }
+            else
+            {
+                pkt[4] += stuffing;
+                memset (&pkt[4 + adaptation], 0xff, stuffing);
+            }
+            adaptation += stuffing;
+        }
+
+        pkt[3] = (adaptation ? 0x30 : 0x10) | (*cc)++ % 16;
+        memcpy (&pkt[4 + adaptation], &pes[done], len);
+        fwrite (pkt, 1, sizeof (pkt), out);
+        done += len;
+    }
+}
+
+static void WriteStream (const char *path)
+{
+    FILE *out = fopen (path, "wb");
+    assert (out != NULL);
+
+    uint8_t cc_pat = 0, cc_pmt = 0, cc_es = 0;
+
+    for (unsigned i = 0; i < PES_COUNT; i++)
+    {
+        if (i % 10 == 0)
+            WriteTables (out, &cc_pat, &cc_pmt);
+        if (i == PES_COUNT / 2)
+        {   /* Garbage between two packets, to lose synchronisation */
+            static const uint8_t garbage[61];
+            fwrite (garbage, 1, sizeof (garbage), out);
+        }
+        WritePES (out, &cc_es, (uint64_t)i * 90000 / 25);
+    }
+    assert (!ferror (out));
+    fclose (out);
+}
+
+static void Check (const char *path, bool mmap)
+{
+    struct stat st;
+    assert (stat (path, &st) == 0);
+
+    const char *argv[ARRAY_SIZE(args) + 1];
+    memcpy (argv, args, sizeof (args));
+    argv[ARRAY_SIZE(args)] = mmap ? "--file-mmap" : "--no-file-mmap";
+
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(argv), argv);
+    assert (vlc != NULL);
+
+    libvlc_media_stats_t stats;
+    RunPass (vlc, path, &stats);
+    libvlc_release (vlc);
+
+    log ("%s: read %d of %"PRId64" bytes, demuxed %d of %d bytes\n",
+         mmap ? "mapped" : "read", stats.i_read_bytes, (int64_t)st.st_size,
+         stats.i_demux_read_bytes, PES_COUNT * PES_PAYLOAD);
+    /* The demuxer reads the start and the end again to find the duration */
+    assert (stats.i_read_bytes >= st.st_size);
+    /* A packet lost or duplicated by a batch would change the size of a PES.
+     * A few PES are parsed before the ES are created, and dropped. */
+    assert (stats.i_demux_read_bytes % PES_PAYLOAD == 0);
+    assert (stats.i_demux_read_bytes <= PES_COUNT * PES_PAYLOAD);
+    assert (stats.i_demux_read_bytes >= PES_COUNT * PES_PAYLOAD * 9 / 10);
+}
+
+static int Benchmark (const char *path, unsigned passes, unsigned packet)
+{
+    struct stat st;
+    if (stat (path, &st))
+    {
+        perror (path);
+        return 1;
+    }
+
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+
+    /* Warm the page cache and the plugins up */
+    RunPass (vlc, path, NULL);
+
+    mtime_t total = 0;
+    const double start = CpuTime ();
+    for (unsigned i = 0; i < passes; i++)
+        total += RunPass (vlc, path, NULL);
+    const double cpu = CpuTime () - start;
+
+    libvlc_release (vlc);
+
+    const double packets = (double)(st.st_size / packet) * passes;
+    const double seconds = (double)total / CLOCK_FREQ;
+
+    printf ("%s: %"PRId64" bytes, %u pass(es):\n", path,
+            (int64_t)st.st_size, passes);
+    printf (" %.0f packets/s, %.1f MB/s\n", packets / seconds,
+            st.st_size * (double)passes / (seconds * 1e6));
+    printf (" CPU: %.3f s, %.1f ns per packet\n", cpu, cpu * 1e9 / packets);
+    return 0;
+}
+
+int main (int argc, char *argv[])
+{
+    test_init ();
+
+    if (argc > 1)
+    {
+        alarm (0); /* long samples take more than the default 10 seconds */
+        return Benchmark (argv[1],
+                          (argc > 2) ? strtoul (argv[2], NULL, 0) : 5,
+                          (argc > 3) ? strtoul (argv[3], NULL, 0) : 188);
+    }
+
+    char path[] = "/tmp/vlc-demux-ts-XXXXXX";
+    int fd = mkstemp (path);
+    if (fd == -1)
+    {
+        perror ("mkstemp");
+        return 1;
+    }
+    close (fd);
+
+    WriteStream (path);
+    Check (path, false);
+    Check (path, true);
+    unlink (path);
+    return 0;
+}
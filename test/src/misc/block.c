@@ -0,0 +1,163 @@
+/*****************************************************************************
+ * block.c: block allocator benchmark
+ *****************************************************************************
+ * Copyright (C) 2015 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Compares block_Alloc() with plain heap allocation of blocks, with pairs of
+ * producer and consumer threads exchanging blocks through FIFOs, as an access
+ * thread and a demux or decoder thread would. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define PAIRS  4
+#define BLOCKS 100000
+#define BACKLOG 256
+
+/* Sizes of typical blocks: TS packets, datagrams, PES */
+static const size_t sizes[] = { 188, 1316, 65535, 188, 204, 3840, 188, 12000 };
+
+/* Block allocation as done without the block allocator caches */
+static void HeapRelease (block_t *block)
+{
+    free (block);
+}
+
+static block_t *HeapAlloc (size_t size)
+{
+    block_t *b = malloc (sizeof (*b) + 32 + 64 + size);
+    if (b == NULL)
+        return NULL;
+
+    block_Init (b, b + 1, 32 + 64 + size);
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer + 63) & ~31);
+    b->i_buffer = size;
+    b->pf_release = HeapRelease;
+    return b;
+}
+
+struct pair
+{
+    block_t *(*alloc) (size_t);
+    block_fifo_t *fifo;
+    vlc_sem_t     credits;
+};
+
+static void *Producer (void *data)
+{
+    struct pair *pair = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        size_t size = sizes[i % ARRAY_SIZE(sizes)];
+
+        vlc_sem_wait (&pair->credits);
+
+        block_t *block = pair->alloc (size);
+        assert (block != NULL);
+        block->p_buffer[0] = i;
+        block->p_buffer[size - 1] = i;
+        block_FifoPut (pair->fifo, block);
+    }
+    return NULL;
+}
+
+static void *Consumer (void *data)
+{
+    struct pair *pair = data;
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_FifoGet (pair->fifo);
+        size_t size = sizes[i % ARRAY_SIZE(sizes)];
+
+        assert (block->i_buffer == size);
+        assert (block->p_buffer[0] == (uint8_t)i);
+        assert (block->p_buffer[size - 1] == (uint8_t)i);
+        block_Release (block);
+        vlc_sem_post (&pair->credits);
+    }
+    return NULL;
+}
+
+static double Run (block_t *(*alloc) (size_t))
+{
+    struct pair pairs[PAIRS];
+    vlc_thread_t producers[PAIRS], consumers[PAIRS];
+
+    mtime_t start = mdate ();
+    for (unsigned i = 0; i < PAIRS; i++)
+    {
+        pairs[i].alloc = alloc;
+        pairs[i].fifo = block_FifoNew ();
+        assert (pairs[i].fifo != NULL);
+        vlc_sem_init (&pairs[i].credits, BACKLOG);
+
+        if (vlc_clone (&producers[i], Producer, &pairs[i],
+                       VLC_THREAD_PRIORITY_LOW)
+         || vlc_clone (&consumers[i], Consumer, &pairs[i],
+                       VLC_THREAD_PRIORITY_LOW))
+            abort ();
+    }
+
+    for (unsigned i = 0; i < PAIRS; i++)
+    {
+        vlc_join (producers[i], NULL);
+        vlc_join (consumers[i], NULL);
+        assert (block_FifoCount (pairs[i].fifo) == 0);
+        block_FifoRelease (pairs[i].fifo);
+        vlc_sem_destroy (&pairs[i].credits);
+    }
+    mtime_t duration = mdate () - start;
+
+    return (double)(PAIRS * BLOCKS) / duration; /* blocks per µs */
+}
+
+int main (void)
+{
+    block_stats_t stats;
+    double heap, cached;
+
+    heap = Run (HeapAlloc);
+    cached = Run (block_Alloc);
+    block_GetStats (&stats);
+
+    printf ("%u producer/consumer pairs, %u blocks each:\n", PAIRS, BLOCKS);
+    printf (" heap:        %6.2f Mblocks/s\n", heap);
+    printf (" block_Alloc: %6.2f Mblocks/s (%+.0f%%)\n", cached,
+            100. * (cached - heap) / heap);
+    printf (" %"PRIu64" allocations, %"PRIu64" from heap, "
+            "%"PRIu64" refills, %"PRIu64" flushes, %"PRIu64" cached\n",
+            stats.i_alloc, stats.i_heap, stats.i_refill, stats.i_flush,
+            stats.i_cached);
+
+    /* All thread caches are flushed on exit */
+    assert (stats.i_alloc >= PAIRS * BLOCKS);
+    assert (stats.i_heap < stats.i_alloc);
+    return 0;
+}
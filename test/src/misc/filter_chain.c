@@ -0,0 +1,192 @@
+/*****************************************************************************
+ * filter_chain.c: pipelined video filter chain test
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Runs the same pictures through a synchronous video filter chain and
+ * through pipelined ones of several depths, with a temporal filter, and
+ * checks that they give the same pictures in the same order. Then checks
+ * that the queues never exceed their depth, and that pictures still in the
+ * chain are released by a flush. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+#define FILTERS  "hqdn3d:invert:transform{type=vflip}:hqdn3d"
+#define PICTURES 60
+#define WIDTH    320
+#define HEIGHT   240
+
+typedef struct
+{
+    mtime_t  date;
+    uint32_t sum;
+} result_t;
+
+static picture_t *NewPicture (filter_t *filter)
+{
+    return picture_NewFromFormat (&filter->fmt_out.video);
+}
+
+static picture_t *RandomPicture (const video_format_t *fmt, unsigned n)
+{
+    picture_t *pic = picture_NewFromFormat (fmt);
+    assert (pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                p->p_pixels[y * p->i_pitch + x] = rand ();
+    }
+    pic->date = VLC_TS_0 + n * 40000;
+    return pic;
+}
+
+static uint32_t Checksum (const picture_t *pic)
+{
+    uint32_t sum = 0;
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                sum = sum * 31 + p->p_pixels[y * p->i_pitch + x];
+    }
+    return sum;
+}
+
+/* Only called by the thread of the last filter */
+static void Wake (void *data)
+{
+    unsigned *wakes = data;
+    (*wakes)++;
+}
+
+static unsigned Run (vlc_object_t *obj, unsigned depth, result_t *res)
+{
+    filter_owner_t owner = {
+        .video = {
+            .buffer_new = NewPicture,
+        },
+    };
+    es_format_t fmt;
+    unsigned count = 0, wakes = 0;
+
+    es_format_Init (&fmt, VIDEO_ES, VLC_CODEC_I420);
+    video_format_Setup (&fmt.video, VLC_CODEC_I420, WIDTH, HEIGHT,
+                        WIDTH, HEIGHT, 1, 1);
+
+    filter_chain_t *chain = filter_chain_NewVideo (obj, false, &owner);
+    assert (chain != NULL);
+    filter_chain_Reset (chain, &fmt, &fmt);
+    if (depth > 0)
+        filter_chain_SetPipeline (chain, depth, Wake, &wakes);
+    assert (filter_chain_AppendFromString (chain, FILTERS) == 4);
+
+    srand (42);
+    for (unsigned i = 0; i < PICTURES; i++)
+    {
+        picture_t *pic = RandomPicture (&fmt.video, i);
+
+        for (pic = filter_chain_VideoFilter (chain, pic); pic != NULL;
+             pic = filter_chain_VideoFilter (chain, NULL))
+        {
+            assert (count < PICTURES);
+            res[count].date = pic->date;
+            res[count].sum = Checksum (pic);
+            count++;
+            picture_Release (pic);
+        }
+    }
+
+    picture_t *pic;
+    while ((pic = filter_chain_VideoDrain (chain)) != NULL)
+    {
+        assert (count < PICTURES);
+        res[count].date = pic->date;
+        res[count].sum = Checksum (pic);
+        count++;
+        picture_Release (pic);
+    }
+
+    filter_chain_stats_t stats;
+    for (unsigned i = 0; filter_chain_GetStats (chain, i, &stats) == 0; i++)
+    {
+        printf (" depth %u, filter %u: %"PRIu64" pictures, %"PRId64" us"
+                " (max %"PRId64" us), up to %u queued\n", depth, i,
+                stats.pictures, stats.time, stats.time_max,
+                stats.queued_max);
+        assert (stats.pictures == PICTURES);
+        /* one more picture may wait for the first filter */
+        assert (stats.queued_max <= depth + (i == 0));
+    }
+
+    /* pictures still in the chain */
+    for (unsigned i = 0; i < 8; i++)
+    {
+        pic = filter_chain_VideoFilter (chain, RandomPicture (&fmt.video, i));
+        if (pic != NULL)
+            picture_Release (pic);
+    }
+    filter_chain_VideoFlush (chain);
+    assert (filter_chain_VideoDrain (chain) == NULL);
+
+    filter_chain_Delete (chain);
+    es_format_Clean (&fmt);
+    assert (depth == 0 || wakes > 0);
+    return count;
+}
+
+int main (void)
+{
+    static result_t ref[PICTURES], res[PICTURES];
+
+    test_init ();
+
+    libvlc_instance_t *vlc = libvlc_new (test_defaults_nargs,
+                                         test_defaults_args);
+    assert (vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    unsigned count = Run (obj, 0, ref);
+    assert (count == PICTURES);
+
+    for (unsigned depth = 1; depth <= 4; depth++)
+    {
+        memset (res, 0, sizeof (res));
+        assert (Run (obj, depth, res) == count);
+        for (unsigned i = 0; i < count; i++)
+        {
+            assert (res[i].date == ref[i].date);
+            assert (res[i].sum == ref[i].sum);
+        }
+    }
+
+    libvlc_release (vlc);
+    return 0;
+}
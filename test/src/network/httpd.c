@@ -0,0 +1,376 @@
+/*****************************************************************************
+ * httpd.c: HTTP server load generator
+ *****************************************************************************
+ * Copyright (C) 2026 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Usage: test_src_network_httpd [clients [seconds [threads [kbps]]]]
+ *
+ * Without arguments, checks what becomes of a client which does not read
+ * the stream for a while, with each of the backlog policies.
+ *
+ * With arguments, serves one HTTP stream and connects many local clients to
+ * it from a separate process, then reports the throughput of each client and
+ * the CPU time spent by the server for each connected client. */
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+
+#define CHUNK (7 * 188)
+
+/* Backlog checks: 24 MB in GOPs of 2 MB, far more than the 5 MB buffer */
+#define BLOCK      65536
+#define GOP_BLOCKS 32
+#define BLOCKS     (12 * GOP_BLOCKS)
+
+static unsigned port;
+
+typedef struct
+{
+    unsigned i_clients;     /* number of clients connected */
+    uint64_t i_min;         /* bytes received by the slowest client */
+    uint64_t i_max;         /* bytes received by the fastest client */
+    uint64_t i_total;       /* bytes received by all clients */
+} bench_result_t;
+
+/* Connects the clients and reads the stream until the deadline */
+static void RunClients (unsigned clients, unsigned seconds, int out)
+{
+    struct rlimit lim;
+    if (getrlimit (RLIMIT_NOFILE, &lim) == 0)
+    {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit (RLIMIT_NOFILE, &lim);
+    }
+
+    struct pollfd *ufd = calloc (clients, sizeof (*ufd));
+    uint64_t *bytes = calloc (clients, sizeof (*bytes));
+    assert (ufd != NULL && bytes != NULL);
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons (port),
+        .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+    };
+    static const char req[] = "GET /bench HTTP/1.0\r\n\r\n";
+    unsigned n = 0;
+
+    while (n < clients)
+    {
+        int fd = socket (AF_INET, SOCK_STREAM, 0);
+        if (fd == -1)
+            break;
+        if (connect (fd, (const struct sockaddr *)&addr, sizeof (addr))
+         || send (fd, req, sizeof (req) - 1, MSG_NOSIGNAL) < 0)
+        {
+            close (fd);
+            break;
+        }
+        ufd[n].fd = fd;
+        ufd[n].events = POLLIN;
+        n++;
+    }
+    if (n < clients)
+        fprintf (stderr, "only %u clients connected: %s\n", n,
+                 strerror (errno));
+
+    const mtime_t deadline = mdate () + seconds * CLOCK_FREQ;
+    static uint8_t buf[65536];
+
+    for (mtime_t now = mdate (); now < deadline; now = mdate ())
+    {
+        if (poll (ufd, n, (deadline - now) / 1000) <= 0)
+            continue;
+
+        for (unsigned i = 0; i < n; i++)
+            if (ufd[i].revents)
+            {
+                ssize_t val = recv (ufd[i].fd, buf, sizeof (buf),
+                                    MSG_DONTWAIT);
+                if (val > 0)
+                    bytes[i] += val;
+                else if (val == 0 || errno != EAGAIN)
+                    ufd[i].events = 0; /* disconnected */
+            }
+    }
+
+    bench_result_t res = { .i_clients = n, .i_min = UINT64_MAX };
+    for (unsigned i = 0; i < n; i++)
+    {
+        res.i_min = __MIN (res.i_min, bytes[i]);
+        res.i_max = __MAX (res.i_max, bytes[i]);
+        res.i_total += bytes[i];
+        close (ufd[i].fd);
+    }
+    if (n == 0)
+        res.i_min = 0;
+
+    if (write (out, &res, sizeof (res)) != sizeof (res))
+        abort ();
+    free (bytes);
+    free (ufd);
+}
+
+/* Finds a free TCP port for the server */
+static unsigned FreePort (void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof (addr);
+
+    int fd = socket (AF_INET, SOCK_STREAM, 0);
+    assert (fd != -1);
+    assert (bind (fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert (getsockname (fd, (struct sockaddr *)&addr, &len) == 0);
+    close (fd);
+    return ntohs (addr.sin_port);
+}
+
+static libvlc_instance_t *Start (const char *threads)
+{
+    char psz_port[32], psz_threads[32];
+    snprintf (psz_port, sizeof (psz_port), "--http-port=%u", port);
+    snprintf (psz_threads, sizeof (psz_threads), "--http-threads=%s",
+              threads);
+
+    const char *args[] = {
+        "--ignore-config", "-I", "dummy", "--no-media-library",
+        "--http-host=127.0.0.1", psz_port, psz_threads,
+    };
+
+    libvlc_instance_t *vlc = libvlc_new (ARRAY_SIZE(args), args);
+    assert (vlc != NULL);
+    return vlc;
+}
+
+/* Connects a client with a small receive buffer, which then waits until the
+ * whole stream is sent before reading it, and returns the bytes it got */
+static uint64_t RunSlowClient (httpd_host_t *host, const char *url,
+                               unsigned gops, int policy,
+                               httpd_stream_stats_t *stats, bool *eof)
+{
+    httpd_stream_t *stream = httpd_StreamNew (host, url,
+                                              "application/octet-stream",
+                                              NULL, NULL);
+    assert (stream != NULL);
+    httpd_StreamSetBacklog (stream, gops, policy);
+
+    const struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons (port),
+        .sin_addr.s_addr = htonl (INADDR_LOOPBACK),
+    };
+    char req[64];
+    int rcvbuf = 4096;
+
+    int fd = socket (AF_INET, SOCK_STREAM, 0);
+    assert (fd != -1);
+    setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+    assert (connect (fd, (const struct sockaddr *)&addr, sizeof (addr)) == 0);
+    snprintf (req, sizeof (req), "GET %s HTTP/1.0\r\n\r\n", url);
+    assert (send (fd, req, strlen (req), MSG_NOSIGNAL) > 0);
+
+    /* The client must start at the beginning of the stream */
+    do
+    {
+        msleep (CLOCK_FREQ / 100);
+        httpd_StreamGetStats (stream, stats);
+    }
+    while (stats->i_clients == 0);
+
+    for (unsigned i = 0; i < BLOCKS; i++)
+    {
+        block_t *block = block_Alloc (BLOCK);
+        assert (block != NULL);
+        memset (block->p_buffer, 0x47, BLOCK);
+        if (i % GOP_BLOCKS == 0)
+            block->i_flags |= BLOCK_FLAG_TYPE_I;
+        httpd_StreamSend (stream, block);
+        block_Release (block);
+    }
+
+    /* Read until the end or until nothing comes anymore */
+    struct pollfd ufd = { .fd = fd, .events = POLLIN };
+    static uint8_t buf[65536];
+    uint64_t bytes = 0;
+
+    *eof = false;
+    while (poll (&ufd, 1, 500) > 0)
+    {
+        ssize_t val = recv (fd, buf, sizeof (buf), 0);
+        if (val <= 0)
+        {
+            *eof = true;
+            break;
+        }
+        bytes += val;
+    }
+    close (fd);
+
+    httpd_StreamGetStats (stream, stats);
+    httpd_StreamDelete (stream);
+
+    log ("%s: %"PRIu64" of %u bytes, %"PRIu64" skip(s) of %"PRIu64" bytes, "
+         "%"PRIu64" disconnect(s)\n", url, bytes, BLOCKS * BLOCK,
+         stats->i_skips, stats->i_skipped, stats->i_disconnects);
+    return bytes;
+}
+
+static void CheckBacklog (void)
+{
+    libvlc_instance_t *vlc = Start ("0");
+    httpd_host_t *host = vlc_http_HostNew (VLC_OBJECT(vlc->p_libvlc_int));
+    assert (host != NULL);
+
+    httpd_stream_stats_t stats;
+    uint64_t bytes;
+    bool eof;
+
+    /* Dropped: the client goes on from the last keyframe */
+    bytes = RunSlowClient (host, "/drop", 1, HTTPD_BACKLOG_DROP,
+                           &stats, &eof);
+    assert (!eof);
+    assert (stats.i_clients == 1 && stats.i_disconnects == 0);
+    assert (stats.i_skips >= 1);
+    assert (bytes < BLOCKS * BLOCK);
+    assert (bytes > GOP_BLOCKS * BLOCK);
+
+    /* Disconnected */
+    bytes = RunSlowClient (host, "/disconnect", 1, HTTPD_BACKLOG_DISCONNECT,
+                           &stats, &eof);
+    assert (eof);
+    assert (stats.i_disconnects == 1 && stats.i_skips == 0);
+    assert (bytes < BLOCKS * BLOCK);
+
+    /* Throttled: all the GOPs are kept, the client gets the whole stream */
+    bytes = RunSlowClient (host, "/throttle", 16, HTTPD_BACKLOG_THROTTLE,
+                           &stats, &eof);
+    assert (!eof);
+    assert (stats.i_disconnects == 0 && stats.i_skips == 0);
+    assert (bytes > BLOCKS * BLOCK);
+
+    httpd_HostDelete (host);
+    libvlc_release (vlc);
+}
+
+static double CpuTime (void)
+{
+    struct rusage ru;
+
+    getrusage (RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+int main (int argc, char *argv[])
+{
+    test_init ();
+    port = FreePort ();
+
+    if (argc <= 1)
+    {
+        CheckBacklog ();
+        return 0;
+    }
+
+    unsigned clients = strtoul (argv[1], NULL, 0);
+    unsigned seconds = (argc > 2) ? strtoul (argv[2], NULL, 0) : 5;
+    const char *threads = (argc > 3) ? argv[3] : "0";
+    unsigned kbps = (argc > 4) ? strtoul (argv[4], NULL, 0) : 4000;
+
+    alarm (seconds + 10);
+
+    libvlc_instance_t *vlc = Start (threads);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    httpd_host_t *host = vlc_http_HostNew (obj);
+    assert (host != NULL);
+    httpd_stream_t *stream = httpd_StreamNew (host, "/bench",
+                                              "application/octet-stream",
+                                              NULL, NULL);
+    assert (stream != NULL);
+
+    int fds[2];
+    if (pipe (fds))
+        abort ();
+
+    pid_t pid = fork ();
+    assert (pid != -1);
+    if (pid == 0)
+    {
+        close (fds[0]);
+        RunClients (clients, seconds, fds[1]);
+        _exit (0);
+    }
+    close (fds[1]);
+
+    /* Feed the stream at the requested bit rate until the clients are done */
+    const mtime_t period = CLOCK_FREQ * CHUNK * 8 / (kbps * 1000);
+    const double start = CpuTime ();
+    mtime_t date = mdate ();
+    int status;
+
+    while (waitpid (pid, &status, WNOHANG) == 0)
+    {
+        block_t *block = block_Alloc (CHUNK);
+        assert (block != NULL);
+        memset (block->p_buffer, 0x47, CHUNK);
+        httpd_StreamSend (stream, block);
+        block_Release (block);
+
+        date += period;
+        mwait (date);
+    }
+
+    const double cpu = CpuTime () - start;
+    bench_result_t res;
+    if (read (fds[0], &res, sizeof (res)) != sizeof (res))
+        abort ();
+    close (fds[0]);
+
+    httpd_StreamDelete (stream);
+    httpd_HostDelete (host);
+    libvlc_release (vlc);
+
+    printf ("%u clients, %u s, %s thread(s), %u kbit/s stream:\n",
+            res.i_clients, seconds, threads, kbps);
+    printf (" per client: %7.1f kbit/s min, %7.1f avg, %7.1f max\n",
+            res.i_min * 8. / (seconds * 1000.),
+            res.i_clients ? res.i_total * 8. / (res.i_clients * seconds * 1000.)
+                          : 0.,
+            res.i_max * 8. / (seconds * 1000.));
+    printf (" server CPU: %.3f s, %.1f us/s per client\n", cpu,
+            res.i_clients ? cpu * 1e6 / (res.i_clients * seconds) : 0.);
+    return 0;
+}